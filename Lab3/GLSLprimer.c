@@ -154,6 +154,8 @@ int main(int argc, char *argv[]) {
 
 	// Create geometry for rendering
 	soupInit(&myShape); // Initialize all fields to zero
+	soupSetFormat(&myShape, VERTEX_PACKED16); // 16 bytes per vertex instead of 32
+	soupBuildLods(&myShape); // Fewer triangles when far away, made when first needed
 	soupCreateSphere(&myShape, 1.0, 200);
 	//soupReadOBJ(&myShape, MESHFILENAME);
 	soupPrintInfo(myShape);
@@ -168,6 +170,7 @@ int main(int argc, char *argv[]) {
 	location_P = glGetUniformLocation( programObject, "P" );
 	location_time = glGetUniformLocation( programObject, "time" );
 	location_tex = glGetUniformLocation( programObject, "tex" );
+	soupSetProgram(&myShape, programObject); // And the ones for the vertex format
 
     // Main loop
     while (!glfwWindowShouldClose(window))
@@ -215,6 +218,9 @@ int main(int argc, char *argv[]) {
 			glUniformMatrix4fv( location_P, 1, GL_FALSE, P );
 		}
 
+		// Upload the next larger mipmap level, if the texture is still streaming in
+		streamTexture(&texture);
+
         // Draw the scene
 		glEnable(GL_DEPTH_TEST); // Use the Z buffer
 		glEnable(GL_CULL_FACE);  // Use back face culling
@@ -223,7 +229,8 @@ int main(int argc, char *argv[]) {
 		//glPolygonMode( GL_FRONT, GL_LINE );
 		//glPolygonMode( GL_BACK, GL_LINE );
 
-		// Render the geometry
+		// Render the geometry, at the level of detail for its distance
+		soupSelectLod(&myShape, MV, P);
 		soupRender(myShape);
 
 		// Play nice and deactivate the shader program
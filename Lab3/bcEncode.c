@@ -0,0 +1,629 @@
+/*
+ * bcEncode.c - BC1, BC3, BC4 and BC5 block compression. See bcEncode.h.
+ *
+ * The pixels of a color block are kept as 16 floats for each of R, G
+ * and B, so that the distances of four pixels at a time to a palette
+ * color can be found in SSE2 registers. A channel block is 16 shorts,
+ * eight to a register.
+ *
+ * Each endpoint pair that is tried is scored by choosing the nearest
+ * palette entry for each pixel and adding up the squared errors. The
+ * encoder keeps the pair with the lowest score.
+ *
+ * This code is in the public domain.
+ */
+
+#include <stdlib.h> // For abs()
+#include <string.h> // For memset() and memcpy()
+#include <math.h>   // For sqrtf() and fabsf()
+#include <pthread.h> // For pthread_once()
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define BC_SIMD 1
+#endif
+
+#include "bcEncode.h"
+
+// Rows of blocks in each task
+#define BC_BAND_ROWS 4
+// Least squares fits of the endpoints to the indices for each quality
+#define BC_FITS_NORMAL 1
+#define BC_FITS_SLOW 4
+// Most passes of the endpoint search of BC_SLOW
+#define BC_SEARCH_PASSES 16
+
+/* The pixels of a block, as floats */
+typedef struct {
+	float c[3][16]; // R, G and B
+} colorBlock;
+
+/* Endpoints of a color block and how well they do */
+typedef struct {
+	int q[2][3];    // 5, 6 and 5 bits for R, G and B
+	float error;
+	unsigned char index[16];
+} colorFit;
+
+/* Endpoints of a channel block and how well they do */
+typedef struct {
+	int a0, a1;     // Eight values between them if a0 > a1, six and 0 and 255 if not
+	int error;
+	unsigned char index[16];
+} channelFit;
+
+/* One image being encoded */
+typedef struct {
+	unsigned char *dst;
+	const unsigned char *pixels;
+	int width, height, bpp, channel, format, quality;
+	int bw, bh;       // Blocks across and down
+	size_t blocksize; // Bytes per block
+} encodeJob;
+
+// For blocks of one color: the endpoints in 5 and 6 bits whose color at
+// index 2, a third of the way from the first, is the nearest to a value
+static unsigned char match5[256][2], match6[256][2];
+static pthread_once_t tablesOnce = PTHREAD_ONCE_INIT; // bcEncode() may run on several threads
+
+static int expand(int v, int bits) {
+	return (bits == 5) ? (v << 3) | (v >> 2) : (v << 2) | (v >> 4);
+}
+
+static void makeMatch(unsigned char match[256][2], int bits) {
+	int v, a, b, e, best, n = 1 << bits;
+
+	for(v = 0; v < 256; v++) {
+		best = 256;
+		for(a = 0; a < n; a++) {
+			for(b = 0; b < n; b++) {
+				e = abs((2 * expand(a, bits) + expand(b, bits) + 1) / 3 - v);
+				if(e < best) {
+					best = e;
+					match[v][0] = a;
+					match[v][1] = b;
+				}
+			}
+		}
+	}
+}
+
+static void makeTables(void) {
+	makeMatch(match5, 5);
+	makeMatch(match6, 6);
+}
+
+/* The four colors of the palette of endpoints q, in 0 to 255 */
+static void colorPalette(const int q[2][3], float palette[4][3]) {
+	float a, b;
+	int c;
+
+	for(c = 0; c < 3; c++) {
+		a = (float)expand(q[0][c], (c == 1) ? 6 : 5);
+		b = (float)expand(q[1][c], (c == 1) ? 6 : 5);
+		palette[0][c] = a;
+		palette[1][c] = b;
+		palette[2][c] = (2.0f * a + b) * (1.0f / 3.0f);
+		palette[3][c] = (a + 2.0f * b) * (1.0f / 3.0f);
+	}
+}
+
+/* Score the endpoints fit->q for block, filling in the rest of fit */
+static void scoreColors(const colorBlock *block, colorFit *fit) {
+	float palette[4][3];
+	int i, k;
+
+	colorPalette(fit->q, palette);
+#ifdef BC_SIMD
+	__m128 best, d, t, total = _mm_setzero_ps();
+	__m128i index, less;
+	float sum[4];
+	int found[4];
+
+	for(i = 0; i < 16; i += 4) {
+		best = _mm_set1_ps(1e30f);
+		index = _mm_setzero_si128();
+		for(k = 0; k < 4; k++) {
+			t = _mm_sub_ps(_mm_loadu_ps(block->c[0] + i), _mm_set1_ps(palette[k][0]));
+			d = _mm_mul_ps(t, t);
+			t = _mm_sub_ps(_mm_loadu_ps(block->c[1] + i), _mm_set1_ps(palette[k][1]));
+			d = _mm_add_ps(d, _mm_mul_ps(t, t));
+			t = _mm_sub_ps(_mm_loadu_ps(block->c[2] + i), _mm_set1_ps(palette[k][2]));
+			d = _mm_add_ps(d, _mm_mul_ps(t, t));
+			less = _mm_castps_si128(_mm_cmplt_ps(d, best));
+			best = _mm_min_ps(d, best);
+			index = _mm_or_si128(_mm_and_si128(less, _mm_set1_epi32(k)), _mm_andnot_si128(less, index));
+		}
+		total = _mm_add_ps(total, best);
+		_mm_storeu_si128((__m128i*)found, index);
+		for(k = 0; k < 4; k++) fit->index[i + k] = (unsigned char)found[k];
+	}
+	_mm_storeu_ps(sum, total);
+	fit->error = sum[0] + sum[1] + sum[2] + sum[3];
+#else
+	float best, d, t;
+	int c;
+
+	fit->error = 0.0f;
+	for(i = 0; i < 16; i++) {
+		best = 1e30f;
+		for(k = 0; k < 4; k++) {
+			for(c = 0, d = 0.0f; c < 3; c++) {
+				t = block->c[c][i] - palette[k][c];
+				d += t * t;
+			}
+			if(d < best) {
+				best = d;
+				fit->index[i] = k;
+			}
+		}
+		fit->error += best;
+	}
+#endif
+}
+
+/* Round endpoints in 0 to 255 to 5:6:5 */
+static void quantizeColors(float e[2][3], int q[2][3]) {
+	int i, c, top;
+
+	for(i = 0; i < 2; i++) {
+		for(c = 0; c < 3; c++) {
+			top = (c == 1) ? 63 : 31;
+			q[i][c] = (int)(e[i][c] * top / 255.0f + 0.5f);
+			q[i][c] = (q[i][c] < 0) ? 0 : (q[i][c] > top) ? top : q[i][c];
+		}
+	}
+}
+
+/*
+ * The endpoints with the least squared error for the indices of fit, in
+ * 0 to 255. Returns -1 if the indices do not tell them apart.
+ */
+static int fitColors(const colorBlock *block, const colorFit *fit, float e[2][3]) {
+	static const float along[4] = { 0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f };
+	float a = 0.0f, b = 0.0f, d = 0.0f, x0[3] = { 0.0f }, x1[3] = { 0.0f }, s, t, det;
+	int i, c;
+
+	for(i = 0; i < 16; i++) {
+		t = along[fit->index[i]];
+		s = 1.0f - t;
+		a += s * s;
+		b += s * t;
+		d += t * t;
+		for(c = 0; c < 3; c++) {
+			x0[c] += s * block->c[c][i];
+			x1[c] += t * block->c[c][i];
+		}
+	}
+	det = a * d - b * b;
+	if(fabsf(det) < 1e-6f) return -1;
+	for(c = 0; c < 3; c++) {
+		e[0][c] = (d * x0[c] - b * x1[c]) / det;
+		e[1][c] = (a * x1[c] - b * x0[c]) / det;
+		for(i = 0; i < 2; i++) e[i][c] = (e[i][c] < 0.0f) ? 0.0f : (e[i][c] > 255.0f) ? 255.0f : e[i][c];
+	}
+	return 0;
+}
+
+/*
+ * Store a BC1 block. The first color must be the larger one as 16 bits
+ * for the four color palette, so they are swapped if needed, and the
+ * indices with them. If they are the same, all indices are 0.
+ */
+static void writeColors(unsigned char *out, const colorFit *fit) {
+	unsigned int c0, c1, t, flip = 0, bits = 0;
+	int i;
+
+	c0 = (fit->q[0][0] << 11) | (fit->q[0][1] << 5) | fit->q[0][2];
+	c1 = (fit->q[1][0] << 11) | (fit->q[1][1] << 5) | fit->q[1][2];
+	if(c0 < c1) {
+		t = c0;
+		c0 = c1;
+		c1 = t;
+		flip = 1; // Index 0 and 1 swap, and 2 and 3
+	}
+	for(i = 0; i < 16 && c0 != c1; i++) bits |= (fit->index[i] ^ flip) << (2 * i);
+	out[0] = c0 & 255;
+	out[1] = c0 >> 8;
+	out[2] = c1 & 255;
+	out[3] = c1 >> 8;
+	for(i = 0; i < 4; i++) out[4 + i] = (bits >> (8 * i)) & 255;
+}
+
+static void encodeColors(unsigned char px[16][4], int quality, unsigned char *out) {
+	colorBlock block;
+	colorFit fit, trial;
+	float lo[3], hi[3], mean[3], cov[3][3], axis[3], v[3], e[2][3], d[3], t, tmin, tmax, len;
+	int i, c, k, widest, fits, pass, better;
+
+	for(c = 0; c < 3; c++) {
+		lo[c] = 255.0f;
+		hi[c] = mean[c] = 0.0f;
+		for(i = 0; i < 16; i++) {
+			block.c[c][i] = px[i][c];
+			lo[c] = (px[i][c] < lo[c]) ? px[i][c] : lo[c];
+			hi[c] = (px[i][c] > hi[c]) ? px[i][c] : hi[c];
+			mean[c] += px[i][c] * (1.0f / 16.0f);
+		}
+	}
+	if(lo[0] == hi[0] && lo[1] == hi[1] && lo[2] == hi[2]) { // One color
+		for(i = 0; i < 2; i++) {
+			fit.q[i][0] = match5[px[0][0]][i];
+			fit.q[i][1] = match6[px[0][1]][i];
+			fit.q[i][2] = match5[px[0][2]][i];
+		}
+		memset(fit.index, 2, 16);
+		writeColors(out, &fit);
+		return;
+	}
+	memset(cov, 0, sizeof(cov));
+	for(i = 0; i < 16; i++) {
+		for(c = 0; c < 3; c++) d[c] = block.c[c][i] - mean[c];
+		for(c = 0; c < 3; c++) {
+			for(k = 0; k < 3; k++) cov[c][k] += d[c] * d[k];
+		}
+	}
+
+	// The diagonal of the bounding box that the colors lie along: the
+	// channels that fall as the widest one rises go the other way
+	widest = (hi[1] - lo[1] > hi[0] - lo[0]) ? 1 : 0;
+	widest = (hi[2] - lo[2] > hi[widest] - lo[widest]) ? 2 : widest;
+	for(c = 0; c < 3; c++) {
+		e[0][c] = (cov[widest][c] < 0.0f) ? lo[c] : hi[c];
+		e[1][c] = (cov[widest][c] < 0.0f) ? hi[c] : lo[c];
+		axis[c] = e[0][c] - e[1][c];
+	}
+	if(quality == BC_FAST) {
+		// Moved in by 1/16 of the box, as the ends are rarely worth a color
+		for(c = 0; c < 3; c++) {
+			t = (e[0][c] - e[1][c]) * (1.0f / 16.0f);
+			e[0][c] -= t;
+			e[1][c] += t;
+		}
+	}
+	else {
+		// The principal axis, by power iteration from the diagonal, and
+		// the endpoints where the colors end along it
+		for(k = 0; k < 8; k++) {
+			for(c = 0; c < 3; c++) v[c] = cov[c][0] * axis[0] + cov[c][1] * axis[1] + cov[c][2] * axis[2];
+			len = fabsf(v[0]) > fabsf(v[1]) ? fabsf(v[0]) : fabsf(v[1]);
+			len = fabsf(v[2]) > len ? fabsf(v[2]) : len;
+			if(len == 0.0f) break;
+			for(c = 0; c < 3; c++) axis[c] = v[c] / len;
+		}
+		len = sqrtf(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+		for(c = 0; c < 3; c++) axis[c] /= len;
+		tmin = 1e30f;
+		tmax = -1e30f;
+		for(i = 0; i < 16; i++) {
+			for(c = 0, t = 0.0f; c < 3; c++) t += (block.c[c][i] - mean[c]) * axis[c];
+			tmin = (t < tmin) ? t : tmin;
+			tmax = (t > tmax) ? t : tmax;
+		}
+		for(c = 0; c < 3; c++) {
+			e[0][c] = mean[c] + tmax * axis[c];
+			e[1][c] = mean[c] + tmin * axis[c];
+			for(i = 0; i < 2; i++) e[i][c] = (e[i][c] < 0.0f) ? 0.0f : (e[i][c] > 255.0f) ? 255.0f : e[i][c];
+		}
+	}
+	quantizeColors(e, fit.q);
+	scoreColors(&block, &fit);
+
+	// Fit the endpoints to the indices, and choose the indices again
+	fits = (quality == BC_SLOW) ? BC_FITS_SLOW : (quality == BC_NORMAL) ? BC_FITS_NORMAL : 0;
+	for(k = 0; k < fits && fitColors(&block, &fit, e) == 0; k++) {
+		quantizeColors(e, trial.q);
+		if(memcmp(trial.q, fit.q, sizeof(fit.q)) == 0) break;
+		scoreColors(&block, &trial);
+		if(trial.error >= fit.error) break;
+		fit = trial;
+	}
+
+	// Try each endpoint one step up and down in each channel
+	for(pass = 0, better = (quality == BC_SLOW); better && pass < BC_SEARCH_PASSES; pass++) {
+		better = 0;
+		for(k = 0; k < 12; k++) {
+			memcpy(trial.q, fit.q, sizeof(fit.q));
+			c = (k / 2) % 3;
+			trial.q[k / 6][c] += (k & 1) ? 1 : -1;
+			if(trial.q[k / 6][c] < 0 || trial.q[k / 6][c] > ((c == 1) ? 63 : 31)) continue;
+			scoreColors(&block, &trial);
+			if(trial.error < fit.error) {
+				fit = trial;
+				better = 1;
+			}
+		}
+	}
+	writeColors(out, &fit);
+}
+
+/* The eight values of the palette of a0 and a1 */
+static void channelPalette(int a0, int a1, int palette[8]) {
+	int i;
+
+	palette[0] = a0;
+	palette[1] = a1;
+	if(a0 > a1) {
+		for(i = 1; i < 7; i++) palette[i + 1] = ((7 - i) * a0 + i * a1 + 3) / 7;
+	}
+	else {
+		for(i = 1; i < 5; i++) palette[i + 1] = ((5 - i) * a0 + i * a1 + 2) / 5;
+		palette[6] = 0;
+		palette[7] = 255;
+	}
+}
+
+/* Score the endpoints a0 and a1 for the values v, and keep them in fit if better */
+static void tryChannel(const short v[16], int a0, int a1, channelFit *fit) {
+	unsigned char index[16];
+	int palette[8], error, i, k;
+
+	channelPalette(a0, a1, palette);
+#ifdef BC_SIMD
+	const __m128i lo = _mm_loadu_si128((const __m128i*)v), hi = _mm_loadu_si128((const __m128i*)(v + 8));
+	__m128i bestlo = _mm_set1_epi16(0x7fff), besthi = bestlo;
+	__m128i indexlo = _mm_setzero_si128(), indexhi = indexlo, p, k8, d, less;
+	short found[16];
+	int sum[4];
+
+	for(k = 0; k < 8; k++) {
+		p = _mm_set1_epi16((short)palette[k]);
+		k8 = _mm_set1_epi16((short)k);
+		d = _mm_sub_epi16(lo, p);
+		d = _mm_max_epi16(d, _mm_sub_epi16(_mm_setzero_si128(), d));
+		less = _mm_cmplt_epi16(d, bestlo);
+		bestlo = _mm_min_epi16(d, bestlo);
+		indexlo = _mm_or_si128(_mm_and_si128(less, k8), _mm_andnot_si128(less, indexlo));
+		d = _mm_sub_epi16(hi, p);
+		d = _mm_max_epi16(d, _mm_sub_epi16(_mm_setzero_si128(), d));
+		less = _mm_cmplt_epi16(d, besthi);
+		besthi = _mm_min_epi16(d, besthi);
+		indexhi = _mm_or_si128(_mm_and_si128(less, k8), _mm_andnot_si128(less, indexhi));
+	}
+	_mm_storeu_si128((__m128i*)sum, _mm_add_epi32(_mm_madd_epi16(bestlo, bestlo), _mm_madd_epi16(besthi, besthi)));
+	error = sum[0] + sum[1] + sum[2] + sum[3];
+	if(error >= fit->error) return;
+	_mm_storeu_si128((__m128i*)found, indexlo);
+	_mm_storeu_si128((__m128i*)(found + 8), indexhi);
+	for(i = 0; i < 16; i++) index[i] = (unsigned char)found[i];
+#else
+	int best, d;
+
+	for(i = 0, error = 0; i < 16; i++) {
+		best = 1 << 30;
+		for(k = 0; k < 8; k++) {
+			d = (v[i] - palette[k]) * (v[i] - palette[k]);
+			if(d < best) {
+				best = d;
+				index[i] = k;
+			}
+		}
+		error += best;
+	}
+	if(error >= fit->error) return;
+#endif
+	fit->a0 = a0;
+	fit->a1 = a1;
+	fit->error = error;
+	memcpy(fit->index, index, 16);
+}
+
+/* Endpoints with eight values, a0 > a1, fit to the indices of fit by least squares */
+static int fitChannel(const short v[16], const channelFit *fit, int *a0, int *a1) {
+	float a = 0.0f, b = 0.0f, d = 0.0f, x0 = 0.0f, x1 = 0.0f, s, t, det, e0, e1;
+	int i, k;
+
+	for(i = 0; i < 16; i++) {
+		k = fit->index[i];
+		t = (k == 0) ? 0.0f : (k == 1) ? 1.0f : (k - 1) * (1.0f / 7.0f);
+		s = 1.0f - t;
+		a += s * s;
+		b += s * t;
+		d += t * t;
+		x0 += s * v[i];
+		x1 += t * v[i];
+	}
+	det = a * d - b * b;
+	if(fabsf(det) < 1e-6f) return -1;
+	e0 = (d * x0 - b * x1) / det;
+	e1 = (a * x1 - b * x0) / det;
+	*a0 = (e0 < 0.0f) ? 0 : (e0 > 255.0f) ? 255 : (int)(e0 + 0.5f);
+	*a1 = (e1 < 0.0f) ? 0 : (e1 > 255.0f) ? 255 : (int)(e1 + 0.5f);
+	return (*a0 > *a1) ? 0 : -1;
+}
+
+static void writeChannel(unsigned char *out, const channelFit *fit) {
+	unsigned long long bits = 0;
+	int i;
+
+	for(i = 0; i < 16; i++) bits |= (unsigned long long)fit->index[i] << (3 * i);
+	out[0] = fit->a0;
+	out[1] = fit->a1;
+	for(i = 0; i < 6; i++) out[2 + i] = (bits >> (8 * i)) & 255;
+}
+
+/* A BC4 block for channel c of the pixels */
+static void encodeChannel(unsigned char px[16][4], int c, int quality, unsigned char *out) {
+	channelFit fit;
+	short v[16];
+	int lo = 255, hi = 0, lo6 = 255, hi6 = 0, a0, a1, k, pass, better, error;
+
+	for(k = 0; k < 16; k++) {
+		v[k] = px[k][c];
+		lo = (v[k] < lo) ? v[k] : lo;
+		hi = (v[k] > hi) ? v[k] : hi;
+		if(v[k] != 0 && v[k] != 255) { // The extremes of the rest, for six values
+			lo6 = (v[k] < lo6) ? v[k] : lo6;
+			hi6 = (v[k] > hi6) ? v[k] : hi6;
+		}
+	}
+	fit.error = 1 << 30;
+	if(lo == hi) {
+		tryChannel(v, lo, lo, &fit);
+		writeChannel(out, &fit);
+		return;
+	}
+	tryChannel(v, hi, lo, &fit);
+	if(quality >= BC_NORMAL) {
+		if(lo6 <= hi6) tryChannel(v, lo6, hi6, &fit);
+		for(k = 0; k < ((quality == BC_SLOW) ? BC_FITS_SLOW : BC_FITS_NORMAL); k++) {
+			if(fit.a0 <= fit.a1 || fitChannel(v, &fit, &a0, &a1) != 0) break;
+			if(a0 == fit.a0 && a1 == fit.a1) break;
+			tryChannel(v, a0, a1, &fit);
+		}
+	}
+	// Try each endpoint one step up and down, in the same mode
+	for(pass = 0, better = (quality == BC_SLOW); better && pass < BC_SEARCH_PASSES; pass++) {
+		error = fit.error;
+		for(k = 0; k < 4; k++) {
+			a0 = fit.a0 + ((k == 0) ? 1 : (k == 1) ? -1 : 0);
+			a1 = fit.a1 + ((k == 2) ? 1 : (k == 3) ? -1 : 0);
+			if(a0 < 0 || a0 > 255 || a1 < 0 || a1 > 255 || (a0 > a1) != (fit.a0 > fit.a1)) continue;
+			tryChannel(v, a0, a1, &fit);
+		}
+		better = (fit.error < error);
+	}
+	writeChannel(out, &fit);
+}
+
+/* The pixels of block (bx, by), with the last row and column repeated past the edges */
+static void fetchBlock(const encodeJob *job, int bx, int by, unsigned char px[16][4]) {
+	const unsigned char *p;
+	int x, y, sx, sy, c;
+
+	for(y = 0; y < 4; y++) {
+		sy = (4 * by + y < job->height) ? 4 * by + y : job->height - 1;
+		for(x = 0; x < 4; x++) {
+			sx = (4 * bx + x < job->width) ? 4 * bx + x : job->width - 1;
+			p = job->pixels + ((size_t)sy * job->width + sx) * job->bpp;
+			for(c = 0; c < 4; c++) px[4 * y + x][c] = (c < job->bpp) ? p[c] : 255;
+		}
+	}
+}
+
+static void bandTask(void *arg, int index, int thread) {
+	encodeJob *job = (encodeJob*)arg;
+	unsigned char px[16][4], *out;
+	int bx, by, by1 = (index + 1) * BC_BAND_ROWS;
+
+	if(by1 > job->bh) by1 = job->bh;
+	for(by = index * BC_BAND_ROWS; by < by1; by++) {
+		out = job->dst + (size_t)by * job->bw * job->blocksize;
+		for(bx = 0; bx < job->bw; bx++, out += job->blocksize) {
+			fetchBlock(job, bx, by, px);
+			if(job->format == BC1) encodeColors(px, job->quality, out);
+			else if(job->format == BC3) {
+				encodeChannel(px, 3, job->quality, out);
+				encodeColors(px, job->quality, out + 8);
+			}
+			else if(job->format == BC4) encodeChannel(px, job->channel, job->quality, out);
+			else {
+				encodeChannel(px, job->channel, job->quality, out);
+				encodeChannel(px, job->channel + 1, job->quality, out + 8);
+			}
+		}
+	}
+}
+
+static size_t blockSize(int format) {
+	return (format == BC1 || format == BC4) ? 8 : 16;
+}
+
+size_t bcSize(int format, int width, int height) {
+	return blockSize(format) * ((width + 3) / 4) * ((height + 3) / 4);
+}
+
+int bcEncode(unsigned char *dst, const unsigned char *pixels, int width, int height, int bpp,
+	int channel, int format, int quality, noisePool *pool) {
+	encodeJob job;
+
+	if(dst == NULL || pixels == NULL || width <= 0 || height <= 0 || bpp < 1 || bpp > 4
+		|| quality < BC_FAST || quality > BC_SLOW) return -1;
+	if(((format == BC1 || format == BC3) && bpp < 3) || (format == BC4 && (channel < 0 || channel >= bpp))
+		|| (format == BC5 && (channel < 0 || channel + 1 >= bpp))
+		|| (format != BC1 && format != BC3 && format != BC4 && format != BC5)) return -1;
+	pthread_once(&tablesOnce, makeTables);
+
+	job.dst = dst;
+	job.pixels = pixels;
+	job.width = width;
+	job.height = height;
+	job.bpp = bpp;
+	job.channel = channel;
+	job.format = format;
+	job.quality = quality;
+	job.bw = (width + 3) / 4;
+	job.bh = (height + 3) / 4;
+	job.blocksize = blockSize(format);
+	noisePoolFor(pool, (job.bh + BC_BAND_ROWS - 1) / BC_BAND_ROWS, bandTask, &job);
+	return 0;
+}
+
+/* The 16 pixels of a BC1 block, to bytes 0 to 2 of each */
+static void decodeColors(const unsigned char *in, unsigned char px[16][4]) {
+	int c0 = in[0] | (in[1] << 8), c1 = in[2] | (in[3] << 8), palette[4][3], a, b, c, i;
+
+	for(c = 0; c < 3; c++) {
+		a = expand((c0 >> ((c == 0) ? 11 : (c == 1) ? 5 : 0)) & ((c == 1) ? 63 : 31), (c == 1) ? 6 : 5);
+		b = expand((c1 >> ((c == 0) ? 11 : (c == 1) ? 5 : 0)) & ((c == 1) ? 63 : 31), (c == 1) ? 6 : 5);
+		palette[0][c] = a;
+		palette[1][c] = b;
+		palette[2][c] = (c0 > c1) ? (2 * a + b + 1) / 3 : (a + b + 1) / 2;
+		palette[3][c] = (c0 > c1) ? (a + 2 * b + 1) / 3 : 0;
+	}
+	for(i = 0; i < 16; i++) {
+		for(c = 0; c < 3; c++) px[i][c] = palette[(in[4 + i / 4] >> (2 * (i % 4))) & 3][c];
+	}
+}
+
+/* The 16 values of a BC4 block, to byte c of each pixel */
+static void decodeChannel(const unsigned char *in, unsigned char px[16][4], int c) {
+	unsigned long long bits = 0;
+	int palette[8], i;
+
+	channelPalette(in[0], in[1], palette);
+	for(i = 0; i < 6; i++) bits |= (unsigned long long)in[2 + i] << (8 * i);
+	for(i = 0; i < 16; i++) px[i][c] = palette[(bits >> (3 * i)) & 7];
+}
+
+void bcDecode(unsigned char *pixels, const unsigned char *blocks, int width, int height, int format) {
+	unsigned char px[16][4];
+	size_t blocksize = blockSize(format);
+	int bx, by, x, y;
+
+	for(by = 0; by < (height + 3) / 4; by++) {
+		for(bx = 0; bx < (width + 3) / 4; bx++, blocks += blocksize) {
+			memset(px, 0, sizeof(px));
+			for(x = 0; x < 16; x++) px[x][3] = 255;
+			if(format == BC1) decodeColors(blocks, px);
+			else if(format == BC3) {
+				decodeChannel(blocks, px, 3);
+				decodeColors(blocks + 8, px);
+			}
+			else if(format == BC4) decodeChannel(blocks, px, 0);
+			else if(format == BC5) {
+				decodeChannel(blocks, px, 0);
+				decodeChannel(blocks + 8, px, 1);
+			}
+			for(y = 0; y < 4 && 4 * by + y < height; y++) {
+				for(x = 0; x < 4 && 4 * bx + x < width; x++)
+					memcpy(pixels + 4 * ((size_t)(4 * by + y) * width + 4 * bx + x), px[4 * y + x], 4);
+			}
+		}
+	}
+}
+
+const char *bcFormatName(int format) {
+	if(format == BC1) return "BC1";
+	if(format == BC3) return "BC3";
+	if(format == BC4) return "BC4";
+	if(format == BC5) return "BC5";
+	return "unknown";
+}
+
+const char *bcQualityName(int quality) {
+	if(quality == BC_FAST) return "fast";
+	if(quality == BC_NORMAL) return "normal";
+	if(quality == BC_SLOW) return "slow";
+	return "unknown";
+}
@@ -0,0 +1,86 @@
+/*
+ * bcEncode.h - block compression of 8 bit images to the BC formats that
+ * OpenGL takes as compressed textures, on the CPU, without OpenGL
+ * dependencies. Used by texCook() (texCook.h) for createTexture().
+ *
+ * The image is split into blocks of 4 x 4 pixels, padded at the edges
+ * with copies of the last row and column, and each block is stored in
+ * 8 or 16 bytes:
+ *
+ * BC1  8 bytes, RGB (GL_COMPRESSED_RGB_S3TC_DXT1_EXT). Two colors of 16
+ *      bits, 5:6:5, and a 2 bit index for each pixel into those two and
+ *      the two colors between them. Opaque only.
+ * BC3  16 bytes, RGBA (GL_COMPRESSED_RGBA_S3TC_DXT5_EXT). A BC4 block
+ *      for the alpha and a BC1 block for the color.
+ * BC4  8 bytes, one channel (GL_COMPRESSED_RED_RGTC1). Two values of 8
+ *      bits and a 3 bit index for each pixel into those two and the six
+ *      between them, or the four between them and 0 and 255. Good for a
+ *      height map such as the one in the alpha of the texture for
+ *      vertexshader.glsl.
+ * BC5  16 bytes, two channels (GL_COMPRESSED_RG_RGTC2). Two BC4 blocks,
+ *      as for the X and Y of a normal map, with Z made in the shader.
+ *
+ * The quality sets how hard the encoder looks for the two endpoints of
+ * each block:
+ *
+ * BC_FAST    the corners of the bounding box of the colors, moved in a
+ *            little, and the extremes of a channel.
+ * BC_NORMAL  the principal axis of the colors, then a least squares fit
+ *            of the endpoints to the indices. For channels, also the
+ *            mode with 0 and 255, where that fits better.
+ * BC_SLOW    as BC_NORMAL, with more fitting, and then a search around
+ *            the endpoints, step by step, as long as the error drops.
+ *
+ * Errors are sums of squares in the stored values, the same as PSNR
+ * measures. The nearest palette entries for a block are found with SSE2
+ * where the compiler has it, and the rows of blocks are split into bands
+ * that run in parallel on a noisePool (cpuNoisePool.c).
+ *
+ * This code is in the public domain.
+ */
+
+#ifndef BCENCODE_H
+#define BCENCODE_H
+
+#include <stddef.h> // For size_t
+
+#include "threadPool.h" // For noisePool
+
+/* Block formats, see above */
+#define BC1 1
+#define BC3 3
+#define BC4 4
+#define BC5 5
+
+/* Qualities, see above */
+#define BC_FAST 0
+#define BC_NORMAL 1
+#define BC_SLOW 2
+
+/* bcSize() - the bytes of an image of width x height pixels in format */
+size_t bcSize(int format, int width, int height);
+
+/*
+ * bcEncode() - compress the image of width x height pixels of bpp bytes
+ * (1 to 4) to format, with quality, to bcSize() bytes at dst, using the
+ * threads of pool, which may be NULL. BC1 takes the first three bytes of
+ * each pixel as RGB, and BC3 also the fourth as alpha, or 255 if there
+ * is none, so both need 3 or 4 bytes. BC4 takes the byte channel of each
+ * pixel, and BC5 that and the next one. Returns 0, or -1 for bad
+ * arguments.
+ */
+int bcEncode(unsigned char *dst, const unsigned char *pixels, int width, int height, int bpp,
+	int channel, int format, int quality, noisePool *pool);
+
+/*
+ * bcDecode() - expand the blocks of an image of width x height pixels
+ * in format to RGBA at pixels, 4 bytes per pixel, as OpenGL reads them:
+ * BC4 to (R, 0, 0, 255), BC5 to (R, G, 0, 255), and BC1 with alpha 255.
+ */
+void bcDecode(unsigned char *pixels, const unsigned char *blocks, int width, int height, int format);
+
+/* bcFormatName(), bcQualityName() - printable names */
+const char *bcFormatName(int format);
+const char *bcQualityName(int quality);
+
+#endif /* BCENCODE_H */
@@ -0,0 +1,193 @@
+/*
+ * bcbench.c - time the block compression of bcEncode.c and measure how
+ * much it loses.
+ *
+ * Each image is compressed to BC1 (its RGB), BC3 (RGBA), BC4 (its height
+ * channel: alpha if it has one, or green) and BC5 (a normal map made from
+ * that height) with each quality. The time of each is shown in million
+ * texels per second, and the PSNR of the decoded blocks against what was
+ * compressed, over the channels that the format keeps, in dB.
+ *
+ * Usage: bcbench [threads [size [file.tga ...]]]
+ * The default is one thread per CPU, a size of 8192 for the painted test
+ * image, and textures/pyramid.tga. A size of 0 leaves the test image out.
+ *
+ * This code is in the public domain.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "bench.h"
+#include "bcEncode.h"
+#include "tgaDecode.h"
+#include "threadPool.h"
+
+#define TEST_SIZE 8192
+#define TEST_FILE "textures/pyramid.tga"
+
+static const int formats[] = { BC1, BC3, BC4, BC5 };
+
+/* A TGA file as RGB(A), or NULL */
+static unsigned char *loadImage(const char *filename, int *width, int *height, int *bpp) {
+	unsigned char *pixels;
+	tgaImage image;
+
+	if(tgaOpen(&image, filename) != 0) return NULL;
+	pixels = (unsigned char*)malloc((size_t)image.width * image.height * image.bpp);
+	if(pixels != NULL && tgaReadRows(&image, pixels, image.height) != image.height) {
+		free(pixels);
+		pixels = NULL;
+	}
+	*width = image.width;
+	*height = image.height;
+	*bpp = image.bpp;
+	tgaClose(&image);
+	return pixels;
+}
+
+/*
+ * Smooth color gradients, a grid of hard edged tiles, fine noise, and a
+ * height in alpha of rounded hills with noise on top
+ */
+static unsigned char *makeImage(int size) {
+	unsigned char *image = (unsigned char*)malloc((size_t)size * size * 4), *p;
+	unsigned int seed = 1;
+	int x, y, c, tile;
+	float u, v, h;
+
+	if(image == NULL) return NULL;
+	for(y = 0; y < size; y++) {
+		for(x = 0; x < size; x++) {
+			p = image + 4 * ((size_t)y * size + x);
+			u = (float)x / size;
+			v = (float)y / size;
+			seed = seed * 1664525u + 1013904223u;
+			tile = ((x >> 7) ^ (y >> 7)) & 1;
+			for(c = 0; c < 3; c++) {
+				h = 127.5f + 90.0f * sinf(6.2832f * ((c + 1) * u + (3 - c) * v)) + (float)(seed >> 29);
+				p[c] = (unsigned char)(tile ? h : 255.0f - h);
+			}
+			h = 0.5f + 0.25f * sinf(25.0f * u) * sinf(19.0f * v) + 0.2f * u;
+			p[3] = (unsigned char)(235.0f * h + (float)(seed >> 28));
+		}
+	}
+	return image;
+}
+
+/* The X and Y of the normals of the height in channel c, as two bytes per pixel */
+static unsigned char *makeNormals(const unsigned char *image, int width, int height, int bpp, int c) {
+	unsigned char *normals = (unsigned char*)malloc((size_t)width * height * 2), *n;
+	float dx, dy, len;
+	int x, y;
+
+	if(normals == NULL) return NULL;
+	for(y = 0; y < height; y++) {
+		for(x = 0; x < width; x++) {
+			n = normals + 2 * ((size_t)y * width + x);
+			dx = (float)image[((size_t)y * width + (x + 1) % width) * bpp + c]
+				- image[((size_t)y * width + (x + width - 1) % width) * bpp + c];
+			dy = (float)image[((size_t)((y + 1) % height) * width + x) * bpp + c]
+				- image[((size_t)((y + height - 1) % height) * width + x) * bpp + c];
+			len = sqrtf(dx * dx + dy * dy + 64.0f * 64.0f);
+			n[0] = (unsigned char)(127.5f - 127.5f * dx / len);
+			n[1] = (unsigned char)(127.5f - 127.5f * dy / len);
+		}
+	}
+	return normals;
+}
+
+/*
+ * PSNR of the first count channels of the decoded RGBA against channels
+ * first to first + count - 1 of pixels
+ */
+static double psnr(const unsigned char *decoded, const unsigned char *pixels, size_t npixels, int bpp,
+	int first, int count) {
+	double sum = 0.0, d;
+	size_t i;
+	int c;
+
+	for(i = 0; i < npixels; i++) {
+		for(c = 0; c < count; c++) {
+			d = (double)decoded[4 * i + c] - pixels[i * bpp + first + c];
+			sum += d * d;
+		}
+	}
+	if(sum == 0.0) return 99.0;
+	return 10.0 * log10(255.0 * 255.0 * npixels * count / sum);
+}
+
+static void bench(const char *name, const unsigned char *pixels, int width, int height, int bpp,
+	noisePool *pool) {
+	int height_channel = (bpp == 4) ? 3 : 1, i, quality, format, first, count;
+	unsigned char *normals = makeNormals(pixels, width, height, bpp, height_channel);
+	unsigned char *blocks = (unsigned char*)malloc(bcSize(BC3, width, height));
+	unsigned char *decoded = (unsigned char*)malloc((size_t)width * height * 4);
+	const unsigned char *source;
+	int sourcebpp;
+	double t;
+
+	printf("\n%s, %d x %d, %d bytes per pixel:\n", name, width, height, bpp);
+	if(normals == NULL || blocks == NULL || decoded == NULL) {
+		printf("  Out of memory\n");
+		free(normals);
+		free(blocks);
+		free(decoded);
+		return;
+	}
+	for(i = 0; i < 4; i++) {
+		format = formats[i];
+		// What is compressed, and where that is in the pixels and in the decoded RGBA
+		source = (format == BC5) ? normals : pixels;
+		sourcebpp = (format == BC5) ? 2 : bpp;
+		first = (format == BC4) ? height_channel : 0;
+		count = (format == BC1) ? 3 : (format == BC3) ? bpp : (format == BC4) ? 1 : 2;
+		for(quality = BC_FAST; quality <= BC_SLOW; quality++) {
+			t = seconds();
+			if(bcEncode(blocks, source, width, height, sourcebpp, first, format, quality, pool) != 0) {
+				printf("  %s failed\n", bcFormatName(format));
+				break;
+			}
+			t = seconds() - t;
+			bcDecode(decoded, blocks, width, height, format);
+			printf("  %s %-7s %8.1f ms, %7.1f Mtexels/s, PSNR %5.2f dB%s\n", bcFormatName(format),
+				bcQualityName(quality), 1e3 * t, 1e-6 * width * height / t,
+				psnr(decoded, source, (size_t)width * height, sourcebpp, first, count),
+				(format == BC4) ? ", height" : (format == BC5) ? ", normals" : "");
+		}
+	}
+	free(normals);
+	free(blocks);
+	free(decoded);
+}
+
+int main(int argc, char *argv[]) {
+	noisePool *pool = noisePoolCreate((argc > 1) ? atoi(argv[1]) : 0);
+	int size = (argc > 2) ? atoi(argv[2]) : TEST_SIZE, width, height, bpp, i;
+	unsigned char *pixels;
+
+	if(pool == NULL) {
+		printf("Could not start the threads.\n");
+		return 1;
+	}
+	printf("%d threads\n", noisePoolThreads(pool));
+	for(i = (argc > 3) ? 3 : 0; i < ((argc > 3) ? argc : 1); i++) {
+		if((pixels = loadImage((argc > 3) ? argv[i] : TEST_FILE, &width, &height, &bpp)) == NULL) {
+			printf("\nCould not load %s\n", (argc > 3) ? argv[i] : TEST_FILE);
+			continue;
+		}
+		bench((argc > 3) ? argv[i] : TEST_FILE, pixels, width, height, bpp, pool);
+		free(pixels);
+	}
+	if(size > 0) {
+		if((pixels = makeImage(size)) == NULL) printf("\nNo memory for the test image\n");
+		else {
+			bench("Test image", pixels, size, size, 4, pool);
+			free(pixels);
+		}
+	}
+	noisePoolDestroy(pool);
+	return 0;
+}
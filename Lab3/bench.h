@@ -0,0 +1,38 @@
+/*
+ * bench.h - what the *bench.c programs share: a wall clock timer and the
+ * meshes they run on when no files are given.
+ *
+ * This code is in the public domain.
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+/* The meshes used by the mesh benchmarks, smallest first */
+#define BENCH_MESHES \
+	"meshes/cube.obj", "meshes/teapot_coarse.obj", "meshes/pyramid.obj", \
+	"meshes/teapot.obj", "meshes/trex.obj"
+
+/*
+ * seconds() - a monotonic wall clock time in seconds, for timing intervals
+ */
+static inline double seconds(void) {
+#ifdef _WIN32
+	LARGE_INTEGER t, f;
+	QueryPerformanceCounter(&t);
+	QueryPerformanceFrequency(&f);
+	return (double)t.QuadPart / (double)f.QuadPart;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + 1e-9 * ts.tv_nsec;
+#endif
+}
+
+#endif /* BENCH_H */
@@ -0,0 +1,839 @@
+/*
+ * bvh.c - a bounding volume hierarchy over the triangles of a mesh, see
+ * bvh.h for how to use it.
+ *
+ * The builder sorts the triangle centroids of a node into BVH_BINS bins
+ * along each axis, and for each plane between two bins estimates the
+ * cost of splitting the node there as
+ *   1 + (A_left * N_left + A_right * N_right) / A
+ * where the A are surface areas of boxes and the N numbers of triangles:
+ * a ray that hits a box of area A hits a box inside it with a chance of
+ * about A_child / A, and then tests its N_child triangles. A node costs
+ * as much as a triangle. The cheapest plane is used, unless a leaf, which
+ * costs N, is cheaper and small enough. Below BVH_MEDIAN_DEPTH, nodes are
+ * split at the median instead, which keeps the tree shallow enough for
+ * the fixed traversal stacks even for the worst meshes.
+ *
+ * With a pool, the top of the tree is built by one thread until the
+ * nodes are small enough, and each of those is then built as a task of
+ * its own. A subtree of n triangles has at most 2n - 1 nodes, so each
+ * task gets that many nodes reserved, and the holes that are left are
+ * squeezed out at the end.
+ *
+ * Rays are tested against boxes with the slab test, and against
+ * triangles with the Moller-Trumbore test, for which the triangles are
+ * stored as one corner and two edges, in the order of the leaves. The
+ * children of a node are visited nearest first, and a node is skipped
+ * when it is further away than the closest hit so far.
+ *
+ * This code is in the public domain.
+ */
+
+#include <stdlib.h> // For malloc() and free()
+#include <string.h> // For memset()
+#include <float.h>  // For FLT_MAX
+#include <math.h>   // For fabsf()
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define BVH_SIMD 1
+#endif
+
+#include "bvh.h"
+
+// Depth from which nodes are split at the median, and the size of the
+// traversal stacks, which must be larger than the depth of any tree
+#define BVH_MEDIAN_DEPTH 64
+#define BVH_STACK 128
+// Fewest triangles in a subtree that is built as a task of its own
+#define BVH_TASK_MIN 1024
+// Rays per task for the batch functions, a multiple of 4
+#define BVH_RAY_CHUNK 1024
+
+typedef struct {
+	float lo[3], hi[3];
+} box;
+
+/* A part of the tree that is left for a task of its own */
+typedef struct {
+	int node, first, count, depth;
+	int next; // The first of the nodes reserved for it
+} subtree;
+
+typedef struct {
+	bvhNode *nodes;
+	const box *bounds;     // Of each triangle
+	const float *centroids; // 3 per triangle
+	unsigned int *index;   // Triangle numbers, in the order of the leaves
+	subtree *tasks;        // Parts that are left for tasks
+	int ntasks, maxtasks;
+	int tasksize;          // Most triangles in such a part, or 0 to build all
+} builder;
+
+/* What the rays of a batch should find */
+enum { RAYS_CLOSEST, RAYS_ANY, RAYS_PACKETS };
+
+typedef struct {
+	const bvh *tree;
+	const bvhRay *rays;
+	bvhHit *hits;
+	unsigned char *occluded;
+	int nrays, mode;
+} rayJob;
+
+static void boxEmpty(box *b) {
+	b->lo[0] = b->lo[1] = b->lo[2] = FLT_MAX;
+	b->hi[0] = b->hi[1] = b->hi[2] = -FLT_MAX;
+}
+
+static void boxGrow(box *b, const box *a) {
+	int k;
+	for(k = 0; k < 3; k++) {
+		if(a->lo[k] < b->lo[k]) b->lo[k] = a->lo[k];
+		if(a->hi[k] > b->hi[k]) b->hi[k] = a->hi[k];
+	}
+}
+
+static void boxGrowPoint(box *b, const float *p) {
+	int k;
+	for(k = 0; k < 3; k++) {
+		if(p[k] < b->lo[k]) b->lo[k] = p[k];
+		if(p[k] > b->hi[k]) b->hi[k] = p[k];
+	}
+}
+
+/* Surface area, 0 for an empty box */
+static float boxArea(const float *lo, const float *hi) {
+	float dx = hi[0] - lo[0], dy = hi[1] - lo[1], dz = hi[2] - lo[2];
+	if(dx < 0.0f) return 0.0f;
+	return 2.0f * (dx * dy + dy * dz + dz * dx);
+}
+
+/* Reorder index[lo .. hi] so that entry nth has the centroid it would
+   have if they were sorted along axis, with none larger before it and
+   none smaller after it (Hoare's selection) */
+static void selectNth(const float *centroids, unsigned int *index, int lo, int hi, int nth, int axis) {
+	unsigned int t;
+	float pivot;
+	int i, j;
+
+	while(hi > lo) {
+		pivot = centroids[3 * index[(lo + hi) / 2] + axis];
+		i = lo;
+		j = hi;
+		while(i <= j) {
+			while(centroids[3 * index[i] + axis] < pivot) i++;
+			while(centroids[3 * index[j] + axis] > pivot) j--;
+			if(i <= j) {
+				t = index[i];
+				index[i++] = index[j];
+				index[j--] = t;
+			}
+		}
+		if(nth <= j) hi = j;
+		else if(nth >= i) lo = i;
+		else break;
+	}
+}
+
+/* The bin of centroid c along an axis with the centroids from lo on */
+static int binOf(float c, float lo, float scale) {
+	int bin = (int)((c - lo) * scale);
+	if(bin < 0) return 0;
+	return (bin < BVH_BINS) ? bin : BVH_BINS - 1;
+}
+
+/*
+ * buildNode() - make node the root of a subtree over the triangles
+ * index[first .. first + count - 1], taking new nodes from *next. If
+ * b->tasksize is not 0, parts of at most b->tasksize triangles are left
+ * for tasks instead. Returns 0, or -1 if out of memory.
+ */
+static int buildNode(builder *b, int node, int first, int count, int depth, int *next) {
+	box bounds, cbounds, bins[3][BVH_BINS], left, right;
+	int bincount[3][BVH_BINS], leftcount[BVH_BINS], nright, i, j, k, axis = -1, split = 0, mid;
+	float scale[3], leftcost[BVH_BINS], area, cost, best = FLT_MAX, extent;
+	bvhNode *n = &b->nodes[node];
+	subtree *s;
+	unsigned int t;
+
+	if(b->tasksize > 0 && count <= b->tasksize) {
+		if(b->ntasks == b->maxtasks) {
+			b->maxtasks = b->maxtasks ? 2 * b->maxtasks : 64;
+			s = (subtree*)realloc(b->tasks, b->maxtasks * sizeof(subtree));
+			if(s == NULL) return -1;
+			b->tasks = s;
+		}
+		s = &b->tasks[b->ntasks++];
+		s->node = node;
+		s->first = first;
+		s->count = count;
+		s->depth = depth;
+		s->next = *next;
+		*next += 2 * count - 2;
+		return 0;
+	}
+
+	boxEmpty(&bounds);
+	boxEmpty(&cbounds);
+	for(i = first; i < first + count; i++) {
+		boxGrow(&bounds, &b->bounds[b->index[i]]);
+		boxGrowPoint(&cbounds, &b->centroids[3 * b->index[i]]);
+	}
+	for(k = 0; k < 3; k++) {
+		n->lo[k] = bounds.lo[k];
+		n->hi[k] = bounds.hi[k];
+	}
+	n->offset = first;
+	n->count = count;
+	if(count == 1) return 0;
+
+	// Find the cheapest plane between bins
+	area = boxArea(bounds.lo, bounds.hi);
+	if(depth < BVH_MEDIAN_DEPTH && area > 0.0f) {
+		for(k = 0; k < 3; k++) {
+			extent = cbounds.hi[k] - cbounds.lo[k];
+			scale[k] = (extent > 0.0f) ? BVH_BINS * 0.9999f / extent : 0.0f;
+			for(j = 0; j < BVH_BINS; j++) {
+				boxEmpty(&bins[k][j]);
+				bincount[k][j] = 0;
+			}
+		}
+		for(i = first; i < first + count; i++) {
+			t = b->index[i];
+			for(k = 0; k < 3; k++) {
+				if(scale[k] == 0.0f) continue;
+				j = binOf(b->centroids[3 * t + k], cbounds.lo[k], scale[k]);
+				bincount[k][j]++;
+				boxGrow(&bins[k][j], &b->bounds[t]);
+			}
+		}
+		for(k = 0; k < 3; k++) {
+			if(scale[k] == 0.0f) continue;
+			boxEmpty(&left);
+			for(j = 0; j < BVH_BINS - 1; j++) {
+				boxGrow(&left, &bins[k][j]);
+				leftcount[j] = (j ? leftcount[j - 1] : 0) + bincount[k][j];
+				leftcost[j] = boxArea(left.lo, left.hi) * leftcount[j];
+			}
+			boxEmpty(&right);
+			nright = 0;
+			for(j = BVH_BINS - 1; j > 0; j--) {
+				boxGrow(&right, &bins[k][j]);
+				nright += bincount[k][j];
+				if(leftcount[j - 1] == 0 || nright == 0) continue;
+				cost = 1.0f + (leftcost[j - 1] + boxArea(right.lo, right.hi) * nright) / area;
+				if(cost < best) {
+					best = cost;
+					axis = k;
+					split = j;
+				}
+			}
+		}
+	}
+	if(count <= BVH_MAX_LEAF && (axis < 0 || best >= (float)count)) return 0;
+
+	if(axis >= 0) {
+		// Bins below split to the left
+		i = first;
+		j = first + count - 1;
+		while(i <= j) {
+			if(binOf(b->centroids[3 * b->index[i] + axis], cbounds.lo[axis], scale[axis]) < split) i++;
+			else {
+				t = b->index[i];
+				b->index[i] = b->index[j];
+				b->index[j--] = t;
+			}
+		}
+		mid = i;
+	}
+	else {
+		// Half of the triangles to each side, along the longest axis
+		axis = 0;
+		for(k = 1; k < 3; k++) {
+			if(cbounds.hi[k] - cbounds.lo[k] > cbounds.hi[axis] - cbounds.lo[axis]) axis = k;
+		}
+		mid = first + count / 2;
+		selectNth(b->centroids, b->index, first, first + count - 1, mid, axis);
+	}
+
+	n->offset = *next;
+	n->count = 0;
+	*next += 2;
+	if(buildNode(b, n->offset, first, mid - first, depth + 1, next) != 0) return -1;
+	return buildNode(b, b->nodes[node].offset + 1, mid, first + count - mid, depth + 1, next);
+}
+
+static void buildTask(void *arg, int index, int thread) {
+	builder *b = (builder*)arg, sub = *b;
+	const subtree *s = &b->tasks[index];
+	int next = s->next;
+
+	sub.tasksize = 0;
+	buildNode(&sub, s->node, s->first, s->count, s->depth, &next);
+}
+
+/* Copy the subtree of node into out, depth first, from slot on */
+static void compactNode(const bvhNode *in, bvhNode *out, int node, int slot, int *next) {
+	int c;
+
+	out[slot] = in[node];
+	if(in[node].count == 0) {
+		c = *next;
+		*next += 2;
+		out[slot].offset = c;
+		compactNode(in, out, in[node].offset, c, next);
+		compactNode(in, out, in[node].offset + 1, c + 1, next);
+	}
+}
+
+int bvhBuild(bvh *tree, const float *vertices, int stride, const unsigned int *indices,
+	int ntris, int nverts, noisePool *pool) {
+	builder b;
+	box *bounds = NULL;
+	float *centroids = NULL, *tri;
+	const float *p[3];
+	bvhNode *compact;
+	int i, j, k, next = 1;
+
+	memset(tree, 0, sizeof(bvh));
+	if(ntris <= 0) return 0;
+	memset(&b, 0, sizeof(b));
+	bounds = (box*)malloc(ntris * sizeof(box));
+	centroids = (float*)malloc(ntris * 3 * sizeof(float));
+	b.index = (unsigned int*)malloc(ntris * sizeof(unsigned int));
+	b.nodes = (bvhNode*)malloc((2 * ntris - 1) * sizeof(bvhNode));
+	tree->triangles = (float*)malloc(ntris * 9 * sizeof(float));
+	if(bounds == NULL || centroids == NULL || b.index == NULL || b.nodes == NULL
+		|| tree->triangles == NULL) goto fail;
+
+	for(i = 0; i < ntris; i++) {
+		boxEmpty(&bounds[i]);
+		for(j = 0; j < 3; j++) {
+			k = (indices[3 * i + j] < (unsigned int)nverts) ? indices[3 * i + j] : 0;
+			boxGrowPoint(&bounds[i], vertices + (size_t)k * stride);
+		}
+		for(k = 0; k < 3; k++) centroids[3 * i + k] = 0.5f * (bounds[i].lo[k] + bounds[i].hi[k]);
+		b.index[i] = i;
+	}
+	b.bounds = bounds;
+	b.centroids = centroids;
+
+	// The top of the tree here, the rest as tasks
+	if(pool != NULL && noisePoolThreads(pool) > 1 && ntris > 2 * BVH_TASK_MIN) {
+		b.tasksize = ntris / (4 * noisePoolThreads(pool));
+		if(b.tasksize < BVH_TASK_MIN) b.tasksize = BVH_TASK_MIN;
+	}
+	if(buildNode(&b, 0, 0, ntris, 0, &next) != 0) goto fail;
+	if(b.tasksize > 0) {
+		noisePoolFor(pool, b.ntasks, buildTask, &b);
+		compact = (bvhNode*)malloc((2 * ntris - 1) * sizeof(bvhNode));
+		if(compact == NULL) goto fail;
+		next = 1;
+		compactNode(b.nodes, compact, 0, 0, &next);
+		free(b.nodes);
+		b.nodes = compact;
+		free(b.tasks);
+		b.tasks = NULL;
+	}
+	tree->nodes = b.nodes;
+	tree->nnodes = next;
+
+	// Corner and edges of each triangle, in the order of the leaves
+	for(i = 0; i < ntris; i++) {
+		tri = tree->triangles + 9 * i;
+		for(j = 0; j < 3; j++) {
+			k = (indices[3 * b.index[i] + j] < (unsigned int)nverts) ? indices[3 * b.index[i] + j] : 0;
+			p[j] = vertices + (size_t)k * stride;
+		}
+		for(k = 0; k < 3; k++) {
+			tri[k] = p[0][k];
+			tri[3 + k] = p[1][k] - p[0][k];
+			tri[6 + k] = p[2][k] - p[0][k];
+		}
+	}
+	tree->triindex = b.index;
+	tree->ntris = ntris;
+	free(bounds);
+	free(centroids);
+	return 0;
+
+fail:
+	free(bounds);
+	free(centroids);
+	free(b.index);
+	free(b.nodes);
+	free(b.tasks);
+	free(tree->triangles);
+	memset(tree, 0, sizeof(bvh));
+	return -1;
+}
+
+/* Make a 4-wide node from binary node, by opening the largest of its
+   descendants until there are four, and return its number */
+static int collapseNode(bvh *tree, int node, int *next) {
+	int slot = (*next)++, children[4], n, i, k, largest;
+	float area, largestarea;
+	const bvhNode *c;
+	bvhNode4 *w;
+
+	if(tree->nodes[node].count > 0) {
+		children[0] = node;
+		n = 1;
+	}
+	else {
+		children[0] = tree->nodes[node].offset;
+		children[1] = children[0] + 1;
+		n = 2;
+	}
+	while(n < 4) {
+		largest = -1;
+		largestarea = -1.0f;
+		for(i = 0; i < n; i++) {
+			c = &tree->nodes[children[i]];
+			if(c->count > 0) continue;
+			area = boxArea(c->lo, c->hi);
+			if(area > largestarea) {
+				largestarea = area;
+				largest = i;
+			}
+		}
+		if(largest < 0) break;
+		children[n++] = tree->nodes[children[largest]].offset + 1;
+		children[largest] = tree->nodes[children[largest]].offset;
+	}
+
+	for(i = 0; i < 4; i++) {
+		w = &tree->nodes4[slot];
+		if(i >= n) {
+			for(k = 0; k < 3; k++) w->lo[k][i] = w->hi[k][i] = 0.0f;
+			w->child[i] = 0;
+			w->count[i] = -1;
+			continue;
+		}
+		c = &tree->nodes[children[i]];
+		for(k = 0; k < 3; k++) {
+			w->lo[k][i] = c->lo[k];
+			w->hi[k][i] = c->hi[k];
+		}
+		if(c->count > 0) {
+			w->child[i] = c->offset;
+			w->count[i] = c->count;
+		}
+		else {
+			k = collapseNode(tree, children[i], next);
+			tree->nodes4[slot].child[i] = k;
+			tree->nodes4[slot].count[i] = 0;
+		}
+	}
+	return slot;
+}
+
+int bvhBuildWide(bvh *tree) {
+	int next = 0;
+
+	free(tree->nodes4);
+	tree->nodes4 = NULL;
+	tree->nnodes4 = 0;
+	if(tree->nnodes == 0) return 0;
+	// One node for each node of the binary tree that has children, or one for a leaf
+	tree->nodes4 = (bvhNode4*)malloc(((tree->nnodes - 1) / 2 + 1) * sizeof(bvhNode4));
+	if(tree->nodes4 == NULL) return -1;
+	collapseNode(tree, 0, &next);
+	tree->nnodes4 = next;
+	return 0;
+}
+
+void bvhFree(bvh *tree) {
+	free(tree->nodes);
+	free(tree->nodes4);
+	free(tree->triangles);
+	free(tree->triindex);
+	memset(tree, 0, sizeof(bvh));
+}
+
+float bvhCost(const bvh *tree) {
+	const bvhNode *n;
+	float root, cost = 0.0f;
+	int i;
+
+	if(tree->nnodes == 0) return 0.0f;
+	root = boxArea(tree->nodes[0].lo, tree->nodes[0].hi);
+	if(root <= 0.0f) return 0.0f;
+	for(i = 0; i < tree->nnodes; i++) {
+		n = &tree->nodes[i];
+		cost += boxArea(n->lo, n->hi) * (n->count ? (float)n->count : 1.0f);
+	}
+	return cost / root;
+}
+
+/* 1 / d, kept finite, since -ffast-math does not allow for infinities */
+static float inverse(float d) {
+	if(fabsf(d) < 1e-20f) d = (d < 0.0f) ? -1e-20f : 1e-20f;
+	return 1.0f / d;
+}
+
+/* Whether a ray hits the box lo, hi at some t in [tmin, tmax], and the
+   first such t in *tnear */
+static int hitBox(const float *lo, const float *hi, const float *org, const float *inv,
+	float tmin, float tmax, float *tnear) {
+	float t0, t1, t;
+	int k;
+
+	for(k = 0; k < 3; k++) {
+		t0 = (lo[k] - org[k]) * inv[k];
+		t1 = (hi[k] - org[k]) * inv[k];
+		if(t0 > t1) {
+			t = t0;
+			t0 = t1;
+			t1 = t;
+		}
+		if(t0 > tmin) tmin = t0;
+		if(t1 < tmax) tmax = t1;
+	}
+	*tnear = tmin;
+	return tmin <= tmax;
+}
+
+/* Whether a ray hits triangle tri (corner, two edges) at some t in
+   [tmin, *tmax], and if so that t in *tmax with the barycentric
+   coordinates in *u and *v (Moller-Trumbore) */
+static int hitTriangle(const float *tri, const float *org, const float *dir,
+	float tmin, float *tmax, float *u, float *v) {
+	float p[3], s[3], q[3], det, inv, a, b, t;
+
+	p[0] = dir[1] * tri[8] - dir[2] * tri[7];
+	p[1] = dir[2] * tri[6] - dir[0] * tri[8];
+	p[2] = dir[0] * tri[7] - dir[1] * tri[6];
+	det = tri[3] * p[0] + tri[4] * p[1] + tri[5] * p[2];
+	if(det == 0.0f) return 0;
+	inv = 1.0f / det;
+	s[0] = org[0] - tri[0];
+	s[1] = org[1] - tri[1];
+	s[2] = org[2] - tri[2];
+	a = (s[0] * p[0] + s[1] * p[1] + s[2] * p[2]) * inv;
+	if(a < 0.0f || a > 1.0f) return 0;
+	q[0] = s[1] * tri[5] - s[2] * tri[4];
+	q[1] = s[2] * tri[3] - s[0] * tri[5];
+	q[2] = s[0] * tri[4] - s[1] * tri[3];
+	b = (dir[0] * q[0] + dir[1] * q[1] + dir[2] * q[2]) * inv;
+	if(b < 0.0f || a + b > 1.0f) return 0;
+	t = (tri[6] * q[0] + tri[7] * q[1] + tri[8] * q[2]) * inv;
+	if(t < tmin || t > *tmax) return 0;
+	*tmax = t;
+	*u = a;
+	*v = b;
+	return 1;
+}
+
+/* Test the triangles first .. first + count - 1, and return 1 if any is hit */
+static int hitLeaf(const bvh *tree, int first, int count, const bvhRay *ray, float *tmax,
+	bvhHit *hit, int any) {
+	int i, found = 0;
+
+	for(i = first; i < first + count; i++) {
+		if(hitTriangle(tree->triangles + 9 * i, ray->org, ray->dir, ray->tmin, tmax, &hit->u, &hit->v)) {
+			hit->triangle = i;
+			found = 1;
+			if(any) break;
+		}
+	}
+	return found;
+}
+
+/* Trace a ray through the binary tree. With any, stop at the first hit. */
+static void traceBinary(const bvh *tree, const bvhRay *ray, bvhHit *hit, int any) {
+	struct { int node; float t; } stack[BVH_STACK];
+	float inv[3], tmax = ray->tmax, t0, t1;
+	const bvhNode *n, *c;
+	int sp = 0, h0, h1, k;
+
+	hit->t = ray->tmax;
+	hit->u = hit->v = 0.0f;
+	hit->triangle = -1;
+	if(tree->nnodes == 0) return;
+	for(k = 0; k < 3; k++) inv[k] = inverse(ray->dir[k]);
+	if(!hitBox(tree->nodes[0].lo, tree->nodes[0].hi, ray->org, inv, ray->tmin, tmax, &t0)) return;
+	stack[sp].node = 0;
+	stack[sp++].t = t0;
+
+	while(sp > 0) {
+		sp--;
+		if(stack[sp].t > tmax) continue;
+		n = &tree->nodes[stack[sp].node];
+		if(n->count > 0) {
+			if(hitLeaf(tree, n->offset, n->count, ray, &tmax, hit, any) && any) break;
+			continue;
+		}
+		// Push the children that are hit, the nearest last
+		c = &tree->nodes[n->offset];
+		h0 = hitBox(c[0].lo, c[0].hi, ray->org, inv, ray->tmin, tmax, &t0);
+		h1 = hitBox(c[1].lo, c[1].hi, ray->org, inv, ray->tmin, tmax, &t1);
+		if(h0 && h1) {
+			k = (t0 <= t1) ? 0 : 1;
+			stack[sp].node = n->offset + 1 - k;
+			stack[sp++].t = k ? t0 : t1;
+			stack[sp].node = n->offset + k;
+			stack[sp++].t = k ? t1 : t0;
+		}
+		else if(h0 || h1) {
+			stack[sp].node = n->offset + h1;
+			stack[sp++].t = h1 ? t1 : t0;
+		}
+	}
+	if(hit->triangle >= 0) {
+		hit->t = tmax;
+		hit->triangle = tree->triindex[hit->triangle];
+	}
+}
+
+/* Which of the four boxes of w a ray hits, as bits, with the first t of each in tnear */
+static int hitBoxes4(const bvhNode4 *w, const float *org, const float *inv, float tmin,
+	float tmax, float *tnear) {
+#ifdef BVH_SIMD
+	__m128 t0, t1, tn, tf, o, d;
+	int k, mask;
+
+	tn = _mm_set1_ps(tmin);
+	tf = _mm_set1_ps(tmax);
+	for(k = 0; k < 3; k++) {
+		o = _mm_set1_ps(org[k]);
+		d = _mm_set1_ps(inv[k]);
+		t0 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(w->lo[k]), o), d);
+		t1 = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(w->hi[k]), o), d);
+		tn = _mm_max_ps(tn, _mm_min_ps(t0, t1));
+		tf = _mm_min_ps(tf, _mm_max_ps(t0, t1));
+	}
+	_mm_storeu_ps(tnear, tn);
+	mask = _mm_movemask_ps(_mm_cmple_ps(tn, tf));
+	return mask & _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpgt_epi32(
+		_mm_loadu_si128((const __m128i*)w->count), _mm_set1_epi32(-1))));
+#else
+	float lo[3], hi[3];
+	int i, k, mask = 0;
+
+	for(i = 0; i < 4; i++) {
+		if(w->count[i] < 0) continue;
+		for(k = 0; k < 3; k++) {
+			lo[k] = w->lo[k][i];
+			hi[k] = w->hi[k][i];
+		}
+		if(hitBox(lo, hi, org, inv, tmin, tmax, &tnear[i])) mask |= 1 << i;
+	}
+	return mask;
+#endif
+}
+
+/* Trace a ray through the 4-wide tree. With any, stop at the first hit. */
+static void traceWide(const bvh *tree, const bvhRay *ray, bvhHit *hit, int any) {
+	struct { int child, count; float t; } stack[BVH_STACK * 3], e;
+	float inv[3], tmax = ray->tmax, tnear[4];
+	const bvhNode4 *w;
+	int sp = 0, mask, i, j, k, first;
+
+	hit->t = ray->tmax;
+	hit->u = hit->v = 0.0f;
+	hit->triangle = -1;
+	if(tree->nnodes4 == 0) return;
+	for(k = 0; k < 3; k++) inv[k] = inverse(ray->dir[k]);
+	stack[sp].child = 0;
+	stack[sp].count = 0;
+	stack[sp++].t = ray->tmin;
+
+	while(sp > 0) {
+		e = stack[--sp];
+		if(e.t > tmax) continue;
+		if(e.count > 0) {
+			if(hitLeaf(tree, e.child, e.count, ray, &tmax, hit, any) && any) break;
+			continue;
+		}
+		w = &tree->nodes4[e.child];
+		mask = hitBoxes4(w, ray->org, inv, ray->tmin, tmax, tnear);
+		// Push the children that are hit, sorted with the nearest last
+		first = sp;
+		for(i = 0; i < 4; i++) {
+			if(!(mask & (1 << i))) continue;
+			for(j = sp; j > first && stack[j - 1].t < tnear[i]; j--) stack[j] = stack[j - 1];
+			stack[j].child = w->child[i];
+			stack[j].count = w->count[i];
+			stack[j].t = tnear[i];
+			sp++;
+		}
+	}
+	if(hit->triangle >= 0) {
+		hit->t = tmax;
+		hit->triangle = tree->triindex[hit->triangle];
+	}
+}
+
+#ifdef BVH_SIMD
+/* Keep a where mask is set, else b */
+static __m128 selectPs(__m128 mask, __m128 a, __m128 b) {
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+/* Trace four rays together through the binary tree, as far as any of them goes */
+static void tracePacket(const bvh *tree, const bvhRay *rays, bvhHit *hits) {
+	__m128 ox, oy, oz, dx, dy, dz, ix, iy, iz, tmin, tmax, u, v, id;
+	__m128 t0, t1, tn, tf, px, py, pz, det, inv, sx, sy, sz, qx, qy, qz, a, b, t, hit;
+	float sum[3], d, tbuf[4], ubuf[4], vbuf[4];
+	int stack[BVH_STACK], sp = 0, i, k, axis, nearest, ibuf[4];
+	const bvhNode *n, *c;
+	const float *tri;
+
+	ox = _mm_setr_ps(rays[0].org[0], rays[1].org[0], rays[2].org[0], rays[3].org[0]);
+	oy = _mm_setr_ps(rays[0].org[1], rays[1].org[1], rays[2].org[1], rays[3].org[1]);
+	oz = _mm_setr_ps(rays[0].org[2], rays[1].org[2], rays[2].org[2], rays[3].org[2]);
+	dx = _mm_setr_ps(rays[0].dir[0], rays[1].dir[0], rays[2].dir[0], rays[3].dir[0]);
+	dy = _mm_setr_ps(rays[0].dir[1], rays[1].dir[1], rays[2].dir[1], rays[3].dir[1]);
+	dz = _mm_setr_ps(rays[0].dir[2], rays[1].dir[2], rays[2].dir[2], rays[3].dir[2]);
+	ix = _mm_setr_ps(inverse(rays[0].dir[0]), inverse(rays[1].dir[0]), inverse(rays[2].dir[0]), inverse(rays[3].dir[0]));
+	iy = _mm_setr_ps(inverse(rays[0].dir[1]), inverse(rays[1].dir[1]), inverse(rays[2].dir[1]), inverse(rays[3].dir[1]));
+	iz = _mm_setr_ps(inverse(rays[0].dir[2]), inverse(rays[1].dir[2]), inverse(rays[2].dir[2]), inverse(rays[3].dir[2]));
+	tmin = _mm_setr_ps(rays[0].tmin, rays[1].tmin, rays[2].tmin, rays[3].tmin);
+	tmax = _mm_setr_ps(rays[0].tmax, rays[1].tmax, rays[2].tmax, rays[3].tmax);
+	u = v = _mm_setzero_ps();
+	id = _mm_castsi128_ps(_mm_set1_epi32(-1));
+	for(k = 0; k < 3; k++) sum[k] = rays[0].dir[k] + rays[1].dir[k] + rays[2].dir[k] + rays[3].dir[k];
+
+	if(tree->nnodes > 0) stack[sp++] = 0;
+	while(sp > 0) {
+		n = &tree->nodes[stack[--sp]];
+		t0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(n->lo[0]), ox), ix);
+		t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(n->hi[0]), ox), ix);
+		tn = _mm_max_ps(tmin, _mm_min_ps(t0, t1));
+		tf = _mm_min_ps(tmax, _mm_max_ps(t0, t1));
+		t0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(n->lo[1]), oy), iy);
+		t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(n->hi[1]), oy), iy);
+		tn = _mm_max_ps(tn, _mm_min_ps(t0, t1));
+		tf = _mm_min_ps(tf, _mm_max_ps(t0, t1));
+		t0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(n->lo[2]), oz), iz);
+		t1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(n->hi[2]), oz), iz);
+		tn = _mm_max_ps(tn, _mm_min_ps(t0, t1));
+		tf = _mm_min_ps(tf, _mm_max_ps(t0, t1));
+		if(!_mm_movemask_ps(_mm_cmple_ps(tn, tf))) continue;
+
+		if(n->count == 0) {
+			// Both children, the one that the rays point towards on top
+			c = &tree->nodes[n->offset];
+			axis = 0;
+			for(k = 1; k < 3; k++) {
+				if(fabsf(c[1].lo[k] + c[1].hi[k] - c[0].lo[k] - c[0].hi[k])
+					> fabsf(c[1].lo[axis] + c[1].hi[axis] - c[0].lo[axis] - c[0].hi[axis])) axis = k;
+			}
+			d = c[1].lo[axis] + c[1].hi[axis] - c[0].lo[axis] - c[0].hi[axis];
+			nearest = (d * sum[axis] >= 0.0f) ? 0 : 1;
+			stack[sp++] = n->offset + 1 - nearest;
+			stack[sp++] = n->offset + nearest;
+			continue;
+		}
+
+		for(i = n->offset; i < (int)(n->offset + n->count); i++) {
+			tri = tree->triangles + 9 * i;
+			px = _mm_sub_ps(_mm_mul_ps(dy, _mm_set1_ps(tri[8])), _mm_mul_ps(dz, _mm_set1_ps(tri[7])));
+			py = _mm_sub_ps(_mm_mul_ps(dz, _mm_set1_ps(tri[6])), _mm_mul_ps(dx, _mm_set1_ps(tri[8])));
+			pz = _mm_sub_ps(_mm_mul_ps(dx, _mm_set1_ps(tri[7])), _mm_mul_ps(dy, _mm_set1_ps(tri[6])));
+			det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(tri[3]), px),
+				_mm_mul_ps(_mm_set1_ps(tri[4]), py)), _mm_mul_ps(_mm_set1_ps(tri[5]), pz));
+			hit = _mm_cmpneq_ps(det, _mm_setzero_ps());
+			inv = _mm_div_ps(_mm_set1_ps(1.0f), selectPs(hit, det, _mm_set1_ps(1.0f)));
+			sx = _mm_sub_ps(ox, _mm_set1_ps(tri[0]));
+			sy = _mm_sub_ps(oy, _mm_set1_ps(tri[1]));
+			sz = _mm_sub_ps(oz, _mm_set1_ps(tri[2]));
+			a = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)),
+				_mm_mul_ps(sz, pz)), inv);
+			qx = _mm_sub_ps(_mm_mul_ps(sy, _mm_set1_ps(tri[5])), _mm_mul_ps(sz, _mm_set1_ps(tri[4])));
+			qy = _mm_sub_ps(_mm_mul_ps(sz, _mm_set1_ps(tri[3])), _mm_mul_ps(sx, _mm_set1_ps(tri[5])));
+			qz = _mm_sub_ps(_mm_mul_ps(sx, _mm_set1_ps(tri[4])), _mm_mul_ps(sy, _mm_set1_ps(tri[3])));
+			b = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)),
+				_mm_mul_ps(dz, qz)), inv);
+			t = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(tri[6]), qx),
+				_mm_mul_ps(_mm_set1_ps(tri[7]), qy)), _mm_mul_ps(_mm_set1_ps(tri[8]), qz)), inv);
+			hit = _mm_and_ps(hit, _mm_and_ps(_mm_cmpge_ps(a, _mm_setzero_ps()), _mm_cmpge_ps(b, _mm_setzero_ps())));
+			hit = _mm_and_ps(hit, _mm_cmple_ps(_mm_add_ps(a, b), _mm_set1_ps(1.0f)));
+			hit = _mm_and_ps(hit, _mm_and_ps(_mm_cmpge_ps(t, tmin), _mm_cmple_ps(t, tmax)));
+			if(!_mm_movemask_ps(hit)) continue;
+			tmax = selectPs(hit, t, tmax);
+			u = selectPs(hit, a, u);
+			v = selectPs(hit, b, v);
+			id = selectPs(hit, _mm_castsi128_ps(_mm_set1_epi32(i)), id);
+		}
+	}
+
+	_mm_storeu_ps(tbuf, tmax);
+	_mm_storeu_ps(ubuf, u);
+	_mm_storeu_ps(vbuf, v);
+	_mm_storeu_si128((__m128i*)ibuf, _mm_castps_si128(id));
+	for(i = 0; i < 4; i++) {
+		hits[i].t = tbuf[i];
+		hits[i].u = ubuf[i];
+		hits[i].v = vbuf[i];
+		hits[i].triangle = (ibuf[i] >= 0) ? (int)tree->triindex[ibuf[i]] : -1;
+	}
+}
+#endif
+
+static void rayTask(void *arg, int index, int thread) {
+	const rayJob *job = (const rayJob*)arg;
+	int first = index * BVH_RAY_CHUNK, last = first + BVH_RAY_CHUNK, i, j;
+	bvhRay pad[4];
+	bvhHit hit, padhits[4];
+
+	if(last > job->nrays) last = job->nrays;
+	switch(job->mode) {
+	case RAYS_CLOSEST:
+		for(i = first; i < last; i++) {
+			if(job->tree->nodes4 != NULL) traceWide(job->tree, &job->rays[i], &job->hits[i], 0);
+			else traceBinary(job->tree, &job->rays[i], &job->hits[i], 0);
+		}
+		break;
+	case RAYS_ANY:
+		for(i = first; i < last; i++) {
+			if(job->tree->nodes4 != NULL) traceWide(job->tree, &job->rays[i], &hit, 1);
+			else traceBinary(job->tree, &job->rays[i], &hit, 1);
+			job->occluded[i] = hit.triangle >= 0;
+		}
+		break;
+	case RAYS_PACKETS:
+#ifdef BVH_SIMD
+		for(i = first; i + 4 <= last; i += 4) tracePacket(job->tree, &job->rays[i], &job->hits[i]);
+		if(i < last) {
+			// The last few rays, with copies of the last one to make four
+			for(j = 0; j < 4; j++) pad[j] = job->rays[(i + j < last) ? i + j : last - 1];
+			tracePacket(job->tree, pad, padhits);
+			for(j = 0; i + j < last; j++) job->hits[i + j] = padhits[j];
+		}
+#else
+		for(i = first; i < last; i++) traceBinary(job->tree, &job->rays[i], &job->hits[i], 0);
+		(void)j; (void)pad; (void)padhits;
+#endif
+		break;
+	}
+}
+
+static void traceRays(const bvh *tree, const bvhRay *rays, bvhHit *hits, unsigned char *occluded,
+	int nrays, int mode, noisePool *pool) {
+	rayJob job;
+
+	job.tree = tree;
+	job.rays = rays;
+	job.hits = hits;
+	job.occluded = occluded;
+	job.nrays = nrays;
+	job.mode = mode;
+	noisePoolFor(pool, (nrays + BVH_RAY_CHUNK - 1) / BVH_RAY_CHUNK, rayTask, &job);
+}
+
+void bvhIntersect(const bvh *tree, const bvhRay *rays, bvhHit *hits, int nrays, noisePool *pool) {
+	traceRays(tree, rays, hits, NULL, nrays, RAYS_CLOSEST, pool);
+}
+
+void bvhOccluded(const bvh *tree, const bvhRay *rays, unsigned char *occluded, int nrays,
+	noisePool *pool) {
+	traceRays(tree, rays, NULL, occluded, nrays, RAYS_ANY, pool);
+}
+
+void bvhIntersectPackets(const bvh *tree, const bvhRay *rays, bvhHit *hits, int nrays,
+	noisePool *pool) {
+	traceRays(tree, rays, hits, NULL, nrays, RAYS_PACKETS, pool);
+}
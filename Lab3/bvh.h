@@ -0,0 +1,105 @@
+/*
+ * bvh.h - a bounding volume hierarchy over the triangles of a mesh, for
+ * ray queries: picking, shadow rays and placing objects on a surface.
+ * Without OpenGL dependencies.
+ *
+ * The meshes are as in triangleSoup, so for a triangleSoup "soup":
+ *   bvhBuild(&tree, soup.vertexarray, 8, soup.indexarray, soup.ntris, soup.nverts, pool);
+ *
+ * The tree is built top down with the surface area heuristic (SAH),
+ * evaluated for BVH_BINS bins of triangle centroids along each axis.
+ * Once the top of the tree has split the mesh into enough parts, those
+ * are built in parallel on a noisePool (cpuNoisePool.c), and the tree is
+ * then stored depth first, with the two children of a node next to each
+ * other. Nodes are 32 bytes: a box and two integers.
+ *
+ * bvhBuildWide() also makes a 4-wide tree from the binary one, with the
+ * boxes of the four children of a node stored component by component, so
+ * that a ray is tested against all four with SSE at once. When there is
+ * one, bvhIntersect() and bvhOccluded() use it.
+ *
+ * A ray hits a triangle from either side. Rays are tested in batches,
+ * spread over the threads of a pool if there is one:
+ *   bvhIntersect()        - the closest hit of each ray
+ *   bvhOccluded()         - whether anything is hit at all (shadow rays)
+ *   bvhIntersectPackets() - closest hits, four rays at a time through the
+ *                           binary tree, for rays that go the same way,
+ *                           like those from a camera through neighbouring
+ *                           pixels
+ *
+ * This code is in the public domain.
+ */
+
+#ifndef BVH_H
+#define BVH_H
+
+#include "threadPool.h" // For noisePool
+
+// Bins per axis for the SAH, and the most triangles in a leaf
+#define BVH_BINS 16
+#define BVH_MAX_LEAF 8
+
+/* A node of the binary tree, 32 bytes */
+typedef struct {
+	float lo[3];
+	unsigned int offset; // First child (the second is next), or first triangle of a leaf
+	float hi[3];
+	unsigned int count;  // Triangles in a leaf, 0 for other nodes
+} bvhNode;
+
+/* A node of the 4-wide tree, 128 bytes */
+typedef struct {
+	float lo[3][4], hi[3][4]; // Boxes of the four children, x, y and z rows
+	int child[4];             // Node4 index, or for a leaf its first triangle
+	int count[4];             // Triangles in a leaf, 0 for nodes, -1 for no child
+} bvhNode4;
+
+typedef struct {
+	bvhNode *nodes;
+	int nnodes;
+	bvhNode4 *nodes4;       // The 4-wide tree, or NULL
+	int nnodes4;
+	float *triangles;       // 9 floats per triangle in leaf order: p0, p1 - p0, p2 - p0
+	unsigned int *triindex; // Triangle number in the mesh, in leaf order
+	int ntris;
+} bvh;
+
+typedef struct {
+	float org[3], tmin;
+	float dir[3], tmax;     // Hits with t in [tmin, tmax] count, at org + t * dir
+} bvhRay;
+
+typedef struct {
+	float t, u, v;          // Distance along the ray, and barycentric coordinates
+	int triangle;           // Triangle number in the mesh, -1 for no hit
+} bvhHit;
+
+/*
+ * bvhBuild() - build a tree over ntris triangles of a mesh with nverts
+ * vertices of stride floats, with the position first. With a NULL pool,
+ * one thread does it all. Returns 0, or -1 if out of memory.
+ */
+int bvhBuild(bvh *tree, const float *vertices, int stride, const unsigned int *indices,
+	int ntris, int nverts, noisePool *pool);
+
+/* bvhBuildWide() - add the 4-wide tree. Returns 0, or -1 if out of memory. */
+int bvhBuildWide(bvh *tree);
+
+/* bvhFree() - free the arrays of a tree and set it to all zeros */
+void bvhFree(bvh *tree);
+
+/* bvhCost() - the SAH cost of the binary tree, for comparisons */
+float bvhCost(const bvh *tree);
+
+/* bvhIntersect() - the closest hit for each of nrays rays */
+void bvhIntersect(const bvh *tree, const bvhRay *rays, bvhHit *hits, int nrays, noisePool *pool);
+
+/* bvhOccluded() - 1 in occluded for each ray that hits anything, else 0 */
+void bvhOccluded(const bvh *tree, const bvhRay *rays, unsigned char *occluded, int nrays,
+	noisePool *pool);
+
+/* bvhIntersectPackets() - as bvhIntersect(), for groups of four rays */
+void bvhIntersectPackets(const bvh *tree, const bvhRay *rays, bvhHit *hits, int nrays,
+	noisePool *pool);
+
+#endif /* BVH_H */
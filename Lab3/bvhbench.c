@@ -0,0 +1,276 @@
+/*
+ * bvhbench.c - build bounding volume hierarchies (bvh.c) for OBJ meshes,
+ * and time ray queries against them, in millions of rays per second.
+ *
+ * Two sets of rays are traced for each mesh: "primary" rays from an eye
+ * in front of the mesh through the pixels of an image, in 2x2 blocks of
+ * pixels so that the packets of four rays go the same way, and "random"
+ * rays between random points around the mesh, which go every which way.
+ * Each set is traced for closest hits through the binary tree, through
+ * the 4-wide tree and as packets, and for any hit through the 4-wide tree.
+ * Some of the rays are also tested against every triangle, and if the
+ * hits differ from those of the trees, this program says so and exits
+ * with 1.
+ *
+ * Usage: bvhbench [file.obj ...]
+ * With no files, the meshes in meshes/ are used.
+ *
+ * This code is in the public domain.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "bench.h"
+#include "objLoader.h"
+#include "bvh.h"
+
+static const char *defaultFiles[] = { BENCH_MESHES };
+
+// Image size for the primary rays, number of random rays, least number
+// of rays for each timing, and every how many rays one is checked
+#define IMAGE_SIZE 512
+#define RANDOM_RAYS (IMAGE_SIZE * IMAGE_SIZE)
+#define BENCH_RAYS 2000000
+#define CHECK_EVERY 97
+
+/* A random number in [-1, 1], the same sequence on every platform */
+static float random1(unsigned int *state) {
+	*state = *state * 1664525u + 1013904223u;
+	return (float)(*state >> 8) / 8388608.0f - 1.0f;
+}
+
+/* Rays from an eye at 3 radii in front of the mesh through the pixels of
+   an image that just covers it, 2x2 pixels after each other */
+static void primaryRays(bvhRay *rays, const float *center, float radius) {
+	int x, y, i = 0, k;
+	float eye[3], pixel = 2.0f * radius / IMAGE_SIZE, len;
+
+	eye[0] = center[0];
+	eye[1] = center[1];
+	eye[2] = center[2] + 3.0f * radius;
+	for(y = 0; y < IMAGE_SIZE; y += 2) {
+		for(x = 0; x < IMAGE_SIZE; x++) {
+			for(k = 0; k < 2; k++, i++) {
+				rays[i].org[0] = eye[0];
+				rays[i].org[1] = eye[1];
+				rays[i].org[2] = eye[2];
+				rays[i].dir[0] = (x + 0.5f) * pixel - radius;
+				rays[i].dir[1] = (y + k + 0.5f) * pixel - radius;
+				rays[i].dir[2] = -3.0f * radius;
+				len = sqrtf(rays[i].dir[0] * rays[i].dir[0] + rays[i].dir[1] * rays[i].dir[1]
+					+ rays[i].dir[2] * rays[i].dir[2]);
+				rays[i].dir[0] /= len;
+				rays[i].dir[1] /= len;
+				rays[i].dir[2] /= len;
+				rays[i].tmin = 0.0f;
+				rays[i].tmax = 1e30f;
+			}
+		}
+	}
+}
+
+/* Rays from random points on a sphere around the mesh to random points
+   in its bounding sphere */
+static void randomRays(bvhRay *rays, const float *center, float radius) {
+	unsigned int state = 1;
+	float to[3], len;
+	int i, k;
+
+	for(i = 0; i < RANDOM_RAYS; i++) {
+		do {
+			for(k = 0; k < 3; k++) rays[i].org[k] = random1(&state);
+			len = sqrtf(rays[i].org[0] * rays[i].org[0] + rays[i].org[1] * rays[i].org[1]
+				+ rays[i].org[2] * rays[i].org[2]);
+		} while(len > 1.0f || len < 0.01f);
+		for(k = 0; k < 3; k++) {
+			rays[i].org[k] = center[k] + rays[i].org[k] / len * 1.5f * radius;
+			to[k] = center[k] + random1(&state) * radius;
+			rays[i].dir[k] = to[k] - rays[i].org[k];
+		}
+		len = sqrtf(rays[i].dir[0] * rays[i].dir[0] + rays[i].dir[1] * rays[i].dir[1]
+			+ rays[i].dir[2] * rays[i].dir[2]);
+		for(k = 0; k < 3; k++) rays[i].dir[k] /= len;
+		rays[i].tmin = 0.0f;
+		rays[i].tmax = 1e30f;
+	}
+}
+
+/* The closest hit of a ray, testing every triangle */
+static float bruteForce(const objMesh *mesh, const bvhRay *ray, int *triangle) {
+	const float *p[3];
+	float e1[3], e2[3], pv[3], s[3], q[3], det, inv, u, v, t, tmax = ray->tmax;
+	int i, j, k;
+
+	*triangle = -1;
+	for(i = 0; i < mesh->ntris; i++) {
+		for(j = 0; j < 3; j++) p[j] = mesh->vertexarray + 8 * mesh->indexarray[3 * i + j];
+		for(k = 0; k < 3; k++) {
+			e1[k] = p[1][k] - p[0][k];
+			e2[k] = p[2][k] - p[0][k];
+			s[k] = ray->org[k] - p[0][k];
+		}
+		pv[0] = ray->dir[1] * e2[2] - ray->dir[2] * e2[1];
+		pv[1] = ray->dir[2] * e2[0] - ray->dir[0] * e2[2];
+		pv[2] = ray->dir[0] * e2[1] - ray->dir[1] * e2[0];
+		det = e1[0] * pv[0] + e1[1] * pv[1] + e1[2] * pv[2];
+		if(det == 0.0f) continue;
+		inv = 1.0f / det;
+		u = (s[0] * pv[0] + s[1] * pv[1] + s[2] * pv[2]) * inv;
+		if(u < 0.0f || u > 1.0f) continue;
+		q[0] = s[1] * e1[2] - s[2] * e1[1];
+		q[1] = s[2] * e1[0] - s[0] * e1[2];
+		q[2] = s[0] * e1[1] - s[1] * e1[0];
+		v = (ray->dir[0] * q[0] + ray->dir[1] * q[1] + ray->dir[2] * q[2]) * inv;
+		if(v < 0.0f || u + v > 1.0f) continue;
+		t = (e2[0] * q[0] + e2[1] * q[1] + e2[2] * q[2]) * inv;
+		if(t < ray->tmin || t > tmax) continue;
+		tmax = t;
+		*triangle = i;
+	}
+	return tmax;
+}
+
+/* Millions of rays per second for a query (0 binary, 1 wide, 2 packets, 3 any hit) */
+static double speed(int query, bvh *tree, const bvhRay *rays, bvhHit *hits,
+	unsigned char *occluded, int nrays, noisePool *pool) {
+	bvhNode4 *wide = tree->nodes4;
+	int reps = BENCH_RAYS / nrays + 1, r;
+	double t;
+
+	if(query == 0) tree->nodes4 = NULL; // Use the binary tree
+	t = seconds();
+	for(r = 0; r < reps; r++) {
+		if(query == 2) bvhIntersectPackets(tree, rays, hits, nrays, pool);
+		else if(query == 3) bvhOccluded(tree, rays, occluded, nrays, pool);
+		else bvhIntersect(tree, rays, hits, nrays, pool);
+	}
+	t = seconds() - t;
+	tree->nodes4 = wide;
+	return (double)reps * nrays / t * 1e-6;
+}
+
+/* Count the checked rays where a query differs from testing every
+   triangle (bruteForce() into t and triangle for every CHECK_EVERY rays):
+   in whether it hits, or by more than a little in how far */
+static int check(int query, bvh *tree, const bvhRay *rays, bvhHit *hits, unsigned char *occluded,
+	int nrays, const float *t, const int *triangle, float radius, noisePool *pool) {
+	bvhNode4 *wide = tree->nodes4;
+	int i, j, wrong = 0;
+
+	if(query == 0) tree->nodes4 = NULL;
+	if(query == 2) bvhIntersectPackets(tree, rays, hits, nrays, pool);
+	else if(query == 3) bvhOccluded(tree, rays, occluded, nrays, pool);
+	else bvhIntersect(tree, rays, hits, nrays, pool);
+	tree->nodes4 = wide;
+	for(i = j = 0; i < nrays; i += CHECK_EVERY, j++) {
+		if(query == 3) wrong += occluded[i] != (triangle[j] >= 0);
+		else if((hits[i].triangle >= 0) != (triangle[j] >= 0)) wrong++;
+		else if(triangle[j] >= 0 && fabsf(hits[i].t - t[j]) > 1e-4f * radius) wrong++;
+	}
+	return wrong;
+}
+
+int main(int argc, char *argv[]) {
+	static const char *queries[] = {"binary", "4-wide", "packets", "any hit"};
+	const char **files = defaultFiles;
+	int nfiles = sizeof(defaultFiles) / sizeof(defaultFiles[0]);
+	int f, i, k, q, s, nrays, wrong, failed = 0, hit;
+	float lo[3], hi[3], center[3], radius, *brutet;
+	int *brutetri;
+	double time, widetime, mrays;
+	bvhRay *rays[2];
+	bvhHit *hits;
+	unsigned char *occluded;
+	noisePool *pool;
+	objMesh mesh;
+	bvh tree;
+
+	if(argc > 1) {
+		files = (const char**)&argv[1];
+		nfiles = argc - 1;
+	}
+	pool = noisePoolCreate(0);
+	nrays = IMAGE_SIZE * IMAGE_SIZE;
+	rays[0] = (bvhRay*)malloc(nrays * sizeof(bvhRay));
+	rays[1] = (bvhRay*)malloc(RANDOM_RAYS * sizeof(bvhRay));
+	hits = (bvhHit*)malloc(nrays * sizeof(bvhHit));
+	occluded = (unsigned char*)malloc(nrays);
+	brutet = (float*)malloc((nrays / CHECK_EVERY + 1) * sizeof(float));
+	brutetri = (int*)malloc((nrays / CHECK_EVERY + 1) * sizeof(int));
+	if(rays[0] == NULL || rays[1] == NULL || hits == NULL || occluded == NULL
+		|| brutet == NULL || brutetri == NULL) {
+		printf("out of memory\n");
+		return 1;
+	}
+	printf("%d threads, %d primary and %d random rays\n", pool ? noisePoolThreads(pool) : 1,
+		nrays, RANDOM_RAYS);
+
+	for(f = 0; f < nfiles; f++) {
+		if(objLoadThreaded(&mesh, files[f], pool, OBJ_WELD) != 0 || mesh.ntris == 0) {
+			printf("%s could not be read\n", files[f]);
+			continue;
+		}
+		time = seconds();
+		if(bvhBuild(&tree, mesh.vertexarray, 8, mesh.indexarray, mesh.ntris, mesh.nverts, pool) != 0) {
+			printf("out of memory\n");
+			return 1;
+		}
+		time = seconds() - time;
+		widetime = seconds();
+		if(bvhBuildWide(&tree) != 0) {
+			printf("out of memory\n");
+			return 1;
+		}
+		widetime = seconds() - widetime;
+		printf("\n%s: %d triangles\n", files[f], mesh.ntris);
+		printf("  built in %.2f ms, %d nodes (%d KB), SAH cost %.1f; 4-wide in %.2f ms, %d nodes (%d KB)\n",
+			1000.0 * time, tree.nnodes, (int)(tree.nnodes * sizeof(bvhNode) / 1024), bvhCost(&tree),
+			1000.0 * widetime, tree.nnodes4, (int)(tree.nnodes4 * sizeof(bvhNode4) / 1024));
+
+		for(k = 0; k < 3; k++) lo[k] = hi[k] = mesh.vertexarray[k];
+		for(i = 1; i < mesh.nverts; i++) {
+			for(k = 0; k < 3; k++) {
+				if(mesh.vertexarray[8 * i + k] < lo[k]) lo[k] = mesh.vertexarray[8 * i + k];
+				if(mesh.vertexarray[8 * i + k] > hi[k]) hi[k] = mesh.vertexarray[8 * i + k];
+			}
+		}
+		radius = 0.0f;
+		for(k = 0; k < 3; k++) {
+			center[k] = 0.5f * (lo[k] + hi[k]);
+			radius += 0.25f * (hi[k] - lo[k]) * (hi[k] - lo[k]);
+		}
+		radius = sqrtf(radius);
+		primaryRays(rays[0], center, radius);
+		randomRays(rays[1], center, radius);
+
+		for(s = 0; s < 2; s++) {
+			for(i = k = 0; i < nrays; i += CHECK_EVERY, k++) brutet[k] = bruteForce(&mesh, &rays[s][i], &brutetri[k]);
+			bvhIntersect(&tree, rays[s], hits, nrays, pool);
+			for(i = hit = 0; i < nrays; i++) hit += hits[i].triangle >= 0;
+			printf("  %-7s rays, %4.1f%% hit:", s ? "random" : "primary", 100.0 * hit / nrays);
+			for(q = 0; q < 4; q++) {
+				mrays = speed(q, &tree, rays[s], hits, occluded, nrays, pool);
+				wrong = check(q, &tree, rays[s], hits, occluded, nrays, brutet, brutetri, radius, pool);
+				printf(" %s %6.2f", queries[q], mrays);
+				if(wrong) {
+					printf(" (%d wrong)", wrong);
+					failed = 1;
+				}
+			}
+			printf(" Mrays/s\n");
+		}
+		bvhFree(&tree);
+		objFree(&mesh);
+	}
+	free(rays[0]);
+	free(rays[1]);
+	free(hits);
+	free(occluded);
+	free(brutet);
+	free(brutetri);
+	if(pool != NULL) noisePoolDestroy(pool);
+	return failed;
+}
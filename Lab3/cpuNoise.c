@@ -0,0 +1,191 @@
+/*
+ * cpuNoise.c - runtime dispatch for the CPU noise library.
+ * The actual noise code is in cpuNoiseImpl.h.
+ *
+ * This code is in the public domain.
+ */
+
+#include <stddef.h> // For NULL
+
+#include "cpuNoise.h"
+#include "cpuNoiseKernels.h"
+
+static const noiseKernelTable *kernelTables[NOISE_ISA_COUNT] = {
+	&NOISE_KERNELS(Scalar),
+	&NOISE_KERNELS(SSE41),
+	&NOISE_KERNELS(AVX2),
+	&NOISE_KERNELS(AVX512)
+};
+
+static const noiseKernelTable *currentKernels = NULL;
+static noiseISA currentISA = NOISE_ISA_SCALAR;
+
+/*
+ * cpuSupports() - check for an instruction set. GCC and Clang check
+ * both the CPUID flags and that the OS saves the wide registers.
+ */
+static int cpuSupports(noiseISA isa) {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+	__builtin_cpu_init();
+	switch(isa) {
+		case NOISE_ISA_SCALAR: return 1;
+		case NOISE_ISA_SSE41: return __builtin_cpu_supports("sse4.1");
+		case NOISE_ISA_AVX2: return __builtin_cpu_supports("avx2")
+			&& __builtin_cpu_supports("fma");
+		case NOISE_ISA_AVX512: return __builtin_cpu_supports("avx512f")
+			&& __builtin_cpu_supports("avx512dq");
+		default: return 0;
+	}
+#else
+	return isa == NOISE_ISA_SCALAR;
+#endif
+}
+
+noiseISA noiseDetectISA(void) {
+	int isa;
+	for(isa = NOISE_ISA_COUNT - 1; isa > NOISE_ISA_SCALAR; isa--) {
+		if(cpuSupports((noiseISA)isa)) break;
+	}
+	return (noiseISA)isa;
+}
+
+noiseISA noiseSetISA(noiseISA isa) {
+	if(isa < NOISE_ISA_SCALAR || isa >= NOISE_ISA_COUNT || !cpuSupports(isa)) {
+		isa = noiseDetectISA();
+	}
+	currentISA = isa;
+	currentKernels = kernelTables[isa];
+	return isa;
+}
+
+noiseISA noiseGetISA(void) {
+	if(!currentKernels) noiseSetISA(noiseDetectISA());
+	return currentISA;
+}
+
+const char *noiseISAName(noiseISA isa) {
+	if(isa < NOISE_ISA_SCALAR || isa >= NOISE_ISA_COUNT) return "unknown";
+	return kernelTables[isa]->name;
+}
+
+const char *noiseHashName(void) {
+	return NOISE_HASH_NAME;
+}
+
+/*
+ * kernels() - the active kernel table, selected on first use
+ */
+static const noiseKernelTable *kernels(void) {
+	if(!currentKernels) noiseSetISA(noiseDetectISA());
+	return currentKernels;
+}
+
+const noiseKernelTable *noiseActiveKernels(void) {
+	return kernels();
+}
+
+void noiseSimplex2(const float *x, const float *y, float *out, int n) {
+	kernels()->simplex2(x, y, out, n);
+}
+
+void noiseSimplex3(const float *x, const float *y, const float *z, float *out, int n) {
+	kernels()->simplex3(x, y, z, out, n);
+}
+
+void noiseSimplex4(const float *x, const float *y, const float *z, const float *w,
+	float *out, int n) {
+	kernels()->simplex4(x, y, z, w, out, n);
+}
+
+void noiseSimplex4Frames(const float *x, const float *y, const float *z, int n,
+	const float *t, int nt, float *out) {
+	kernels()->simplex4frames(x, y, z, n, t, nt, out);
+}
+
+void noiseSimplex2Deriv(const float *x, const float *y,
+	float *out, float *dx, float *dy, int n) {
+	kernels()->simplex2deriv(x, y, out, dx, dy, n);
+}
+
+void noiseSimplex3Deriv(const float *x, const float *y, const float *z,
+	float *out, float *dx, float *dy, float *dz, int n) {
+	kernels()->simplex3deriv(x, y, z, out, dx, dy, dz, n);
+}
+
+void noiseSimplex4Deriv(const float *x, const float *y, const float *z, const float *w,
+	float *out, float *dx, float *dy, float *dz, float *dw, int n) {
+	kernels()->simplex4deriv(x, y, z, w, out, dx, dy, dz, dw, n);
+}
+
+void noiseFbmDefaults(noiseFbmParams *params) {
+	params->octaves = 8;
+	params->lacunarity = 2.0f;
+	params->gain = 0.5f;
+	params->type = NOISE_FRACTAL_FBM;
+	params->offset = 1.0f;
+}
+
+void noiseFractal3(const float *x, const float *y, const float *z,
+	const float *filterwidth, const noiseFbmParams *params, float *out, int n) {
+	kernels()->fractal3(x, y, z, filterwidth, params, out, n);
+}
+
+void noiseFractal3Deriv(const float *x, const float *y, const float *z,
+	const float *filterwidth, const noiseFbmParams *params,
+	float *out, float *dx, float *dy, float *dz, int n) {
+	kernels()->fractal3deriv(x, y, z, filterwidth, params, out, dx, dy, dz, n);
+}
+
+void noiseFbm3Deriv(const float *x, const float *y, const float *z,
+	const noiseFbmParams *params, float *out, float *dx, float *dy, float *dz, int n) {
+	kernels()->fractal3deriv(x, y, z, NULL, params, out, dx, dy, dz, n);
+}
+
+void noiseSimplex3Large(const long long cell[3], const float *x, const float *y,
+	const float *z, float *out, int n) {
+	kernels()->simplex3large(cell, x, y, z, out, n);
+}
+
+void noiseSimplex3LargeDeriv(const long long cell[3], const float *x, const float *y,
+	const float *z, float *out, float *dx, float *dy, float *dz, int n) {
+	kernels()->simplex3largederiv(cell, x, y, z, out, dx, dy, dz, n);
+}
+
+void noiseFractal3Large(const long long cell[3], const float *x, const float *y,
+	const float *z, const float *filterwidth, const noiseFbmParams *params,
+	float *out, int n) {
+	kernels()->fractal3large(cell, x, y, z, filterwidth, params, out, n);
+}
+
+void noiseFractal3LargeDeriv(const long long cell[3], const float *x, const float *y,
+	const float *z, const float *filterwidth, const noiseFbmParams *params,
+	float *out, float *dx, float *dy, float *dz, int n) {
+	kernels()->fractal3largederiv(cell, x, y, z, filterwidth, params, out, dx, dy, dz, n);
+}
+
+void noiseClassic2(const float *x, const float *y, float *out, int n) {
+	kernels()->classic2(x, y, out, n);
+}
+
+void noiseClassic3(const float *x, const float *y, const float *z, float *out, int n) {
+	kernels()->classic3(x, y, z, out, n);
+}
+
+void noiseClassic4(const float *x, const float *y, const float *z, const float *w,
+	float *out, int n) {
+	kernels()->classic4(x, y, z, w, out, n);
+}
+
+void noisePeriodic2(const float *x, const float *y, const float *rep, float *out, int n) {
+	kernels()->periodic2(x, y, rep, out, n);
+}
+
+void noisePeriodic3(const float *x, const float *y, const float *z, const float *rep,
+	float *out, int n) {
+	kernels()->periodic3(x, y, z, rep, out, n);
+}
+
+void noisePeriodic4(const float *x, const float *y, const float *z, const float *w,
+	const float *rep, float *out, int n) {
+	kernels()->periodic4(x, y, z, w, rep, out, n);
+}
@@ -0,0 +1,434 @@
+/*
+ * cpuNoise.h - CPU versions of the GLSL noise functions in noise/src,
+ * for offline baking of planets and terrain on machines without a GPU.
+ *
+ * All functions work on batches of points stored as separate x, y, z
+ * arrays ("structure of arrays") and write one float per point.
+ * The work is done by SIMD kernels for scalar C, SSE4.1, AVX2 and
+ * AVX-512, and the fastest one the CPU supports is picked at runtime.
+ *
+ * The arithmetic mirrors the Ashima Arts shaders: the same mod289()
+ * permutation polynomial, the same gradients and taylorInvSqrt().
+ * Results agree with a line-by-line single precision port of the GLSL
+ * code to within NOISE_EPSILON for coordinates within +/-16 of the origin.
+ * Further out, the difference grows with the float spacing of the input
+ * coordinates (about 3e-5 at +/-100), because the AVX2 and AVX-512 paths,
+ * like GPU shader compilers, are free to fuse multiplies and adds.
+ * Beyond roughly 1e4 the float precision of the mod289() hashing itself
+ * degrades, exactly like it does in the shader; see noiseSimplex3Large()
+ * for points far from the origin. The library can instead
+ * be built with a permutation table or an integer hash, which use the
+ * same gradients but give different noise (see noiseHashName()).
+ *
+ * This code is in the public domain.
+ */
+
+#ifndef CPUNOISE_H
+#define CPUNOISE_H
+
+#include <stddef.h> // For size_t
+
+#include "threadPool.h" // For noisePool, used by noiseFieldGenerate()
+
+/* Maximum absolute difference from the GLSL reference, see above.
+   noisehashbench checks every path and hash against it. */
+#define NOISE_EPSILON 5e-6f
+
+/* Instruction set paths, in order of preference */
+typedef enum {
+	NOISE_ISA_SCALAR = 0,
+	NOISE_ISA_SSE41,
+	NOISE_ISA_AVX2,
+	NOISE_ISA_AVX512,
+	NOISE_ISA_COUNT
+} noiseISA;
+
+/*
+ * noiseDetectISA() - return the best instruction set supported by this CPU
+ */
+noiseISA noiseDetectISA(void);
+
+/*
+ * noiseGetISA() - return the instruction set currently in use
+ */
+noiseISA noiseGetISA(void);
+
+/*
+ * noiseSetISA() - force a specific instruction set, e.g. for benchmarks.
+ * Requests for a path the CPU does not support fall back to the best
+ * supported one. Returns the instruction set actually selected.
+ */
+noiseISA noiseSetISA(noiseISA isa);
+
+/*
+ * noiseISAName() - a printable name for an instruction set
+ */
+const char *noiseISAName(noiseISA isa);
+
+/*
+ * noiseHashName() - the lattice hash the library was built with:
+ * "ashima" (the default, same results as the GLSL code), "table" or
+ * "integer". See cpuNoiseHash.h and NOISEHASH in the Makefile.
+ */
+const char *noiseHashName(void);
+
+/*
+ * noiseSimplex2() - 2D simplex noise, snoise(vec2) from noise2D.glsl.
+ * out[i] = snoise(vec2(x[i], y[i])) for i = 0..n-1.
+ */
+void noiseSimplex2(const float *x, const float *y, float *out, int n);
+
+/*
+ * noiseSimplex3() - 3D simplex noise, snoise(vec3) from noise3D.glsl.
+ * out[i] = snoise(vec3(x[i], y[i], z[i])) for i = 0..n-1.
+ * The arrays need no particular alignment, and out may alias x, y or z.
+ */
+void noiseSimplex3(const float *x, const float *y, const float *z, float *out, int n);
+
+/*
+ * noiseSimplex4() - 4D simplex noise, snoise(vec4) from noise4D.glsl.
+ * out[i] = snoise(vec4(x[i], y[i], z[i], w[i])) for i = 0..n-1.
+ */
+void noiseSimplex4(const float *x, const float *y, const float *z, const float *w,
+	float *out, int n);
+
+/*
+ * noiseSimplex4Frames() - 4D simplex noise for an animation: one set of
+ * n points (x, y, z) evaluated at nt time values t[0..nt-1] in a single pass.
+ * out must hold n*nt floats and is written frame by frame:
+ * out[f*n + i] = snoise(vec4(x[i], y[i], z[i], t[f])).
+ * The results are the same as from nt calls to noiseSimplex4() with w
+ * filled in with t[f], and take about as long: the 4D skew depends on w,
+ * so little of the work for a point carries over between frames. What
+ * this saves is filling in the w array, and reading the points again.
+ */
+void noiseSimplex4Frames(const float *x, const float *y, const float *z, int n,
+	const float *t, int nt, float *out);
+
+/*
+ * noiseSimplex2/3/4Deriv() - simplex noise with its analytic gradient.
+ * out[] gets the same values as noiseSimplex2/3/4(), and dx[], dy[] etc.
+ * the partial derivatives of the noise with respect to x, y etc.,
+ * computed in the same pass from the same gradients, at a fraction of the
+ * cost of finite differences. This gives exact normals for displacement:
+ * a surface displaced by h*noise(P) along N has its normal tilted by
+ * the part of h*gradient that is perpendicular to N.
+ */
+void noiseSimplex2Deriv(const float *x, const float *y,
+	float *out, float *dx, float *dy, int n);
+void noiseSimplex3Deriv(const float *x, const float *y, const float *z,
+	float *out, float *dx, float *dy, float *dz, int n);
+void noiseSimplex4Deriv(const float *x, const float *y, const float *z, const float *w,
+	float *out, float *dx, float *dy, float *dz, float *dw, int n);
+
+/* How each octave of a fractal sum is shaped before it is added */
+typedef enum {
+	NOISE_FRACTAL_FBM = 0,    // noise, plain fBm
+	NOISE_FRACTAL_TURBULENCE, // |noise|, billowy turbulence
+	NOISE_FRACTAL_RIDGED      // (offset - |noise|)^2, sharp ridges
+} noiseFractalType;
+
+/* Parameters for fractal sums of noise octaves (fBm) */
+typedef struct {
+	int octaves;           // Maximum number of octaves to sum
+	float lacunarity;      // Frequency factor between octaves, usually 2.0
+	float gain;            // Amplitude factor between octaves, usually 0.5
+	noiseFractalType type; // Octave shaping, NOISE_FRACTAL_FBM if left as 0
+	float offset;          // Ridge height for NOISE_FRACTAL_RIDGED, usually 1.0
+} noiseFbmParams;
+
+/*
+ * noiseFbmDefaults() - 8 octaves of fBm with lacunarity 2 and gain 0.5
+ */
+void noiseFbmDefaults(noiseFbmParams *params);
+
+/*
+ * noiseFractal3() - fBm, turbulence or ridged noise from 3D simplex noise:
+ * out[i] = sum over k of gain^k * shape(snoise(lacunarity^k * P[i])).
+ * filterwidth[i] is the size of the footprint of sample i in the same
+ * units as P, for example the distance to the next sample, or NULL to
+ * sum every octave. Octaves above the Nyquist limit of a sample are faded
+ * out smoothly and replaced by their mean value, and are not computed at
+ * all once every sample in a SIMD block has faded them out. All octaves
+ * are summed in registers, with no intermediate buffers.
+ */
+void noiseFractal3(const float *x, const float *y, const float *z,
+	const float *filterwidth, const noiseFbmParams *params, float *out, int n);
+
+/*
+ * noiseFractal3Deriv() - noiseFractal3() with its gradient in dx, dy and dz
+ */
+void noiseFractal3Deriv(const float *x, const float *y, const float *z,
+	const float *filterwidth, const noiseFbmParams *params,
+	float *out, float *dx, float *dy, float *dz, int n);
+
+/*
+ * noiseFbm3Deriv() - noiseFractal3Deriv() without a filter width:
+ * for plain fBm, out[i] = sum over k of gain^k * snoise(lacunarity^k * P[i]),
+ * with the derivatives of each octave accumulated into dx, dy and dz.
+ */
+void noiseFbm3Deriv(const float *x, const float *y, const float *z,
+	const noiseFbmParams *params, float *out, float *dx, float *dy, float *dz, int n);
+
+/*
+ * Large coordinates, for planet sized domains. A float coordinate of 1e4
+ * has a spacing of 1e-3, and the noise itself loses precision even
+ * sooner, so a point far from the origin is instead given as a 64-bit
+ * whole number cell[3], the same for the whole batch, plus small float
+ * offsets x[i], y[i], z[i] from that cell. The skewing and hashing of the
+ * cell are done in integers once per batch, and the per point work stays
+ * in single precision SIMD, at the same precision as near the origin.
+ * For example, with a noise frequency of 1 per meter on an Earth sized
+ * sphere, split positions into whole kilometers for the cell and meters
+ * within the kilometer for the offsets.
+ *
+ * The results are the same noise as the functions above, wherever those
+ * are precise: cell {0, 0, 0} gives noiseSimplex3() etc. up to rounding, and
+ * moving whole units between cell and offsets changes the result only by
+ * rounding. The offsets should stay within about +/-1e4, and for the
+ * fractals, cell * lacunarity^k must fit in 64 bits.
+ */
+
+/*
+ * noiseSimplex3Large() - out[i] = snoise(vec3(cell) + vec3(x[i], y[i], z[i]))
+ */
+void noiseSimplex3Large(const long long cell[3], const float *x, const float *y,
+	const float *z, float *out, int n);
+
+/*
+ * noiseSimplex3LargeDeriv() - noiseSimplex3Large() with its gradient
+ */
+void noiseSimplex3LargeDeriv(const long long cell[3], const float *x, const float *y,
+	const float *z, float *out, float *dx, float *dy, float *dz, int n);
+
+/*
+ * noiseFractal3Large() - noiseFractal3() at cell + (x[i], y[i], z[i]).
+ * Each octave scales the cell by its frequency in double precision and
+ * moves the fraction over to the offsets.
+ */
+void noiseFractal3Large(const long long cell[3], const float *x, const float *y,
+	const float *z, const float *filterwidth, const noiseFbmParams *params,
+	float *out, int n);
+
+/*
+ * noiseFractal3LargeDeriv() - noiseFractal3Large() with its gradient
+ */
+void noiseFractal3LargeDeriv(const long long cell[3], const float *x, const float *y,
+	const float *z, const float *filterwidth, const noiseFbmParams *params,
+	float *out, float *dx, float *dy, float *dz, int n);
+
+/*
+ * noiseClassic2/3/4() - classic Perlin noise, cnoise() from
+ * classicnoise2D.glsl, classicnoise3D.glsl and classicnoise4D.glsl.
+ */
+void noiseClassic2(const float *x, const float *y, float *out, int n);
+void noiseClassic3(const float *x, const float *y, const float *z, float *out, int n);
+void noiseClassic4(const float *x, const float *y, const float *z, const float *w,
+	float *out, int n);
+
+/*
+ * noisePeriodic2/3/4() - periodic classic Perlin noise, pnoise(P, rep).
+ * rep[] holds the period along each axis (2, 3 or 4 values), the same
+ * for all points in the batch. Periods should be whole numbers.
+ */
+void noisePeriodic2(const float *x, const float *y, const float *rep, float *out, int n);
+void noisePeriodic3(const float *x, const float *y, const float *z, const float *rep,
+	float *out, int n);
+void noisePeriodic4(const float *x, const float *y, const float *z, const float *w,
+	const float *rep, float *out, int n);
+
+/*
+ * Tileable texture baking with periodic noise (cpuNoiseBake.c).
+ *
+ * A tile of width x height (x depth) texels is filled with a sum of
+ * octaves of pnoise(), octave k at frequency 2^k and amplitude gain^k.
+ * Octave 0 has period[] cells across the tile, octave k has period[]*2^k,
+ * so every octave, and hence the sum, wraps around seamlessly at the
+ * tile edges. Texel centers are sampled, i.e. at (i+0.5)/width etc.
+ *
+ * The result is written straight into the caller's buffer in one of the
+ * formats below, channels texels apart and rowstride bytes between rows
+ * (0 means tightly packed), so the tile can be baked directly into one
+ * channel of an interleaved image. FLOAT32 and FLOAT16 store the raw noise
+ * value, UNORM8 maps [-1,1] to [0,255] with clamping.
+ */
+typedef enum {
+	NOISE_FORMAT_FLOAT32 = 0,
+	NOISE_FORMAT_FLOAT16,
+	NOISE_FORMAT_UNORM8
+} noiseFormat;
+
+typedef struct {
+	noiseFormat format;
+	int channels;     // Distance in texels between written values (1 if 0)
+	size_t rowstride; // Bytes between rows (0 = width*channels*texel size)
+	int octaves;      // Number of octaves (at least 1)
+	float gain;       // Amplitude factor between octaves, usually 0.5
+	float period[3];  // Lattice cells across the tile in x, y and z
+} noiseBakeParams;
+
+/* Sensible defaults: tightly packed float, 1 octave, period 4 */
+void noiseBakeDefaults(noiseBakeParams *params);
+
+/*
+ * noiseBakeTile2D() - fill a width x height tileable 2D texture.
+ * Returns 0, or -1 if a size is not positive or out of memory, in which
+ * case dst is left as it was.
+ */
+int noiseBakeTile2D(void *dst, int width, int height, const noiseBakeParams *params);
+
+/*
+ * noiseBakeTile3D() - fill a width x height x depth tileable volume,
+ * stored as depth consecutive 2D slices of height rows each.
+ * Returns 0 or -1 as noiseBakeTile2D().
+ */
+int noiseBakeTile3D(void *dst, int width, int height, int depth,
+	const noiseBakeParams *params);
+
+/*
+ * noiseFloatToHalf() - convert a float to IEEE half precision bits,
+ * rounding to nearest even, as stored by NOISE_FORMAT_FLOAT16
+ */
+unsigned short noiseFloatToHalf(float f);
+
+/*
+ * Tiled noise fields (cpuNoiseField.c).
+ *
+ * noiseFieldGenerate() fills a float image or volume with any kernel of
+ * the type noiseFieldKernel below, using a noisePool. The output is split
+ * into tiles of tilesize x tilesize texels within each slice, small
+ * enough for the coordinates and the results of a tile to stay in the
+ * L1 and L2 caches, and the tiles are shared out over the pool. Results
+ * are written straight into dst. The only allocation is one set of
+ * scratch rows per thread for each call, none per tile.
+ *
+ * Texel (i, j, k) is evaluated at origin + (i, j, k) * step in noise space.
+ */
+typedef struct {
+	int width, height, depth; // depth 1 for a 2D image
+	float origin[3];          // Noise space position of texel (0, 0, 0)
+	float step[3];            // Noise space distance between texels
+	size_t rowstride;         // Floats between rows (0 = width)
+	size_t slicestride;       // Floats between slices (0 = height * rowstride)
+	int tilesize;             // Tile width and height in texels (64 if 0)
+} noiseFieldParams;
+
+/*
+ * A field kernel evaluates n points, with filterwidth[] the size of each
+ * texel in noise space, the largest of step[]. user is passed through
+ * from noiseFieldGenerate(). Kernels run on several threads at once.
+ */
+typedef void (*noiseFieldKernel)(const float *x, const float *y, const float *z,
+	const float *filterwidth, float *out, int n, void *user);
+
+/* Field kernels for noiseSimplex3() and noiseClassic3(), user is unused */
+void noiseFieldSimplex3(const float *x, const float *y, const float *z,
+	const float *filterwidth, float *out, int n, void *user);
+void noiseFieldClassic3(const float *x, const float *y, const float *z,
+	const float *filterwidth, float *out, int n, void *user);
+/* Field kernel for noiseFractal3(), user points to a noiseFbmParams */
+void noiseFieldFractal3(const float *x, const float *y, const float *z,
+	const float *filterwidth, float *out, int n, void *user);
+
+/* Defaults: origin 0, step 1, packed rows and slices, 64x64 tiles */
+void noiseFieldDefaults(noiseFieldParams *params, int width, int height, int depth);
+
+/*
+ * noiseFieldGenerate() - fill dst with kernel over the whole field.
+ * If pool is NULL, the field is generated on the calling thread.
+ * Returns 0 on success, -1 if the parameters are invalid or the scratch
+ * rows could not be allocated.
+ */
+int noiseFieldGenerate(noisePool *pool, float *dst, const noiseFieldParams *params,
+	noiseFieldKernel kernel, void *user);
+
+/*
+ * Noise graphs (cpuNoiseGraph.c).
+ *
+ * A terrain or texture is usually a chain of operations on noise, like
+ * the shader nodes of a Terragen project: warp the position, sum a few
+ * octaves, scale, remap by altitude, mix. Evaluating such a chain node by
+ * node means one full size image per node, written and read back again.
+ * A noiseGraph instead holds the nodes as a small expression graph, and
+ * noiseGraphCompile() turns it into a single program that runs the whole
+ * chain on each SIMD step of samples, with every intermediate value in one
+ * of NOISE_GRAPH_SLOTS (16) vector registers and nothing but the final
+ * result written to memory.
+ *
+ * Nodes are added one at a time and refer to earlier nodes by the index
+ * that noiseGraphAdd() returned, so a graph is always in evaluation order.
+ * Inputs are in[0], in[1] and in[2], shortened to a, b and c below.
+ */
+typedef enum {
+	NOISE_NODE_X = 0,      // The sample position
+	NOISE_NODE_Y,
+	NOISE_NODE_Z,
+	NOISE_NODE_CONST,      // value[0]
+	NOISE_NODE_ADD,        // a + b
+	NOISE_NODE_SUB,        // a - b
+	NOISE_NODE_MUL,        // a * b
+	NOISE_NODE_DIV,        // a / b
+	NOISE_NODE_MIN,        // min(a, b)
+	NOISE_NODE_MAX,        // max(a, b)
+	NOISE_NODE_ABS,        // |a|
+	NOISE_NODE_MAD,        // a * value[0] + value[1]
+	NOISE_NODE_CLAMP,      // clamp(a, value[0], value[1])
+	NOISE_NODE_SMOOTHSTEP, // smoothstep(value[0], value[1], a)
+	NOISE_NODE_MIX,        // mix(a, b, c)
+	NOISE_NODE_NOISE,      // snoise(value[0] * (a, b, c))
+	NOISE_NODE_FBM,        // noiseFractal3() at value[0] * (a, b, c) with fbm
+	NOISE_NODE_WARP,       // The position (a, b, c) component value[2] (0, 1 or 2)
+	                       // plus value[1] * noiseFractal3() at value[0] * (a, b, c),
+	                       // with a different offset for each component
+	NOISE_NODE_COUNT
+} noiseNodeOp;
+
+typedef struct {
+	noiseNodeOp op;
+	int in[3];           // Indices of earlier nodes, as many as op uses
+	float value[3];      // Constants, see noiseNodeOp
+	noiseFbmParams fbm;  // Octaves for NOISE_NODE_FBM and NOISE_NODE_WARP
+} noiseNode;
+
+typedef struct noiseGraph noiseGraph;
+
+/*
+ * noiseNodeInit() - a node for op with no inputs, zero values and
+ * noiseFbmDefaults() octaves, to be filled in before noiseGraphAdd()
+ */
+void noiseNodeInit(noiseNode *node, noiseNodeOp op);
+
+noiseGraph *noiseGraphCreate(void);
+void noiseGraphDestroy(noiseGraph *graph);
+
+/*
+ * noiseGraphAdd() - append a copy of node. Returns its index, or -1 if
+ * op is invalid, an input is not an earlier node or memory ran out.
+ */
+int noiseGraphAdd(noiseGraph *graph, const noiseNode *node);
+
+/*
+ * noiseGraphCompile() - compile the graph for the output node. Nodes the
+ * output does not depend on are dropped, and vector registers are reused
+ * as soon as a value is no longer needed. Returns 0 on success, or -1 if
+ * output is not a node or more than NOISE_GRAPH_SLOTS values would have
+ * to be live at the same time. The previous program is kept until a
+ * compile succeeds, so a graph can be extended and compiled again, but
+ * not while it is being evaluated.
+ */
+int noiseGraphCompile(noiseGraph *graph, int output);
+
+/*
+ * noiseGraphEvaluate() - out[i] = the output of the compiled graph at
+ * (x[i], y[i], z[i]). filterwidth[] is as for noiseFractal3(), scaled by
+ * the frequency of each FBM and WARP node, or NULL. Safe to call from
+ * several threads at once. A graph that was never compiled gives 0.
+ */
+void noiseGraphEvaluate(const noiseGraph *graph, const float *x, const float *y,
+	const float *z, const float *filterwidth, float *out, int n);
+
+/* Field kernel for noiseGraphEvaluate(), user points to a compiled noiseGraph */
+void noiseFieldGraph(const float *x, const float *y, const float *z,
+	const float *filterwidth, float *out, int n, void *user);
+
+#endif /* CPUNOISE_H */
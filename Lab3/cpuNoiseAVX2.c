@@ -0,0 +1,10 @@
+/*
+ * cpuNoiseAVX2.c - AVX2/FMA instantiation of the CPU noise kernels.
+ * Compiled with the matching -m flags, see the Makefile.
+ *
+ * This code is in the public domain.
+ */
+
+#define CPUNOISE_AVX2
+
+#include "cpuNoiseImpl.h"
@@ -0,0 +1,10 @@
+/*
+ * cpuNoiseAVX512.c - AVX-512F instantiation of the CPU noise kernels.
+ * Compiled with the matching -m flags, see the Makefile.
+ *
+ * This code is in the public domain.
+ */
+
+#define CPUNOISE_AVX512
+
+#include "cpuNoiseImpl.h"
@@ -0,0 +1,185 @@
+/*
+ * cpuNoiseBake.c - bake tileable noise textures with periodic noise,
+ * straight into a caller-provided buffer. See cpuNoise.h.
+ *
+ * This code is in the public domain.
+ */
+
+#include <stdlib.h> // For malloc() and free()
+#include <string.h> // For memcpy()
+
+#include "cpuNoise.h"
+
+void noiseBakeDefaults(noiseBakeParams *params) {
+	params->format = NOISE_FORMAT_FLOAT32;
+	params->channels = 1;
+	params->rowstride = 0;
+	params->octaves = 1;
+	params->gain = 0.5f;
+	params->period[0] = 4.0f;
+	params->period[1] = 4.0f;
+	params->period[2] = 4.0f;
+}
+
+/*
+ * noiseFloatToHalf() - float to half with round-to-nearest-even.
+ * Handles overflow to infinity, NaN and half precision denormals.
+ */
+unsigned short noiseFloatToHalf(float f) {
+	union { float f; unsigned int u; } v;
+	unsigned int sign, a, mantodd, o;
+
+	v.f = f;
+	sign = (v.u >> 16) & 0x8000;
+	a = v.u & 0x7fffffff;
+	if(a >= (143u << 23)) { // Too large for a half (>= 65536), Inf or NaN
+		o = (a > 0x7f800000) ? 0x7e00 : 0x7c00;
+	}
+	else if(a < (113u << 23)) { // Half denormal or zero. Let the FPU round.
+		v.u = a;
+		v.f += 0.5f;
+		o = v.u - 0x3f000000;
+	}
+	else { // Normal half: rebias the exponent, round the mantissa
+		mantodd = (a >> 13) & 1;
+		a -= 112u << 23;
+		a += 0xfff + mantodd;
+		o = a >> 13;
+	}
+	return (unsigned short)(o | sign);
+}
+
+static int texelSize(noiseFormat format) {
+	switch(format) {
+		case NOISE_FORMAT_FLOAT16: return 2;
+		case NOISE_FORMAT_UNORM8: return 1;
+		default: return 4;
+	}
+}
+
+/*
+ * storeRow() - convert one row of noise values to the output format
+ */
+static void storeRow(unsigned char *dst, const float *row, int width,
+	noiseFormat format, int channels) {
+	int i;
+	float v;
+
+	switch(format) {
+		case NOISE_FORMAT_FLOAT32:
+			if(channels == 1) {
+				memcpy(dst, row, width * sizeof(float));
+			}
+			else {
+				for(i = 0; i < width; i++) ((float*)dst)[i * channels] = row[i];
+			}
+			break;
+		case NOISE_FORMAT_FLOAT16:
+			for(i = 0; i < width; i++) {
+				((unsigned short*)dst)[i * channels] = noiseFloatToHalf(row[i]);
+			}
+			break;
+		case NOISE_FORMAT_UNORM8:
+			for(i = 0; i < width; i++) {
+				v = 0.5f + 0.5f * row[i];
+				v = (v < 0.0f) ? 0.0f : ((v > 1.0f) ? 1.0f : v);
+				dst[i * channels] = (unsigned char)(v * 255.0f + 0.5f);
+			}
+			break;
+	}
+}
+
+/*
+ * bakeSlice() - the common code for 2D tiles and slices of 3D tiles.
+ * If zs is NULL, 2D noise is used. xs holds the octave 0 x coordinates
+ * of one row, one row of ys and zs is filled in here for each row.
+ */
+static void bakeSlice(unsigned char *dst, int width, int height, float z,
+	int threeD, const noiseBakeParams *params, size_t rowstride,
+	float *xs, float *ys, float *zs, float *tmp, float *acc) {
+	int i, j, k, octaves;
+	float freq, amp, rep[3];
+
+	octaves = (params->octaves < 1) ? 1 : params->octaves;
+	for(j = 0; j < height; j++) {
+		for(k = 0, freq = 1.0f, amp = 1.0f; k < octaves; k++, freq *= 2.0f, amp *= params->gain) {
+			rep[0] = params->period[0] * freq;
+			rep[1] = params->period[1] * freq;
+			rep[2] = params->period[2] * freq;
+			for(i = 0; i < width; i++) {
+				ys[i] = (j + 0.5f) / height * rep[1];
+				if(threeD) zs[i] = z * rep[2];
+			}
+			if(threeD) {
+				noisePeriodic3(xs + (size_t)k * width, ys, zs, rep, tmp, width);
+			}
+			else {
+				noisePeriodic2(xs + (size_t)k * width, ys, rep, tmp, width);
+			}
+			if(k == 0) {
+				for(i = 0; i < width; i++) acc[i] = tmp[i];
+			}
+			else {
+				for(i = 0; i < width; i++) acc[i] += amp * tmp[i];
+			}
+		}
+		storeRow(dst + j * rowstride, acc, width, params->format,
+			(params->channels < 1) ? 1 : params->channels);
+	}
+}
+
+/*
+ * bakeTile() - set up the per-octave x coordinates and scratch rows,
+ * then bake depth slices (depth is 0 for a 2D tile). Returns 0, or -1
+ * if the size is not positive or the scratch rows could not be allocated.
+ */
+static int bakeTile(void *dst, int width, int height, int depth,
+	const noiseBakeParams *params) {
+	int i, k, s, octaves, channels;
+	size_t rowstride;
+	float *xs, *ys, *zs, *tmp, *acc;
+	float freq;
+
+	if(width <= 0 || height <= 0) return -1;
+	octaves = (params->octaves < 1) ? 1 : params->octaves;
+	channels = (params->channels < 1) ? 1 : params->channels;
+	rowstride = params->rowstride;
+	if(rowstride == 0) rowstride = (size_t)width * channels * texelSize(params->format);
+
+	xs = (float*)malloc(((size_t)octaves + 4) * width * sizeof(float));
+	if(xs == NULL) return -1;
+	ys = xs + (size_t)octaves * width;
+	zs = ys + width;
+	tmp = zs + width;
+	acc = tmp + width;
+
+	// The x coordinates are the same for all rows, so compute them once
+	for(k = 0, freq = 1.0f; k < octaves; k++, freq *= 2.0f) {
+		for(i = 0; i < width; i++) {
+			xs[(size_t)k * width + i] = (i + 0.5f) / width * params->period[0] * freq;
+		}
+	}
+
+	if(depth == 0) {
+		bakeSlice((unsigned char*)dst, width, height, 0.0f, 0, params, rowstride,
+			xs, ys, zs, tmp, acc);
+	}
+	else {
+		for(s = 0; s < depth; s++) {
+			bakeSlice((unsigned char*)dst + (size_t)s * height * rowstride, width, height,
+				(s + 0.5f) / depth, 1, params, rowstride, xs, ys, zs, tmp, acc);
+		}
+	}
+	free(xs);
+	return 0;
+}
+
+int noiseBakeTile2D(void *dst, int width, int height, const noiseBakeParams *params) {
+	return bakeTile(dst, width, height, 0, params);
+}
+
+int noiseBakeTile3D(void *dst, int width, int height, int depth,
+	const noiseBakeParams *params) {
+	if(depth <= 0) return -1;
+	return bakeTile(dst, width, height, depth, params);
+}
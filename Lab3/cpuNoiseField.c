@@ -0,0 +1,122 @@
+/*
+ * cpuNoiseField.c - generate large noise images and volumes in tiles,
+ * spread over the threads of a noisePool. See cpuNoise.h.
+ *
+ * This code is in the public domain.
+ */
+
+#include <stdlib.h> // For malloc() and free()
+#include <math.h>   // For fabsf()
+
+#include "cpuNoise.h"
+
+void noiseFieldSimplex3(const float *x, const float *y, const float *z,
+	const float *filterwidth, float *out, int n, void *user) {
+	noiseSimplex3(x, y, z, out, n);
+}
+
+void noiseFieldClassic3(const float *x, const float *y, const float *z,
+	const float *filterwidth, float *out, int n, void *user) {
+	noiseClassic3(x, y, z, out, n);
+}
+
+void noiseFieldFractal3(const float *x, const float *y, const float *z,
+	const float *filterwidth, float *out, int n, void *user) {
+	noiseFractal3(x, y, z, filterwidth, (const noiseFbmParams*)user, out, n);
+}
+
+void noiseFieldDefaults(noiseFieldParams *params, int width, int height, int depth) {
+	params->width = width;
+	params->height = height;
+	params->depth = depth;
+	params->origin[0] = params->origin[1] = params->origin[2] = 0.0f;
+	params->step[0] = params->step[1] = params->step[2] = 1.0f;
+	params->rowstride = 0;
+	params->slicestride = 0;
+	params->tilesize = 64;
+}
+
+/* Everything a tile task needs, shared by all threads */
+typedef struct {
+	float *dst;
+	const noiseFieldParams *params;
+	size_t rowstride, slicestride;
+	int tilesize, tilesx, tilesy;
+	float filterwidth;
+	noiseFieldKernel kernel;
+	void *user;
+	float *scratch;       // Four rows of tilesize floats per thread
+	size_t scratchstride; // Floats between the scratch of two threads
+} fieldJob;
+
+/*
+ * fieldTile() - evaluate one tile, one row at a time, straight into dst.
+ * Tiles are numbered row by row within each slice.
+ */
+static void fieldTile(void *arg, int index, int thread) {
+	fieldJob *job = (fieldJob*)arg;
+	const noiseFieldParams *p = job->params;
+	float *xs, *ys, *zs, *fw, y, z;
+	int i, j, n, x0, y0, y1, slice, tile;
+
+	slice = index / (job->tilesx * job->tilesy);
+	tile = index % (job->tilesx * job->tilesy);
+	x0 = (tile % job->tilesx) * job->tilesize;
+	y0 = (tile / job->tilesx) * job->tilesize;
+	n = (p->width - x0 < job->tilesize) ? p->width - x0 : job->tilesize;
+	y1 = (p->height - y0 < job->tilesize) ? p->height : y0 + job->tilesize;
+
+	xs = job->scratch + (size_t)thread * job->scratchstride;
+	ys = xs + job->tilesize;
+	zs = ys + job->tilesize;
+	fw = zs + job->tilesize;
+	z = p->origin[2] + slice * p->step[2];
+	for(i = 0; i < n; i++) {
+		xs[i] = p->origin[0] + (x0 + i) * p->step[0];
+		zs[i] = z;
+		fw[i] = job->filterwidth;
+	}
+	for(j = y0; j < y1; j++) {
+		y = p->origin[1] + j * p->step[1];
+		for(i = 0; i < n; i++) ys[i] = y;
+		job->kernel(xs, ys, zs, fw, job->dst + slice * job->slicestride
+			+ j * job->rowstride + x0, n, job->user);
+	}
+}
+
+int noiseFieldGenerate(noisePool *pool, float *dst, const noiseFieldParams *params,
+	noiseFieldKernel kernel, void *user) {
+	fieldJob job;
+	int threads, depth, ntiles;
+	float fw;
+
+	depth = (params->depth < 1) ? 1 : params->depth;
+	if(params->width <= 0 || params->height <= 0 || dst == NULL || kernel == NULL) return -1;
+
+	job.dst = dst;
+	job.params = params;
+	job.rowstride = params->rowstride ? params->rowstride : (size_t)params->width;
+	job.slicestride = params->slicestride ? params->slicestride
+		: (size_t)params->height * job.rowstride;
+	job.tilesize = (params->tilesize > 0) ? params->tilesize : 64;
+	job.tilesx = (params->width + job.tilesize - 1) / job.tilesize;
+	job.tilesy = (params->height + job.tilesize - 1) / job.tilesize;
+	fw = fabsf(params->step[0]);
+	if(fabsf(params->step[1]) > fw) fw = fabsf(params->step[1]);
+	if(depth > 1 && fabsf(params->step[2]) > fw) fw = fabsf(params->step[2]);
+	job.filterwidth = fw;
+	job.kernel = kernel;
+	job.user = user;
+	if((long long)job.tilesx * job.tilesy * depth > 0x7fffffff) return -1;
+	ntiles = job.tilesx * job.tilesy * depth;
+
+	// Round the scratch of each thread up to whole cache lines
+	threads = pool ? noisePoolThreads(pool) : 1;
+	job.scratchstride = ((size_t)job.tilesize * 4 + 15) & ~(size_t)15;
+	job.scratch = (float*)malloc(threads * job.scratchstride * sizeof(float));
+	if(job.scratch == NULL) return -1;
+
+	noisePoolFor(pool, ntiles, fieldTile, &job);
+	free(job.scratch);
+	return 0;
+}
@@ -0,0 +1,165 @@
+/*
+ * cpuNoiseGraph.c - noise expression graphs, compiled into one program
+ * that the SIMD kernels run for each step of samples. See cpuNoise.h.
+ *
+ * The compiler is a single pass over the nodes, which are already in
+ * evaluation order: nodes that the output does not depend on are dropped,
+ * and each remaining node gets the first free vector slot, after the
+ * slots of the inputs it is the last user of have been freed. The result
+ * may therefore overwrite one of its own inputs, which the kernels allow.
+ *
+ * This code is in the public domain.
+ */
+
+#include <stdlib.h> // For malloc(), realloc() and free()
+#include <string.h> // For memset()
+
+#include "cpuNoise.h"
+#include "cpuNoiseKernels.h"
+
+struct noiseGraph {
+	noiseNode *nodes;
+	int count, capacity;
+	noiseGraphInstr *code; // One instruction per node, at most
+	noiseGraphProgram program;
+};
+
+/* Number of inputs that each noiseNodeOp reads */
+static const int nodeInputs[NOISE_NODE_COUNT] = {
+	0, 0, 0, 0,       // X, Y, Z, CONST
+	2, 2, 2, 2, 2, 2, // ADD, SUB, MUL, DIV, MIN, MAX
+	1, 1, 1, 1,       // ABS, MAD, CLAMP, SMOOTHSTEP
+	3, 3, 3, 3        // MIX, NOISE, FBM, WARP
+};
+
+void noiseNodeInit(noiseNode *node, noiseNodeOp op) {
+	memset(node, 0, sizeof(noiseNode));
+	node->op = op;
+	node->in[0] = node->in[1] = node->in[2] = -1;
+	noiseFbmDefaults(&node->fbm);
+}
+
+noiseGraph *noiseGraphCreate(void) {
+	return (noiseGraph*)calloc(1, sizeof(noiseGraph));
+}
+
+void noiseGraphDestroy(noiseGraph *graph) {
+	if(graph == NULL) return;
+	free(graph->nodes);
+	free(graph->code);
+	free(graph);
+}
+
+int noiseGraphAdd(noiseGraph *graph, const noiseNode *node) {
+	noiseNode *nodes;
+	int k, capacity;
+
+	if(node->op < 0 || node->op >= NOISE_NODE_COUNT) return -1;
+	for(k = 0; k < nodeInputs[node->op]; k++) {
+		if(node->in[k] < 0 || node->in[k] >= graph->count) return -1;
+	}
+	if(graph->count == graph->capacity) {
+		capacity = graph->capacity ? 2 * graph->capacity : 16;
+		nodes = (noiseNode*)realloc(graph->nodes, capacity * sizeof(noiseNode));
+		if(nodes == NULL) return -1;
+		graph->nodes = nodes;
+		graph->capacity = capacity;
+	}
+	graph->nodes[graph->count] = *node;
+	return graph->count++;
+}
+
+int noiseGraphCompile(noiseGraph *graph, int output) {
+	noiseGraphInstr *code, *ins;
+	const noiseNode *node;
+	int *live, *lastuse, *slot, freeslots[NOISE_GRAPH_SLOTS];
+	int i, k, j, nfree, used, length, result = -1;
+
+	if(output < 0 || output >= graph->count) return -1;
+	code = (noiseGraphInstr*)malloc((output + 1) * sizeof(noiseGraphInstr));
+	live = (int*)malloc(3 * (output + 1) * sizeof(int));
+	if(code == NULL || live == NULL) {
+		free(code);
+		free(live);
+		return -1;
+	}
+	lastuse = live + output + 1;
+	slot = lastuse + output + 1;
+
+	// Mark the nodes the output depends on, and where each is last used
+	for(i = 0; i <= output; i++) live[i] = 0;
+	live[output] = 1;
+	lastuse[output] = output + 1; // Never freed
+	for(i = output; i >= 0; i--) {
+		if(!live[i]) continue;
+		node = &graph->nodes[i];
+		for(k = 0; k < nodeInputs[node->op]; k++) {
+			j = node->in[k];
+			if(!live[j]) {
+				live[j] = 1;
+				lastuse[j] = i;
+			}
+		}
+	}
+
+	// Allocate slots in evaluation order, freed slots first
+	nfree = 0;
+	used = 0;
+	length = 0;
+	for(i = 0; i <= output; i++) {
+		if(!live[i]) continue;
+		node = &graph->nodes[i];
+		for(k = 0; k < nodeInputs[node->op]; k++) {
+			j = node->in[k];
+			// The same input may appear twice, but is freed only once
+			if(lastuse[j] == i && (k < 1 || node->in[0] != j) && (k < 2 || node->in[1] != j)) {
+				freeslots[nfree++] = slot[j];
+			}
+		}
+		if(nfree > 0) slot[i] = freeslots[--nfree];
+		else if(used < NOISE_GRAPH_SLOTS) slot[i] = used++;
+		else break;
+
+		ins = &code[length++];
+		ins->op = node->op;
+		ins->dst = slot[i];
+		ins->a = (nodeInputs[node->op] > 0) ? slot[node->in[0]] : 0;
+		ins->b = (nodeInputs[node->op] > 1) ? slot[node->in[1]] : 0;
+		ins->c = (nodeInputs[node->op] > 2) ? slot[node->in[2]] : 0;
+		ins->axis = (int)node->value[2];
+		if(ins->axis < 0 || ins->axis > 2) ins->axis = 0;
+		ins->value[0] = node->value[0];
+		ins->value[1] = node->value[1];
+		ins->value[2] = node->value[2];
+		ins->fbm = node->fbm;
+		if(i == output) result = slot[i];
+	}
+	free(live);
+	if(result < 0) {
+		free(code);
+		return -1;
+	}
+
+	free(graph->code);
+	graph->code = code;
+	graph->program.code = code;
+	graph->program.length = length;
+	graph->program.result = result;
+	return 0;
+}
+
+void noiseGraphEvaluate(const noiseGraph *graph, const float *x, const float *y,
+	const float *z, const float *filterwidth, float *out, int n) {
+	int i;
+
+	if(graph->code == NULL) {
+		for(i = 0; i < n; i++) out[i] = 0.0f;
+		return;
+	}
+	noiseActiveKernels()->graph(&graph->program, x, y, z, filterwidth, out, n);
+}
+
+void noiseFieldGraph(const float *x, const float *y, const float *z,
+	const float *filterwidth, float *out, int n, void *user) {
+	noiseGraphEvaluate((const noiseGraph*)user, x, y, z, filterwidth, out, n);
+}
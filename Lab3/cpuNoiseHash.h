@@ -0,0 +1,185 @@
+/*
+ * cpuNoiseHash.h - the lattice hashing policies for cpuNoiseImpl.h.
+ *
+ * Every noise function hashes integer lattice points the same way:
+ * the lattice coordinates go through vlattice(), and are then chained
+ * through vpermute() as permute(permute(permute(z) + y) + x). The result
+ * is a whole number in [0, 289), which the gradient code maps to the
+ * Ashima gradient sets. Any vpermute() with that output range gives the
+ * same set of gradients, so the policies below are drop-in replacements
+ * for each other, selected by one of these macros at compile time:
+ *
+ * CPUNOISE_HASH_ASHIMA (the default) - the mod289() permutation polynomial
+ * of the GLSL code, with identical results, no tables and a period of 289.
+ *
+ * CPUNOISE_HASH_TABLE - a classic permutation table of 0..288 in the
+ * manner of Perlin's reference code, read with gathers. Also periodic
+ * with 289, but with no float arithmetic in the hash itself.
+ *
+ * CPUNOISE_HASH_INTEGER - a 32-bit integer mixing function (Chris
+ * Wellons' "lowbias32"), with the lattice coordinates left unreduced,
+ * so there is no period shorter than the float precision of the input
+ * and no loss of precision from mod289() far from the origin.
+ *
+ * The large coordinate kernels hash lattice points given as a 64-bit
+ * cell offset, shared by a whole batch, plus a small per lane offset.
+ * They do so through the type "vlat" and the functions below, which for
+ * the two mod 289 policies simply reduce the cell offset mod 289 once per
+ * batch, and for the integer hash keep the lattice in 32-bit integers:
+ *
+ * noiseLatticeBase latticeBase(c) - the 64-bit cell offset c, reduced once
+ * vlatticeAt(b, i) - the lattice point b + i, for whole numbers i
+ * vtolat(i) - the lattice point i, as vlattice() for the float kernels
+ * vlatadd(a, h) - the lattice point a + h, for whole numbers h
+ * vpermutelat(a) - vpermute() of a lattice point
+ *
+ * This file is meant to be included by cpuNoiseImpl.h only.
+ *
+ * This code is in the public domain.
+ */
+
+#ifndef CPUNOISEHASH_H
+#define CPUNOISEHASH_H
+
+#include "cpuNoiseSimd.h"
+
+static inline vfloat vmod289(vfloat x) {
+	return x - vfloor(x * (1.0f / 289.0f)) * 289.0f;
+}
+
+#if defined(CPUNOISE_HASH_TABLE)
+
+/* A fixed random permutation of 0..288 */
+static const float noisePermTable[289] = {
+	170, 167, 112, 254, 9, 163, 142, 92, 113, 253, 194, 127, 128, 91, 105, 197, 188,
+	218, 48, 165, 109, 281, 106, 121, 192, 207, 66, 242, 243, 12, 265, 39, 216, 59,
+	183, 21, 174, 204, 168, 264, 125, 246, 64, 29, 266, 54, 86, 14, 221, 88, 83,
+	145, 178, 84, 161, 135, 241, 82, 110, 261, 89, 17, 40, 10, 263, 252, 171, 166,
+	116, 67, 74, 140, 237, 274, 100, 156, 120, 152, 23, 256, 31, 50, 219, 108, 57,
+	244, 15, 45, 181, 24, 245, 4, 154, 123, 87, 6, 147, 258, 211, 286, 114, 99,
+	18, 30, 144, 78, 184, 16, 19, 269, 282, 60, 53, 36, 280, 96, 77, 56, 7,
+	139, 58, 220, 190, 232, 229, 172, 72, 195, 198, 0, 132, 214, 175, 104, 44, 164,
+	98, 33, 240, 155, 85, 215, 158, 191, 69, 277, 279, 143, 79, 276, 5, 213, 228,
+	187, 138, 27, 119, 80, 90, 136, 189, 212, 203, 122, 101, 34, 115, 267, 235, 287,
+	95, 2, 283, 126, 94, 202, 118, 159, 186, 148, 179, 81, 13, 47, 102, 234, 177,
+	248, 117, 134, 259, 149, 206, 1, 35, 51, 233, 223, 278, 226, 227, 180, 151, 250,
+	153, 73, 275, 70, 272, 76, 97, 68, 25, 249, 288, 208, 43, 103, 193, 268, 247,
+	231, 251, 11, 32, 75, 200, 131, 129, 107, 257, 8, 22, 49, 52, 270, 38, 20,
+	222, 260, 160, 210, 42, 46, 133, 130, 63, 146, 3, 273, 224, 176, 236, 185, 62,
+	196, 182, 285, 239, 284, 169, 65, 61, 111, 150, 37, 93, 141, 271, 255, 225, 157,
+	71, 238, 124, 41, 162, 201, 55, 28, 137, 209, 230, 262, 199, 173, 205, 26, 217
+};
+
+/*
+ * With fast math, vmod289() can return 289.0 for exact multiples of 289,
+ * harmless for the polynomial but not as a table index, so wrap that too
+ */
+static inline vfloat vlattice(vfloat x) {
+	x = vmod289(x);
+	return x - vstep(vset1(289.0f), x) * 289.0f;
+}
+
+/* x is at most 288 + 288 + 1, so one conditional subtraction wraps it */
+static inline vfloat vpermute(vfloat x) {
+	return vgather(noisePermTable, x - vstep(vset1(289.0f), x) * 289.0f);
+}
+
+#define NOISE_FLOAT_LATTICE
+
+#elif defined(CPUNOISE_HASH_INTEGER)
+
+static inline vfloat vlattice(vfloat x) {
+	return x;
+}
+
+/*
+ * Hash the whole number in x, then scale the top 16 bits of the hash
+ * to [0, 289) with a multiply and shift instead of a division. The xor
+ * with a constant first breaks up the near linear output of lowbias32
+ * for small inputs, where the lattice coordinates of most noise are.
+ */
+static inline vfloat vpermutei(vint h) {
+	h = vxori(h, vset1i(0x9e3779b9U));
+	h = vxori(h, vsrli(h, 16));
+	h = vmuli(h, vset1i(0x7feb352dU));
+	h = vxori(h, vsrli(h, 15));
+	h = vmuli(h, vset1i(0x846ca68bU));
+	h = vxori(h, vsrli(h, 16));
+	return vtofloat(vsrli(vmuli(vsrli(h, 16), vset1i(289)), 16));
+}
+
+static inline vfloat vpermute(vfloat x) {
+	return vpermutei(vtoint(x));
+}
+
+/*
+ * Lattice points stay 32-bit integers, which wrap around exactly like
+ * vtoint() of the same whole number would, so a cell offset gives the
+ * same noise as the float kernels wherever those are exact.
+ */
+typedef unsigned int noiseLatticeBase;
+typedef vint vlat;
+
+static inline noiseLatticeBase latticeBase(long long c) {
+	return (unsigned int)c;
+}
+
+static inline vlat vlatticeAt(noiseLatticeBase b, vfloat i) {
+	return vaddi(vset1i(b), vtoint(i));
+}
+
+static inline vlat vtolat(vfloat i) {
+	return vtoint(i);
+}
+
+static inline vlat vlatadd(vlat a, vfloat h) {
+	return vaddi(a, vtoint(h));
+}
+
+static inline vfloat vpermutelat(vlat a) {
+	return vpermutei(a);
+}
+
+#else /* CPUNOISE_HASH_ASHIMA */
+
+static inline vfloat vlattice(vfloat x) {
+	return vmod289(x);
+}
+
+static inline vfloat vpermute(vfloat x) {
+	return vmod289((x * 34.0f + 1.0f) * x);
+}
+
+#define NOISE_FLOAT_LATTICE
+
+#endif
+
+#ifdef NOISE_FLOAT_LATTICE
+/* Both mod 289 policies keep lattice points as floats in [0, 289) */
+typedef float noiseLatticeBase;
+typedef vfloat vlat;
+
+/* c mod 289, exactly, as the float lattice coordinate of the whole batch */
+static inline noiseLatticeBase latticeBase(long long c) {
+	c %= 289;
+	return (float)((c < 0) ? c + 289 : c);
+}
+
+static inline vlat vlatticeAt(noiseLatticeBase b, vfloat i) {
+	return vlattice(vset1(b) + i);
+}
+
+static inline vlat vtolat(vfloat i) {
+	return vlattice(i);
+}
+
+static inline vlat vlatadd(vlat a, vfloat h) {
+	return a + h;
+}
+
+static inline vfloat vpermutelat(vlat a) {
+	return vpermute(a);
+}
+#endif
+
+#endif /* CPUNOISEHASH_H */
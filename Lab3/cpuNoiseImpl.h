@@ -0,0 +1,1047 @@
+/*
+ * cpuNoiseImpl.h - CPU ports of the Ashima Arts GLSL noise functions
+ * in noise/src, written once against the vector abstraction in
+ * cpuNoiseSimd.h and instantiated for each instruction set by
+ * cpuNoiseScalar.c, cpuNoiseSSE41.c, cpuNoiseAVX2.c and cpuNoiseAVX512.c,
+ * each of which exports the kernel table defined at the end of this file.
+ *
+ * Each lane of a vfloat holds one sample point. Where the GLSL code
+ * uses a vec4 to process the corners of a simplex side by side, the
+ * code below computes one corner at a time for all lanes instead.
+ * The arithmetic is otherwise kept exactly as in the shaders: the same
+ * mod289() hashing, the same gradient construction and the same
+ * taylorInvSqrt() normalization, all in single precision. The hashing
+ * can be swapped for a permutation table or an integer hash at compile
+ * time, see cpuNoiseHash.h.
+ *
+ * This file is meant to be included, not compiled on its own.
+ *
+ * This code is in the public domain.
+ */
+
+#include <stddef.h> // For size_t
+
+#include "cpuNoiseSimd.h"
+#include "cpuNoiseHash.h"
+#include "cpuNoiseKernels.h"
+
+/*
+ * Helpers shared by all noise functions (noise2D.glsl etc.)
+ */
+static inline vfloat vtaylorInvSqrt(vfloat r) {
+	return 1.79284291400159f - 0.85373472095314f * r;
+}
+
+static inline vfloat vfract(vfloat x) {
+	return x - vfloor(x);
+}
+
+/*
+ * vsnoise2d() - 2D simplex noise, as snoise(vec2) in noise2D.glsl,
+ * with the analytic gradient in d[0..1].
+ * Gradients: 41 points uniformly over a line, mapped onto a diamond.
+ */
+static inline vfloat vsnoise2d(vfloat vx, vfloat vy, vfloat *d) {
+	const float C[4] = {
+		0.211324865405187f,   // (3.0-sqrt(3.0))/6.0
+		0.366025403784439f,   // 0.5*(sqrt(3.0)-1.0)
+		-0.577350269189626f,  // -1.0 + 2.0 * C.x
+		0.024390243902439f};  // 1.0 / 41.0
+	vfloat s, t, ix, iy, i1x, i1y, py0, py1, p[3];
+	vfloat cx[3], cy[3], gx, h, m, m2, norm, gdotx, a, b, n;
+	int k;
+
+	// First corner
+	s = vexact((vx + vy) * C[1]);
+	ix = vfloor(vx + s);
+	iy = vfloor(vy + s);
+	t = vexact((ix + iy) * C[0]);
+	cx[0] = vx - ix + t;
+	cy[0] = vy - iy + t;
+
+	// Other corners
+	i1x = 1.0f - vstep(cx[0], cy[0]); // x0.x > x0.y ? 1.0 : 0.0
+	i1y = 1.0f - i1x;
+	cx[1] = cx[0] + C[0] - i1x;
+	cy[1] = cy[0] + C[0] - i1y;
+	cx[2] = cx[0] + C[2];
+	cy[2] = cy[0] + C[2];
+
+	// Permutations, sharing the innermost permute() as in 3D
+	ix = vlattice(ix);
+	iy = vlattice(iy);
+	py0 = vpermute(iy);
+	py1 = vpermute(iy + 1.0f);
+	p[0] = vpermute(py0 + ix);
+	p[1] = vpermute(py0 + (py1 - py0) * i1y + ix + i1x);
+	p[2] = vpermute(py1 + ix + 1.0f);
+
+	n = vset1(0.0f);
+	d[0] = d[1] = vset1(0.0f);
+	for(k = 0; k < 3; k++) {
+		m = vmax(0.5f - (cx[k] * cx[k] + cy[k] * cy[k]), vset1(0.0f));
+		m2 = m * m;
+		gx = 2.0f * vfract(p[k] * C[3]) - 1.0f;
+		h = vabs(gx) - 0.5f;
+		gx = gx - vfloor(gx + 0.5f);
+		// Normalise gradients implicitly by scaling m
+		norm = vtaylorInvSqrt(gx * gx + h * h);
+		gdotx = gx * cx[k] + h * cy[k];
+		a = m2 * m2 * norm;
+		b = -8.0f * m2 * m * norm * gdotx;
+		d[0] = d[0] + a * gx + b * cx[k];
+		d[1] = d[1] + a * h + b * cy[k];
+		n = n + a * gdotx;
+	}
+	d[0] = 130.0f * d[0];
+	d[1] = 130.0f * d[1];
+	return 130.0f * n;
+}
+
+static inline vfloat vsnoise2(vfloat vx, vfloat vy) {
+	vfloat d[2];
+	return vsnoise2d(vx, vy, d);
+}
+
+/*
+ * vgrad3corner() - the contribution from one corner of a 3D simplex:
+ * gradient number p (0..288) mapped to a point on an octahedron,
+ * normalized and dotted with the offset (x, y, z) from the corner,
+ * weighted by the radial falloff m^4.
+ * Gradients: 7x7 points over a square, mapped onto an octahedron.
+ *
+ * The analytic derivative of the contribution is added to d[0..2]:
+ * d(m^4 g.x)/dx = m^4 g - 8 m^3 (g.x) x, with m = 0.6 - x.x (or 0).
+ * When the caller ignores d, the compiler removes that code entirely.
+ */
+static inline vfloat vgrad3corner(vfloat p, vfloat x, vfloat y, vfloat z, vfloat *d) {
+	const float nsx = 2.0f * 0.142857142857f;       // n_ * D.w - D.x
+	const float nsy = 0.5f * 0.142857142857f - 1.0f; // n_ * D.y - D.z
+	const float nsz = 0.142857142857f;               // n_ * D.z - D.x
+	vfloat j, gx_, gy_, gx, gy, gz, sh, norm, m, m2, gdotx, a, b;
+
+	j = p - 49.0f * vfloor(p * (nsz * nsz)); // mod(p,7*7)
+	gx_ = vfloor(j * nsz);
+	gy_ = j - 7.0f * gx_; // mod(j,N), already an integer so floor() is not needed
+	gx = gx_ * nsx + nsy;
+	gy = gy_ * nsx + nsy;
+	gz = 1.0f - vabs(gx) - vabs(gy);
+
+	// floor(b)*2.0+1.0 in the shader is just the sign of b as +/-1.0,
+	// since b is never 0 or outside [-1,1). vsign1() is the same value.
+	sh = -vstep(gz, vset1(0.0f));
+	gx = gx + vsign1(gx) * sh;
+	gy = gy + vsign1(gy) * sh;
+
+	norm = vtaylorInvSqrt(gx * gx + gy * gy + gz * gz);
+	m = vmax(0.6f - (x * x + y * y + z * z), vset1(0.0f));
+	m2 = m * m;
+	gdotx = gx * x + gy * y + gz * z;
+	a = m2 * m2 * norm;
+	b = -8.0f * m2 * m * norm * gdotx;
+	d[0] = d[0] + a * gx + b * x;
+	d[1] = d[1] + a * gy + b * y;
+	d[2] = d[2] + a * gz + b * z;
+	return a * gdotx;
+}
+
+/*
+ * vsnoise3corners() - the second half of snoise(vec3): given the offset
+ * x0 from the first corner of the simplex and that corner's lattice point,
+ * find the other corners, hash them and sum the four contributions.
+ */
+static inline vfloat vsnoise3corners(vfloat x0, vfloat y0, vfloat z0,
+	vlat ix, vlat iy, vlat iz, vfloat *d) {
+	const float Cx = 1.0f / 6.0f, Cy = 1.0f / 3.0f;
+	vfloat gx, gy, gz, lx, ly, lz;
+	vfloat i1x, i1y, i1z, i2x, i2y, i2z;
+	vfloat p0, p1, p2, p3, px, py, pz;
+	vfloat n;
+
+	// Other corners
+	gx = vstep(y0, x0);
+	gy = vstep(z0, y0);
+	gz = vstep(x0, z0);
+	lx = 1.0f - gx;
+	ly = 1.0f - gy;
+	lz = 1.0f - gz;
+	i1x = vmin(gx, lz); i1y = vmin(gy, lx); i1z = vmin(gz, ly);
+	i2x = vmax(gx, lz); i2y = vmax(gy, lx); i2z = vmax(gz, ly);
+
+	// Permutations
+	// The innermost permute() only ever sees iz or iz+1.0, so compute
+	// those two once and pick between them with the 0/1 offsets.
+	p0 = vpermutelat(iz);
+	p3 = vpermutelat(vlatadd(iz, vset1(1.0f)));
+	pz = p3 - p0;
+	p1 = vpermutelat(vlatadd(ix, vpermutelat(vlatadd(iy, p0 + pz * i1z + i1y)) + i1x));
+	p2 = vpermutelat(vlatadd(ix, vpermutelat(vlatadd(iy, p0 + pz * i2z + i2y)) + i2x));
+	p0 = vpermutelat(vlatadd(ix, vpermutelat(vlatadd(iy, p0))));
+	p3 = vpermutelat(vlatadd(ix, vpermutelat(vlatadd(iy, p3 + 1.0f)) + 1.0f));
+
+	// Mix final noise value, one corner at a time
+	d[0] = d[1] = d[2] = vset1(0.0f);
+	n = vgrad3corner(p0, x0, y0, z0, d);
+	px = x0 - i1x + Cx; py = y0 - i1y + Cx; pz = z0 - i1z + Cx;
+	n = n + vgrad3corner(p1, px, py, pz, d);
+	px = x0 - i2x + Cy; py = y0 - i2y + Cy; pz = z0 - i2z + Cy;
+	n = n + vgrad3corner(p2, px, py, pz, d);
+	px = x0 - 0.5f; py = y0 - 0.5f; pz = z0 - 0.5f;
+	n = n + vgrad3corner(p3, px, py, pz, d);
+	d[0] = 42.0f * d[0];
+	d[1] = 42.0f * d[1];
+	d[2] = 42.0f * d[2];
+	return 42.0f * n;
+}
+
+/*
+ * vsnoise3d() - 3D simplex noise, as snoise(vec3) in noise3D.glsl,
+ * also returning the analytic gradient of the noise in d[0..2]
+ */
+static inline vfloat vsnoise3d(vfloat vx, vfloat vy, vfloat vz, vfloat *d) {
+	const float Cx = 1.0f / 6.0f, Cy = 1.0f / 3.0f;
+	vfloat s, t, ix, iy, iz;
+
+	// First corner
+	s = vexact((vx + vy + vz) * Cy);
+	ix = vfloor(vx + s);
+	iy = vfloor(vy + s);
+	iz = vfloor(vz + s);
+	t = vexact((ix + iy + iz) * Cx);
+	return vsnoise3corners(vx - ix + t, vy - iy + t, vz - iz + t,
+		vtolat(ix), vtolat(iy), vtolat(iz), d);
+}
+
+/*
+ * Large coordinates: the point cell + (x, y, z), with a 64-bit whole
+ * number cell shared by a batch and small float offsets x, y and z.
+ * Skewing is linear, so the cell can be skewed on its own. With the
+ * cell sum split as 3q + r, r in {0, 1, 2}, the skewed cell is the whole
+ * number cell + q plus a fraction r/3 that is left to the float side.
+ * The q terms cancel in the unskewed offset x0, so the only 64-bit work
+ * is reducing cell + q for the hash, once per batch. noiseLargeCell holds
+ * that per batch setup, for the cell scaled by the frequency of one octave.
+ */
+typedef struct {
+	float frac[3];              // Fraction of cell * frequency, added to x, y, z
+	float r;                    // (sum of the whole cell) mod 3
+	noiseLatticeBase base[3];   // Skewed whole cell, reduced for the hash
+} noiseLargeCell;
+
+static void largeCellSetup(noiseLargeCell *c, const long long *cell, double freq) {
+	long long b[3], sum, q;
+	double v;
+	int k;
+
+	for(k = 0; k < 3; k++) {
+		v = (double)cell[k] * freq;
+		b[k] = (long long)floor(v);
+		c->frac[k] = (float)(v - (double)b[k]);
+	}
+	sum = b[0] + b[1] + b[2];
+	q = sum / 3;
+	if(sum - 3 * q < 0) q--;
+	c->r = (float)(sum - 3 * q);
+	for(k = 0; k < 3; k++) c->base[k] = latticeBase(b[k] + q);
+}
+
+/*
+ * vsnoise3larged() - vsnoise3d() of the point c + (vx, vy, vz). With a
+ * zero cell, this is vsnoise3d() up to rounding.
+ */
+static inline vfloat vsnoise3larged(const noiseLargeCell *c,
+	vfloat vx, vfloat vy, vfloat vz, vfloat *d) {
+	const float Cx = 1.0f / 6.0f, Cy = 1.0f / 3.0f;
+	vfloat s, t, ix, iy, iz;
+
+	vx = vx + c->frac[0];
+	vy = vy + c->frac[1];
+	vz = vz + c->frac[2];
+	s = vexact((vx + vy + vz + c->r) * Cy);
+	ix = vfloor(vx + s);
+	iy = vfloor(vy + s);
+	iz = vfloor(vz + s);
+	t = vexact((ix + iy + iz + c->r) * Cx);
+	return vsnoise3corners(vx - ix + t, vy - iy + t, vz - iz + t,
+		vlatticeAt(c->base[0], ix), vlatticeAt(c->base[1], iy),
+		vlatticeAt(c->base[2], iz), d);
+}
+
+static inline vfloat vsnoise3large(const noiseLargeCell *c, vfloat vx, vfloat vy, vfloat vz) {
+	vfloat d[3];
+	return vsnoise3larged(c, vx, vy, vz, d);
+}
+
+static inline vfloat vsnoise3(vfloat vx, vfloat vy, vfloat vz) {
+	vfloat d[3];
+	return vsnoise3d(vx, vy, vz, d);
+}
+
+/*
+ * vgrad4corner() - the contribution from one corner of a 4D simplex,
+ * as grad4() in noise4D.glsl followed by the normalization and falloff.
+ * Gradients: 7x7x6 points over a cube, mapped onto a 4-cross polytope.
+ */
+static inline vfloat vgrad4corner(vfloat j, vfloat x, vfloat y, vfloat z, vfloat w,
+	vfloat *d) {
+	const float ipx = 1.0f / 294.0f, ipy = 1.0f / 49.0f, ipz = 1.0f / 7.0f;
+	vfloat gx, gy, gz, gw, sw, norm, m, m2, gdotx, a, b;
+
+	gx = j * ipx; gx = vfloor((gx - vfloor(gx)) * 7.0f) * ipz - 1.0f;
+	gy = j * ipy; gy = vfloor((gy - vfloor(gy)) * 7.0f) * ipz - 1.0f;
+	gz = j * ipz; gz = vfloor((gz - vfloor(gz)) * 7.0f) * ipz - 1.0f;
+	gw = 1.5f - (vabs(gx) + vabs(gy) + vabs(gz));
+	// s.xyz*2.0-1.0 in the shader is minus the sign of p.xyz, which is never 0
+	sw = 1.0f - vstep(vset1(0.0f), gw);
+	gx = gx - vsign1(gx) * sw;
+	gy = gy - vsign1(gy) * sw;
+	gz = gz - vsign1(gz) * sw;
+
+	norm = vtaylorInvSqrt(gx * gx + gy * gy + gz * gz + gw * gw);
+	m = vmax(0.6f - (x * x + y * y + z * z + w * w), vset1(0.0f));
+	m2 = m * m;
+	gdotx = gx * x + gy * y + gz * z + gw * w;
+	a = m2 * m2 * norm;
+	b = -8.0f * m2 * m * norm * gdotx; // Derivative, as in vgrad3corner()
+	d[0] = d[0] + a * gx + b * x;
+	d[1] = d[1] + a * gy + b * y;
+	d[2] = d[2] + a * gz + b * z;
+	d[3] = d[3] + a * gw + b * w;
+	return a * gdotx;
+}
+
+/*
+ * vsnoise4d() - 4D simplex noise, as snoise(vec4) in noise4D.glsl,
+ * with the analytic gradient in d[0..3].
+ * sxyz is x+y+z, which the caller may have computed once for several w.
+ */
+static inline vfloat vsnoise4d(vfloat vx, vfloat vy, vfloat vz, vfloat sxyz, vfloat vw,
+	vfloat *d) {
+	const float F4 = 0.309016994374947451f; // (sqrt(5) - 1)/4
+	const float C[4] = {
+		0.138196601125011f,   // (5 - sqrt(5))/20  G4
+		0.276393202250021f,   // 2 * G4
+		0.414589803375032f,   // 3 * G4
+		-0.447213595499958f}; // -1 + 4 * G4
+	vfloat s, t, ix, iy, iz, iw, x0, y0, z0, w0;
+	vfloat isXx, isXy, isXz, isYZx, isYZy, isYZz;
+	vfloat i0x, i0y, i0z, i0w;
+	vfloat j0, j1, j2, j3, j4, pw0, pw1, dpw;
+	vfloat n;
+
+	// First corner
+	s = vexact((sxyz + vw) * F4);
+	ix = vfloor(vx + s);
+	iy = vfloor(vy + s);
+	iz = vfloor(vz + s);
+	iw = vfloor(vw + s);
+	t = vexact((ix + iy + iz + iw) * C[0]);
+	x0 = vexact(vx - ix + t);
+	y0 = vexact(vy - iy + t);
+	z0 = vexact(vz - iz + t);
+	w0 = vexact(vw - iw + t);
+
+	// Other corners: rank sorting by Bill Licea-Kane, as in the shader.
+	// i0 ends up with the unique values 0,1,2,3 in each component.
+	isXx = vstep(y0, x0);
+	isXy = vstep(z0, x0);
+	isXz = vstep(w0, x0);
+	isYZx = vstep(z0, y0);
+	isYZy = vstep(w0, y0);
+	isYZz = vstep(w0, z0);
+	i0x = isXx + isXy + isXz;
+	i0y = 1.0f - isXx + isYZx + isYZy;
+	i0z = 1.0f - isXy + 1.0f - isYZx + isYZz;
+	i0w = 1.0f - isXz + 1.0f - isYZy + 1.0f - isYZz;
+
+	// Permutations. As in 3D, the innermost permute() only ever sees
+	// iw or iw+1.0, and the corner offsets i1, i2, i3 are all 0 or 1.
+	ix = vlattice(ix);
+	iy = vlattice(iy);
+	iz = vlattice(iz);
+	iw = vlattice(iw);
+	pw0 = vpermute(iw);
+	pw1 = vpermute(iw + 1.0f);
+	dpw = pw1 - pw0;
+	j0 = vpermute(vpermute(vpermute(pw0 + iz) + iy) + ix);
+	j4 = vpermute(vpermute(vpermute(pw1 + iz + 1.0f) + iy + 1.0f) + ix + 1.0f);
+#define CLAMP01(a) vmin(vmax((a), vset1(0.0f)), vset1(1.0f))
+#define CORNER4(o, jk, xk) { \
+	vfloat ox = CLAMP01(i0x - o), oy = CLAMP01(i0y - o); \
+	vfloat oz = CLAMP01(i0z - o), ow = CLAMP01(i0w - o); \
+	jk = vpermute(vpermute(vpermute(pw0 + dpw * ow + iz + oz) + iy + oy) + ix + ox); \
+	n = n + vgrad4corner(jk, x0 - ox + xk, y0 - oy + xk, z0 - oz + xk, w0 - ow + xk, d); }
+
+	// Mix contributions from the five corners
+	d[0] = d[1] = d[2] = d[3] = vset1(0.0f);
+	n = vgrad4corner(j0, x0, y0, z0, w0, d);
+	CORNER4(2.0f, j1, C[0]) // i1 = clamp(i0-2.0, 0.0, 1.0)
+	CORNER4(1.0f, j2, C[1]) // i2 = clamp(i0-1.0, 0.0, 1.0)
+	CORNER4(0.0f, j3, C[2]) // i3 = clamp(i0, 0.0, 1.0)
+	n = n + vgrad4corner(j4, x0 + C[3], y0 + C[3], z0 + C[3], w0 + C[3], d);
+#undef CORNER4
+#undef CLAMP01
+	d[0] = 49.0f * d[0];
+	d[1] = 49.0f * d[1];
+	d[2] = 49.0f * d[2];
+	d[3] = 49.0f * d[3];
+	return 49.0f * n;
+}
+
+static inline vfloat vsnoise4(vfloat vx, vfloat vy, vfloat vz, vfloat sxyz, vfloat vw) {
+	vfloat d[4];
+	return vsnoise4d(vx, vy, vz, sxyz, vw, d);
+}
+
+/*
+ * Classic Perlin noise, cnoise() and pnoise() from classicnoise2D.glsl,
+ * classicnoise3D.glsl and classicnoise4D.glsl. The periodic version only
+ * differs in how the integer lattice coordinates are wrapped, so both
+ * share one core function per dimension, which takes the two integer
+ * lattice coordinates along each axis already reduced by mod289().
+ */
+static inline vfloat vfade(vfloat t) {
+	return t * t * t * (t * (t * 6.0f - 15.0f) + 10.0f);
+}
+
+static inline vfloat vmix(vfloat a, vfloat b, vfloat t) {
+	return a + (b - a) * t;
+}
+
+/*
+ * mod(x, y) as in GLSL, for positive y. The final correction keeps the
+ * result in [0,y) even when x/y is computed as x*(1/y) and rounds down
+ * at exact multiples, which would break the periodicity.
+ */
+static inline vfloat vmodf(vfloat x, vfloat y) {
+	vfloat r = x - y * vfloor(x / y);
+	r = r - y * vstep(y, r);
+	return r + y * (1.0f - vstep(vset1(0.0f), r));
+}
+
+/* The gradient dot product for one corner of the 2D lattice */
+static inline vfloat vcgrad2(vfloat i, vfloat fx, vfloat fy) {
+	vfloat gx, gy;
+	gx = vfract(i * (1.0f / 41.0f)) * 2.0f - 1.0f;
+	gy = vabs(gx) - 0.5f;
+	gx = gx - vfloor(gx + 0.5f);
+	return vtaylorInvSqrt(gx * gx + gy * gy) * (gx * fx + gy * fy);
+}
+
+static inline vfloat vcnoise2core(vfloat ix0, vfloat iy0, vfloat ix1, vfloat iy1,
+	vfloat fx0, vfloat fy0) {
+	vfloat fx1 = fx0 - 1.0f, fy1 = fy0 - 1.0f;
+	vfloat px0 = vpermute(ix0), px1 = vpermute(ix1);
+	vfloat n00, n10, n01, n11, fadex, fadey;
+
+	n00 = vcgrad2(vpermute(px0 + iy0), fx0, fy0);
+	n10 = vcgrad2(vpermute(px1 + iy0), fx1, fy0);
+	n01 = vcgrad2(vpermute(px0 + iy1), fx0, fy1);
+	n11 = vcgrad2(vpermute(px1 + iy1), fx1, fy1);
+
+	fadex = vfade(fx0);
+	fadey = vfade(fy0);
+	return 2.3f * vmix(vmix(n00, n10, fadex), vmix(n01, n11, fadex), fadey);
+}
+
+static inline vfloat vcnoise2(vfloat x, vfloat y) {
+	vfloat ix = vfloor(x), iy = vfloor(y);
+	return vcnoise2core(vlattice(ix), vlattice(iy), vlattice(ix + 1.0f), vlattice(iy + 1.0f),
+		x - ix, y - iy);
+}
+
+static inline vfloat vpnoise2(vfloat x, vfloat y, vfloat repx, vfloat repy) {
+	vfloat ix = vfloor(x), iy = vfloor(y);
+	return vcnoise2core(vlattice(vmodf(ix, repx)), vlattice(vmodf(iy, repy)),
+		vlattice(vmodf(ix + 1.0f, repx)), vlattice(vmodf(iy + 1.0f, repy)),
+		x - ix, y - iy);
+}
+
+/* The gradient dot product for one corner of the 3D lattice */
+static inline vfloat vcgrad3(vfloat h, vfloat fx, vfloat fy, vfloat fz) {
+	vfloat gx, gy, gz, sz;
+	gx = h * (1.0f / 7.0f);
+	gy = vfract(vfloor(gx) * (1.0f / 7.0f)) - 0.5f;
+	gx = vfract(gx);
+	gz = 0.5f - vabs(gx) - vabs(gy);
+	sz = vstep(gz, vset1(0.0f));
+	gx = gx - sz * (vstep(vset1(0.0f), gx) - 0.5f);
+	gy = gy - sz * (vstep(vset1(0.0f), gy) - 0.5f);
+	return vtaylorInvSqrt(gx * gx + gy * gy + gz * gz) * (gx * fx + gy * fy + gz * fz);
+}
+
+static inline vfloat vcnoise3core(vfloat ix0, vfloat iy0, vfloat iz0,
+	vfloat ix1, vfloat iy1, vfloat iz1, vfloat fx0, vfloat fy0, vfloat fz0) {
+	vfloat fx1 = fx0 - 1.0f, fy1 = fy0 - 1.0f, fz1 = fz0 - 1.0f;
+	vfloat px0 = vpermute(ix0), px1 = vpermute(ix1);
+	vfloat i00 = vpermute(px0 + iy0), i10 = vpermute(px1 + iy0);
+	vfloat i01 = vpermute(px0 + iy1), i11 = vpermute(px1 + iy1);
+	vfloat n000, n100, n010, n110, n001, n101, n011, n111;
+	vfloat fadex, fadey, fadez, nz00, nz10, nz01, nz11;
+
+	n000 = vcgrad3(vpermute(i00 + iz0), fx0, fy0, fz0);
+	n100 = vcgrad3(vpermute(i10 + iz0), fx1, fy0, fz0);
+	n010 = vcgrad3(vpermute(i01 + iz0), fx0, fy1, fz0);
+	n110 = vcgrad3(vpermute(i11 + iz0), fx1, fy1, fz0);
+	n001 = vcgrad3(vpermute(i00 + iz1), fx0, fy0, fz1);
+	n101 = vcgrad3(vpermute(i10 + iz1), fx1, fy0, fz1);
+	n011 = vcgrad3(vpermute(i01 + iz1), fx0, fy1, fz1);
+	n111 = vcgrad3(vpermute(i11 + iz1), fx1, fy1, fz1);
+
+	fadex = vfade(fx0);
+	fadey = vfade(fy0);
+	fadez = vfade(fz0);
+	nz00 = vmix(n000, n001, fadez);
+	nz10 = vmix(n100, n101, fadez);
+	nz01 = vmix(n010, n011, fadez);
+	nz11 = vmix(n110, n111, fadez);
+	return 2.2f * vmix(vmix(nz00, nz01, fadey), vmix(nz10, nz11, fadey), fadex);
+}
+
+static inline vfloat vcnoise3(vfloat x, vfloat y, vfloat z) {
+	vfloat ix = vfloor(x), iy = vfloor(y), iz = vfloor(z);
+	return vcnoise3core(vlattice(ix), vlattice(iy), vlattice(iz),
+		vlattice(ix + 1.0f), vlattice(iy + 1.0f), vlattice(iz + 1.0f),
+		x - ix, y - iy, z - iz);
+}
+
+static inline vfloat vpnoise3(vfloat x, vfloat y, vfloat z,
+	vfloat repx, vfloat repy, vfloat repz) {
+	vfloat ix = vfloor(x), iy = vfloor(y), iz = vfloor(z);
+	vfloat ix0 = vmodf(ix, repx), iy0 = vmodf(iy, repy), iz0 = vmodf(iz, repz);
+	return vcnoise3core(vlattice(ix0), vlattice(iy0), vlattice(iz0),
+		vlattice(vmodf(ix0 + 1.0f, repx)), vlattice(vmodf(iy0 + 1.0f, repy)),
+		vlattice(vmodf(iz0 + 1.0f, repz)), x - ix, y - iy, z - iz);
+}
+
+/* The gradient dot product for one corner of the 4D lattice */
+static inline vfloat vcgrad4(vfloat h, vfloat fx, vfloat fy, vfloat fz, vfloat fw) {
+	vfloat gx, gy, gz, gw, sw;
+	gx = h * (1.0f / 7.0f);
+	gy = vfloor(gx) * (1.0f / 7.0f);
+	gz = vfloor(gy) * (1.0f / 6.0f);
+	gx = vfract(gx) - 0.5f;
+	gy = vfract(gy) - 0.5f;
+	gz = vfract(gz) - 0.5f;
+	gw = 0.75f - vabs(gx) - vabs(gy) - vabs(gz);
+	sw = vstep(gw, vset1(0.0f));
+	gx = gx - sw * (vstep(vset1(0.0f), gx) - 0.5f);
+	gy = gy - sw * (vstep(vset1(0.0f), gy) - 0.5f);
+	return vtaylorInvSqrt(gx * gx + gy * gy + gz * gz + gw * gw)
+		* (gx * fx + gy * fy + gz * fz + gw * fw);
+}
+
+static inline vfloat vcnoise4core(vfloat ix0, vfloat iy0, vfloat iz0, vfloat iw0,
+	vfloat ix1, vfloat iy1, vfloat iz1, vfloat iw1,
+	vfloat fx0, vfloat fy0, vfloat fz0, vfloat fw0) {
+	vfloat fx1 = fx0 - 1.0f, fy1 = fy0 - 1.0f, fz1 = fz0 - 1.0f, fw1 = fw0 - 1.0f;
+	vfloat px0 = vpermute(ix0), px1 = vpermute(ix1);
+	vfloat ixy[4], ixyz, n[2][2][2][2]; // n[w][z][y][x]
+	vfloat fadex, fadey, fadez, fadew, nzw[2][2], nyzw[2];
+	int c, iz, iw;
+
+	ixy[0] = vpermute(px0 + iy0);
+	ixy[1] = vpermute(px1 + iy0);
+	ixy[2] = vpermute(px0 + iy1);
+	ixy[3] = vpermute(px1 + iy1);
+	for(iz = 0; iz < 2; iz++) {
+		for(c = 0; c < 4; c++) {
+			ixyz = vpermute(ixy[c] + (iz ? iz1 : iz0));
+			for(iw = 0; iw < 2; iw++) {
+				n[iw][iz][c >> 1][c & 1] = vcgrad4(vpermute(ixyz + (iw ? iw1 : iw0)),
+					(c & 1) ? fx1 : fx0, (c >> 1) ? fy1 : fy0,
+					iz ? fz1 : fz0, iw ? fw1 : fw0);
+			}
+		}
+	}
+
+	fadex = vfade(fx0);
+	fadey = vfade(fy0);
+	fadez = vfade(fz0);
+	fadew = vfade(fw0);
+	for(c = 0; c < 4; c++) {
+		nzw[c >> 1][c & 1] = vmix(vmix(n[0][0][c >> 1][c & 1], n[1][0][c >> 1][c & 1], fadew),
+			vmix(n[0][1][c >> 1][c & 1], n[1][1][c >> 1][c & 1], fadew), fadez);
+	}
+	nyzw[0] = vmix(nzw[0][0], nzw[1][0], fadey);
+	nyzw[1] = vmix(nzw[0][1], nzw[1][1], fadey);
+	return 2.2f * vmix(nyzw[0], nyzw[1], fadex);
+}
+
+static inline vfloat vcnoise4(vfloat x, vfloat y, vfloat z, vfloat w) {
+	vfloat ix = vfloor(x), iy = vfloor(y), iz = vfloor(z), iw = vfloor(w);
+	return vcnoise4core(vlattice(ix), vlattice(iy), vlattice(iz), vlattice(iw),
+		vlattice(ix + 1.0f), vlattice(iy + 1.0f), vlattice(iz + 1.0f), vlattice(iw + 1.0f),
+		x - ix, y - iy, z - iz, w - iw);
+}
+
+static inline vfloat vpnoise4(vfloat x, vfloat y, vfloat z, vfloat w,
+	vfloat repx, vfloat repy, vfloat repz, vfloat repw) {
+	vfloat ix = vfloor(x), iy = vfloor(y), iz = vfloor(z), iw = vfloor(w);
+	vfloat ix0 = vmodf(ix, repx), iy0 = vmodf(iy, repy);
+	vfloat iz0 = vmodf(iz, repz), iw0 = vmodf(iw, repw);
+	return vcnoise4core(vlattice(ix0), vlattice(iy0), vlattice(iz0), vlattice(iw0),
+		vlattice(vmodf(ix0 + 1.0f, repx)), vlattice(vmodf(iy0 + 1.0f, repy)),
+		vlattice(vmodf(iz0 + 1.0f, repz)), vlattice(vmodf(iw0 + 1.0f, repw)),
+		x - ix, y - iy, z - iz, w - iw);
+}
+
+/*
+ * Batch entry points. Full SIMD steps are loaded straight from the
+ * caller's arrays. A trailing partial step is padded through small
+ * local buffers, so there are no alignment or length requirements.
+ * NOISE_BATCH(dims, expr) expands to that loop for a kernel expression
+ * in the vfloat arguments X, Y, Z and W (only the first dims are read).
+ */
+#define NOISE_BATCH(dims, expr) { \
+	int i, k; \
+	vfloat X, Y, Z, W; \
+	float tin[4][NOISE_LANES], tout[NOISE_LANES]; \
+	const float *in[4]; \
+	in[0] = x; in[1] = y; in[2] = z; in[3] = w; \
+	for(i = 0; i + NOISE_LANES <= n; i += NOISE_LANES) { \
+		X = vload(x + i); \
+		Y = (dims > 1) ? vload(in[1] + i) : vset1(0.0f); \
+		Z = (dims > 2) ? vload(in[2] + i) : vset1(0.0f); \
+		W = (dims > 3) ? vload(in[3] + i) : vset1(0.0f); \
+		vstore(out + i, (expr)); \
+	} \
+	if(i < n) { \
+		for(k = 0; k < NOISE_LANES * 4; k++) { \
+			tin[k / NOISE_LANES][k % NOISE_LANES] = \
+				(k / NOISE_LANES < dims && i + k % NOISE_LANES < n) \
+				? in[k / NOISE_LANES][i + k % NOISE_LANES] : 0.0f; \
+		} \
+		X = vload(tin[0]); Y = vload(tin[1]); Z = vload(tin[2]); W = vload(tin[3]); \
+		vstore(tout, (expr)); \
+		for(k = 0; i + k < n; k++) out[i + k] = tout[k]; \
+	} \
+	(void)Z; (void)W; \
+}
+
+/*
+ * NOISE_BATCH_DERIV(dims, nderiv, expr) is the same loop for a kernel
+ * expression that also fills in the vfloat D[nderiv] with the gradient,
+ * which is stored to the arrays dout[0..nderiv-1].
+ */
+#define NOISE_BATCH_DERIV(dims, nderiv, expr) { \
+	int i, k, c; \
+	vfloat X, Y, Z, W, D[4]; \
+	float tin[4][NOISE_LANES], tout[5][NOISE_LANES]; \
+	const float *in[4]; \
+	in[0] = x; in[1] = y; in[2] = z; in[3] = w; \
+	for(i = 0; i + NOISE_LANES <= n; i += NOISE_LANES) { \
+		X = vload(x + i); \
+		Y = (dims > 1) ? vload(in[1] + i) : vset1(0.0f); \
+		Z = (dims > 2) ? vload(in[2] + i) : vset1(0.0f); \
+		W = (dims > 3) ? vload(in[3] + i) : vset1(0.0f); \
+		vstore(out + i, (expr)); \
+		for(c = 0; c < nderiv; c++) vstore(dout[c] + i, D[c]); \
+	} \
+	if(i < n) { \
+		for(k = 0; k < NOISE_LANES * 4; k++) { \
+			tin[k / NOISE_LANES][k % NOISE_LANES] = \
+				(k / NOISE_LANES < dims && i + k % NOISE_LANES < n) \
+				? in[k / NOISE_LANES][i + k % NOISE_LANES] : 0.0f; \
+		} \
+		X = vload(tin[0]); Y = vload(tin[1]); Z = vload(tin[2]); W = vload(tin[3]); \
+		vstore(tout[0], (expr)); \
+		for(c = 0; c < nderiv; c++) vstore(tout[c + 1], D[c]); \
+		for(k = 0; i + k < n; k++) { \
+			out[i + k] = tout[0][k]; \
+			for(c = 0; c < nderiv; c++) dout[c][i + k] = tout[c + 1][k]; \
+		} \
+	} \
+	(void)Z; (void)W; \
+}
+
+static void NOISE_FN(simplex2)(const float *x, const float *y, float *out, int n) {
+	const float *z = NULL, *w = NULL;
+	NOISE_BATCH(2, vsnoise2(X, Y))
+}
+
+static void NOISE_FN(simplex3)(const float *x, const float *y, const float *z,
+	float *out, int n) {
+	const float *w = NULL;
+	NOISE_BATCH(3, vsnoise3(X, Y, Z))
+}
+
+static void NOISE_FN(simplex4)(const float *x, const float *y, const float *z,
+	const float *w, float *out, int n) {
+	NOISE_BATCH(4, vsnoise4(X, Y, Z, X + Y + Z, W))
+}
+
+static void NOISE_FN(simplex2deriv)(const float *x, const float *y,
+	float *out, float *dx, float *dy, int n) {
+	const float *z = NULL, *w = NULL;
+	float *dout[2];
+	dout[0] = dx; dout[1] = dy;
+	NOISE_BATCH_DERIV(2, 2, vsnoise2d(X, Y, D))
+}
+
+static void NOISE_FN(simplex3deriv)(const float *x, const float *y, const float *z,
+	float *out, float *dx, float *dy, float *dz, int n) {
+	const float *w = NULL;
+	float *dout[3];
+	dout[0] = dx; dout[1] = dy; dout[2] = dz;
+	NOISE_BATCH_DERIV(3, 3, vsnoise3d(X, Y, Z, D))
+}
+
+static void NOISE_FN(simplex4deriv)(const float *x, const float *y, const float *z,
+	const float *w, float *out, float *dx, float *dy, float *dz, float *dw, int n) {
+	float *dout[4];
+	dout[0] = dx; dout[1] = dy; dout[2] = dz; dout[3] = dw;
+	NOISE_BATCH_DERIV(4, 4, vsnoise4d(X, Y, Z, X + Y + Z, W, D))
+}
+
+/*
+ * Mean values of |snoise3| and snoise3^2, measured over a few million
+ * random points. An octave that is faded out for being above the Nyquist
+ * limit is replaced by its mean rather than by 0, so that turbulence and
+ * ridged noise keep their average brightness in the distance.
+ */
+#define NOISE_MEAN_ABS 0.3095f
+#define NOISE_MEAN_SQR 0.1393f
+
+/*
+ * The most octaves the large coordinate fractals set up cells for.
+ * Octave 32 at lacunarity 2 is already 4e9 times finer than the first.
+ */
+#define NOISE_LARGE_OCTAVES 32
+
+/*
+ * vfractal3d() - fBm, turbulence or ridged sum of 3D simplex noise octaves
+ * with its gradient. fw is the filter width of each sample in noise space.
+ * Octave k is faded out as lacunarity^k * fw goes from 0.2 to 0.75, like
+ * filteredsnoise() in Gritz's antialiased shaders, and the loop stops when
+ * the octave is faded out in every lane, so distant samples get cheaper.
+ * With cells, octave k is evaluated at cells[k] + frequency * (x, y, z),
+ * and octaves from NOISE_LARGE_OCTAVES up are counted as faded out.
+ */
+static inline vfloat vfractal3d(vfloat x, vfloat y, vfloat z, vfloat fw,
+	const noiseFbmParams *p, const noiseLargeCell *cells, vfloat *D) {
+	vfloat sum, v, s, r, fade, g, d[3];
+	float freq = 1.0f, amp = 1.0f, minfw, mean, rest = 0.0f;
+	int k;
+
+	switch(p->type) {
+		case NOISE_FRACTAL_TURBULENCE: mean = NOISE_MEAN_ABS; break;
+		case NOISE_FRACTAL_RIDGED:
+			mean = p->offset * p->offset - 2.0f * p->offset * NOISE_MEAN_ABS + NOISE_MEAN_SQR;
+			break;
+		default: mean = 0.0f; break;
+	}
+	minfw = vhmin(fw);
+	sum = vset1(0.0f);
+	D[0] = D[1] = D[2] = vset1(0.0f);
+	for(k = 0; k < p->octaves && freq * minfw < 0.75f; k++) {
+		if(cells) {
+			if(k >= NOISE_LARGE_OCTAVES) break;
+			v = vsnoise3larged(&cells[k], x * freq, y * freq, z * freq, d);
+		}
+		else {
+			v = vsnoise3d(x * freq, y * freq, z * freq, d);
+		}
+		// Shape the octave, with s the derivative of the shaping function
+		switch(p->type) {
+			case NOISE_FRACTAL_TURBULENCE:
+				s = vsign1(v);
+				v = vabs(v);
+				break;
+			case NOISE_FRACTAL_RIDGED:
+				r = p->offset - vabs(v);
+				s = -2.0f * r * vsign1(v);
+				v = r * r;
+				break;
+			default:
+				s = vset1(1.0f);
+				break;
+		}
+		// fade = smoothstep(0.2, 0.75, freq * fw)
+		fade = vmin(vmax((freq * fw - 0.2f) * (1.0f / 0.55f), vset1(0.0f)), vset1(1.0f));
+		fade = fade * fade * (3.0f - 2.0f * fade);
+		sum = sum + amp * (v + fade * (mean - v));
+		g = (amp * freq) * (1.0f - fade) * s;
+		D[0] = D[0] + g * d[0];
+		D[1] = D[1] + g * d[1];
+		D[2] = D[2] + g * d[2];
+		freq *= p->lacunarity;
+		amp *= p->gain;
+	}
+	for(; k < p->octaves; k++) {
+		rest += amp;
+		amp *= p->gain;
+	}
+	return sum + rest * mean;
+}
+
+static inline vfloat vfractal3(vfloat x, vfloat y, vfloat z, vfloat fw,
+	const noiseFbmParams *p, const noiseLargeCell *cells) {
+	vfloat D[3];
+	return vfractal3d(x, y, z, fw, p, cells, D);
+}
+
+/*
+ * The filter width is passed through the unused w input of the batch
+ * loops. Without one, every octave is summed.
+ */
+static void NOISE_FN(fractal3)(const float *x, const float *y, const float *z,
+	const float *filterwidth, const noiseFbmParams *params, float *out, int n) {
+	const float *w = filterwidth;
+	if(w == NULL) {
+		NOISE_BATCH(3, vfractal3(X, Y, Z, vset1(0.0f), params, NULL))
+	}
+	else {
+		NOISE_BATCH(4, vfractal3(X, Y, Z, W, params, NULL))
+	}
+}
+
+static void NOISE_FN(fractal3deriv)(const float *x, const float *y, const float *z,
+	const float *filterwidth, const noiseFbmParams *params,
+	float *out, float *dx, float *dy, float *dz, int n) {
+	const float *w = filterwidth;
+	float *dout[3];
+	dout[0] = dx; dout[1] = dy; dout[2] = dz;
+	if(w == NULL) {
+		NOISE_BATCH_DERIV(3, 3, vfractal3d(X, Y, Z, vset1(0.0f), params, NULL, D))
+	}
+	else {
+		NOISE_BATCH_DERIV(4, 3, vfractal3d(X, Y, Z, W, params, NULL, D))
+	}
+}
+
+static void NOISE_FN(simplex3large)(const long long *cell, const float *x,
+	const float *y, const float *z, float *out, int n) {
+	const float *w = NULL;
+	noiseLargeCell large;
+	largeCellSetup(&large, cell, 1.0);
+	NOISE_BATCH(3, vsnoise3large(&large, X, Y, Z))
+}
+
+static void NOISE_FN(simplex3largederiv)(const long long *cell, const float *x,
+	const float *y, const float *z, float *out, float *dx, float *dy, float *dz, int n) {
+	const float *w = NULL;
+	float *dout[3];
+	noiseLargeCell large;
+	dout[0] = dx; dout[1] = dy; dout[2] = dz;
+	largeCellSetup(&large, cell, 1.0);
+	NOISE_BATCH_DERIV(3, 3, vsnoise3larged(&large, X, Y, Z, D))
+}
+
+/*
+ * The large coordinate fractals set up the cell of each octave once per
+ * call. The frequencies are the same floats as in vfractal3d(), so that
+ * cell and offsets are scaled alike, but the products with the cell are
+ * taken in double precision to keep their fractions exact enough.
+ */
+static void largeCellOctaves(noiseLargeCell *cells, const long long *cell,
+	const noiseFbmParams *params) {
+	float freq = 1.0f;
+	int k;
+
+	for(k = 0; k < params->octaves && k < NOISE_LARGE_OCTAVES; k++) {
+		largeCellSetup(&cells[k], cell, freq);
+		freq *= params->lacunarity;
+	}
+}
+
+static void NOISE_FN(fractal3large)(const long long *cell, const float *x,
+	const float *y, const float *z, const float *filterwidth,
+	const noiseFbmParams *params, float *out, int n) {
+	const float *w = filterwidth;
+	noiseLargeCell cells[NOISE_LARGE_OCTAVES];
+	largeCellOctaves(cells, cell, params);
+	if(w == NULL) {
+		NOISE_BATCH(3, vfractal3(X, Y, Z, vset1(0.0f), params, cells))
+	}
+	else {
+		NOISE_BATCH(4, vfractal3(X, Y, Z, W, params, cells))
+	}
+}
+
+static void NOISE_FN(fractal3largederiv)(const long long *cell, const float *x,
+	const float *y, const float *z, const float *filterwidth,
+	const noiseFbmParams *params, float *out, float *dx, float *dy, float *dz, int n) {
+	const float *w = filterwidth;
+	float *dout[3];
+	noiseLargeCell cells[NOISE_LARGE_OCTAVES];
+	dout[0] = dx; dout[1] = dy; dout[2] = dz;
+	largeCellOctaves(cells, cell, params);
+	if(w == NULL) {
+		NOISE_BATCH_DERIV(3, 3, vfractal3d(X, Y, Z, vset1(0.0f), params, cells, D))
+	}
+	else {
+		NOISE_BATCH_DERIV(4, 3, vfractal3d(X, Y, Z, W, params, cells, D))
+	}
+}
+
+/*
+ * vgraph() - run a compiled noise graph (see cpuNoiseGraph.c) on one SIMD
+ * step of samples. The slots live in the stack frame, which the compiler
+ * keeps in registers or in the L1 cache, and the switch costs far less
+ * than the noise in the nodes. WARP offsets the noise of each component
+ * along the diagonal, so that the three displacements are independent.
+ */
+static inline vfloat vgraph(const noiseGraphProgram *prog, vfloat x, vfloat y, vfloat z,
+	vfloat fw) {
+	vfloat r[NOISE_GRAPH_SLOTS], t, f, o;
+	const noiseGraphInstr *ins, *end = prog->code + prog->length;
+
+	for(ins = prog->code; ins < end; ins++) {
+		switch(ins->op) {
+			case NOISE_NODE_X: r[ins->dst] = x; break;
+			case NOISE_NODE_Y: r[ins->dst] = y; break;
+			case NOISE_NODE_Z: r[ins->dst] = z; break;
+			case NOISE_NODE_CONST: r[ins->dst] = vset1(ins->value[0]); break;
+			case NOISE_NODE_ADD: r[ins->dst] = r[ins->a] + r[ins->b]; break;
+			case NOISE_NODE_SUB: r[ins->dst] = r[ins->a] - r[ins->b]; break;
+			case NOISE_NODE_MUL: r[ins->dst] = r[ins->a] * r[ins->b]; break;
+			case NOISE_NODE_DIV: r[ins->dst] = r[ins->a] / r[ins->b]; break;
+			case NOISE_NODE_MIN: r[ins->dst] = vmin(r[ins->a], r[ins->b]); break;
+			case NOISE_NODE_MAX: r[ins->dst] = vmax(r[ins->a], r[ins->b]); break;
+			case NOISE_NODE_ABS: r[ins->dst] = vabs(r[ins->a]); break;
+			case NOISE_NODE_MAD:
+				r[ins->dst] = r[ins->a] * ins->value[0] + ins->value[1];
+				break;
+			case NOISE_NODE_CLAMP:
+				r[ins->dst] = vmin(vmax(r[ins->a], vset1(ins->value[0])), vset1(ins->value[1]));
+				break;
+			case NOISE_NODE_SMOOTHSTEP:
+				t = (r[ins->a] - ins->value[0]) * (1.0f / (ins->value[1] - ins->value[0]));
+				t = vmin(vmax(t, vset1(0.0f)), vset1(1.0f));
+				r[ins->dst] = t * t * (3.0f - 2.0f * t);
+				break;
+			case NOISE_NODE_MIX:
+				r[ins->dst] = vmix(r[ins->a], r[ins->b], r[ins->c]);
+				break;
+			case NOISE_NODE_NOISE:
+				f = vset1(ins->value[0]);
+				r[ins->dst] = vsnoise3(r[ins->a] * f, r[ins->b] * f, r[ins->c] * f);
+				break;
+			case NOISE_NODE_FBM:
+				f = vset1(ins->value[0]);
+				r[ins->dst] = vfractal3(r[ins->a] * f, r[ins->b] * f, r[ins->c] * f,
+					fw * f, &ins->fbm, NULL);
+				break;
+			case NOISE_NODE_WARP:
+				f = vset1(ins->value[0]);
+				o = vset1(17.0f * (ins->axis + 1));
+				t = (ins->axis == 0) ? r[ins->a] : (ins->axis == 1) ? r[ins->b] : r[ins->c];
+				r[ins->dst] = t + ins->value[1] * vfractal3(r[ins->a] * f + o,
+					r[ins->b] * f + o, r[ins->c] * f + o, fw * f, &ins->fbm, NULL);
+				break;
+		}
+	}
+	return r[prog->result];
+}
+
+/* The filter width is passed as w, like for fractal3 */
+static void NOISE_FN(graph)(const noiseGraphProgram *prog, const float *x,
+	const float *y, const float *z, const float *filterwidth, float *out, int n) {
+	const float *w = filterwidth;
+	if(w == NULL) {
+		NOISE_BATCH(3, vgraph(prog, X, Y, Z, vset1(0.0f)))
+	}
+	else {
+		NOISE_BATCH(4, vgraph(prog, X, Y, Z, W))
+	}
+}
+
+static void NOISE_FN(classic2)(const float *x, const float *y, float *out, int n) {
+	const float *z = NULL, *w = NULL;
+	NOISE_BATCH(2, vcnoise2(X, Y))
+}
+
+static void NOISE_FN(classic3)(const float *x, const float *y, const float *z,
+	float *out, int n) {
+	const float *w = NULL;
+	NOISE_BATCH(3, vcnoise3(X, Y, Z))
+}
+
+static void NOISE_FN(classic4)(const float *x, const float *y, const float *z,
+	const float *w, float *out, int n) {
+	NOISE_BATCH(4, vcnoise4(X, Y, Z, W))
+}
+
+static void NOISE_FN(periodic2)(const float *x, const float *y, const float *rep,
+	float *out, int n) {
+	const float *z = NULL, *w = NULL;
+	vfloat rx = vset1(rep[0]), ry = vset1(rep[1]);
+	NOISE_BATCH(2, vpnoise2(X, Y, rx, ry))
+}
+
+static void NOISE_FN(periodic3)(const float *x, const float *y, const float *z,
+	const float *rep, float *out, int n) {
+	const float *w = NULL;
+	vfloat rx = vset1(rep[0]), ry = vset1(rep[1]), rz = vset1(rep[2]);
+	NOISE_BATCH(3, vpnoise3(X, Y, Z, rx, ry, rz))
+}
+
+static void NOISE_FN(periodic4)(const float *x, const float *y, const float *z,
+	const float *w, const float *rep, float *out, int n) {
+	vfloat rx = vset1(rep[0]), ry = vset1(rep[1]), rz = vset1(rep[2]), rw = vset1(rep[3]);
+	NOISE_BATCH(4, vpnoise4(X, Y, Z, W, rx, ry, rz, rw))
+}
+
+/*
+ * simplex4frames: one xyz point set, nt time values. The points are the
+ * outer loop, so each block of x, y, z and x+y+z is loaded once and then
+ * stays in registers while all time slices are evaluated. The rest of
+ * the setup depends on w and is done for every frame.
+ */
+static void NOISE_FN(simplex4frames)(const float *x, const float *y, const float *z,
+	int n, const float *t, int nt, float *out) {
+	int i, k, f;
+	vfloat vx, vy, vz, sxyz;
+	float tx[NOISE_LANES], ty[NOISE_LANES], tz[NOISE_LANES], tout[NOISE_LANES];
+
+	for(i = 0; i + NOISE_LANES <= n; i += NOISE_LANES) {
+		vx = vload(x + i); vy = vload(y + i); vz = vload(z + i);
+		sxyz = vx + vy + vz;
+		for(f = 0; f < nt; f++) {
+			vstore(out + (size_t)f * n + i, vsnoise4(vx, vy, vz, sxyz, vset1(t[f])));
+		}
+	}
+	if(i < n) {
+		for(k = 0; k < NOISE_LANES; k++) {
+			tx[k] = (i + k < n) ? x[i + k] : 0.0f;
+			ty[k] = (i + k < n) ? y[i + k] : 0.0f;
+			tz[k] = (i + k < n) ? z[i + k] : 0.0f;
+		}
+		vx = vload(tx); vy = vload(ty); vz = vload(tz);
+		sxyz = vx + vy + vz;
+		for(f = 0; f < nt; f++) {
+			vstore(tout, vsnoise4(vx, vy, vz, sxyz, vset1(t[f])));
+			for(k = 0; i + k < n; k++) out[(size_t)f * n + i + k] = tout[k];
+		}
+	}
+}
+
+/*
+ * The exported kernel table, named noiseKernelsScalar, noiseKernelsAVX2 etc.
+ */
+const noiseKernelTable NOISE_TABLE = {
+	.name = NOISE_ISA_NAME,
+	.hash = NOISE_HASH_NAME,
+	.lanes = NOISE_LANES,
+	.simplex2 = NOISE_FN(simplex2),
+	.simplex3 = NOISE_FN(simplex3),
+	.simplex4 = NOISE_FN(simplex4),
+	.simplex4frames = NOISE_FN(simplex4frames),
+	.simplex2deriv = NOISE_FN(simplex2deriv),
+	.simplex3deriv = NOISE_FN(simplex3deriv),
+	.simplex4deriv = NOISE_FN(simplex4deriv),
+	.fractal3 = NOISE_FN(fractal3),
+	.fractal3deriv = NOISE_FN(fractal3deriv),
+	.simplex3large = NOISE_FN(simplex3large),
+	.simplex3largederiv = NOISE_FN(simplex3largederiv),
+	.fractal3large = NOISE_FN(fractal3large),
+	.fractal3largederiv = NOISE_FN(fractal3largederiv),
+	.graph = NOISE_FN(graph),
+	.classic2 = NOISE_FN(classic2),
+	.classic3 = NOISE_FN(classic3),
+	.classic4 = NOISE_FN(classic4),
+	.periodic2 = NOISE_FN(periodic2),
+	.periodic3 = NOISE_FN(periodic3),
+	.periodic4 = NOISE_FN(periodic4),
+};
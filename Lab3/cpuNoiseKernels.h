@@ -0,0 +1,121 @@
+/*
+ * cpuNoiseKernels.h - the table of batch noise kernels that each
+ * instruction set specific translation unit exports.
+ * cpuNoise.c picks one of these tables at runtime.
+ *
+ * This code is in the public domain.
+ */
+
+#ifndef CPUNOISEKERNELS_H
+#define CPUNOISEKERNELS_H
+
+#include "cpuNoise.h" // For the parameter structs
+
+/*
+ * The hash policy (see cpuNoiseHash.h) is part of the table names, so
+ * that kernels with different policies can be linked into one program:
+ * noiseKernelsAVX2 for the default Ashima hash, noiseKernelsAVX2Table
+ * and noiseKernelsAVX2Int for the other two.
+ */
+#if defined(CPUNOISE_HASH_TABLE)
+#define NOISE_HASH_SUFFIX Table
+#define NOISE_HASH_NAME "table"
+#elif defined(CPUNOISE_HASH_INTEGER)
+#define NOISE_HASH_SUFFIX Int
+#define NOISE_HASH_NAME "integer"
+#else
+#define NOISE_HASH_SUFFIX
+#define NOISE_HASH_NAME "ashima"
+#endif
+#define NOISE_KCAT2(a, b, c) a##b##c
+#define NOISE_KCAT(a, b, c) NOISE_KCAT2(a, b, c)
+#define NOISE_KERNELS(isa) NOISE_KCAT(noiseKernels, isa, NOISE_HASH_SUFFIX)
+
+/*
+ * A compiled noise graph, see cpuNoiseGraph.c: a straight line program
+ * over NOISE_GRAPH_SLOTS vector registers, which runs from start to end
+ * for each SIMD step of samples, so that no intermediate value is ever
+ * stored to memory outside the kernel's own stack frame.
+ */
+#define NOISE_GRAPH_SLOTS 16
+
+typedef struct {
+	int op;                    // A noiseNodeOp
+	int dst, a, b, c;          // Slots of the result and the inputs
+	int axis;                  // Component warped by NOISE_NODE_WARP
+	float value[3];            // The constants of the node
+	noiseFbmParams fbm;        // For NOISE_NODE_FBM and NOISE_NODE_WARP
+} noiseGraphInstr;
+
+typedef struct {
+	const noiseGraphInstr *code;
+	int length;
+	int result; // Slot that holds the output at the end
+} noiseGraphProgram;
+
+typedef struct {
+	const char *name; // "scalar", "sse4.1", "avx2" or "avx512"
+	const char *hash; // "ashima", "table" or "integer"
+	int lanes;        // Number of samples processed per SIMD step
+	/* 2D simplex noise: out[i] = snoise(vec2(x[i], y[i])) */
+	void (*simplex2)(const float *x, const float *y, float *out, int n);
+	/* 3D simplex noise over SoA arrays: out[i] = snoise(vec3(x[i], y[i], z[i])) */
+	void (*simplex3)(const float *x, const float *y, const float *z, float *out, int n);
+	/* 4D simplex noise: out[i] = snoise(vec4(x[i], y[i], z[i], w[i])) */
+	void (*simplex4)(const float *x, const float *y, const float *z, const float *w,
+		float *out, int n);
+	/* 4D simplex noise for nt time slices: out[f*n+i] = snoise(vec4(x[i], y[i], z[i], t[f])) */
+	void (*simplex4frames)(const float *x, const float *y, const float *z, int n,
+		const float *t, int nt, float *out);
+	/* Simplex noise with analytic derivatives, written to d* */
+	void (*simplex2deriv)(const float *x, const float *y,
+		float *out, float *dx, float *dy, int n);
+	void (*simplex3deriv)(const float *x, const float *y, const float *z,
+		float *out, float *dx, float *dy, float *dz, int n);
+	void (*simplex4deriv)(const float *x, const float *y, const float *z, const float *w,
+		float *out, float *dx, float *dy, float *dz, float *dw, int n);
+	/* Filtered fBm, turbulence or ridged 3D simplex noise, with or without derivatives */
+	void (*fractal3)(const float *x, const float *y, const float *z,
+		const float *filterwidth, const noiseFbmParams *params, float *out, int n);
+	void (*fractal3deriv)(const float *x, const float *y, const float *z,
+		const float *filterwidth, const noiseFbmParams *params,
+		float *out, float *dx, float *dy, float *dz, int n);
+	/* The same at cell[0..2] + (x[i], y[i], z[i]), see noiseSimplex3Large() */
+	void (*simplex3large)(const long long *cell, const float *x, const float *y,
+		const float *z, float *out, int n);
+	void (*simplex3largederiv)(const long long *cell, const float *x, const float *y,
+		const float *z, float *out, float *dx, float *dy, float *dz, int n);
+	void (*fractal3large)(const long long *cell, const float *x, const float *y,
+		const float *z, const float *filterwidth, const noiseFbmParams *params,
+		float *out, int n);
+	void (*fractal3largederiv)(const long long *cell, const float *x, const float *y,
+		const float *z, const float *filterwidth, const noiseFbmParams *params,
+		float *out, float *dx, float *dy, float *dz, int n);
+	/* Run a compiled noise graph on each point, see noiseGraphEvaluate() */
+	void (*graph)(const noiseGraphProgram *prog, const float *x, const float *y,
+		const float *z, const float *filterwidth, float *out, int n);
+	/* Classic Perlin noise, cnoise() in 2D, 3D and 4D */
+	void (*classic2)(const float *x, const float *y, float *out, int n);
+	void (*classic3)(const float *x, const float *y, const float *z, float *out, int n);
+	void (*classic4)(const float *x, const float *y, const float *z, const float *w,
+		float *out, int n);
+	/* Periodic classic noise, pnoise() in 2D, 3D and 4D, with the period in rep[] */
+	void (*periodic2)(const float *x, const float *y, const float *rep, float *out, int n);
+	void (*periodic3)(const float *x, const float *y, const float *z, const float *rep,
+		float *out, int n);
+	void (*periodic4)(const float *x, const float *y, const float *z, const float *w,
+		const float *rep, float *out, int n);
+} noiseKernelTable;
+
+/*
+ * noiseActiveKernels() - the kernel table selected by cpuNoise.c, for the
+ * parts of the library that call the kernels directly
+ */
+const noiseKernelTable *noiseActiveKernels(void);
+
+extern const noiseKernelTable NOISE_KERNELS(Scalar);
+extern const noiseKernelTable NOISE_KERNELS(SSE41);
+extern const noiseKernelTable NOISE_KERNELS(AVX2);
+extern const noiseKernelTable NOISE_KERNELS(AVX512);
+
+#endif /* CPUNOISEKERNELS_H */
@@ -0,0 +1,246 @@
+/*
+ * cpuNoisePool.c - a small work stealing thread pool for the noise
+ * field generator and the loaders. See threadPool.h.
+ *
+ * Each thread owns a range of task indices, packed as begin and end in
+ * one 64-bit word so that the owner taking an index from the front and
+ * a thief taking half from the back are both a single compare-and-swap.
+ * Indices are only ever moved between ranges, never added, so a thread
+ * that finds every range empty can stop: any range that was in transit
+ * belongs to the thief that stole it, which runs it itself.
+ *
+ * This code is in the public domain.
+ */
+
+#include <stdlib.h> // For malloc() and free()
+#include <pthread.h>
+#ifdef _WIN32
+#include <windows.h> // For GetSystemInfo()
+#else
+#include <unistd.h> // For sysconf()
+#endif
+
+#include "threadPool.h"
+
+/* One range per thread, padded to a cache line to avoid false sharing */
+typedef struct {
+	unsigned long long range; // begin in the low 32 bits, end in the high
+	char pad[56];
+} poolQueue;
+
+typedef struct {
+	noisePool *pool;
+	int thread;
+} poolWorker;
+
+struct noisePool {
+	int threads;
+	pthread_t *handles;
+	poolWorker *workers;
+	poolQueue *queues;  // Cache line aligned, inside queuemem
+	void *queuemem;
+	pthread_mutex_t lock;
+	pthread_cond_t start; // Signalled when a new run begins or at shutdown
+	pthread_cond_t done;  // Signalled when the last worker finishes a run
+	unsigned int generation; // Incremented for each run
+	int running;             // Workers still busy with the current run
+	int quit;
+	noiseTaskFunc task;
+	void *arg;
+};
+
+static unsigned long long packRange(unsigned int begin, unsigned int end) {
+	return ((unsigned long long)end << 32) | begin;
+}
+
+/*
+ * popFront() - take the first index of our own range, or -1 if it is empty
+ */
+static int popFront(poolQueue *q) {
+	unsigned long long r, n;
+	unsigned int begin, end;
+
+	r = __atomic_load_n(&q->range, __ATOMIC_ACQUIRE);
+	for(;;) {
+		begin = (unsigned int)r;
+		end = (unsigned int)(r >> 32);
+		if(begin >= end) return -1;
+		n = packRange(begin + 1, end);
+		if(__atomic_compare_exchange_n(&q->range, &r, n, 0,
+			__ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) return (int)begin;
+	}
+}
+
+/*
+ * steal() - move the back half of some other thread's range into ours,
+ * trying the other threads in turn. Returns 0 if all ranges were empty.
+ */
+static int steal(noisePool *pool, int self) {
+	unsigned long long r;
+	unsigned int begin, end, mid;
+	int i, victim;
+
+	for(i = 1; i < pool->threads; i++) {
+		victim = (self + i) % pool->threads;
+		r = __atomic_load_n(&pool->queues[victim].range, __ATOMIC_ACQUIRE);
+		for(;;) {
+			begin = (unsigned int)r;
+			end = (unsigned int)(r >> 32);
+			if(begin >= end) break;
+			mid = end - (end - begin + 1) / 2;
+			if(__atomic_compare_exchange_n(&pool->queues[victim].range, &r,
+				packRange(begin, mid), 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+				// Our own range is empty, so nobody else will touch it now
+				__atomic_store_n(&pool->queues[self].range, packRange(mid, end),
+					__ATOMIC_RELEASE);
+				return 1;
+			}
+		}
+	}
+	return 0;
+}
+
+static void runTasks(noisePool *pool, int self) {
+	int index;
+
+	do {
+		while((index = popFront(&pool->queues[self])) >= 0) {
+			pool->task(pool->arg, index, self);
+		}
+	} while(steal(pool, self));
+}
+
+static void *workerMain(void *p) {
+	poolWorker *worker = (poolWorker*)p;
+	noisePool *pool = worker->pool;
+	unsigned int seen = 0;
+
+	for(;;) {
+		pthread_mutex_lock(&pool->lock);
+		while(!pool->quit && pool->generation == seen) {
+			pthread_cond_wait(&pool->start, &pool->lock);
+		}
+		if(pool->quit) {
+			pthread_mutex_unlock(&pool->lock);
+			return NULL;
+		}
+		seen = pool->generation;
+		pthread_mutex_unlock(&pool->lock);
+
+		runTasks(pool, worker->thread);
+
+		pthread_mutex_lock(&pool->lock);
+		if(--pool->running == 0) pthread_cond_signal(&pool->done);
+		pthread_mutex_unlock(&pool->lock);
+	}
+}
+
+static int onlineCPUs(void) {
+#ifdef _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return (int)info.dwNumberOfProcessors;
+#else
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+	return (n < 1) ? 1 : (int)n;
+#endif
+}
+
+noisePool *noisePoolCreate(int threads) {
+	noisePool *pool;
+	int i;
+
+	if(threads <= 0) threads = onlineCPUs();
+	pool = (noisePool*)calloc(1, sizeof(noisePool));
+	if(pool == NULL) return NULL;
+	pool->queuemem = malloc((threads + 1) * sizeof(poolQueue));
+	pool->handles = (pthread_t*)malloc(threads * sizeof(pthread_t));
+	pool->workers = (poolWorker*)malloc(threads * sizeof(poolWorker));
+	if(pool->queuemem == NULL || pool->handles == NULL || pool->workers == NULL) {
+		free(pool->queuemem);
+		free(pool->handles);
+		free(pool->workers);
+		free(pool);
+		return NULL;
+	}
+	pool->queues = (poolQueue*)(((size_t)pool->queuemem + 63) & ~(size_t)63);
+	for(i = 0; i < threads; i++) {
+		pool->queues[i].range = 0;
+		pool->workers[i].pool = pool;
+		pool->workers[i].thread = i;
+	}
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->start, NULL);
+	pthread_cond_init(&pool->done, NULL);
+
+	// Thread 0 is the caller of noisePoolRun(), so start threads-1 workers
+	pool->threads = 1;
+	for(i = 1; i < threads; i++) {
+		if(pthread_create(&pool->handles[i], NULL, workerMain, &pool->workers[i]) != 0) {
+			noisePoolDestroy(pool);
+			return NULL;
+		}
+		pool->threads++;
+	}
+	return pool;
+}
+
+void noisePoolDestroy(noisePool *pool) {
+	int i;
+
+	if(pool == NULL) return;
+	pthread_mutex_lock(&pool->lock);
+	pool->quit = 1;
+	pthread_cond_broadcast(&pool->start);
+	pthread_mutex_unlock(&pool->lock);
+	for(i = 1; i < pool->threads; i++) pthread_join(pool->handles[i], NULL);
+	pthread_mutex_destroy(&pool->lock);
+	pthread_cond_destroy(&pool->start);
+	pthread_cond_destroy(&pool->done);
+	free(pool->handles);
+	free(pool->workers);
+	free(pool->queuemem);
+	free(pool);
+}
+
+int noisePoolThreads(const noisePool *pool) {
+	return pool->threads;
+}
+
+void noisePoolRun(noisePool *pool, int ntasks, noiseTaskFunc task, void *arg) {
+	int i;
+	unsigned int begin, end;
+
+	if(ntasks <= 0) return;
+	if(pool->threads == 1) {
+		for(i = 0; i < ntasks; i++) task(arg, i, 0);
+		return;
+	}
+
+	// Start each thread on an equal share of consecutive indices
+	for(i = 0; i < pool->threads; i++) {
+		begin = (unsigned int)((long long)ntasks * i / pool->threads);
+		end = (unsigned int)((long long)ntasks * (i + 1) / pool->threads);
+		pool->queues[i].range = packRange(begin, end);
+	}
+	pthread_mutex_lock(&pool->lock);
+	pool->task = task;
+	pool->arg = arg;
+	pool->running = pool->threads - 1;
+	pool->generation++;
+	pthread_cond_broadcast(&pool->start);
+	pthread_mutex_unlock(&pool->lock);
+
+	runTasks(pool, 0);
+
+	pthread_mutex_lock(&pool->lock);
+	while(pool->running > 0) pthread_cond_wait(&pool->done, &pool->lock);
+	pthread_mutex_unlock(&pool->lock);
+}
+
+void noisePoolFor(noisePool *pool, int ntasks, noiseTaskFunc task, void *arg) {
+	int i;
+
+	if(pool != NULL && ntasks > 1) noisePoolRun(pool, ntasks, task, arg);
+	else for(i = 0; i < ntasks; i++) task(arg, i, 0);
+}
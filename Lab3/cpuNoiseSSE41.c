@@ -0,0 +1,10 @@
+/*
+ * cpuNoiseSSE41.c - SSE4.1 instantiation of the CPU noise kernels.
+ * Compiled with the matching -m flags, see the Makefile.
+ *
+ * This code is in the public domain.
+ */
+
+#define CPUNOISE_SSE41
+
+#include "cpuNoiseImpl.h"
@@ -0,0 +1,8 @@
+/*
+ * cpuNoiseScalar.c - Plain scalar C instantiation of the CPU noise kernels.
+ * This is the reference version and the fallback on any CPU.
+ *
+ * This code is in the public domain.
+ */
+
+#include "cpuNoiseImpl.h"
@@ -0,0 +1,217 @@
+/*
+ * cpuNoiseSimd.h - a minimal SIMD vector abstraction for the CPU noise kernels.
+ *
+ * The kernels in cpuNoiseImpl.h are written once against the type
+ * "vfloat" and the small set of functions below. Which instruction set
+ * they compile to is decided by a single macro defined before including
+ * this file: CPUNOISE_AVX512, CPUNOISE_AVX2, CPUNOISE_SSE41 or nothing,
+ * which gives a plain scalar float version. Arithmetic uses the ordinary
+ * C operators, which GCC and Clang accept directly on the SSE/AVX types.
+ * The few 32-bit integer operations needed by the hash functions in
+ * cpuNoiseHash.h work on the type "vint", through functions, because
+ * the C operators on the SSE/AVX integer types act on 64-bit lanes.
+ *
+ * This code is in the public domain.
+ */
+
+#ifndef CPUNOISESIMD_H
+#define CPUNOISESIMD_H
+
+#include <math.h>
+
+#if defined(CPUNOISE_AVX512)
+
+#include <immintrin.h>
+#define NOISE_LANES 16
+#define NOISE_ISA_SUFFIX AVX512
+#define NOISE_ISA_NAME "avx512"
+typedef __m512 vfloat;
+
+static inline vfloat vset1(float a) { return _mm512_set1_ps(a); }
+static inline vfloat vload(const float *p) { return _mm512_loadu_ps(p); }
+static inline void vstore(float *p, vfloat a) { _mm512_storeu_ps(p, a); }
+static inline vfloat vfloor(vfloat a) {
+	return _mm512_roundscale_ps(a, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+}
+static inline vfloat vmin(vfloat a, vfloat b) { return _mm512_min_ps(a, b); }
+static inline vfloat vmax(vfloat a, vfloat b) { return _mm512_max_ps(a, b); }
+static inline vfloat vabs(vfloat a) {
+	return _mm512_castsi512_ps(_mm512_and_si512(_mm512_castps_si512(a),
+		_mm512_set1_epi32(0x7fffffff)));
+}
+/* vsign1(a): -1.0 for negative a, else +1.0 */
+static inline vfloat vsign1(vfloat a) {
+	return _mm512_castsi512_ps(_mm512_or_si512(_mm512_and_si512(_mm512_castps_si512(a),
+		_mm512_set1_epi32(0x80000000)), _mm512_set1_epi32(0x3f800000)));
+}
+/* step(edge, x) as in GLSL: 0.0 if x < edge, else 1.0 */
+static inline vfloat vstep(vfloat edge, vfloat x) {
+	return _mm512_maskz_mov_ps(_mm512_cmp_ps_mask(x, edge, _CMP_GE_OQ), _mm512_set1_ps(1.0f));
+}
+/* select(c, a, b): a where c is 1.0, b where c is 0.0 */
+static inline vfloat vselect(vfloat c, vfloat a, vfloat b) {
+	return _mm512_mask_mov_ps(b, _mm512_cmp_ps_mask(c, _mm512_setzero_ps(), _CMP_NEQ_OQ), a);
+}
+/* vhmin(a): the smallest of the lanes of a */
+static inline float vhmin(vfloat a) { return _mm512_reduce_min_ps(a); }
+/* vgather(t, i): t[i] for each lane of i, which holds whole numbers */
+static inline vfloat vgather(const float *t, vfloat i) {
+	return _mm512_i32gather_ps(_mm512_cvttps_epi32(i), t, 4);
+}
+/*
+ * vexact(a): a, rounded to float and taken as it is. With -ffast-math and
+ * FMA the compiler is otherwise free to fuse the multiply that made a
+ * into an add that uses it, or to regroup the sums that use it, and each
+ * path does that its own way. Where that moves a point on the edge of a
+ * simplex into the next one, the noise jumps, since the GLSL kernels do
+ * not quite fall to 0 there. The empty asm hides a from the optimizer.
+ */
+static inline vfloat vexact(vfloat a) { __asm__("" : "+v"(a)); return a; }
+
+typedef __m512i vint;
+static inline vint vset1i(unsigned int a) { return _mm512_set1_epi32((int)a); }
+static inline vint vtoint(vfloat a) { return _mm512_cvttps_epi32(a); }
+static inline vfloat vtofloat(vint a) { return _mm512_cvtepi32_ps(a); }
+static inline vint vaddi(vint a, vint b) { return _mm512_add_epi32(a, b); }
+static inline vint vxori(vint a, vint b) { return _mm512_xor_si512(a, b); }
+static inline vint vmuli(vint a, vint b) { return _mm512_mullo_epi32(a, b); }
+static inline vint vsrli(vint a, unsigned int n) { return _mm512_srli_epi32(a, n); }
+
+#elif defined(CPUNOISE_AVX2)
+
+#include <immintrin.h>
+#define NOISE_LANES 8
+#define NOISE_ISA_SUFFIX AVX2
+#define NOISE_ISA_NAME "avx2"
+typedef __m256 vfloat;
+
+static inline vfloat vset1(float a) { return _mm256_set1_ps(a); }
+static inline vfloat vload(const float *p) { return _mm256_loadu_ps(p); }
+static inline void vstore(float *p, vfloat a) { _mm256_storeu_ps(p, a); }
+static inline vfloat vfloor(vfloat a) { return _mm256_floor_ps(a); }
+static inline vfloat vmin(vfloat a, vfloat b) { return _mm256_min_ps(a, b); }
+static inline vfloat vmax(vfloat a, vfloat b) { return _mm256_max_ps(a, b); }
+static inline vfloat vabs(vfloat a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+static inline vfloat vsign1(vfloat a) {
+	return _mm256_or_ps(_mm256_and_ps(_mm256_set1_ps(-0.0f), a), _mm256_set1_ps(1.0f));
+}
+static inline vfloat vstep(vfloat edge, vfloat x) {
+	return _mm256_and_ps(_mm256_cmp_ps(x, edge, _CMP_GE_OQ), _mm256_set1_ps(1.0f));
+}
+static inline vfloat vselect(vfloat c, vfloat a, vfloat b) {
+	return _mm256_blendv_ps(b, a, _mm256_cmp_ps(c, _mm256_setzero_ps(), _CMP_NEQ_OQ));
+}
+static inline float vhmin(vfloat a) {
+	__m128 m = _mm_min_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1));
+	m = _mm_min_ps(m, _mm_movehl_ps(m, m));
+	m = _mm_min_ss(m, _mm_shuffle_ps(m, m, 1));
+	return _mm_cvtss_f32(m);
+}
+static inline vfloat vgather(const float *t, vfloat i) {
+	return _mm256_i32gather_ps(t, _mm256_cvttps_epi32(i), 4);
+}
+static inline vfloat vexact(vfloat a) { __asm__("" : "+x"(a)); return a; }
+
+typedef __m256i vint;
+static inline vint vset1i(unsigned int a) { return _mm256_set1_epi32((int)a); }
+static inline vint vtoint(vfloat a) { return _mm256_cvttps_epi32(a); }
+static inline vfloat vtofloat(vint a) { return _mm256_cvtepi32_ps(a); }
+static inline vint vaddi(vint a, vint b) { return _mm256_add_epi32(a, b); }
+static inline vint vxori(vint a, vint b) { return _mm256_xor_si256(a, b); }
+static inline vint vmuli(vint a, vint b) { return _mm256_mullo_epi32(a, b); }
+static inline vint vsrli(vint a, unsigned int n) { return _mm256_srli_epi32(a, n); }
+
+#elif defined(CPUNOISE_SSE41)
+
+#include <smmintrin.h>
+#define NOISE_LANES 4
+#define NOISE_ISA_SUFFIX SSE41
+#define NOISE_ISA_NAME "sse4.1"
+typedef __m128 vfloat;
+
+static inline vfloat vset1(float a) { return _mm_set1_ps(a); }
+static inline vfloat vload(const float *p) { return _mm_loadu_ps(p); }
+static inline void vstore(float *p, vfloat a) { _mm_storeu_ps(p, a); }
+static inline vfloat vfloor(vfloat a) { return _mm_floor_ps(a); }
+static inline vfloat vmin(vfloat a, vfloat b) { return _mm_min_ps(a, b); }
+static inline vfloat vmax(vfloat a, vfloat b) { return _mm_max_ps(a, b); }
+static inline vfloat vabs(vfloat a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+static inline vfloat vsign1(vfloat a) {
+	return _mm_or_ps(_mm_and_ps(_mm_set1_ps(-0.0f), a), _mm_set1_ps(1.0f));
+}
+static inline vfloat vstep(vfloat edge, vfloat x) {
+	return _mm_and_ps(_mm_cmpge_ps(x, edge), _mm_set1_ps(1.0f));
+}
+static inline vfloat vselect(vfloat c, vfloat a, vfloat b) {
+	return _mm_blendv_ps(b, a, _mm_cmpneq_ps(c, _mm_setzero_ps()));
+}
+static inline float vhmin(vfloat a) {
+	a = _mm_min_ps(a, _mm_movehl_ps(a, a));
+	a = _mm_min_ss(a, _mm_shuffle_ps(a, a, 1));
+	return _mm_cvtss_f32(a);
+}
+/* SSE has no gather instruction, so load the four lanes one by one */
+static inline vfloat vgather(const float *t, vfloat i) {
+	__m128i k = _mm_cvttps_epi32(i);
+	return _mm_setr_ps(t[_mm_cvtsi128_si32(k)], t[_mm_extract_epi32(k, 1)],
+		t[_mm_extract_epi32(k, 2)], t[_mm_extract_epi32(k, 3)]);
+}
+static inline vfloat vexact(vfloat a) { __asm__("" : "+x"(a)); return a; }
+
+typedef __m128i vint;
+static inline vint vset1i(unsigned int a) { return _mm_set1_epi32((int)a); }
+static inline vint vtoint(vfloat a) { return _mm_cvttps_epi32(a); }
+static inline vfloat vtofloat(vint a) { return _mm_cvtepi32_ps(a); }
+static inline vint vaddi(vint a, vint b) { return _mm_add_epi32(a, b); }
+static inline vint vxori(vint a, vint b) { return _mm_xor_si128(a, b); }
+static inline vint vmuli(vint a, vint b) { return _mm_mullo_epi32(a, b); }
+static inline vint vsrli(vint a, unsigned int n) { return _mm_srli_epi32(a, n); }
+
+#else /* Plain scalar C, one sample at a time */
+
+#define NOISE_LANES 1
+#define NOISE_ISA_SUFFIX Scalar
+#define NOISE_ISA_NAME "scalar"
+typedef float vfloat;
+
+static inline vfloat vset1(float a) { return a; }
+static inline vfloat vload(const float *p) { return *p; }
+static inline void vstore(float *p, vfloat a) { *p = a; }
+static inline vfloat vfloor(vfloat a) { return floorf(a); }
+static inline vfloat vmin(vfloat a, vfloat b) { return a < b ? a : b; }
+static inline vfloat vmax(vfloat a, vfloat b) { return a > b ? a : b; }
+static inline vfloat vabs(vfloat a) { return fabsf(a); }
+static inline vfloat vsign1(vfloat a) { return a < 0.0f ? -1.0f : 1.0f; }
+static inline vfloat vstep(vfloat edge, vfloat x) { return x < edge ? 0.0f : 1.0f; }
+static inline vfloat vselect(vfloat c, vfloat a, vfloat b) { return c != 0.0f ? a : b; }
+static inline float vhmin(vfloat a) { return a; }
+static inline vfloat vgather(const float *t, vfloat i) { return t[(int)i]; }
+static inline vfloat vexact(vfloat a) {
+#ifdef __GNUC__
+	__asm__("" : "+g"(a));
+#endif
+	return a;
+}
+
+typedef unsigned int vint;
+static inline vint vset1i(unsigned int a) { return a; }
+static inline vint vtoint(vfloat a) { return (vint)(int)a; }
+static inline vfloat vtofloat(vint a) { return (float)(int)a; }
+static inline vint vaddi(vint a, vint b) { return a + b; }
+static inline vint vxori(vint a, vint b) { return a ^ b; }
+static inline vint vmuli(vint a, vint b) { return a * b; }
+static inline vint vsrli(vint a, unsigned int n) { return a >> n; }
+
+#endif
+
+/*
+ * Name mangling: NOISE_FN(simplex3) becomes noise_simplex3_AVX2 etc.
+ * NOISE_TABLE is the exported kernel table, see NOISE_KERNELS() in
+ * cpuNoiseKernels.h.
+ */
+#define NOISE_CAT2(a, b) a##b
+#define NOISE_CAT(a, b) NOISE_CAT2(a, b)
+#define NOISE_FN(name) NOISE_CAT(noise_##name##_, NOISE_ISA_SUFFIX)
+#define NOISE_TABLE NOISE_KERNELS(NOISE_ISA_SUFFIX)
+
+#endif /* CPUNOISESIMD_H */
@@ -0,0 +1,362 @@
+/*
+ * cpunoisebench.c - a headless CPU counterpart of noise/benchmark/common/noisebench.c.
+ *
+ * Runs the same set of noise functions as the GLSL benchmark (constant
+ * shading, 2D/3D/4D simplex noise, 2D/3D/4D classic noise) plus periodic
+ * noise, simplex noise with derivatives, fBm with and without filtering,
+ * 4D simplex noise for several animation frames at once and the large
+ * coordinate versions of simplex noise and fBm, through the CPU noise
+ * library, for every instruction set path the CPU supports and for a
+ * range of thread counts. Each case gets warm-up runs and then a number
+ * of timed repetitions, and the median and 95th percentile times are
+ * reported as Msamples/s, counting every frame of the frames case. The output is a text table, JSON or CSV, so the
+ * numbers can be collected per commit and compared.
+ *
+ * Usage: cpunoisebench [options]
+ *   -n samples   points per repetition (default 1048576)
+ *   -r reps      timed repetitions per case (default 15)
+ *   -w warmup    untimed warm-up runs per case (default 3)
+ *   -t threads   largest thread count, runs 1, 2, 4 ... threads
+ *                (default: all online CPUs)
+ *   -i isa       only this path: scalar, sse4.1, avx2 or avx512
+ *   -c case      only cases whose name starts with this
+ *   -f format    text, json or csv (default text)
+ *   -o file      write to file instead of stdout
+ *   -l label     free text copied to the output, e.g. a commit id
+ *
+ * This code is in the public domain.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "cpuNoise.h"
+
+// Points per task handed to the thread pool
+#define CHUNK 4096
+// Time values for the frames case
+#define FRAMES 8
+
+/* The input and output arrays for one case, shared by all threads */
+typedef struct {
+	float *x, *y, *z, *w;
+	float *out, *dx, *dy, *dz, *dw;
+	float *filterwidth, *frames; // frames holds FRAMES outputs per point
+	float rep[4], t[FRAMES];
+	long long cell[3];
+	noiseFbmParams fbm;
+	int n;
+} benchData;
+
+typedef void (*benchFunc)(benchData *b, size_t i, int n);
+
+static void runConstant(benchData *b, size_t i, int n) {
+	int k;
+	for(k = 0; k < n; k++) b->out[i + k] = 0.5f;
+}
+static void runSimplex2(benchData *b, size_t i, int n) {
+	noiseSimplex2(b->x + i, b->y + i, b->out + i, n);
+}
+static void runSimplex3(benchData *b, size_t i, int n) {
+	noiseSimplex3(b->x + i, b->y + i, b->z + i, b->out + i, n);
+}
+static void runSimplex4(benchData *b, size_t i, int n) {
+	noiseSimplex4(b->x + i, b->y + i, b->z + i, b->w + i, b->out + i, n);
+}
+static void runClassic2(benchData *b, size_t i, int n) {
+	noiseClassic2(b->x + i, b->y + i, b->out + i, n);
+}
+static void runClassic3(benchData *b, size_t i, int n) {
+	noiseClassic3(b->x + i, b->y + i, b->z + i, b->out + i, n);
+}
+static void runClassic4(benchData *b, size_t i, int n) {
+	noiseClassic4(b->x + i, b->y + i, b->z + i, b->w + i, b->out + i, n);
+}
+static void runPeriodic2(benchData *b, size_t i, int n) {
+	noisePeriodic2(b->x + i, b->y + i, b->rep, b->out + i, n);
+}
+static void runPeriodic3(benchData *b, size_t i, int n) {
+	noisePeriodic3(b->x + i, b->y + i, b->z + i, b->rep, b->out + i, n);
+}
+static void runPeriodic4(benchData *b, size_t i, int n) {
+	noisePeriodic4(b->x + i, b->y + i, b->z + i, b->w + i, b->rep, b->out + i, n);
+}
+static void runSimplex2Deriv(benchData *b, size_t i, int n) {
+	noiseSimplex2Deriv(b->x + i, b->y + i, b->out + i, b->dx + i, b->dy + i, n);
+}
+static void runSimplex3Deriv(benchData *b, size_t i, int n) {
+	noiseSimplex3Deriv(b->x + i, b->y + i, b->z + i,
+		b->out + i, b->dx + i, b->dy + i, b->dz + i, n);
+}
+static void runSimplex4Deriv(benchData *b, size_t i, int n) {
+	noiseSimplex4Deriv(b->x + i, b->y + i, b->z + i, b->w + i,
+		b->out + i, b->dx + i, b->dy + i, b->dz + i, b->dw + i, n);
+}
+static void runFbm3(benchData *b, size_t i, int n) {
+	noiseFractal3(b->x + i, b->y + i, b->z + i, NULL, &b->fbm, b->out + i, n);
+}
+static void runFbm3Filtered(benchData *b, size_t i, int n) {
+	noiseFractal3(b->x + i, b->y + i, b->z + i, b->filterwidth + i, &b->fbm, b->out + i, n);
+}
+static void runSimplex4Frames(benchData *b, size_t i, int n) {
+	noiseSimplex4Frames(b->x + i, b->y + i, b->z + i, n, b->t, FRAMES, b->frames + i * FRAMES);
+}
+static void runFbm3Deriv(benchData *b, size_t i, int n) {
+	noiseFbm3Deriv(b->x + i, b->y + i, b->z + i, &b->fbm,
+		b->out + i, b->dx + i, b->dy + i, b->dz + i, n);
+}
+static void runSimplex3Large(benchData *b, size_t i, int n) {
+	noiseSimplex3Large(b->cell, b->x + i, b->y + i, b->z + i, b->out + i, n);
+}
+static void runFbm3Large(benchData *b, size_t i, int n) {
+	noiseFractal3Large(b->cell, b->x + i, b->y + i, b->z + i, NULL, &b->fbm, b->out + i, n);
+}
+
+static const struct {
+	const char *name;
+	benchFunc func;
+	int outputs; // Per point
+} cases[] = {
+	{ "constant", runConstant, 1 },
+	{ "simplex2", runSimplex2, 1 },
+	{ "simplex3", runSimplex3, 1 },
+	{ "simplex4", runSimplex4, 1 },
+	{ "classic2", runClassic2, 1 },
+	{ "classic3", runClassic3, 1 },
+	{ "classic4", runClassic4, 1 },
+	{ "periodic2", runPeriodic2, 1 },
+	{ "periodic3", runPeriodic3, 1 },
+	{ "periodic4", runPeriodic4, 1 },
+	{ "simplex2deriv", runSimplex2Deriv, 1 },
+	{ "simplex3deriv", runSimplex3Deriv, 1 },
+	{ "simplex4deriv", runSimplex4Deriv, 1 },
+	{ "simplex4frames", runSimplex4Frames, FRAMES },
+	{ "fbm3x8", runFbm3, 1 },
+	{ "fbm3x8filtered", runFbm3Filtered, 1 },
+	{ "fbm3x8deriv", runFbm3Deriv, 1 },
+	{ "simplex3large", runSimplex3Large, 1 },
+	{ "fbm3x8large", runFbm3Large, 1 },
+};
+#define NCASES ((int)(sizeof(cases) / sizeof(cases[0])))
+
+/* What a pool task needs to run one chunk of a case */
+typedef struct {
+	benchData *data;
+	benchFunc func;
+} benchTask;
+
+static void chunkTask(void *arg, int index, int thread) {
+	benchTask *task = (benchTask*)arg;
+	size_t i = (size_t)index * CHUNK;
+	int n = (task->data->n - (int)i < CHUNK) ? task->data->n - (int)i : CHUNK;
+	task->func(task->data, i, n);
+}
+
+static int compareDoubles(const void *a, const void *b) {
+	double d = *(const double*)a - *(const double*)b;
+	return (d > 0.0) - (d < 0.0);
+}
+
+/*
+ * percentile() - the p-th percentile of the sorted times t[0..n-1],
+ * by the nearest rank method
+ */
+static double percentile(const double *t, int n, double p) {
+	int rank = (int)(p / 100.0 * n + 0.999999);
+	if(rank < 1) rank = 1;
+	if(rank > n) rank = n;
+	return t[rank - 1];
+}
+
+/*
+ * fillInput() - a plane of points, like the fragments of the fullscreen
+ * quad in the GLSL benchmark, 1024 samples wide and 64 per noise cell,
+ * with z and w varying slowly as in an animation. The filter width of
+ * each point is the distance to the next one, and the frames are 0.02
+ * apart in w.
+ */
+static void fillInput(benchData *b) {
+	int i;
+	for(i = 0; i < b->n; i++) {
+		b->x[i] = (i % 1024) / 64.0f;
+		b->y[i] = (i / 1024) / 64.0f;
+		b->z[i] = 0.5f + 0.001f * (i / 1024);
+		b->w[i] = 0.25f + 0.002f * (i / 1024);
+		b->filterwidth[i] = 1.0f / 64.0f;
+	}
+	for(i = 0; i < FRAMES; i++) b->t[i] = 0.25f + 0.02f * i;
+	b->rep[0] = b->rep[1] = b->rep[2] = b->rep[3] = 16.0f;
+	b->cell[0] = 6371000; b->cell[1] = -1000000; b->cell[2] = 250000;
+	noiseFbmDefaults(&b->fbm);
+}
+
+/*
+ * printCSVString() - print s as a quoted CSV field, with quotes doubled
+ */
+static void printCSVString(FILE *fp, const char *s) {
+	fputc('"', fp);
+	for(; *s; s++) {
+		if(*s == '"') fputc('"', fp);
+		fputc(*s, fp);
+	}
+	fputc('"', fp);
+}
+
+/*
+ * printJSONString() - print s as a quoted JSON string
+ */
+static void printJSONString(FILE *fp, const char *s) {
+	fputc('"', fp);
+	for(; *s; s++) {
+		if(*s == '"' || *s == '\\') fputc('\\', fp);
+		if((unsigned char)*s < 0x20) fprintf(fp, "\\u%04x", *s);
+		else fputc(*s, fp);
+	}
+	fputc('"', fp);
+}
+
+static const char *isaName(int isa) {
+	return noiseISAName((noiseISA)isa);
+}
+
+int main(int argc, char *argv[]) {
+	benchData data;
+	benchTask task;
+	noisePool *pool;
+	FILE *fp = stdout;
+	const char *format = "text", *onlyisa = NULL, *onlycase = NULL;
+	const char *outname = NULL, *label = "";
+	double *times, t0, median, p95, total;
+	int samples = 1 << 20, reps = 15, warmup = 3, maxthreads = 0;
+	int a, c, r, isa, threads, nchunks, first = 1;
+
+	for(a = 1; a < argc; a++) {
+		if(argv[a][0] != '-' || argv[a][1] == '\0' || argv[a][2] != '\0' || a + 1 >= argc) {
+			fprintf(stderr, "Usage: %s [-n samples] [-r reps] [-w warmup] [-t threads]"
+				" [-i isa] [-c case] [-f text|json|csv] [-o file] [-l label]\n", argv[0]);
+			return 1;
+		}
+		switch(argv[a][1]) {
+			case 'n': samples = atoi(argv[++a]); break;
+			case 'r': reps = atoi(argv[++a]); break;
+			case 'w': warmup = atoi(argv[++a]); break;
+			case 't': maxthreads = atoi(argv[++a]); break;
+			case 'i': onlyisa = argv[++a]; break;
+			case 'c': onlycase = argv[++a]; break;
+			case 'f': format = argv[++a]; break;
+			case 'o': outname = argv[++a]; break;
+			case 'l': label = argv[++a]; break;
+			default:
+				fprintf(stderr, "Unknown option %s\n", argv[a]);
+				return 1;
+		}
+	}
+	if(samples < 1) samples = 1;
+	if(reps < 1) reps = 1;
+	if(maxthreads <= 0) {
+		pool = noisePoolCreate(0);
+		maxthreads = pool ? noisePoolThreads(pool) : 1;
+		noisePoolDestroy(pool);
+	}
+
+	data.n = samples;
+	data.x = (float*)malloc((10 + FRAMES) * (size_t)samples * sizeof(float));
+	times = (double*)malloc(reps * sizeof(double));
+	if(data.x == NULL || times == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+	data.y = data.x + samples;
+	data.z = data.y + samples;
+	data.w = data.z + samples;
+	data.out = data.w + samples;
+	data.dx = data.out + samples;
+	data.dy = data.dx + samples;
+	data.dz = data.dy + samples;
+	data.dw = data.dz + samples;
+	data.filterwidth = data.dw + samples;
+	data.frames = data.filterwidth + samples;
+	fillInput(&data);
+	nchunks = (samples + CHUNK - 1) / CHUNK;
+
+	if(outname) {
+		fp = fopen(outname, "w");
+		if(fp == NULL) {
+			perror(outname);
+			return 1;
+		}
+	}
+	if(strcmp(format, "json") == 0) {
+		fprintf(fp, "{\n  \"label\": ");
+		printJSONString(fp, label);
+		fprintf(fp, ",\n  \"samples\": %d,\n  \"repetitions\": %d,\n"
+			"  \"warmup\": %d,\n  \"results\": [", samples, reps, warmup);
+	}
+	else if(strcmp(format, "csv") == 0) {
+		fprintf(fp, "label,isa,threads,case,samples,median_ms,p95_ms,"
+			"msamples_median,msamples_p95\n");
+	}
+	else {
+		fprintf(fp, "CPU noise benchmark%s%s, %d samples, %d repetitions"
+			" after %d warm-up runs\n", label[0] ? " " : "", label, samples, reps, warmup);
+		fprintf(fp, "%-7s %7s  %-14s %12s %12s\n", "isa", "threads", "case",
+			"Ms/s median", "Ms/s p95");
+	}
+
+	for(isa = 0; isa < NOISE_ISA_COUNT; isa++) {
+		if(onlyisa && strcmp(onlyisa, isaName(isa)) != 0) continue;
+		if(noiseSetISA((noiseISA)isa) != (noiseISA)isa) continue; // Not supported
+		for(threads = 1; threads <= maxthreads; threads = (threads * 2 > maxthreads
+			&& threads < maxthreads) ? maxthreads : threads * 2) {
+			pool = noisePoolCreate(threads);
+			if(pool == NULL) {
+				fprintf(stderr, "Could not start %d threads\n", threads);
+				return 1;
+			}
+			for(c = 0; c < NCASES; c++) {
+				if(onlycase && strncmp(onlycase, cases[c].name, strlen(onlycase)) != 0) continue;
+				task.data = &data;
+				task.func = cases[c].func;
+				for(r = 0; r < warmup; r++) noisePoolRun(pool, nchunks, chunkTask, &task);
+				for(r = 0; r < reps; r++) {
+					t0 = seconds();
+					noisePoolRun(pool, nchunks, chunkTask, &task);
+					times[r] = seconds() - t0;
+				}
+				qsort(times, reps, sizeof(double), compareDoubles);
+				median = percentile(times, reps, 50.0);
+				p95 = percentile(times, reps, 95.0);
+				total = (double)samples * cases[c].outputs;
+
+				if(strcmp(format, "json") == 0) {
+					fprintf(fp, "%s\n    {\"isa\": \"%s\", \"threads\": %d, \"case\": \"%s\", "
+						"\"median_ms\": %.4f, \"p95_ms\": %.4f, "
+						"\"msamples_median\": %.2f, \"msamples_p95\": %.2f}",
+						first ? "" : ",", isaName(isa), threads, cases[c].name,
+						median * 1e3, p95 * 1e3, total / median * 1e-6, total / p95 * 1e-6);
+				}
+				else if(strcmp(format, "csv") == 0) {
+					printCSVString(fp, label);
+					fprintf(fp, ",%s,%d,%s,%.0f,%.4f,%.4f,%.2f,%.2f\n", isaName(isa),
+						threads, cases[c].name, total, median * 1e3, p95 * 1e3,
+						total / median * 1e-6, total / p95 * 1e-6);
+				}
+				else {
+					fprintf(fp, "%-7s %7d  %-14s %12.1f %12.1f\n", isaName(isa), threads,
+						cases[c].name, total / median * 1e-6, total / p95 * 1e-6);
+				}
+				fflush(fp);
+				first = 0;
+			}
+			noisePoolDestroy(pool);
+		}
+	}
+	if(strcmp(format, "json") == 0) fprintf(fp, "\n  ]\n}\n");
+
+	if(outname) fclose(fp);
+	free(data.x);
+	free(times);
+	return 0;
+}
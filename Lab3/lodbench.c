@@ -0,0 +1,392 @@
+/*
+ * lodbench.c - make chains of levels of detail (meshSimplify.c) for OBJ
+ * meshes and for the sphere of soupCreateSphere(), and show what they
+ * cost and how far they are from the full mesh.
+ *
+ * For each level this prints the triangles, the error that meshLodBuild()
+ * records for it, and the distance that is actually there: from each
+ * vertex and the middle of each triangle of the full mesh to the nearest
+ * point of the level, found in a grid of its triangles, as the largest
+ * and the mean. The error must be at least the largest. Then comes the
+ * largest distance from the middle of each triangle along its normal,
+ * both ways, to the level (with bvh.c). That is more than the distance
+ * where the surface is slanted, and much more where the ray slips past
+ * an open border of the level and hits some other part. It also counts
+ * the open edges, those without a twin by position, which must not grow
+ * where the full mesh is closed, or seams have opened. Last comes the
+ * level that meshLodSelect() picks at a few distances, for a 60 degree
+ * field of view 1080 pixels high.
+ *
+ * Usage: lodbench [file.obj ...]
+ * With no files, the sphere and the meshes in meshes/ are used. The name
+ * "sphere" means the sphere.
+ *
+ * This code is in the public domain.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+
+#include "bench.h"
+#include "objLoader.h"
+#include "meshSimplify.h"
+#include "meshOptimize.h"
+#include "bvh.h"
+
+static const char *defaultFiles[] = { "sphere", BENCH_MESHES };
+
+// Segments of the sphere, as in GLSLprimer.c, and the screen for meshLodSelect()
+#define SPHERE_SEGMENTS 200
+#define SCREEN_HEIGHT 1080
+#define FIELD_OF_VIEW 60.0
+
+/* The sphere of soupCreateSphere(), without OpenGL, to be freed with objFree() */
+static int makeSphere(objMesh *mesh, float radius, int segments) {
+	int i, j, base, i0, vsegs = segments, hsegs = 2 * segments;
+	double theta, phi;
+	float *v;
+
+	memset(mesh, 0, sizeof(objMesh));
+	mesh->nverts = 1 + (vsegs - 1) * (hsegs + 1) + 1;
+	mesh->ntris = hsegs + (vsegs - 2) * hsegs * 2 + hsegs;
+	mesh->vertexarray = (float*)malloc(mesh->nverts * 8 * sizeof(float));
+	mesh->indexarray = (unsigned int*)malloc(mesh->ntris * 3 * sizeof(unsigned int));
+	if(mesh->vertexarray == NULL || mesh->indexarray == NULL) return -1;
+	v = mesh->vertexarray;
+	v[0] = 0.0f; v[1] = radius; v[2] = 0.0f; v[3] = 0.0f; v[4] = 1.0f; v[5] = 0.0f; v[6] = 0.5f; v[7] = 1.0f;
+	v += 8 * (mesh->nverts - 1);
+	v[0] = 0.0f; v[1] = -radius; v[2] = 0.0f; v[3] = 0.0f; v[4] = -1.0f; v[5] = 0.0f; v[6] = 0.5f; v[7] = 0.0f;
+	for(j = 0; j < vsegs - 1; j++) {
+		theta = (double)(j + 1) / vsegs * M_PI;
+		for(i = 0; i <= hsegs; i++) {
+			phi = (double)i / hsegs * 2.0 * M_PI;
+			v = mesh->vertexarray + 8 * (1 + j * (hsegs + 1) + i);
+			v[3] = (float)(sin(theta) * sin(phi));
+			v[4] = (float)cos(theta);
+			v[5] = (float)(sin(theta) * cos(phi));
+			v[0] = radius * v[3];
+			v[1] = radius * v[4];
+			v[2] = radius * v[5];
+			v[6] = (float)i / hsegs;
+			v[7] = 1.0f - (float)(j + 1) / vsegs;
+		}
+	}
+	for(i = 0; i < hsegs; i++) {
+		mesh->indexarray[3 * i] = 0;
+		mesh->indexarray[3 * i + 1] = 1 + i;
+		mesh->indexarray[3 * i + 2] = 2 + i;
+	}
+	for(j = 0; j < vsegs - 2; j++) {
+		for(i = 0; i < hsegs; i++) {
+			base = 3 * (hsegs + 2 * (j * hsegs + i));
+			i0 = 1 + j * (hsegs + 1) + i;
+			mesh->indexarray[base] = i0;
+			mesh->indexarray[base + 1] = i0 + hsegs + 1;
+			mesh->indexarray[base + 2] = i0 + 1;
+			mesh->indexarray[base + 3] = i0 + 1;
+			mesh->indexarray[base + 4] = i0 + hsegs + 1;
+			mesh->indexarray[base + 5] = i0 + hsegs + 2;
+		}
+	}
+	base = 3 * (hsegs + 2 * (vsegs - 2) * hsegs);
+	for(i = 0; i < hsegs; i++) {
+		mesh->indexarray[base + 3 * i] = mesh->nverts - 1;
+		mesh->indexarray[base + 3 * i + 1] = mesh->nverts - 2 - i;
+		mesh->indexarray[base + 3 * i + 2] = mesh->nverts - 3 - i;
+	}
+	return 0;
+}
+
+static int compareKeys(const void *a, const void *b) {
+	unsigned long long ka = *(const unsigned long long*)a, kb = *(const unsigned long long*)b;
+	return (ka > kb) - (ka < kb);
+}
+
+/* Position numbers: vertices closer than a millionth of the mesh size get the same */
+static void positionIds(unsigned int *ids, const objMesh *mesh, float size) {
+	unsigned long long *keys = (unsigned long long*)malloc(mesh->nverts * sizeof(unsigned long long));
+	unsigned long long q[3];
+	int i, k, id = -1;
+
+	for(i = 0; i < mesh->nverts; i++) {
+		for(k = 0; k < 3; k++) q[k] = (unsigned long long)llrintf(mesh->vertexarray[8 * i + k] / size * 1e6f + 2e6f);
+		keys[i] = ((q[0] * 4000003ull + q[1]) * 4000003ull + q[2]) << 20 | (unsigned long long)i;
+	}
+	// Sorted, the vertices at one position are next to each other (i < 2^20 here)
+	qsort(keys, mesh->nverts, sizeof(unsigned long long), compareKeys);
+	for(i = 0; i < mesh->nverts; i++) {
+		if(i == 0 || (keys[i] >> 20) != (keys[i - 1] >> 20)) id++;
+		ids[keys[i] & 0xfffff] = id;
+	}
+	free(keys);
+}
+
+/* Edges without a twin the other way, by position */
+static int openEdges(const unsigned int *indices, int ntris, const unsigned int *ids) {
+	unsigned long long *edges = (unsigned long long*)malloc(3 * (size_t)ntris * sizeof(unsigned long long)), key;
+	int i, open = 0;
+
+	for(i = 0; i < 3 * ntris; i++) {
+		edges[i] = (unsigned long long)ids[indices[i]] << 32 | ids[indices[i - i % 3 + (i + 1) % 3]];
+	}
+	qsort(edges, 3 * ntris, sizeof(unsigned long long), compareKeys);
+	for(i = 0; i < 3 * ntris; i++) {
+		key = (edges[i] << 32) | (edges[i] >> 32);
+		open += bsearch(&key, edges, 3 * ntris, sizeof(unsigned long long), compareKeys) == NULL;
+	}
+	free(edges);
+	return open;
+}
+
+/* The triangles of a level in a grid of n x n x n cells across the mesh */
+typedef struct {
+	const float *vertices;
+	const unsigned int *indices;
+	float lo[3], cell;
+	int n, *first, *tris; // The triangles of cell c are tris[first[c]] to tris[first[c + 1] - 1]
+} triangleGrid;
+
+static int gridCell(const triangleGrid *grid, float x, int k) {
+	int c = (int)((x - grid->lo[k]) / grid->cell);
+	return (c < 0) ? 0 : (c >= grid->n) ? grid->n - 1 : c;
+}
+
+/* Put each triangle in the cells that its bounding box covers */
+static int gridBuild(triangleGrid *grid, const objMesh *mesh, const unsigned int *indices, int ntris) {
+	int i, j, k, pass, x, y, z, c0[3], c1[3], ncells, *fill = NULL;
+	float hi[3], v;
+
+	memset(grid, 0, sizeof(triangleGrid));
+	grid->vertices = mesh->vertexarray;
+	grid->indices = indices;
+	for(k = 0; k < 3; k++) grid->lo[k] = hi[k] = mesh->vertexarray[k];
+	for(i = 0; i < mesh->nverts; i++) {
+		for(k = 0; k < 3; k++) {
+			v = mesh->vertexarray[8 * i + k];
+			if(v < grid->lo[k]) grid->lo[k] = v;
+			if(v > hi[k]) hi[k] = v;
+		}
+	}
+	for(k = 0; k < 3; k++) if(hi[k] - grid->lo[k] > grid->cell) grid->cell = hi[k] - grid->lo[k];
+	grid->n = (int)(2.0f * cbrtf((float)ntris)) + 2; // About 8 cells per triangle, most of them empty
+	grid->cell = (grid->cell > 0.0f) ? grid->cell / grid->n * 1.0001f : 1.0f;
+	ncells = grid->n * grid->n * grid->n;
+	grid->first = (int*)calloc(ncells + 1, sizeof(int));
+	fill = (int*)malloc((ncells + 1) * sizeof(int));
+	if(grid->first == NULL || fill == NULL) {
+		free(grid->first);
+		free(fill);
+		return -1;
+	}
+	// Count, then fill in
+	for(pass = 0; pass < 2; pass++) {
+		for(i = 0; i < ntris; i++) {
+			for(k = 0; k < 3; k++) {
+				c0[k] = c1[k] = gridCell(grid, mesh->vertexarray[8 * indices[3 * i] + k], k);
+				for(j = 1; j < 3; j++) {
+					x = gridCell(grid, mesh->vertexarray[8 * indices[3 * i + j] + k], k);
+					if(x < c0[k]) c0[k] = x;
+					if(x > c1[k]) c1[k] = x;
+				}
+			}
+			for(z = c0[2]; z <= c1[2]; z++) for(y = c0[1]; y <= c1[1]; y++) for(x = c0[0]; x <= c1[0]; x++) {
+				if(pass == 0) grid->first[(z * grid->n + y) * grid->n + x + 1]++;
+				else grid->tris[fill[(z * grid->n + y) * grid->n + x]++] = i;
+			}
+		}
+		if(pass == 0) {
+			for(i = 0; i < ncells; i++) grid->first[i + 1] += grid->first[i];
+			memcpy(fill, grid->first, (ncells + 1) * sizeof(int));
+			if((grid->tris = (int*)malloc((grid->first[ncells] + 1) * sizeof(int))) == NULL) {
+				free(grid->first);
+				free(fill);
+				return -1;
+			}
+		}
+	}
+	free(fill);
+	return 0;
+}
+
+static void gridFree(triangleGrid *grid) {
+	free(grid->first);
+	free(grid->tris);
+}
+
+/* Distance from p, inside the grid, to the nearest triangle: the cells
+   in shells around the cell of p, until the next shell is farther away */
+static float gridDistance(const triangleGrid *grid, const float *p) {
+	const unsigned int *tri;
+	float d, margin, best = FLT_MAX;
+	int c[3], r, x, y, z, i;
+
+	for(i = 0; i < 3; i++) c[i] = gridCell(grid, p[i], i);
+	for(r = 0; r < grid->n; r++) {
+		for(z = c[2] - r; z <= c[2] + r; z++) for(y = c[1] - r; y <= c[1] + r; y++) for(x = c[0] - r; x <= c[0] + r; x++) {
+			if(x < 0 || y < 0 || z < 0 || x >= grid->n || y >= grid->n || z >= grid->n) continue;
+			if(abs(x - c[0]) != r && abs(y - c[1]) != r && abs(z - c[2]) != r) continue; // Inner shell
+			for(i = grid->first[(z * grid->n + y) * grid->n + x]; i < grid->first[(z * grid->n + y) * grid->n + x + 1]; i++) {
+				tri = grid->indices + 3 * grid->tris[i];
+				d = meshTriangleDistance2(p, grid->vertices + 8 * tri[0], grid->vertices + 8 * tri[1],
+					grid->vertices + 8 * tri[2], NULL);
+				if(d < best) best = d;
+			}
+		}
+		// How far p is from the cells outside those seen so far
+		for(margin = FLT_MAX, i = 0; i < 3; i++) {
+			d = p[i] - grid->lo[i] - (c[i] - r) * grid->cell;
+			if(c[i] - r > 0 && d < margin) margin = d;
+			d = grid->lo[i] + (c[i] + r + 1) * grid->cell - p[i];
+			if(c[i] + r + 1 < grid->n && d < margin) margin = d;
+		}
+		if(best <= margin * margin) break;
+	}
+	return sqrtf(best);
+}
+
+/* Distance from the vertices and the middles of the triangles of the full
+   mesh to the nearest point of a level, the largest and the mean */
+static void measureNearest(const objMesh *mesh, const unsigned int *indices, int ntris,
+	float *maxdist, float *meandist) {
+	const float *p[3];
+	float middle[3], d;
+	double sum = 0.0;
+	int i, j, k;
+	triangleGrid grid;
+
+	*maxdist = *meandist = 0.0f;
+	if(gridBuild(&grid, mesh, indices, ntris) != 0) return;
+	for(i = 0; i < mesh->ntris; i++) {
+		for(j = 0; j < 3; j++) p[j] = mesh->vertexarray + 8 * mesh->indexarray[3 * i + j];
+		for(k = 0; k < 3; k++) middle[k] = (p[0][k] + p[1][k] + p[2][k]) / 3.0f;
+		d = gridDistance(&grid, middle);
+		sum += d;
+		if(d > *maxdist) *maxdist = d;
+	}
+	for(i = 0; i < mesh->nverts; i++) {
+		d = gridDistance(&grid, mesh->vertexarray + 8 * i);
+		sum += d;
+		if(d > *maxdist) *maxdist = d;
+	}
+	*meandist = (float)(sum / (mesh->ntris + mesh->nverts));
+	gridFree(&grid);
+}
+
+/* Distance from the middle of each triangle of the full mesh along its
+   normal to the triangles of a level, the largest and the mean */
+static void measure(const objMesh *mesh, const unsigned int *indices, int ntris, float size,
+	float *maxdist, float *meandist) {
+	bvhRay *rays = (bvhRay*)malloc(2 * mesh->ntris * sizeof(bvhRay));
+	bvhHit *hits = (bvhHit*)malloc(2 * mesh->ntris * sizeof(bvhHit));
+	const float *p[3];
+	double sum = 0.0;
+	float e1[3], e2[3], n[3], d, len;
+	int i, j, k, count = 0;
+	bvh tree;
+
+	*maxdist = *meandist = 0.0f;
+	if(rays == NULL || hits == NULL
+		|| bvhBuild(&tree, mesh->vertexarray, 8, indices, ntris, mesh->nverts, NULL) != 0) {
+		free(rays);
+		free(hits);
+		return;
+	}
+	for(i = 0; i < mesh->ntris; i++) {
+		for(j = 0; j < 3; j++) p[j] = mesh->vertexarray + 8 * mesh->indexarray[3 * i + j];
+		for(k = 0; k < 3; k++) {
+			e1[k] = p[1][k] - p[0][k];
+			e2[k] = p[2][k] - p[0][k];
+		}
+		n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+		n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+		n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+		len = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+		if(len == 0.0f) len = 1.0f;
+		for(k = 0; k < 3; k++) {
+			rays[2 * i].org[k] = rays[2 * i + 1].org[k] = (p[0][k] + p[1][k] + p[2][k]) / 3.0f;
+			rays[2 * i].dir[k] = n[k] / len;
+			rays[2 * i + 1].dir[k] = -n[k] / len;
+		}
+		rays[2 * i].tmin = rays[2 * i + 1].tmin = 0.0f;
+		rays[2 * i].tmax = rays[2 * i + 1].tmax = size;
+	}
+	bvhIntersect(&tree, rays, hits, 2 * mesh->ntris, NULL);
+	for(i = 0; i < mesh->ntris; i++) {
+		d = (hits[2 * i].t < hits[2 * i + 1].t) ? hits[2 * i].t : hits[2 * i + 1].t;
+		if(d >= size) continue; // Nothing there, as beside a thin part
+		if(d > *maxdist) *maxdist = d;
+		sum += d;
+		count++;
+	}
+	if(count) *meandist = (float)(sum / count);
+	bvhFree(&tree);
+	free(rays);
+	free(hits);
+}
+
+int main(int argc, char *argv[]) {
+	static const float distances[] = {2.0f, 5.0f, 10.0f, 20.0f, 50.0f, 100.0f, 200.0f};
+	const char **files = defaultFiles;
+	int nfiles = sizeof(defaultFiles) / sizeof(defaultFiles[0]);
+	int f, i, j, ntris, result;
+	unsigned int *ids;
+	float size, maxdist, meandist, nearmax, nearmean, pixelscale;
+	double time;
+	meshCacheStats stats;
+	meshLodChain chain;
+	objMesh mesh;
+
+	if(argc > 1) {
+		files = (const char**)&argv[1];
+		nfiles = argc - 1;
+	}
+	pixelscale = (float)(1.0 / tan(0.5 * FIELD_OF_VIEW * M_PI / 180.0) * SCREEN_HEIGHT / 2);
+	for(f = 0; f < nfiles; f++) {
+		if(strcmp(files[f], "sphere") == 0) {
+			result = makeSphere(&mesh, 1.0f, SPHERE_SEGMENTS);
+			if(result == 0) meshOptimize(mesh.vertexarray, 8, mesh.indexarray, mesh.ntris, mesh.nverts);
+		}
+		else result = objLoadThreaded(&mesh, files[f], NULL, OBJ_WELD | OBJ_OPTIMIZE);
+		if(result != 0 || mesh.ntris == 0) {
+			printf("%s could not be read\n", files[f]);
+			continue;
+		}
+		time = seconds();
+		if(meshLodBuild(&chain, mesh.vertexarray, 8, mesh.indexarray, mesh.ntris, mesh.nverts, NULL, 0) != 0) {
+			printf("out of memory\n");
+			return 1;
+		}
+		time = seconds() - time;
+		size = 2.0f * chain.radius;
+		ids = (unsigned int*)malloc(mesh.nverts * sizeof(unsigned int));
+		positionIds(ids, &mesh, size);
+
+		printf("\n%s: %d triangles, %d vertices, %d levels in %.1f ms, %d KB of indices for all\n",
+			files[f], mesh.ntris, mesh.nverts, chain.nlods, 1000.0 * time,
+			(int)(chain.nindices * sizeof(unsigned int) / 1024));
+		printf("  %5s %8s %7s %10s %10s %10s %10s %6s %6s\n", "level", "tris", "ratio", "error",
+			"max dist", "mean dist", "normal max", "open", "ACMR");
+		for(i = 0; i < chain.nlods; i++) {
+			ntris = chain.lods[i].count / 3;
+			measureNearest(&mesh, chain.indices + chain.lods[i].first, ntris, &nearmax, &nearmean);
+			measure(&mesh, chain.indices + chain.lods[i].first, ntris, size, &maxdist, &meandist);
+			meshCacheSimulate(chain.indices + chain.lods[i].first, ntris, mesh.nverts, MESH_CACHE_SIZE, &stats);
+			printf("  %5d %8d %7.4f %10.3g %10.3g %10.3g %10.3g %6d %6.3f%s\n", i, ntris, (float)ntris / mesh.ntris,
+				chain.lods[i].error, nearmax, nearmean, maxdist, openEdges(chain.indices + chain.lods[i].first, ntris, ids),
+				stats.acmr, (nearmax > chain.lods[i].error * 1.001f + 1e-6f * size) ? "  error too small!" : "");
+		}
+		printf("  selected at 1 pixel, distance in mesh sizes:");
+		for(j = 0; j < (int)(sizeof(distances) / sizeof(distances[0])); j++) {
+			i = meshLodSelect(&chain, distances[j] * size - chain.radius, pixelscale, 1.0f);
+			printf(" %g: %d (%d)", distances[j], i, chain.lods[i].count / 3);
+		}
+		printf("\n");
+		free(ids);
+		meshLodFree(&chain);
+		objFree(&mesh);
+	}
+	return 0;
+}
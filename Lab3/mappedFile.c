@@ -0,0 +1,175 @@
+/*
+ * mappedFile.c - read only memory mapping of whole files. See mappedFile.h.
+ *
+ * This code is in the public domain.
+ */
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "mappedFile.h"
+
+// Number and size of the samples of a file for fileFingerprint()
+#define FINGERPRINT_SAMPLES 64
+#define FINGERPRINT_SAMPLESIZE 1024
+
+#ifdef _WIN32
+
+int mapFile(mappedFile *file, const char *filename) {
+	HANDLE handle, mapping;
+	LARGE_INTEGER size;
+
+	file->data = NULL;
+	file->size = 0;
+	file->handle = NULL;
+	handle = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+		OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if(handle == INVALID_HANDLE_VALUE) return -1;
+	if(!GetFileSizeEx(handle, &size)) {
+		CloseHandle(handle);
+		return -1;
+	}
+	if(size.QuadPart == 0) { // Nothing to map
+		CloseHandle(handle);
+		return 0;
+	}
+	mapping = CreateFileMappingA(handle, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(handle); // The mapping keeps the file open
+	if(mapping == NULL) return -1;
+	file->data = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+	if(file->data == NULL) {
+		CloseHandle(mapping);
+		return -1;
+	}
+	file->size = (size_t)size.QuadPart;
+	file->handle = (void*)mapping;
+	return 0;
+}
+
+int mapFileStream(mappedFile *file, const char *filename) {
+	return mapFile(file, filename); // Views are not read in up front anyway
+}
+
+void releaseFileRange(mappedFile *file, size_t offset, size_t size) {
+	SYSTEM_INFO info;
+	size_t first, last;
+
+	GetSystemInfo(&info);
+	first = (offset + info.dwPageSize - 1) / info.dwPageSize * info.dwPageSize;
+	last = (offset + size) / info.dwPageSize * info.dwPageSize;
+	if(file->data == NULL || last <= first) return;
+	// Unlocking pages that are not locked takes them out of the working set
+	VirtualUnlock((LPVOID)(file->data + first), last - first);
+}
+
+void unmapFile(mappedFile *file) {
+	if(file->data) UnmapViewOfFile((LPCVOID)file->data);
+	if(file->handle) CloseHandle((HANDLE)file->handle);
+	file->data = NULL;
+	file->size = 0;
+	file->handle = NULL;
+}
+
+#else
+
+static int mapWhole(mappedFile *file, const char *filename, int populate) {
+	struct stat st;
+	void *data;
+	int fd;
+
+	file->data = NULL;
+	file->size = 0;
+	file->handle = NULL;
+	fd = open(filename, O_RDONLY);
+	if(fd < 0) return -1;
+	if(fstat(fd, &st) != 0) {
+		close(fd);
+		return -1;
+	}
+	if(st.st_size == 0) { // mmap() refuses empty mappings
+		close(fd);
+		return 0;
+	}
+#ifdef MAP_POPULATE
+	// Map all pages up front, which is cheaper than a fault for each page
+	data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE | (populate ? MAP_POPULATE : 0), fd, 0);
+#else
+	data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+#endif
+	close(fd); // The mapping keeps the file open
+	if(data == MAP_FAILED) return -1;
+	madvise(data, (size_t)st.st_size, MADV_SEQUENTIAL);
+	file->data = (const char*)data;
+	file->size = (size_t)st.st_size;
+	return 0;
+}
+
+int mapFile(mappedFile *file, const char *filename) {
+	return mapWhole(file, filename, 1);
+}
+
+int mapFileStream(mappedFile *file, const char *filename) {
+	return mapWhole(file, filename, 0);
+}
+
+void releaseFileRange(mappedFile *file, size_t offset, size_t size) {
+	size_t page = (size_t)sysconf(_SC_PAGESIZE);
+	size_t first = (offset + page - 1) / page * page, last = (offset + size) / page * page;
+
+	if(file->data == NULL || last <= first) return;
+	// The mapping is private and read only, so this only drops the pages
+	// from the process, and they stay in the page cache
+	madvise((void*)(file->data + first), last - first, MADV_DONTNEED);
+}
+
+void unmapFile(mappedFile *file) {
+	if(file->data) munmap((void*)file->data, file->size);
+	file->data = NULL;
+	file->size = 0;
+	file->handle = NULL;
+}
+
+#endif
+
+/* FNV-1a, 64 bits */
+static unsigned long long hashBytes(unsigned long long h, const unsigned char *p, size_t n) {
+	while(n--) {
+		h ^= *p++;
+		h *= 0x100000001B3ULL;
+	}
+	return h;
+}
+
+int fileFingerprint(const char *filename, unsigned long long *size, long long *mtime,
+	unsigned long long *hash) {
+	struct stat st;
+	mappedFile file;
+	unsigned long long h;
+	size_t offset, step, n;
+	int i;
+
+	if(stat(filename, &st) != 0) return -1;
+	// The samples are read through a mapping, which has no trouble with
+	// offsets past 2 GB, as fseek() with a long would have
+	if(mapFileStream(&file, filename) != 0) return -1;
+	*size = (unsigned long long)file.size;
+	*mtime = (long long)st.st_mtime;
+	h = hashBytes(0xCBF29CE484222325ULL, (const unsigned char*)size, sizeof(*size));
+	step = (file.size > FINGERPRINT_SAMPLESIZE) ? (file.size - FINGERPRINT_SAMPLESIZE) / (FINGERPRINT_SAMPLES - 1) : 0;
+	for(i = 0; i < FINGERPRINT_SAMPLES; i++) {
+		offset = i * step; // The first sample is at the start, the last at the end
+		n = (file.size - offset < FINGERPRINT_SAMPLESIZE) ? file.size - offset : FINGERPRINT_SAMPLESIZE;
+		h = hashBytes(h, (const unsigned char*)file.data + offset, n);
+		if(step == 0) break;
+	}
+	unmapFile(&file);
+	*hash = h;
+	return 0;
+}
@@ -0,0 +1,58 @@
+/*
+ * mappedFile.h - read only memory mapping of whole files, for loaders
+ * that parse their input in place instead of copying it through stdio.
+ * Uses mmap() on Linux and MacOSX and file mappings on Windows.
+ *
+ * This code is in the public domain.
+ */
+
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <stddef.h> // For size_t
+
+typedef struct {
+	const char *data; // The file contents, NULL for an empty file
+	size_t size;      // Size of the file in bytes
+	void *handle;     // Platform specific, for unmapFile()
+} mappedFile;
+
+/*
+ * mapFile() - map the file read only, with a hint to the OS that it
+ * will be read sequentially. Returns 0 on success or -1 if the file
+ * could not be opened or mapped.
+ */
+int mapFile(mappedFile *file, const char *filename);
+
+/*
+ * mapFileStream() - map the file like mapFile(), but without reading all
+ * of it in up front, for readers that go through it once and give back
+ * each part they are done with by releaseFileRange(). Then only the part
+ * that is being read takes up memory in the process.
+ */
+int mapFileStream(mappedFile *file, const char *filename);
+
+/*
+ * releaseFileRange() - drop the pages that are wholly within size bytes
+ * from offset from the memory of the process. They are still in the
+ * mapping, and are read in again if they are used.
+ */
+void releaseFileRange(mappedFile *file, size_t offset, size_t size);
+
+/*
+ * unmapFile() - release a mapping from mapFile(), and clear the struct
+ */
+void unmapFile(mappedFile *file);
+
+/*
+ * fileFingerprint() - the size, modification time and a hash of a file,
+ * to tell if a cache made from it is still good. The hash is taken over
+ * the size and 64 evenly spaced 1 KB samples of the file, so that it
+ * does not cost a read of the whole file. Together with the size and
+ * the modification time, that catches any ordinary edit of the file.
+ * Returns 0, or -1 if the file can't be read.
+ */
+int fileFingerprint(const char *filename, unsigned long long *size, long long *mtime,
+	unsigned long long *hash);
+
+#endif /* MAPPEDFILE_H */
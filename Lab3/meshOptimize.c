@@ -0,0 +1,514 @@
+/*
+ * meshOptimize.c - vertex cache, overdraw and vertex fetch optimization
+ * of indexed triangle meshes. See meshOptimize.h.
+ *
+ * This code is in the public domain.
+ */
+
+#include <stdlib.h> // For malloc(), calloc(), free() and qsort()
+#include <string.h> // For memcpy(), memmove() and memset()
+#include <math.h>   // For sqrt()
+
+#include "meshOptimize.h"
+
+void meshCacheSimulate(const unsigned int *indices, int ntris, int nverts,
+	int cachesize, meshCacheStats *stats) {
+	int *stamp, time, misses = 0, used = 0, i;
+	unsigned int v;
+
+	stats->misses = 0;
+	stats->acmr = stats->atvr = 0.0f;
+	if(ntris <= 0 || nverts <= 0) return;
+	// stamp[v] is the miss count when v last entered the cache, and v is
+	// still in it while fewer than cachesize misses have happened since
+	stamp = (int*)malloc(nverts * sizeof(int));
+	if(stamp == NULL) return;
+	for(i = 0; i < nverts; i++) stamp[i] = -1;
+	time = 0;
+	for(i = 0; i < 3 * ntris; i++) {
+		v = indices[i];
+		if(stamp[v] < 0) used++;
+		if(stamp[v] < 0 || time - stamp[v] >= cachesize) {
+			stamp[v] = time++;
+			misses++;
+		}
+	}
+	free(stamp);
+	stats->misses = misses;
+	stats->acmr = (float)misses / ntris;
+	stats->atvr = (float)misses / used;
+}
+
+// Directions of the views of meshOverdrawSimulate(), before normalizing
+static const float overdrawViews[14][3] = {
+	{1, 0, 0}, {-1, 0, 0}, {0, 1, 0}, {0, -1, 0}, {0, 0, 1}, {0, 0, -1},
+	{1, 1, 1}, {1, 1, -1}, {1, -1, 1}, {1, -1, -1},
+	{-1, 1, 1}, {-1, 1, -1}, {-1, -1, 1}, {-1, -1, -1}
+};
+
+float meshOverdrawSimulate(const unsigned int *indices, int ntris, const float *vertices,
+	int stride, int nverts, int size) {
+	float *screen, *depth, *a, *b, *c, *t;
+	float lo[3], hi[3], centre[3], d[3], u[3], w[3], q[3], radius = 0.0f, len, area;
+	float eab, ebc, eca, x, y, z;
+	double covered = 0.0, shaded = 0.0;
+	int view, i, k, x0, x1, y0, y1, px, py;
+
+	if(ntris <= 0 || nverts <= 0 || size <= 0) return 0.0f;
+	screen = (float*)malloc(3 * (size_t)nverts * sizeof(float));
+	depth = (float*)malloc((size_t)size * size * sizeof(float));
+	if(screen == NULL || depth == NULL) {
+		free(screen);
+		free(depth);
+		return 0.0f;
+	}
+	// The views are fitted to the bounding sphere around the bounding box
+	for(k = 0; k < 3; k++) lo[k] = hi[k] = vertices[k];
+	for(i = 1; i < nverts; i++) {
+		for(k = 0; k < 3; k++) {
+			if(vertices[(size_t)i * stride + k] < lo[k]) lo[k] = vertices[(size_t)i * stride + k];
+			if(vertices[(size_t)i * stride + k] > hi[k]) hi[k] = vertices[(size_t)i * stride + k];
+		}
+	}
+	for(k = 0; k < 3; k++) centre[k] = 0.5f * (lo[k] + hi[k]);
+	radius = 0.5f * sqrtf((hi[0] - lo[0]) * (hi[0] - lo[0]) + (hi[1] - lo[1]) * (hi[1] - lo[1])
+		+ (hi[2] - lo[2]) * (hi[2] - lo[2]));
+	if(radius <= 0.0f) radius = 1.0f;
+
+	for(view = 0; view < 14; view++) {
+		// Look along d, with u to the right and w up, so that u x w = d
+		len = sqrtf(overdrawViews[view][0] * overdrawViews[view][0]
+			+ overdrawViews[view][1] * overdrawViews[view][1] + overdrawViews[view][2] * overdrawViews[view][2]);
+		for(k = 0; k < 3; k++) d[k] = overdrawViews[view][k] / len;
+		q[0] = (fabsf(d[0]) < 0.9f) ? 1.0f : 0.0f;
+		q[1] = 1.0f - q[0];
+		q[2] = 0.0f;
+		u[0] = q[1] * d[2] - q[2] * d[1];
+		u[1] = q[2] * d[0] - q[0] * d[2];
+		u[2] = q[0] * d[1] - q[1] * d[0];
+		len = sqrtf(u[0] * u[0] + u[1] * u[1] + u[2] * u[2]);
+		for(k = 0; k < 3; k++) u[k] /= len;
+		w[0] = d[1] * u[2] - d[2] * u[1];
+		w[1] = d[2] * u[0] - d[0] * u[2];
+		w[2] = d[0] * u[1] - d[1] * u[0];
+		for(i = 0; i < nverts; i++) {
+			for(k = 0; k < 3; k++) q[k] = vertices[(size_t)i * stride + k] - centre[k];
+			screen[3 * i] = (0.5f + 0.5f * (q[0] * u[0] + q[1] * u[1] + q[2] * u[2]) / radius) * size;
+			screen[3 * i + 1] = (0.5f + 0.5f * (q[0] * w[0] + q[1] * w[1] + q[2] * w[2]) / radius) * size;
+			screen[3 * i + 2] = q[0] * d[0] + q[1] * d[1] + q[2] * d[2];
+		}
+		for(i = 0; i < size * size; i++) depth[i] = 1e30f;
+
+		for(i = 0; i < ntris; i++) {
+			a = screen + 3 * indices[3 * i];
+			b = screen + 3 * indices[3 * i + 1];
+			c = screen + 3 * indices[3 * i + 2];
+			// Counterclockwise triangles face the viewer when their area
+			// is negative here, since the view is mirrored by looking along d
+			area = (b[0] - a[0]) * (c[1] - a[1]) - (c[0] - a[0]) * (b[1] - a[1]);
+			if(area >= 0.0f) continue;
+			t = b; b = c; c = t;
+			area = -area;
+			x0 = (int)ceilf(fminf(a[0], fminf(b[0], c[0])) - 0.5f);
+			x1 = (int)floorf(fmaxf(a[0], fmaxf(b[0], c[0])) - 0.5f);
+			y0 = (int)ceilf(fminf(a[1], fminf(b[1], c[1])) - 0.5f);
+			y1 = (int)floorf(fmaxf(a[1], fmaxf(b[1], c[1])) - 0.5f);
+			if(x0 < 0) x0 = 0;
+			if(y0 < 0) y0 = 0;
+			if(x1 > size - 1) x1 = size - 1;
+			if(y1 > size - 1) y1 = size - 1;
+			for(py = y0; py <= y1; py++) {
+				y = py + 0.5f;
+				for(px = x0; px <= x1; px++) {
+					x = px + 0.5f;
+					eab = (b[0] - a[0]) * (y - a[1]) - (b[1] - a[1]) * (x - a[0]);
+					ebc = (c[0] - b[0]) * (y - b[1]) - (c[1] - b[1]) * (x - b[0]);
+					eca = (a[0] - c[0]) * (y - c[1]) - (a[1] - c[1]) * (x - c[0]);
+					if(eab < 0.0f || ebc < 0.0f || eca < 0.0f) continue;
+					z = (ebc * a[2] + eca * b[2] + eab * c[2]) / area;
+					if(z < depth[py * size + px]) {
+						if(depth[py * size + px] == 1e30f) covered++;
+						depth[py * size + px] = z;
+						shaded++;
+					}
+				}
+			}
+		}
+	}
+	free(screen);
+	free(depth);
+	return (covered > 0.0) ? (float)(shaded / covered) : 0.0f;
+}
+
+// Size in bytes and number of the cache lines of meshFetchSimulate()
+#define FETCH_LINE 64
+#define FETCH_LINES 64
+
+float meshFetchSimulate(const unsigned int *indices, int ntris, int nverts, int vertexbytes) {
+	int *stamp, time = 0, nused = 0, i;
+	size_t line, last, nlines;
+	unsigned char *used;
+
+	if(ntris <= 0 || nverts <= 0) return 0.0f;
+	// As in meshCacheSimulate(), a line is in the cache while fewer than
+	// FETCH_LINES lines have been read since it was
+	nlines = ((size_t)nverts * vertexbytes + FETCH_LINE - 1) / FETCH_LINE;
+	stamp = (int*)malloc(nlines * sizeof(int));
+	used = (unsigned char*)calloc(nverts, 1);
+	if(stamp == NULL || used == NULL) {
+		free(stamp);
+		free(used);
+		return 0.0f;
+	}
+	for(line = 0; line < nlines; line++) stamp[line] = -FETCH_LINES - 1;
+	for(i = 0; i < 3 * ntris; i++) {
+		if(!used[indices[i]]) {
+			used[indices[i]] = 1;
+			nused++;
+		}
+		// A vertex may straddle two lines
+		line = (size_t)indices[i] * vertexbytes / FETCH_LINE;
+		last = ((size_t)indices[i] * vertexbytes + vertexbytes - 1) / FETCH_LINE;
+		for(; line <= last; line++) {
+			if(time - stamp[line] >= FETCH_LINES) stamp[line] = time++;
+		}
+	}
+	free(stamp);
+	free(used);
+	return (float)time * FETCH_LINE / ((float)nused * vertexbytes);
+}
+
+void meshBuildAdjacency(int *first, int *tris, const unsigned int *indices, int ntris, int nverts) {
+	int i;
+
+	// Count the triangles of each vertex into first[v + 1] and add them
+	// up, then use first[v] as the place for the next one, which leaves
+	// the start of the list of v + 1 in it, and move them all back
+	memset(first, 0, (nverts + 1) * sizeof(int));
+	for(i = 0; i < 3 * ntris; i++) first[indices[i] + 1]++;
+	for(i = 0; i < nverts; i++) first[i + 1] += first[i];
+	for(i = 0; i < 3 * ntris; i++) tris[first[indices[i]]++] = i / 3;
+	memmove(first + 1, first, nverts * sizeof(int));
+	first[0] = 0;
+}
+
+int meshOptimizeVertexCache(unsigned int *indices, int ntris, int nverts, int cachesize,
+	int *clusters, int *nclusters) {
+	meshCacheStats before, after;
+	int *first, *tris, *live, *stamp, *deadend, *candidates, *order;
+	unsigned char *emitted;
+	int ndead = 0, ncand, fan, cursor = 0, time, out = 0, count = 0;
+	int i, k, t, v, best, priority, p;
+
+	if(nclusters) *nclusters = 0;
+	if(ntris <= 0) return 0;
+	first = (int*)malloc((nverts + 1) * sizeof(int));
+	tris = (int*)malloc(3 * (size_t)ntris * sizeof(int));
+	live = (int*)malloc(nverts * sizeof(int));
+	stamp = (int*)calloc(nverts, sizeof(int));
+	deadend = (int*)malloc(3 * (size_t)ntris * sizeof(int));
+	candidates = (int*)malloc(3 * (size_t)ntris * sizeof(int));
+	order = (int*)malloc(ntris * sizeof(int));
+	emitted = (unsigned char*)calloc(ntris, 1);
+	if(first == NULL || tris == NULL || live == NULL || stamp == NULL || deadend == NULL
+		|| candidates == NULL || order == NULL || emitted == NULL) {
+		free(first); free(tris); free(live); free(stamp);
+		free(deadend); free(candidates); free(order); free(emitted);
+		return -1;
+	}
+	meshBuildAdjacency(first, tris, indices, ntris, nverts);
+	for(v = 0; v < nverts; v++) live[v] = first[v + 1] - first[v];
+
+	// Timestamps start past the cache size, so that no vertex is in it
+	time = cachesize + 1;
+	fan = indices[0];
+	if(clusters) clusters[count++] = 0;
+	while(fan >= 0) {
+		// Emit all remaining triangles around the fanning vertex
+		ncand = 0;
+		for(i = first[fan]; i < first[fan + 1]; i++) {
+			t = tris[i];
+			if(emitted[t]) continue;
+			emitted[t] = 1;
+			order[out++] = t;
+			for(k = 0; k < 3; k++) {
+				v = indices[3 * t + k];
+				deadend[ndead++] = v;
+				candidates[ncand++] = v;
+				live[v]--;
+				if(time - stamp[v] > cachesize) stamp[v] = time++;
+			}
+		}
+		// The next fanning vertex: the candidate that stays longest in the
+		// cache while its remaining triangles are emitted
+		best = -1;
+		priority = -1;
+		for(i = 0; i < ncand; i++) {
+			v = candidates[i];
+			if(live[v] <= 0) continue;
+			p = 0;
+			if(time - stamp[v] + 2 * live[v] <= cachesize) p = time - stamp[v];
+			if(p > priority) {
+				priority = p;
+				best = v;
+			}
+		}
+		if(best < 0) { // A dead end: the most recent vertex with triangles left
+			while(ndead > 0 && best < 0) {
+				v = deadend[--ndead];
+				if(live[v] > 0) best = v;
+			}
+			while(best < 0 && cursor < nverts) {
+				if(live[cursor] > 0) best = cursor;
+				cursor++;
+			}
+			if(best >= 0 && clusters) clusters[count++] = out;
+		}
+		fan = best;
+	}
+
+	// Put the triangles in the new order, unless the order they were in
+	// misses the cache less, which is then one cluster
+	for(i = 0; i < ntris; i++) {
+		t = order[i];
+		candidates[3 * i] = indices[3 * t];
+		candidates[3 * i + 1] = indices[3 * t + 1];
+		candidates[3 * i + 2] = indices[3 * t + 2];
+	}
+	meshCacheSimulate(indices, ntris, nverts, cachesize, &before);
+	meshCacheSimulate((const unsigned int*)candidates, ntris, nverts, cachesize, &after);
+	if(after.misses <= before.misses) {
+		for(i = 0; i < 3 * ntris; i++) indices[i] = (unsigned int)candidates[i];
+	}
+	else count = 1;
+	if(nclusters) *nclusters = count;
+
+	free(first); free(tris); free(live); free(stamp);
+	free(deadend); free(candidates); free(order); free(emitted);
+	return 0;
+}
+
+/* A cluster of triangles and its sort key for meshOptimizeOverdraw() */
+typedef struct {
+	int first, count;
+	float key;
+} meshCluster;
+
+static int compareClusters(const void *a, const void *b) {
+	const meshCluster *ca = (const meshCluster*)a, *cb = (const meshCluster*)b;
+	if(ca->key != cb->key) return (ca->key < cb->key) ? 1 : -1; // Highest first
+	return ca->first - cb->first; // Keep the order otherwise
+}
+
+// Splits that meshOptimizeOverdraw() tries: threshold, then halfway to
+// 1 each time, and last only the clusters of meshOptimizeVertexCache()
+#define OVERDRAW_TRIES 5
+
+/*
+ * splitClusters() - the clusters, split where the triangles since the
+ * last split have missed the cache at most limit times per triangle,
+ * with misses[t] the misses of triangle t in the order as it is. A limit
+ * below 0 makes no splits. Returns the number of clusters in list.
+ */
+static int splitClusters(meshCluster *list, const unsigned char *misses, int ntris,
+	const int *clusters, int nclusters, float limit) {
+	int n = 0, sum, c, i, end;
+
+	for(c = 0; c < nclusters; c++) {
+		end = (c + 1 < nclusters) ? clusters[c + 1] : ntris;
+		list[n].first = clusters[c];
+		sum = 0;
+		for(i = clusters[c]; i < end; i++) {
+			sum += misses[i];
+			if(i + 1 < end && sum <= limit * (i + 1 - list[n].first)) {
+				list[n].count = i + 1 - list[n].first;
+				list[++n].first = i + 1;
+				sum = 0;
+			}
+		}
+		list[n].count = end - list[n].first;
+		n++;
+	}
+	return n;
+}
+
+/*
+ * clusterKeys() - each cluster's key: how much its area weighted normal
+ * points away from centre, as seen from the cluster's centroid
+ */
+static void clusterKeys(meshCluster *list, int n, const unsigned int *indices,
+	const float *vertices, int stride, const double *centre) {
+	const float *p0, *p1, *p2;
+	double area, pos[3], normal[3], e1[3], e2[3], fn[3], a, len;
+	int c, i, k;
+
+	for(c = 0; c < n; c++) {
+		pos[0] = pos[1] = pos[2] = 0.0;
+		normal[0] = normal[1] = normal[2] = 0.0;
+		area = 0.0;
+		for(i = list[c].first; i < list[c].first + list[c].count; i++) {
+			p0 = vertices + stride * indices[3 * i];
+			p1 = vertices + stride * indices[3 * i + 1];
+			p2 = vertices + stride * indices[3 * i + 2];
+			for(k = 0; k < 3; k++) {
+				e1[k] = p1[k] - p0[k];
+				e2[k] = p2[k] - p0[k];
+			}
+			fn[0] = e1[1]*e2[2] - e1[2]*e2[1];
+			fn[1] = e1[2]*e2[0] - e1[0]*e2[2];
+			fn[2] = e1[0]*e2[1] - e1[1]*e2[0];
+			a = sqrt(fn[0]*fn[0] + fn[1]*fn[1] + fn[2]*fn[2]);
+			for(k = 0; k < 3; k++) {
+				pos[k] += a * (p0[k] + p1[k] + p2[k]) / 3.0;
+				normal[k] += fn[k]; // Length a already
+			}
+			area += a;
+		}
+		list[c].key = 0.0f;
+		len = sqrt(normal[0]*normal[0] + normal[1]*normal[1] + normal[2]*normal[2]);
+		if(area > 0.0 && len > 0.0) {
+			list[c].key = (float)(((pos[0] / area - centre[0]) * normal[0]
+				+ (pos[1] / area - centre[1]) * normal[1]
+				+ (pos[2] / area - centre[2]) * normal[2]) / len);
+		}
+	}
+}
+
+int meshOptimizeOverdraw(unsigned int *indices, int ntris, const float *vertices,
+	int stride, int nverts, int cachesize, const int *clusters, int nclusters,
+	float threshold) {
+	meshCluster *list;
+	meshCacheStats stats;
+	unsigned int *sorted;
+	unsigned char *misses;
+	int *stamp, time = 0, total = 0, n, c, i, k, attempt;
+	float limit, overdraw = -1.0f;
+	const float *p0, *p1, *p2;
+	double centre[3] = {0.0, 0.0, 0.0}, area = 0.0, e1[3], e2[3], a;
+
+	if(ntris <= 0 || nclusters <= 0) return 0;
+	list = (meshCluster*)malloc((ntris + 1) * sizeof(meshCluster));
+	stamp = (int*)malloc(nverts * sizeof(int));
+	sorted = (unsigned int*)malloc(3 * (size_t)ntris * sizeof(unsigned int));
+	misses = (unsigned char*)malloc(ntris);
+	if(list == NULL || stamp == NULL || sorted == NULL || misses == NULL) {
+		free(list); free(stamp); free(sorted); free(misses);
+		return -1;
+	}
+
+	// The cache misses of each triangle in a FIFO cache, in the order as
+	// it is, so that the cost of splitting somewhere is judged on what the
+	// cache really holds there rather than on an empty cache
+	for(i = 0; i < nverts; i++) stamp[i] = -cachesize - 1;
+	for(i = 0; i < ntris; i++) {
+		misses[i] = 0;
+		for(k = 0; k < 3; k++) {
+			if(time - stamp[indices[3 * i + k]] >= cachesize) {
+				stamp[indices[3 * i + k]] = time++;
+				misses[i]++;
+			}
+		}
+	}
+	total = time;
+
+	// The area weighted centroid of the whole mesh
+	for(i = 0; i < ntris; i++) {
+		p0 = vertices + stride * indices[3 * i];
+		p1 = vertices + stride * indices[3 * i + 1];
+		p2 = vertices + stride * indices[3 * i + 2];
+		for(k = 0; k < 3; k++) {
+			e1[k] = p1[k] - p0[k];
+			e2[k] = p2[k] - p0[k];
+		}
+		a = sqrt((e1[1]*e2[2] - e1[2]*e2[1]) * (e1[1]*e2[2] - e1[2]*e2[1])
+			+ (e1[2]*e2[0] - e1[0]*e2[2]) * (e1[2]*e2[0] - e1[0]*e2[2])
+			+ (e1[0]*e2[1] - e1[1]*e2[0]) * (e1[0]*e2[1] - e1[1]*e2[0]));
+		for(k = 0; k < 3; k++) centre[k] += a * (p0[k] + p1[k] + p2[k]) / 3.0;
+		area += a;
+	}
+	if(area > 0.0) for(k = 0; k < 3; k++) centre[k] /= area;
+
+	// Split, sort and run the whole sorted order through the cache, with
+	// fewer splits until it stays within threshold times the misses of
+	// the order as it is. It must also have less overdraw to be kept.
+	for(attempt = 0; attempt < OVERDRAW_TRIES; attempt++) {
+		limit = -1.0f;
+		if(attempt + 1 < OVERDRAW_TRIES) limit = (1.0f + (threshold - 1.0f) / (1 << attempt)) * total / ntris;
+		n = splitClusters(list, misses, ntris, clusters, nclusters, limit);
+		clusterKeys(list, n, indices, vertices, stride, centre);
+		qsort(list, n, sizeof(meshCluster), compareClusters);
+		for(c = 0, k = 0; c < n; c++) {
+			memcpy(sorted + k, indices + 3 * list[c].first, 3 * list[c].count * sizeof(unsigned int));
+			k += 3 * list[c].count;
+		}
+		meshCacheSimulate(sorted, ntris, nverts, cachesize, &stats);
+		if(stats.misses > threshold * total) continue;
+		if(overdraw < 0.0f) {
+			overdraw = meshOverdrawSimulate(indices, ntris, vertices, stride, nverts, MESH_OVERDRAW_PIXELS);
+		}
+		if(meshOverdrawSimulate(sorted, ntris, vertices, stride, nverts, MESH_OVERDRAW_PIXELS) < overdraw) {
+			memcpy(indices, sorted, 3 * (size_t)ntris * sizeof(unsigned int));
+			break;
+		}
+	}
+	free(list); free(stamp); free(sorted); free(misses);
+	return 0;
+}
+
+int meshOptimizeVertexFetch(float *vertices, int stride, unsigned int *indices,
+	int ntris, int nverts) {
+	int *remap, count = 0, i, v;
+	unsigned int *renumbered;
+	float *moved, before;
+
+	remap = (int*)malloc((nverts + 1) * sizeof(int));
+	moved = (float*)malloc(((size_t)nverts * stride + 1) * sizeof(float));
+	renumbered = (unsigned int*)malloc((3 * (size_t)ntris + 1) * sizeof(unsigned int));
+	if(remap == NULL || moved == NULL || renumbered == NULL) {
+		free(remap);
+		free(moved);
+		free(renumbered);
+		return -1;
+	}
+	for(i = 0; i < nverts; i++) remap[i] = -1;
+	for(i = 0; i < 3 * ntris; i++) {
+		v = indices[i];
+		if(remap[v] < 0) remap[v] = count++;
+		renumbered[i] = (unsigned int)remap[v];
+	}
+	// The first use order reads a line again whenever a triangle comes
+	// back to a vertex from long ago, which an order that was already
+	// spatially coherent may do less
+	before = meshFetchSimulate(indices, ntris, nverts, stride * sizeof(float));
+	if(meshFetchSimulate(renumbered, ntris, count, stride * sizeof(float)) > before) {
+		// Keep the order, but close up the gaps of unused vertices
+		for(v = 0, count = 0; v < nverts; v++) if(remap[v] >= 0) remap[v] = count++;
+		for(i = 0; i < 3 * ntris; i++) renumbered[i] = (unsigned int)remap[indices[i]];
+	}
+	for(v = 0; v < nverts; v++) {
+		if(remap[v] >= 0) {
+			memcpy(moved + (size_t)remap[v] * stride, vertices + (size_t)v * stride, stride * sizeof(float));
+		}
+	}
+	memcpy(vertices, moved, (size_t)count * stride * sizeof(float));
+	memcpy(indices, renumbered, 3 * (size_t)ntris * sizeof(unsigned int));
+	free(remap);
+	free(moved);
+	free(renumbered);
+	return count;
+}
+
+int meshOptimize(float *vertices, int stride, unsigned int *indices, int ntris, int nverts) {
+	int *clusters, nclusters;
+
+	clusters = (int*)malloc((ntris + 1) * sizeof(int));
+	if(clusters == NULL) return -1;
+	if(meshOptimizeVertexCache(indices, ntris, nverts, MESH_CACHE_SIZE, clusters, &nclusters)
+		|| meshOptimizeOverdraw(indices, ntris, vertices, stride, nverts, MESH_CACHE_SIZE,
+			clusters, nclusters, MESH_OVERDRAW_THRESHOLD)) {
+		free(clusters);
+		return -1;
+	}
+	free(clusters);
+	return meshOptimizeVertexFetch(vertices, stride, indices, ntris, nverts);
+}
@@ -0,0 +1,121 @@
+/*
+ * meshOptimize.h - reordering of indexed triangle meshes for the GPU:
+ * triangle order for the post-transform vertex cache and for less
+ * overdraw, and vertex order for fetch locality, plus simulators of
+ * the vertex cache, overdraw and vertex fetch to measure the results.
+ * Without OpenGL dependencies.
+ *
+ * The meshes are as in triangleSoup: an index array of 3 * ntris vertex
+ * numbers, and a vertex array of nverts vertices of stride floats each,
+ * with the position in the first three.
+ *
+ * The triangle order comes from Tipsify, by Sander, Nehab and Barczak:
+ * "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw"
+ * (SIGGRAPH 2007). It fans around one vertex at a time, and picks the
+ * next fanning vertex among the vertices of the last fan that are still
+ * in the cache, which runs in linear time. Where it has to start over
+ * from a vertex elsewhere, a cluster of triangles ends. The overdraw
+ * pass from the same paper then splits the clusters further wherever
+ * their cache miss rate so far is within a threshold of the rate of the
+ * whole mesh, and sorts them so that clusters facing away from the
+ * middle of the mesh come first, as they are the ones most likely to be
+ * in front. Each pass keeps the order it was given if it can't do better
+ * by the simulators below.
+ *
+ * This code is in the public domain.
+ */
+
+#ifndef MESHOPTIMIZE_H
+#define MESHOPTIMIZE_H
+
+// Cache size the optimizations assume, unless told otherwise
+#define MESH_CACHE_SIZE 16
+// Most cache misses meshOptimizeOverdraw() may add, 1.05 is 5% more
+#define MESH_OVERDRAW_THRESHOLD 1.05f
+// Width and height in pixels of the views of meshOverdrawSimulate()
+#define MESH_OVERDRAW_PIXELS 128
+
+/* Results of meshCacheSimulate() */
+typedef struct {
+	int misses;  // Vertices transformed
+	float acmr;  // Average cache miss ratio: misses per triangle (0.5 is ideal)
+	float atvr;  // Average transform to vertex ratio: misses per used vertex (1 is ideal)
+} meshCacheStats;
+
+/*
+ * meshCacheSimulate() - run the triangles through a FIFO vertex cache
+ * of cachesize entries, as on most GPUs, and count the misses
+ */
+void meshCacheSimulate(const unsigned int *indices, int ntris, int nverts,
+	int cachesize, meshCacheStats *stats);
+
+/*
+ * meshBuildAdjacency() - the triangles around each vertex, as lists in
+ * one array: the triangles of vertex v are tris[first[v]] to
+ * tris[first[v + 1] - 1], in order. first has room for nverts + 1
+ * entries and tris for 3 * ntris.
+ */
+void meshBuildAdjacency(int *first, int *tris, const unsigned int *indices, int ntris, int nverts);
+
+/*
+ * meshOverdrawSimulate() - draw the triangles in order from 14 directions
+ * (along the axes and the diagonals) with orthographic views of size x
+ * size pixels, back face culling and a depth test, and return the
+ * overdraw: the number of fragments that pass the depth test per pixel
+ * covered. 1 is ideal, and only convex meshes can get there. Returns 0
+ * if out of memory.
+ */
+float meshOverdrawSimulate(const unsigned int *indices, int ntris, const float *vertices,
+	int stride, int nverts, int size);
+
+/*
+ * meshFetchSimulate() - read the vertices of the triangles from a vertex
+ * array of vertexbytes per vertex through a FIFO cache of 64 lines of 64
+ * bytes, and return the bytes read per byte of the vertices used. An
+ * order that reads each line once gets 1.
+ */
+float meshFetchSimulate(const unsigned int *indices, int ntris, int nverts, int vertexbytes);
+
+/*
+ * meshOptimizeVertexCache() - reorder the triangles with Tipsify for a
+ * cache of cachesize entries. If clusters is not NULL, it gets the first
+ * triangle of each cluster, ntris + 1 at most, and nclusters their
+ * number. If the triangles were in an order with fewer cache misses,
+ * they are left in it, as one cluster. Returns 0, or -1 if out of memory.
+ */
+int meshOptimizeVertexCache(unsigned int *indices, int ntris, int nverts, int cachesize,
+	int *clusters, int *nclusters);
+
+/*
+ * meshOptimizeOverdraw() - reorder the clusters from
+ * meshOptimizeVertexCache() to reduce overdraw, splitting them first
+ * where their miss rate so far is at most threshold times that of the
+ * whole mesh. Each triangle stays in place within its cluster. The new
+ * order is kept only if it has at most threshold times the cache misses
+ * of the old one (1 and up, higher values allow more clusters, less
+ * overdraw and more cache misses), and less overdraw. Otherwise fewer
+ * splits are tried, then none, and then the order is left alone.
+ * Returns 0 or -1.
+ */
+int meshOptimizeOverdraw(unsigned int *indices, int ntris, const float *vertices,
+	int stride, int nverts, int cachesize, const int *clusters, int nclusters,
+	float threshold);
+
+/*
+ * meshOptimizeVertexFetch() - renumber the vertices in the order that
+ * the triangles first use them, moving them in the vertex array to
+ * match, and drop unused vertices. If meshFetchSimulate() finds that
+ * worse than the order the vertices were in, that order is kept, less
+ * the unused vertices. Returns the new number of vertices, or -1 if out
+ * of memory.
+ */
+int meshOptimizeVertexFetch(float *vertices, int stride, unsigned int *indices,
+	int ntris, int nverts);
+
+/*
+ * meshOptimize() - all of the above with the default settings, in the
+ * right order. Returns the new number of vertices, or -1.
+ */
+int meshOptimize(float *vertices, int stride, unsigned int *indices, int ntris, int nverts);
+
+#endif /* MESHOPTIMIZE_H */
@@ -0,0 +1,782 @@
+/*
+ * meshSimplify.c - quadric error simplification of indexed triangle
+ * meshes, and levels of detail. See meshSimplify.h.
+ *
+ * Each position (vertices closer than about a millionth of the size of
+ * the mesh count as one) has a quadric: the sum over the triangles around
+ * it of the squared distance to their planes, weighted by area, plus the
+ * same for planes through the seams, perpendicular to their triangles.
+ * The cost of moving a vertex onto a neighbour is its quadric at the
+ * neighbour divided by the total weight, which is a mean squared
+ * distance. The planes through the open borders have a quadric of their
+ * own, weighted by length, which adds MESH_BORDER_WEIGHT times its mean
+ * to the cost, so that a border that is pulled in is charged for it in
+ * full, however much surface there is around it. When a vertex is moved,
+ * its quadrics are added to those of the neighbour. Borders around holes
+ * of three edges are kept, so that holes do not close up.
+ *
+ * The collapses are done in passes, as in meshoptimizer by Arseny
+ * Kapoulkine. Each pass finds out what kind each vertex is (free, on a
+ * border, on a seam or locked), sorts the allowed collapses of all edges
+ * by cost, and does them cheapest first. A collapse next to a vertex
+ * that was already moved in the pass waits for the next pass, so that
+ * the test for triangles that turn over sees the triangles as they will
+ * be. Passes go on until there are few enough triangles, or no collapse
+ * is allowed.
+ *
+ * The quadrics only estimate the error. For the levels of detail, the
+ * distance from each vertex and the middle of each triangle of the full
+ * mesh to the level is measured instead, to the triangles around the
+ * vertices that they were moved onto, and on from the nearest of those
+ * while that gets nearer. Any triangle of the level is at least as far
+ * as the nearest one, so this bounds how far the level is from those
+ * points, and it is close to the real distance where the search ends
+ * inside a triangle.
+ *
+ * This code is in the public domain.
+ */
+
+#include <stdlib.h> // For malloc(), calloc(), free() and qsort()
+#include <string.h> // For memcpy() and memset()
+#include <float.h>  // For FLT_MAX
+#include <math.h>   // For sqrt()
+
+#include "meshSimplify.h"
+#include "meshOptimize.h" // For meshOptimizeVertexCache() and meshBuildAdjacency()
+
+// Grid steps across the mesh for finding vertices at the same position
+#define POSITION_GRID 1048576.0f
+// Least cosine of the angle that a triangle may turn in a collapse
+#define TURN_LIMIT 0.25f
+// Weight of the seams in the error, relative to the surface
+#define SEAM_WEIGHT 1.0f
+// Most steps from triangle to triangle in the search for the nearest one
+#define LEVEL_WALK_STEPS 8
+
+enum { KIND_MANIFOLD, KIND_BORDER, KIND_SEAM, KIND_LOCKED };
+
+/* Error x^T A x + 2 b.x + c for a symmetric A, summed with weights w */
+typedef struct {
+	double a00, a11, a22, a01, a02, a12;
+	double b0, b1, b2, c, w;
+} quadric;
+
+/* The open edges of a vertex: edges without a twin with the vertices
+   the other way around, which are seams if there is a twin by position */
+typedef struct {
+	unsigned int outto;   // The other end of an open edge from the vertex
+	unsigned int infrom;  // The other end of an open edge to the vertex
+	unsigned char nout, nin; // Number of such edges, up to 2
+	unsigned char seams;  // 1 if outto is a seam, 2 if infrom is, or both
+	unsigned char kind;
+} vertexInfo;
+
+typedef struct {
+	float cost;
+	unsigned int from, to; // Move vertex from onto vertex to
+} collapse;
+
+/* Directed edges in an open addressing hash table */
+typedef struct {
+	unsigned long long *keys; // ~0 for empty slots
+	unsigned int mask;
+} edgeSet;
+
+static void quadricAddPlane(quadric *q, const double *n, double d, double w) {
+	q->a00 += w * n[0] * n[0];
+	q->a11 += w * n[1] * n[1];
+	q->a22 += w * n[2] * n[2];
+	q->a01 += w * n[0] * n[1];
+	q->a02 += w * n[0] * n[2];
+	q->a12 += w * n[1] * n[2];
+	q->b0 += w * n[0] * d;
+	q->b1 += w * n[1] * d;
+	q->b2 += w * n[2] * d;
+	q->c += w * d * d;
+	q->w += w;
+}
+
+static void quadricAdd(quadric *q, const quadric *r) {
+	q->a00 += r->a00; q->a11 += r->a11; q->a22 += r->a22;
+	q->a01 += r->a01; q->a02 += r->a02; q->a12 += r->a12;
+	q->b0 += r->b0; q->b1 += r->b1; q->b2 += r->b2;
+	q->c += r->c;
+	q->w += r->w;
+}
+
+/* Mean squared distance at p */
+static float quadricError(const quadric *q, const float *p) {
+	double x = p[0], y = p[1], z = p[2], e;
+
+	e = q->a00 * x * x + q->a11 * y * y + q->a22 * z * z
+		+ 2.0 * (q->a01 * x * y + q->a02 * x * z + q->a12 * y * z)
+		+ 2.0 * (q->b0 * x + q->b1 * y + q->b2 * z) + q->c;
+	if(e < 0.0 || q->w <= 0.0) return 0.0f; // Rounding
+	return (float)(e / q->w);
+}
+
+/* The plane through p0 with normal n, normalized, with weight w */
+static void quadricAddPoint(quadric *q, const double *n, const float *p0, double w) {
+	double len = sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]), m[3];
+
+	if(len <= 0.0) return;
+	m[0] = n[0] / len;
+	m[1] = n[1] / len;
+	m[2] = n[2] / len;
+	quadricAddPlane(q, m, -(m[0] * p0[0] + m[1] * p0[1] + m[2] * p0[2]), w);
+}
+
+static unsigned int hashEdge(unsigned int a, unsigned int b) {
+	unsigned int h = a * 0x9E3779B1u;
+	h = (h ^ b) * 0x85EBCA77u;
+	return h ^ (h >> 16);
+}
+
+static int edgeSetInit(edgeSet *set, int nedges) {
+	size_t capacity = 16;
+
+	while(capacity < 2 * (size_t)nedges) capacity *= 2;
+	set->keys = (unsigned long long*)malloc(capacity * sizeof(unsigned long long));
+	if(set->keys == NULL) return -1;
+	set->mask = (unsigned int)capacity - 1;
+	return 0;
+}
+
+static void edgeSetClear(edgeSet *set) {
+	memset(set->keys, 0xff, ((size_t)set->mask + 1) * sizeof(unsigned long long));
+}
+
+static void edgeSetAdd(edgeSet *set, unsigned int a, unsigned int b) {
+	unsigned long long key = ((unsigned long long)a << 32) | b;
+	unsigned int slot;
+
+	for(slot = hashEdge(a, b) & set->mask; set->keys[slot] != ~0ull; slot = (slot + 1) & set->mask) {
+		if(set->keys[slot] == key) return;
+	}
+	set->keys[slot] = key;
+}
+
+static int edgeSetHas(const edgeSet *set, unsigned int a, unsigned int b) {
+	unsigned long long key = ((unsigned long long)a << 32) | b;
+	unsigned int slot;
+
+	for(slot = hashEdge(a, b) & set->mask; set->keys[slot] != ~0ull; slot = (slot + 1) & set->mask) {
+		if(set->keys[slot] == key) return 1;
+	}
+	return 0;
+}
+
+/*
+ * groupPositions() - find the vertices at the same position, up to a
+ * grid of POSITION_GRID steps across the mesh. group[v] is the first
+ * vertex at the position of v, and next[v] the next one, around in a
+ * ring. Returns 0, or -1 if out of memory.
+ */
+static int groupPositions(unsigned int *group, unsigned int *next, const float *vertices,
+	int stride, int nverts) {
+	unsigned int *table, *keys, *key, mask, slot, h;
+	float lo[3], hi[3], scale = 0.0f;
+	size_t capacity = 16;
+	int v, k;
+
+	while(capacity < 2 * (size_t)nverts) capacity *= 2;
+	table = (unsigned int*)calloc(capacity, sizeof(unsigned int));
+	keys = (unsigned int*)malloc(3 * (size_t)nverts * sizeof(unsigned int));
+	if(table == NULL || keys == NULL) {
+		free(table);
+		free(keys);
+		return -1;
+	}
+	mask = (unsigned int)capacity - 1;
+
+	for(k = 0; k < 3; k++) lo[k] = hi[k] = vertices[k];
+	for(v = 1; v < nverts; v++) {
+		for(k = 0; k < 3; k++) {
+			if(vertices[(size_t)stride * v + k] < lo[k]) lo[k] = vertices[(size_t)stride * v + k];
+			if(vertices[(size_t)stride * v + k] > hi[k]) hi[k] = vertices[(size_t)stride * v + k];
+		}
+	}
+	// The largest extent sets the grid
+	for(k = 0; k < 3; k++) {
+		if(hi[k] - lo[k] > 0.0f && (scale == 0.0f || POSITION_GRID / (hi[k] - lo[k]) < scale)) {
+			scale = POSITION_GRID / (hi[k] - lo[k]);
+		}
+	}
+
+	for(v = 0; v < nverts; v++) {
+		key = keys + 3 * v;
+		for(k = 0; k < 3; k++) key[k] = (unsigned int)((vertices[(size_t)stride * v + k] - lo[k]) * scale + 0.5f);
+		h = key[0] * 0x9E3779B1u;
+		h = (h ^ key[1]) * 0x85EBCA77u;
+		h = (h ^ key[2]) * 0xC2B2AE3Du;
+		for(slot = (h ^ (h >> 16)) & mask; table[slot]; slot = (slot + 1) & mask) {
+			if(memcmp(keys + 3 * (table[slot] - 1), key, 3 * sizeof(unsigned int)) == 0) break;
+		}
+		if(table[slot] == 0) {
+			table[slot] = v + 1;
+			group[v] = next[v] = v;
+		}
+		else {
+			group[v] = table[slot] - 1;
+			next[v] = next[group[v]];
+			next[group[v]] = v;
+		}
+	}
+	free(table);
+	free(keys);
+	return 0;
+}
+
+/* Whether the open edges from v go around a hole of at most three edges */
+static int smallHole(const vertexInfo *info, unsigned int v) {
+	unsigned int u = info[v].outto;
+
+	if(info[u].nout != 1) return 0;
+	if(info[u].outto == v) return 1;
+	u = info[u].outto;
+	return info[u].nout == 1 && info[u].outto == v;
+}
+
+/* What kind of vertex v is, from its open edges and those at its position */
+static int vertexKind(const vertexInfo *info, const unsigned int *next, unsigned int v) {
+	unsigned int s = next[v];
+
+	if(s == v) { // Alone at its position
+		if(info[v].nout == 0 && info[v].nin == 0) return KIND_MANIFOLD;
+		if(info[v].nout == 1 && info[v].nin == 1 && info[v].seams == 0 && !smallHole(info, v)) return KIND_BORDER;
+		return KIND_LOCKED;
+	}
+	if(next[s] != v) return KIND_LOCKED; // More than two
+	if(info[v].nout == 1 && info[v].nin == 1 && info[v].seams == 3
+		&& info[s].nout == 1 && info[s].nin == 1 && info[s].seams == 3) return KIND_SEAM;
+	return KIND_LOCKED;
+}
+
+/* Whether vertex v may be moved onto its neighbour t */
+static int collapseAllowed(const vertexInfo *info, const unsigned int *group,
+	const unsigned int *next, unsigned int v, unsigned int t) {
+	unsigned int s = next[v];
+
+	if(group[v] == group[t]) return 0;
+	switch(info[v].kind) {
+	case KIND_MANIFOLD:
+		return 1;
+	case KIND_BORDER: // Only along the border
+		return t == info[v].outto || t == info[v].infrom;
+	case KIND_SEAM: // Only along the seam, where the other side goes the same way
+		if(t == info[v].outto) return group[info[s].infrom] == group[t];
+		if(t == info[v].infrom) return group[info[s].outto] == group[t];
+		return 0;
+	}
+	return 0;
+}
+
+/* For moving vertex v onto t: the number of triangles around v that go
+   away, or -1 if one of the others would turn too far */
+static int checkCollapse(const unsigned int *indices, const int *first, const int *tris,
+	const unsigned int *group, const float *vertices, int stride, unsigned int v, unsigned int t) {
+	const unsigned int *tri;
+	const float *p[3];
+	float e1[3], e2[3], n0[3], n1[3], d, l0, l1;
+	int i, j, k, gone = 0;
+
+	for(i = first[v]; i < first[v + 1]; i++) {
+		tri = indices + 3 * tris[i];
+		for(j = 0; j < 3; j++) if(group[tri[j]] == group[t]) break;
+		if(j < 3) {
+			gone++;
+			continue;
+		}
+		for(j = 0; j < 3; j++) p[j] = vertices + (size_t)stride * tri[j];
+		for(k = 0; k < 3; k++) {
+			e1[k] = p[1][k] - p[0][k];
+			e2[k] = p[2][k] - p[0][k];
+		}
+		n0[0] = e1[1] * e2[2] - e1[2] * e2[1];
+		n0[1] = e1[2] * e2[0] - e1[0] * e2[2];
+		n0[2] = e1[0] * e2[1] - e1[1] * e2[0];
+		for(j = 0; j < 3; j++) if(tri[j] == v) p[j] = vertices + (size_t)stride * t;
+		for(k = 0; k < 3; k++) {
+			e1[k] = p[1][k] - p[0][k];
+			e2[k] = p[2][k] - p[0][k];
+		}
+		n1[0] = e1[1] * e2[2] - e1[2] * e2[1];
+		n1[1] = e1[2] * e2[0] - e1[0] * e2[2];
+		n1[2] = e1[0] * e2[1] - e1[1] * e2[0];
+		l0 = n0[0] * n0[0] + n0[1] * n0[1] + n0[2] * n0[2];
+		l1 = n1[0] * n1[0] + n1[1] * n1[1] + n1[2] * n1[2];
+		if(l0 == 0.0f) continue; // Degenerate already
+		d = n0[0] * n1[0] + n0[1] * n1[1] + n0[2] * n1[2];
+		if(l1 == 0.0f || d <= TURN_LIMIT * sqrtf(l0 * l1)) return -1;
+	}
+	return gone;
+}
+
+float meshTriangleDistance2(const float *p, const float *a, const float *b, const float *c, int *inside) {
+	// In double, since in float the regions of a sliver triangle can come
+	// out wrong, and put the nearest point well off the triangle
+	double ab[3], ac[3], ap[3], bp[3], cp[3], q[3], d1, d2, d3, d4, d5, d6, va, vb, vc, v, w;
+	int k;
+
+	for(k = 0; k < 3; k++) {
+		ab[k] = (double)b[k] - a[k];
+		ac[k] = (double)c[k] - a[k];
+		ap[k] = (double)p[k] - a[k];
+		bp[k] = (double)p[k] - b[k];
+		cp[k] = (double)p[k] - c[k];
+	}
+	d1 = ab[0] * ap[0] + ab[1] * ap[1] + ab[2] * ap[2];
+	d2 = ac[0] * ap[0] + ac[1] * ap[1] + ac[2] * ap[2];
+	d3 = ab[0] * bp[0] + ab[1] * bp[1] + ab[2] * bp[2];
+	d4 = ac[0] * bp[0] + ac[1] * bp[1] + ac[2] * bp[2];
+	d5 = ab[0] * cp[0] + ab[1] * cp[1] + ab[2] * cp[2];
+	d6 = ac[0] * cp[0] + ac[1] * cp[1] + ac[2] * cp[2];
+	vc = d1 * d4 - d3 * d2;
+	vb = d5 * d2 - d1 * d6;
+	va = d3 * d6 - d5 * d4;
+	if(inside) *inside = 0;
+	if(d1 <= 0.0 && d2 <= 0.0) { // Nearest to a corner
+		for(k = 0; k < 3; k++) q[k] = a[k];
+	}
+	else if(d3 >= 0.0 && d4 <= d3) {
+		for(k = 0; k < 3; k++) q[k] = b[k];
+	}
+	else if(d6 >= 0.0 && d5 <= d6) {
+		for(k = 0; k < 3; k++) q[k] = c[k];
+	}
+	else if(vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0) { // Nearest to an edge
+		v = d1 / (d1 - d3);
+		for(k = 0; k < 3; k++) q[k] = a[k] + v * ab[k];
+	}
+	else if(vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0) {
+		w = d2 / (d2 - d6);
+		for(k = 0; k < 3; k++) q[k] = a[k] + w * ac[k];
+	}
+	else if(va <= 0.0 && d4 - d3 >= 0.0 && d5 - d6 >= 0.0) {
+		w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+		for(k = 0; k < 3; k++) q[k] = b[k] + w * ((double)c[k] - b[k]);
+	}
+	else if(va + vb + vc > 0.0) { // Inside
+		if(inside) *inside = 1;
+		v = vb / (va + vb + vc);
+		w = vc / (va + vb + vc);
+		for(k = 0; k < 3; k++) q[k] = a[k] + v * ab[k] + w * ac[k];
+	}
+	else { // Flat, and between the corners
+		for(k = 0; k < 3; k++) q[k] = a[k];
+	}
+	for(k = 0; k < 3; k++) q[k] -= p[k];
+	return (float)(q[0] * q[0] + q[1] * q[1] + q[2] * q[2]);
+}
+
+static int compareCollapses(const void *a, const void *b) {
+	float ca = ((const collapse*)a)->cost, cb = ((const collapse*)b)->cost;
+	return (ca > cb) - (ca < cb);
+}
+
+/*
+ * simplify() - meshSimplify(), and if parent is not NULL, set parent[v]
+ * to the vertex that each vertex v is moved onto
+ */
+static int simplify(unsigned int *destination, const unsigned int *indices, int ntris,
+	const float *vertices, int stride, int nverts, int targettris, float maxerror, float *error,
+	unsigned int *parent) {
+	unsigned int *group, *next, *remap, *idx = destination, a, b, v, t, s, ts, tri[3];
+	unsigned char *locked;
+	int *first, *tris, i, j, k, n, goal, removed, done, gone, moved, ncand, pass;
+	vertexInfo *info;
+	quadric *quadrics, *borders;
+	collapse *cand;
+	edgeSet edges, pedges;
+	const float *p[3];
+	double normal[3], edge[3], cross[3], len, w;
+	float maxcost = 0.0f, limit;
+
+	if(error) *error = 0.0f;
+	if(destination != indices) memcpy(destination, indices, 3 * (size_t)ntris * sizeof(unsigned int));
+	if(ntris <= targettris || nverts <= 0) return ntris;
+	limit = (maxerror < sqrtf(FLT_MAX)) ? maxerror * maxerror : FLT_MAX;
+
+	group = (unsigned int*)malloc(nverts * sizeof(unsigned int));
+	next = (unsigned int*)malloc(nverts * sizeof(unsigned int));
+	remap = (unsigned int*)malloc(nverts * sizeof(unsigned int));
+	locked = (unsigned char*)malloc(nverts);
+	first = (int*)malloc((nverts + 1) * sizeof(int));
+	tris = (int*)malloc(3 * (size_t)ntris * sizeof(int));
+	info = (vertexInfo*)malloc(nverts * sizeof(vertexInfo));
+	quadrics = (quadric*)calloc(nverts, sizeof(quadric));
+	borders = (quadric*)calloc(nverts, sizeof(quadric));
+	cand = (collapse*)malloc(3 * (size_t)ntris * sizeof(collapse));
+	edges.keys = pedges.keys = NULL;
+	if(group == NULL || next == NULL || remap == NULL || locked == NULL || first == NULL
+		|| tris == NULL || info == NULL || quadrics == NULL || borders == NULL || cand == NULL
+		|| edgeSetInit(&edges, 3 * ntris) || edgeSetInit(&pedges, 3 * ntris)
+		|| groupPositions(group, next, vertices, stride, nverts)) {
+		ntris = -1;
+		goto done;
+	}
+
+	// The planes of the triangles, weighted by area
+	for(i = 0; i < ntris; i++) {
+		for(j = 0; j < 3; j++) p[j] = vertices + (size_t)stride * idx[3 * i + j];
+		for(k = 0; k < 3; k++) {
+			edge[k] = p[1][k] - p[0][k];
+			normal[k] = p[2][k] - p[0][k];
+		}
+		cross[0] = edge[1] * normal[2] - edge[2] * normal[1];
+		cross[1] = edge[2] * normal[0] - edge[0] * normal[2];
+		cross[2] = edge[0] * normal[1] - edge[1] * normal[0];
+		len = sqrt(cross[0] * cross[0] + cross[1] * cross[1] + cross[2] * cross[2]);
+		for(j = 0; j < 3; j++) quadricAddPoint(&quadrics[group[idx[3 * i + j]]], cross, p[0], 0.5 * len);
+	}
+
+	for(pass = 0; ntris > targettris; pass++) {
+		// Find the open edges, and the kinds of vertices
+		edgeSetClear(&edges);
+		edgeSetClear(&pedges);
+		for(i = 0; i < 3 * ntris; i++) {
+			a = idx[i];
+			b = idx[i - i % 3 + (i + 1) % 3];
+			edgeSetAdd(&edges, a, b);
+			edgeSetAdd(&pedges, group[a], group[b]);
+		}
+		memset(info, 0, nverts * sizeof(vertexInfo));
+		for(i = 0; i < 3 * ntris; i++) {
+			a = idx[i];
+			b = idx[i - i % 3 + (i + 1) % 3];
+			if(edgeSetHas(&edges, b, a)) continue;
+			j = edgeSetHas(&pedges, group[b], group[a]);
+			if(info[a].nout < 2) info[a].nout++;
+			if(info[b].nin < 2) info[b].nin++;
+			info[a].outto = b;
+			info[b].infrom = a;
+			if(j) {
+				info[a].seams |= 1;
+				info[b].seams |= 2;
+			}
+			if(pass == 0) {
+				// A plane through the edge, perpendicular to the triangle
+				p[0] = vertices + (size_t)stride * idx[i - i % 3];
+				p[1] = vertices + (size_t)stride * idx[i - i % 3 + 1];
+				p[2] = vertices + (size_t)stride * idx[i - i % 3 + 2];
+				for(k = 0; k < 3; k++) {
+					edge[k] = p[1][k] - p[0][k];
+					normal[k] = p[2][k] - p[0][k];
+				}
+				cross[0] = edge[1] * normal[2] - edge[2] * normal[1];
+				cross[1] = edge[2] * normal[0] - edge[0] * normal[2];
+				cross[2] = edge[0] * normal[1] - edge[1] * normal[0];
+				for(k = 0; k < 3; k++) edge[k] = vertices[(size_t)stride * b + k] - vertices[(size_t)stride * a + k];
+				normal[0] = edge[1] * cross[2] - edge[2] * cross[1];
+				normal[1] = edge[2] * cross[0] - edge[0] * cross[2];
+				normal[2] = edge[0] * cross[1] - edge[1] * cross[0];
+				len = edge[0] * edge[0] + edge[1] * edge[1] + edge[2] * edge[2];
+				if(j) { // Seams count with the surface, weighted like it by area
+					quadricAddPoint(&quadrics[group[a]], normal, vertices + (size_t)stride * a, len * SEAM_WEIGHT);
+					quadricAddPoint(&quadrics[group[b]], normal, vertices + (size_t)stride * a, len * SEAM_WEIGHT);
+				}
+				else { // Borders by themselves, weighted by length
+					quadricAddPoint(&borders[group[a]], normal, vertices + (size_t)stride * a, sqrt(len));
+					quadricAddPoint(&borders[group[b]], normal, vertices + (size_t)stride * a, sqrt(len));
+				}
+			}
+		}
+		for(v = 0; v < (unsigned int)nverts; v++) info[v].kind = (unsigned char)vertexKind(info, next, v);
+		meshBuildAdjacency(first, tris, idx, ntris, nverts);
+
+		// The cheaper way to collapse each edge, if any is allowed
+		ncand = 0;
+		for(i = 0; i < 3 * ntris; i++) {
+			a = idx[i];
+			b = idx[i - i % 3 + (i + 1) % 3];
+			if(a > b && edgeSetHas(&edges, b, a)) continue; // Done from the twin
+			cand[ncand].cost = FLT_MAX;
+			for(j = 0; j < 2; j++) {
+				v = j ? b : a;
+				t = j ? a : b;
+				if(!collapseAllowed(info, group, next, v, t)) continue;
+				w = quadricError(&quadrics[group[v]], vertices + (size_t)stride * t)
+					+ MESH_BORDER_WEIGHT * quadricError(&borders[group[v]], vertices + (size_t)stride * t);
+				if(w >= cand[ncand].cost) continue;
+				cand[ncand].cost = (float)w;
+				cand[ncand].from = v;
+				cand[ncand].to = t;
+			}
+			if(cand[ncand].cost < FLT_MAX) ncand++;
+		}
+		qsort(cand, ncand, sizeof(collapse), compareCollapses);
+
+		memset(locked, 0, nverts);
+		for(v = 0; v < (unsigned int)nverts; v++) remap[v] = v;
+		goal = ntris - targettris;
+		removed = done = 0;
+		for(i = 0; i < ncand && removed < goal && cand[i].cost <= limit; i++) {
+			v = cand[i].from;
+			t = cand[i].to;
+			if(locked[group[v]] || locked[group[t]]) continue;
+			gone = checkCollapse(idx, first, tris, group, vertices, stride, v, t);
+			if(gone < 0) continue;
+			s = ts = v;
+			if(info[v].kind == KIND_SEAM) { // And the vertex on the other side
+				s = next[v];
+				ts = (t == info[v].outto) ? info[s].infrom : info[s].outto;
+				moved = checkCollapse(idx, first, tris, group, vertices, stride, s, ts);
+				if(moved < 0) continue;
+				gone += moved;
+			}
+			remap[s] = ts;
+			remap[v] = t;
+			if(parent) {
+				parent[s] = ts;
+				parent[v] = t;
+			}
+			quadricAdd(&quadrics[group[t]], &quadrics[group[v]]);
+			quadricAdd(&borders[group[t]], &borders[group[v]]);
+			if(cand[i].cost > maxcost) maxcost = cand[i].cost;
+			// No more collapses around here in this pass
+			for(j = first[v]; j < first[v + 1]; j++) {
+				for(k = 0; k < 3; k++) locked[group[idx[3 * tris[j] + k]]] = 1;
+			}
+			for(j = first[s]; j < first[s + 1]; j++) {
+				for(k = 0; k < 3; k++) locked[group[idx[3 * tris[j] + k]]] = 1;
+			}
+			removed += gone;
+			done++;
+		}
+		if(done == 0) break;
+
+		// Move the vertices, and drop the triangles that are gone
+		n = 0;
+		for(i = 0; i < ntris; i++) {
+			for(k = 0; k < 3; k++) tri[k] = remap[idx[3 * i + k]];
+			if(group[tri[0]] == group[tri[1]] || group[tri[1]] == group[tri[2]]
+				|| group[tri[2]] == group[tri[0]]) continue;
+			for(k = 0; k < 3; k++) idx[3 * n + k] = tri[k];
+			n++;
+		}
+		ntris = n;
+	}
+	if(error) *error = sqrtf(maxcost);
+
+done:
+	free(group); free(next); free(remap); free(locked); free(first); free(tris);
+	free(info); free(quadrics); free(borders); free(cand); free(edges.keys); free(pedges.keys);
+	return ntris;
+}
+
+int meshSimplify(unsigned int *destination, const unsigned int *indices, int ntris,
+	const float *vertices, int stride, int nverts, int targettris, float maxerror, float *error) {
+	return simplify(destination, indices, ntris, vertices, stride, nverts, targettris, maxerror, error, NULL);
+}
+
+/* The vertex that v was moved onto in the end, by parent from simplify() */
+static unsigned int movedTo(unsigned int *parent, unsigned int v) {
+	unsigned int r = v, n;
+
+	while(parent[r] != r) r = parent[r];
+	while(v != r) { // Shorten the way for next time
+		n = parent[v];
+		parent[v] = r;
+		v = n;
+	}
+	return r;
+}
+
+/* Squared distance from p to the triangles around vertex v of a level, the
+   nearest of them in *nearest and *inside if it is nearer than *best */
+static void fanDistance2(const float *p, unsigned int v, const unsigned int *lod, const int *first,
+	const int *tris, const float *vertices, int stride, float *best, int *nearest, int *inside) {
+	const unsigned int *tri;
+	float d;
+	int i, in;
+
+	for(i = first[v]; i < first[v + 1]; i++) {
+		tri = lod + 3 * tris[i];
+		d = meshTriangleDistance2(p, vertices + (size_t)stride * tri[0], vertices + (size_t)stride * tri[1],
+			vertices + (size_t)stride * tri[2], &in);
+		if(d < *best) {
+			*best = d;
+			*nearest = tris[i];
+			*inside = in;
+		}
+	}
+}
+
+/* Squared distance from p to the triangles of a level near the vertices
+   r[0] to r[n - 1]: around them, and then on around the nearest triangle
+   while that gets nearer, until the nearest point is inside a triangle.
+   Or to r[0], if they have no triangles. */
+static float levelDistance2(const float *p, const unsigned int *r, int n, const unsigned int *lod,
+	const int *first, const int *tris, const float *vertices, int stride) {
+	float best = FLT_MAX;
+	int j, k, step, nearest = -1, from, inside = 0;
+
+	for(j = 0; j < n && !inside; j++) fanDistance2(p, r[j], lod, first, tris, vertices, stride, &best, &nearest, &inside);
+	for(step = 0; !inside && nearest >= 0 && step < LEVEL_WALK_STEPS; step++) {
+		from = nearest;
+		for(j = 0; j < 3; j++) {
+			fanDistance2(p, lod[3 * from + j], lod, first, tris, vertices, stride, &best, &nearest, &inside);
+		}
+		if(nearest == from) break; // No nearer one around it
+	}
+	if(nearest >= 0) return best;
+	for(best = 0.0f, k = 0; k < 3; k++) {
+		best += (p[k] - vertices[(size_t)stride * r[0] + k]) * (p[k] - vertices[(size_t)stride * r[0] + k]);
+	}
+	return best;
+}
+
+/*
+ * levelError() - the largest distance from the vertices and the middles
+ * of the triangles of the full mesh to the triangles of a level, around
+ * the vertices that they were moved onto. Returns -1 if out of memory.
+ */
+static float levelError(const unsigned int *indices, int ntris, const unsigned int *lod, int nlod,
+	const float *vertices, int stride, int nverts, unsigned int *parent) {
+	int *first = (int*)malloc((nverts + 1) * sizeof(int)), *tris = (int*)malloc(3 * (size_t)nlod * sizeof(int));
+	unsigned char *seen = (unsigned char*)calloc(nverts, 1);
+	unsigned int r[3];
+	const float *p[3];
+	float middle[3], d, largest = 0.0f;
+	int i, j, k;
+
+	if(first == NULL || tris == NULL || seen == NULL) {
+		free(first);
+		free(tris);
+		free(seen);
+		return -1.0f;
+	}
+	meshBuildAdjacency(first, tris, lod, nlod, nverts);
+	for(i = 0; i < ntris; i++) {
+		for(j = 0; j < 3; j++) {
+			p[j] = vertices + (size_t)stride * indices[3 * i + j];
+			r[j] = movedTo(parent, indices[3 * i + j]);
+			if(seen[indices[3 * i + j]]) continue;
+			seen[indices[3 * i + j]] = 1;
+			d = levelDistance2(p[j], &r[j], 1, lod, first, tris, vertices, stride);
+			if(d > largest) largest = d;
+		}
+		for(k = 0; k < 3; k++) middle[k] = (p[0][k] + p[1][k] + p[2][k]) / 3.0f;
+		d = levelDistance2(middle, r, 3, lod, first, tris, vertices, stride);
+		if(d > largest) largest = d;
+	}
+	free(first);
+	free(tris);
+	free(seen);
+	return sqrtf(largest);
+}
+
+int meshLodBuild(meshLodChain *chain, const float *vertices, int stride,
+	const unsigned int *indices, int ntris, int nverts, const float *ratios, int nratios) {
+	unsigned int *lod, *grown, *parent;
+	meshLod *last;
+	float lo[3], hi[3], d, ratio = 1.0f, error;
+	int capacity, target, n, i, k, r;
+
+	memset(chain, 0, sizeof(meshLodChain));
+	if(ntris <= 0) return 0;
+
+	// Bounding sphere, around the middle of the box
+	for(k = 0; k < 3; k++) lo[k] = hi[k] = vertices[(size_t)stride * indices[0] + k];
+	for(i = 1; i < 3 * ntris; i++) {
+		for(k = 0; k < 3; k++) {
+			if(vertices[(size_t)stride * indices[i] + k] < lo[k]) lo[k] = vertices[(size_t)stride * indices[i] + k];
+			if(vertices[(size_t)stride * indices[i] + k] > hi[k]) hi[k] = vertices[(size_t)stride * indices[i] + k];
+		}
+	}
+	for(k = 0; k < 3; k++) chain->center[k] = 0.5f * (lo[k] + hi[k]);
+	for(i = 0; i < 3 * ntris; i++) {
+		for(d = 0.0f, k = 0; k < 3; k++) {
+			d += (vertices[(size_t)stride * indices[i] + k] - chain->center[k])
+				* (vertices[(size_t)stride * indices[i] + k] - chain->center[k]);
+		}
+		if(d > chain->radius) chain->radius = d;
+	}
+	chain->radius = sqrtf(chain->radius);
+
+	// The full mesh, with room for halving it all the way down
+	capacity = 6 * ntris;
+	chain->indices = (unsigned int*)malloc(capacity * sizeof(unsigned int));
+	lod = (unsigned int*)malloc(3 * (size_t)ntris * sizeof(unsigned int));
+	parent = (unsigned int*)malloc(nverts * sizeof(unsigned int));
+	if(chain->indices == NULL || lod == NULL || parent == NULL) {
+		free(lod);
+		free(parent);
+		meshLodFree(chain);
+		return -1;
+	}
+	for(i = 0; i < nverts; i++) parent[i] = i;
+	memcpy(chain->indices, indices, 3 * (size_t)ntris * sizeof(unsigned int));
+	chain->lods[0].first = 0;
+	chain->lods[0].count = 3 * ntris;
+	chain->lods[0].error = 0.0f;
+	chain->nlods = 1;
+	chain->nindices = 3 * ntris;
+
+	for(r = 0; chain->nlods < MESH_MAX_LODS; r++) {
+		last = &chain->lods[chain->nlods - 1];
+		if(ratios != NULL) {
+			if(r >= nratios) break;
+			target = (int)(ratios[r] * ntris);
+			if(3 * target >= (int)last->count) continue;
+		}
+		else {
+			ratio *= MESH_LOD_RATIO;
+			target = (int)(ratio * ntris);
+			if(target < MESH_LOD_MIN_TRIS) break;
+		}
+		n = simplify(lod, chain->indices + last->first, last->count / 3, vertices, stride, nverts,
+			target, FLT_MAX, NULL, parent);
+		if(n < 0 || (n > 0 && meshOptimizeVertexCache(lod, n, nverts, MESH_CACHE_SIZE, NULL, NULL))) {
+			free(lod);
+			free(parent);
+			meshLodFree(chain);
+			return -1;
+		}
+		if(10 * 3 * n > 9 * (int)last->count) break; // Stuck
+		// How far it is from the full mesh, and never less than the level before
+		if((error = levelError(chain->indices, ntris, lod, n, vertices, stride, nverts, parent)) < 0.0f) {
+			free(lod);
+			free(parent);
+			meshLodFree(chain);
+			return -1;
+		}
+		if(error < last->error) error = last->error;
+		if(chain->nindices + 3 * n > capacity) {
+			capacity = 2 * capacity;
+			grown = (unsigned int*)realloc(chain->indices, capacity * sizeof(unsigned int));
+			if(grown == NULL) {
+				free(lod);
+				free(parent);
+				meshLodFree(chain);
+				return -1;
+			}
+			chain->indices = grown;
+			last = &chain->lods[chain->nlods - 1];
+		}
+		memcpy(chain->indices + chain->nindices, lod, 3 * (size_t)n * sizeof(unsigned int));
+		chain->lods[chain->nlods].first = chain->nindices;
+		chain->lods[chain->nlods].count = 3 * n;
+		chain->lods[chain->nlods].error = error;
+		chain->nindices += 3 * n;
+		chain->nlods++;
+	}
+	free(lod);
+	free(parent);
+	return 0;
+}
+
+void meshLodFree(meshLodChain *chain) {
+	free(chain->indices);
+	memset(chain, 0, sizeof(meshLodChain));
+}
+
+int meshLodSelect(const meshLodChain *chain, float distance, float pixelscale, float maxpixels) {
+	int i;
+
+	if(distance <= 0.0f) return 0;
+	for(i = chain->nlods - 1; i > 0; i--) {
+		if(chain->lods[i].error * pixelscale <= maxpixels * distance) return i;
+	}
+	return 0;
+}
@@ -0,0 +1,105 @@
+/*
+ * meshSimplify.h - simplification of indexed triangle meshes with
+ * quadric error metrics, and chains of levels of detail (LODs) made with
+ * it, for drawing distant objects with fewer triangles. Without OpenGL
+ * dependencies.
+ *
+ * The meshes are as in triangleSoup: an index array of 3 * ntris vertex
+ * numbers, and a vertex array of nverts vertices of stride floats each,
+ * with the position in the first three.
+ *
+ * The simplification collapses edges by moving one vertex onto the
+ * other, as in Garland and Heckbert: "Surface Simplification Using
+ * Quadric Error Metrics" (SIGGRAPH 1997), cheapest first. No vertices
+ * are made or changed, so all levels of detail index the same vertex
+ * array. Vertices at the same position with different normals or
+ * texture coordinates make a seam, and a seam is only collapsed along
+ * itself, on both sides at once, so that it stays closed and the
+ * attributes on each side stay right. Corners where more than two
+ * vertices meet are kept as they are. Open borders are only collapsed
+ * along themselves, and how far they are pulled in counts in full, and
+ * extra, so the outline of the mesh stays. Holes of three edges are not
+ * closed. Collapses that would turn a triangle over are not done.
+ *
+ * The error of a level is how far the vertices and the middles of the
+ * triangles of the full mesh are from its surface, at most, in the units
+ * of the vertex coordinates. It is measured, not estimated, and never
+ * less than the error of the level before. Projected to the screen, it
+ * gives meshLodSelect() the level to draw, see there.
+ *
+ * This code is in the public domain.
+ */
+
+#ifndef MESHSIMPLIFY_H
+#define MESHSIMPLIFY_H
+
+// Most levels of detail in a chain, the number of triangles of each level
+// relative to the one before it, and the fewest triangles worth a level
+#define MESH_MAX_LODS 8
+#define MESH_LOD_RATIO 0.5f
+#define MESH_LOD_MIN_TRIS 64
+// Weight of the distance that open borders are pulled in, in the cost
+// of a collapse, relative to the distance from the surface
+#define MESH_BORDER_WEIGHT 10.0f
+
+/* One level of detail, a range in meshLodChain.indices */
+typedef struct {
+	unsigned int first; // First index
+	unsigned int count; // Number of indices, 3 per triangle
+	float error;        // Largest distance from the full mesh, see above
+} meshLod;
+
+typedef struct {
+	unsigned int *indices;  // The triangles of all levels, the full mesh first
+	int nindices;
+	meshLod lods[MESH_MAX_LODS];
+	int nlods;
+	float center[3], radius; // Bounding sphere, for meshLodSelect()
+} meshLodChain;
+
+/*
+ * meshSimplify() - collapse edges of a mesh until it has at most
+ * targettris triangles, or until the next collapse would make the error
+ * larger than maxerror. The triangles go to destination, which has room
+ * for 3 * ntris indices and may be the same as indices. The error that
+ * the quadrics estimate, the root of the largest cost of a collapse, is
+ * stored in *error if error is not NULL. Returns the number of
+ * triangles, or -1 if out of memory.
+ */
+int meshSimplify(unsigned int *destination, const unsigned int *indices, int ntris,
+	const float *vertices, int stride, int nverts, int targettris, float maxerror, float *error);
+
+/*
+ * meshLodBuild() - make a chain of levels of detail, each simplified
+ * from the one before it to ratios[i] times the triangles of the full
+ * mesh, for i = 0 to nratios - 1. With ratios NULL, each level has
+ * MESH_LOD_RATIO times the triangles of the one before it, down to
+ * MESH_LOD_MIN_TRIS. The chain stops early where the simplification
+ * gets stuck. The levels after the full mesh are reordered for the
+ * vertex cache (meshOptimize.c). Returns 0, or -1 if out of memory.
+ */
+int meshLodBuild(meshLodChain *chain, const float *vertices, int stride,
+	const unsigned int *indices, int ntris, int nverts, const float *ratios, int nratios);
+
+/*
+ * meshTriangleDistance2() - the squared distance from p to the triangle
+ * a, b, c, as in Ericson: "Real-Time Collision Detection" (2005), 5.1.5,
+ * but in double so that sliver triangles come out right too. If inside
+ * is not NULL, it is set to 1 if the nearest point is inside the
+ * triangle, not on its edges, and 0 if not.
+ */
+float meshTriangleDistance2(const float *p, const float *a, const float *b, const float *c, int *inside);
+
+/* meshLodFree() - free the indices of chain and set it to all zeros */
+void meshLodFree(meshLodChain *chain);
+
+/*
+ * meshLodSelect() - the coarsest level whose error covers at most
+ * maxpixels pixels on the screen, seen from distance. For a perspective
+ * projection matrix P (column major) and a viewport height pixels high,
+ * pixelscale is P[5] * height / 2. The distance is to the nearest point
+ * of the bounding sphere. Returns a level number.
+ */
+int meshLodSelect(const meshLodChain *chain, float distance, float pixelscale, float maxpixels);
+
+#endif /* MESHSIMPLIFY_H */
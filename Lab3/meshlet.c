@@ -0,0 +1,261 @@
+/*
+ * meshlet.c - meshlets with culling bounds. See meshlet.h.
+ *
+ * The normal cones and the test against them are as in Arseny
+ * Kapoulkine's meshoptimizer library (meshopt_computeMeshletBounds).
+ *
+ * This code is in the public domain.
+ */
+
+#include <stdlib.h> // For malloc(), calloc(), realloc() and free()
+#include <string.h> // For memset() and memcpy()
+#include <math.h>   // For sqrt()
+
+#include "meshlet.h"
+#include "meshOptimize.h" // For meshBuildAdjacency()
+
+// Narrowest cone, as the cosine of the half angle between the axis and
+// the normal farthest from it, that is still worth culling with
+#define MESHLET_CONE_MIN 0.1f
+
+/* The unit normal of each triangle, or zero for degenerate ones */
+static void triangleNormals(float *normals, const float *vertices, int stride,
+	const unsigned int *indices, int ntris) {
+	const float *p0, *p1, *p2;
+	float e1[3], e2[3], n[3], len;
+	int t, k;
+
+	for(t = 0; t < ntris; t++) {
+		p0 = vertices + (size_t)stride * indices[3 * t];
+		p1 = vertices + (size_t)stride * indices[3 * t + 1];
+		p2 = vertices + (size_t)stride * indices[3 * t + 2];
+		for(k = 0; k < 3; k++) {
+			e1[k] = p1[k] - p0[k];
+			e2[k] = p2[k] - p0[k];
+		}
+		n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+		n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+		n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+		len = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+		for(k = 0; k < 3; k++) normals[3 * t + k] = (len > 0.0f) ? n[k] / len : 0.0f;
+	}
+}
+
+/* The box, sphere and normal cone of a finished meshlet */
+static void meshletBounds(meshlet *m, const meshletSet *set, const float *vertices, int stride,
+	const unsigned int *indices, const float *normals, const int *tris) {
+	const float *p;
+	float axis[3] = {0.0f, 0.0f, 0.0f}, d, r2 = 0.0f, len, mindot = 1.0f, maxt = 0.0f, dn, dc;
+	int i, k, t;
+
+	p = vertices + (size_t)stride * set->vertices[m->vertexoffset];
+	for(k = 0; k < 3; k++) m->lo[k] = m->hi[k] = p[k];
+	for(i = 1; i < m->nverts; i++) {
+		p = vertices + (size_t)stride * set->vertices[m->vertexoffset + i];
+		for(k = 0; k < 3; k++) {
+			if(p[k] < m->lo[k]) m->lo[k] = p[k];
+			if(p[k] > m->hi[k]) m->hi[k] = p[k];
+		}
+	}
+	for(k = 0; k < 3; k++) m->center[k] = 0.5f * (m->lo[k] + m->hi[k]);
+	for(i = 0; i < m->nverts; i++) {
+		p = vertices + (size_t)stride * set->vertices[m->vertexoffset + i];
+		d = (p[0] - m->center[0]) * (p[0] - m->center[0]) + (p[1] - m->center[1]) * (p[1] - m->center[1])
+			+ (p[2] - m->center[2]) * (p[2] - m->center[2]);
+		if(d > r2) r2 = d;
+	}
+	m->radius = sqrtf(r2);
+
+	// The cone axis is the mean normal, and the cone must hold all normals
+	for(i = 0; i < m->ntris; i++) {
+		for(k = 0; k < 3; k++) axis[k] += normals[3 * tris[i] + k];
+	}
+	len = sqrtf(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+	for(k = 0; k < 3; k++) {
+		axis[k] = (len > 0.0f) ? axis[k] / len : 0.0f;
+		m->coneaxis[k] = axis[k];
+		m->coneapex[k] = m->center[k];
+	}
+	m->conecutoff = 1.0f;
+	for(i = 0; i < m->ntris; i++) {
+		t = tris[i];
+		if(normals[3 * t] == 0.0f && normals[3 * t + 1] == 0.0f && normals[3 * t + 2] == 0.0f) continue;
+		d = normals[3 * t] * axis[0] + normals[3 * t + 1] * axis[1] + normals[3 * t + 2] * axis[2];
+		if(d < mindot) mindot = d;
+	}
+	if(len == 0.0f || mindot <= MESHLET_CONE_MIN) return; // Too wide to cull with
+
+	// Move the apex back along the axis until it is behind every triangle
+	// plane, so that all of them face away from any eye in the cone
+	for(i = 0; i < m->ntris; i++) {
+		t = tris[i];
+		dn = normals[3 * t] * axis[0] + normals[3 * t + 1] * axis[1] + normals[3 * t + 2] * axis[2];
+		if(dn <= 0.0f) continue; // Degenerate
+		p = vertices + (size_t)stride * indices[3 * t];
+		dc = (m->center[0] - p[0]) * normals[3 * t] + (m->center[1] - p[1]) * normals[3 * t + 1]
+			+ (m->center[2] - p[2]) * normals[3 * t + 2];
+		if(dc / dn > maxt) maxt = dc / dn;
+	}
+	for(k = 0; k < 3; k++) m->coneapex[k] = m->center[k] - axis[k] * maxt;
+	m->conecutoff = sqrtf(1.0f - mindot * mindot);
+}
+
+int meshletBuild(meshletSet *set, const float *vertices, int stride,
+	const unsigned int *indices, int ntris, int nverts) {
+	meshlet *m;
+	float *normals, axis[3], score, bestscore, dot;
+	unsigned char *local, *used;
+	int tris[MESHLET_MAX_TRIANGLES];
+	int *adjfirst, *adjtris, cursor = 0, best, extra, t, i, j, k, v;
+
+	memset(set, 0, sizeof(meshletSet));
+	if(ntris <= 0) return 0;
+	adjfirst = (int*)malloc((nverts + 1) * sizeof(int));
+	adjtris = (int*)malloc(3 * (size_t)ntris * sizeof(int));
+	normals = (float*)malloc(3 * (size_t)ntris * sizeof(float));
+	local = (unsigned char*)malloc(nverts);
+	used = (unsigned char*)calloc(ntris, 1);
+	set->meshlets = (meshlet*)malloc(ntris * sizeof(meshlet));
+	set->vertices = (unsigned int*)malloc(3 * (size_t)ntris * sizeof(unsigned int));
+	set->triangles = (unsigned char*)malloc(3 * (size_t)ntris);
+	if(adjfirst == NULL || adjtris == NULL || normals == NULL || local == NULL || used == NULL
+		|| set->meshlets == NULL || set->vertices == NULL || set->triangles == NULL) {
+		free(adjfirst); free(adjtris); free(normals); free(local); free(used);
+		meshletFree(set);
+		return -1;
+	}
+	meshBuildAdjacency(adjfirst, adjtris, indices, ntris, nverts);
+	triangleNormals(normals, vertices, stride, indices, ntris);
+	memset(local, 0xff, nverts); // 0xff: not in the current meshlet
+
+	while(1) {
+		// Start a new meshlet at the first triangle that is left
+		while(cursor < ntris && used[cursor]) cursor++;
+		if(cursor == ntris) break;
+		m = &set->meshlets[set->nmeshlets];
+		m->vertexoffset = set->nvertices;
+		m->triangleoffset = 3 * set->ntriangles;
+		m->nverts = m->ntris = 0;
+		axis[0] = axis[1] = axis[2] = 0.0f;
+		best = cursor;
+
+		while(best >= 0) {
+			// Add triangle best
+			used[best] = 1;
+			tris[m->ntris] = best;
+			for(k = 0; k < 3; k++) {
+				v = indices[3 * best + k];
+				if(local[v] == 0xff) {
+					local[v] = m->nverts++;
+					set->vertices[set->nvertices++] = v;
+				}
+				set->triangles[3 * set->ntriangles + k] = local[v];
+				axis[k] += normals[3 * best + k];
+			}
+			set->ntriangles++;
+			m->ntris++;
+			if(m->ntris == MESHLET_MAX_TRIANGLES) break;
+
+			// The next one: a triangle sharing a vertex with the meshlet,
+			// with the fewest new vertices and a normal close to the axis
+			dot = sqrtf(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+			best = -1;
+			bestscore = 1e30f;
+			for(i = 0; i < m->nverts; i++) {
+				v = set->vertices[m->vertexoffset + i];
+				for(j = adjfirst[v]; j < adjfirst[v + 1]; j++) {
+					t = adjtris[j];
+					if(used[t]) continue;
+					extra = (local[indices[3 * t]] == 0xff) + (local[indices[3 * t + 1]] == 0xff)
+						+ (local[indices[3 * t + 2]] == 0xff);
+					if(m->nverts + extra > MESHLET_MAX_VERTICES) continue;
+					score = (float)extra;
+					if(dot > 0.0f) {
+						score += 1.0f - (normals[3 * t] * axis[0] + normals[3 * t + 1] * axis[1]
+							+ normals[3 * t + 2] * axis[2]) / dot;
+					}
+					if(score < bestscore) {
+						bestscore = score;
+						best = t;
+					}
+				}
+			}
+		}
+
+		meshletBounds(m, set, vertices, stride, indices, normals, tris);
+		for(i = 0; i < m->nverts; i++) local[set->vertices[m->vertexoffset + i]] = 0xff;
+		set->nmeshlets++;
+	}
+
+	free(adjfirst); free(adjtris); free(normals); free(local); free(used);
+	// Give back what was not needed, if the system will take it
+	m = (meshlet*)realloc(set->meshlets, set->nmeshlets * sizeof(meshlet));
+	if(m) set->meshlets = m;
+	return 0;
+}
+
+void meshletFree(meshletSet *set) {
+	free(set->meshlets);
+	free(set->vertices);
+	free(set->triangles);
+	memset(set, 0, sizeof(meshletSet));
+}
+
+void meshletViewInit(meshletView *view, const float *mvp, const float *eye) {
+	float len;
+	int i, k;
+
+	// Gribb and Hartmann: the planes are the last row of the matrix plus
+	// or minus each of the other rows
+	for(i = 0; i < 6; i++) {
+		for(k = 0; k < 4; k++) {
+			view->planes[i][k] = mvp[4 * k + 3] + ((i & 1) ? -mvp[4 * k + i / 2] : mvp[4 * k + i / 2]);
+		}
+		len = sqrtf(view->planes[i][0] * view->planes[i][0] + view->planes[i][1] * view->planes[i][1]
+			+ view->planes[i][2] * view->planes[i][2]);
+		if(len > 0.0f) for(k = 0; k < 4; k++) view->planes[i][k] /= len;
+	}
+	for(k = 0; k < 3; k++) view->eye[k] = eye[k];
+}
+
+int meshletCull(const meshletSet *set, const meshletView *view, int *visible,
+	meshletCullStats *stats) {
+	const meshlet *m;
+	const float *p;
+	float d[3], len;
+	int i, j, n = 0, culled;
+
+	if(stats) memset(stats, 0, sizeof(meshletCullStats));
+	for(i = 0; i < set->nmeshlets; i++) {
+		m = &set->meshlets[i];
+		culled = 0;
+		for(j = 0; j < 6 && !culled; j++) {
+			p = view->planes[j];
+			culled = p[0] * m->center[0] + p[1] * m->center[1] + p[2] * m->center[2] + p[3] < -m->radius;
+		}
+		if(culled) {
+			if(stats) {
+				stats->frustummeshlets++;
+				stats->frustumtris += m->ntris;
+			}
+		}
+		else if(m->conecutoff < 1.0f) {
+			// All triangles face away if the eye sees the apex within the cone
+			d[0] = m->coneapex[0] - view->eye[0];
+			d[1] = m->coneapex[1] - view->eye[1];
+			d[2] = m->coneapex[2] - view->eye[2];
+			len = sqrtf(d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+			culled = d[0] * m->coneaxis[0] + d[1] * m->coneaxis[1] + d[2] * m->coneaxis[2] >= m->conecutoff * len;
+			if(culled && stats) {
+				stats->backfacemeshlets++;
+				stats->backfacetris += m->ntris;
+			}
+		}
+		if(!culled) visible[n++] = i;
+		if(stats) {
+			stats->meshlets++;
+			stats->triangles += m->ntris;
+		}
+	}
+	return n;
+}
@@ -0,0 +1,94 @@
+/*
+ * meshlet.h - split an indexed triangle mesh into small clusters
+ * (meshlets) with bounds for culling, for culling on the CPU and for
+ * software rendering. Without OpenGL dependencies.
+ *
+ * The meshes are as in triangleSoup, so for a triangleSoup "soup":
+ *   meshletBuild(&set, soup.vertexarray, 8, soup.indexarray, soup.ntris, soup.nverts);
+ *
+ * Each meshlet has at most MESHLET_MAX_VERTICES vertices, listed as
+ * indices into the vertex array, and at most MESHLET_MAX_TRIANGLES
+ * triangles, as triples of 8-bit indices into that list. The meshlets
+ * are grown from one triangle over shared vertices, preferring the
+ * triangles that add the fewest new vertices and that face the same way
+ * as the meshlet so far, which keeps the normal cones narrow.
+ *
+ * Each meshlet has an axis aligned box, a bounding sphere and a normal
+ * cone. The cone has its apex behind all of the triangle planes, so a
+ * viewer inside the cone, on the far side of the apex, sees all of the
+ * triangles from behind, which is how meshletCull() rejects them without
+ * looking at any triangle. Meshlets outside the view frustum are
+ * rejected by their spheres. Front faces are counterclockwise, as in
+ * OpenGL by default.
+ *
+ * This code is in the public domain.
+ */
+
+#ifndef MESHLET_H
+#define MESHLET_H
+
+// Limits of one meshlet, the ones usually suggested for mesh shaders
+#define MESHLET_MAX_VERTICES 64
+#define MESHLET_MAX_TRIANGLES 124
+
+typedef struct {
+	unsigned int vertexoffset;   // First of its entries in meshletSet.vertices
+	unsigned int triangleoffset; // First of its bytes in meshletSet.triangles
+	unsigned char nverts, ntris; // Number of vertices and triangles
+	float lo[3], hi[3];          // Axis aligned bounding box
+	float center[3], radius;     // Bounding sphere
+	float coneapex[3];           // Normal cone, see above
+	float coneaxis[3];
+	float conecutoff;            // Sine of the cone's half angle, or 1 for no cone
+} meshlet;
+
+typedef struct {
+	meshlet *meshlets;
+	int nmeshlets;
+	unsigned int *vertices;      // Indices into the vertex array, per meshlet
+	int nvertices;
+	unsigned char *triangles;    // 3 local vertex indices per triangle
+	int ntriangles;
+} meshletSet;
+
+/* A view to cull against */
+typedef struct {
+	float planes[6][4]; // Frustum planes a x + b y + c z + d >= 0 inside, normalized
+	float eye[3];       // Eye position, in the coordinates of the mesh
+} meshletView;
+
+/* Results of meshletCull() */
+typedef struct {
+	int meshlets, triangles;         // All of them
+	int frustummeshlets, frustumtris; // Culled by the frustum
+	int backfacemeshlets, backfacetris; // Culled by the normal cone
+} meshletCullStats;
+
+/*
+ * meshletBuild() - split a mesh with ntris triangles and nverts vertices
+ * of stride floats, with the position first, into set. The arrays are
+ * allocated with malloc(), see meshletFree(). Returns 0, or -1 if out of
+ * memory, in which case set is empty.
+ */
+int meshletBuild(meshletSet *set, const float *vertices, int stride,
+	const unsigned int *indices, int ntris, int nverts);
+
+/* meshletFree() - free the arrays of set and set it to all zeros */
+void meshletFree(meshletSet *set);
+
+/*
+ * meshletViewInit() - set up view for a 4x4 matrix from the coordinates of
+ * the mesh to clip coordinates (P * MV), in column major order as for
+ * glUniformMatrix4fv(), and for the eye position in mesh coordinates.
+ */
+void meshletViewInit(meshletView *view, const float *mvp, const float *eye);
+
+/*
+ * meshletCull() - find the meshlets of set that may be visible in view.
+ * Their numbers go into visible, which has room for set->nmeshlets, and
+ * their count is returned. If stats is not NULL, it is filled in.
+ */
+int meshletCull(const meshletSet *set, const meshletView *view, int *visible,
+	meshletCullStats *stats);
+
+#endif /* MESHLET_H */
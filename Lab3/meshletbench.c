@@ -0,0 +1,276 @@
+/*
+ * meshletbench.c - build meshlets (meshlet.c) for an OBJ mesh, and cull
+ * them from a few fixed views, counting the triangles that are culled.
+ *
+ * For each view, the triangles culled with the meshlets by the frustum
+ * and by the normal cones are compared with the triangles that a test
+ * of each triangle would cull: those facing away from the eye or
+ * outside the frustum. Culling a whole meshlet can't get them all, but
+ * it must never cull a triangle that can be seen, and if it does, this
+ * program says so and exits with 1.
+ *
+ * First, a flat square grid is culled from three views where the counts
+ * are known whatever the meshlets look like: from in front nothing is
+ * culled, from behind all of it by the normal cones, and looking away
+ * all of it by the frustum. Other counts are a failure too.
+ *
+ * Usage: meshletbench [file.obj]
+ * With no file, meshes/teapot.obj is used.
+ *
+ * This code is in the public domain.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "bench.h"
+#include "objLoader.h"
+#include "meshlet.h"
+
+/* Fixed views: the direction to the eye from the middle of the mesh, and
+   the distance in units of the bounding sphere radius */
+static const float views[][4] = {
+	{0.0f, 0.0f, 1.0f, 3.0f},   // Front
+	{0.0f, 0.0f, -1.0f, 3.0f},  // Back
+	{1.0f, 0.0f, 0.0f, 3.0f},   // Side
+	{0.0f, 1.0f, 0.0f, 3.0f},   // Top
+	{0.0f, -1.0f, 0.0f, 3.0f},  // Bottom
+	{1.0f, 1.0f, 1.0f, 3.0f},   // Diagonal
+	{1.0f, 0.3f, 0.5f, 1.2f},   // Close, with much outside the frustum
+};
+static const char *viewNames[] = {"front", "back", "side", "top", "bottom", "diagonal", "close"};
+
+/* mvp = perspective (60 degrees, square) * look at center from eye, column major */
+static void viewMatrix(float *mvp, const float *eye, const float *center, float znear, float zfar) {
+	float f[3], s[3], u[3], up[3] = {0.0f, 1.0f, 0.0f}, len, V[16], P[16];
+	int i, j, k;
+
+	for(k = 0; k < 3; k++) f[k] = center[k] - eye[k];
+	len = sqrtf(f[0] * f[0] + f[1] * f[1] + f[2] * f[2]);
+	for(k = 0; k < 3; k++) f[k] /= len;
+	if(fabsf(f[1]) > 0.99f) { // Looking straight up or down
+		up[1] = 0.0f;
+		up[2] = 1.0f;
+	}
+	s[0] = f[1] * up[2] - f[2] * up[1];
+	s[1] = f[2] * up[0] - f[0] * up[2];
+	s[2] = f[0] * up[1] - f[1] * up[0];
+	len = sqrtf(s[0] * s[0] + s[1] * s[1] + s[2] * s[2]);
+	for(k = 0; k < 3; k++) s[k] /= len;
+	u[0] = s[1] * f[2] - s[2] * f[1];
+	u[1] = s[2] * f[0] - s[0] * f[2];
+	u[2] = s[0] * f[1] - s[1] * f[0];
+	memset(V, 0, sizeof(V));
+	for(k = 0; k < 3; k++) {
+		V[4 * k] = s[k];
+		V[4 * k + 1] = u[k];
+		V[4 * k + 2] = -f[k];
+	}
+	V[12] = -(s[0] * eye[0] + s[1] * eye[1] + s[2] * eye[2]);
+	V[13] = -(u[0] * eye[0] + u[1] * eye[1] + u[2] * eye[2]);
+	V[14] = f[0] * eye[0] + f[1] * eye[1] + f[2] * eye[2];
+	V[15] = 1.0f;
+	memset(P, 0, sizeof(P));
+	P[0] = P[5] = 1.0f / tanf(0.5f * 60.0f * (float)M_PI / 180.0f);
+	P[10] = (zfar + znear) / (znear - zfar);
+	P[11] = -1.0f;
+	P[14] = 2.0f * zfar * znear / (znear - zfar);
+	for(i = 0; i < 4; i++) {
+		for(j = 0; j < 4; j++) {
+			mvp[4 * j + i] = 0.0f;
+			for(k = 0; k < 4; k++) mvp[4 * j + i] += P[4 * k + i] * V[4 * j + k];
+		}
+	}
+}
+
+/* Whether a triangle faces away from the eye or is outside a frustum plane */
+static int triangleCulled(const meshletView *view, const float *p0, const float *p1, const float *p2) {
+	float e1[3], e2[3], n[3];
+	int k, j;
+
+	for(k = 0; k < 3; k++) {
+		e1[k] = p1[k] - p0[k];
+		e2[k] = p2[k] - p0[k];
+	}
+	n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+	n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+	n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+	if(n[0] * (p0[0] - view->eye[0]) + n[1] * (p0[1] - view->eye[1]) + n[2] * (p0[2] - view->eye[2]) >= 0.0f) {
+		return 1;
+	}
+	for(j = 0; j < 6; j++) {
+		const float *q = view->planes[j];
+		if(q[0] * p0[0] + q[1] * p0[1] + q[2] * p0[2] + q[3] < 0.0f
+			&& q[0] * p1[0] + q[1] * p1[1] + q[2] * p1[2] + q[3] < 0.0f
+			&& q[0] * p2[0] + q[1] * p2[1] + q[2] * p2[2] + q[3] < 0.0f) return 1;
+	}
+	return 0;
+}
+
+// Quads along each side of the grid of checkKnownViews()
+#define GRID_QUADS 32
+
+/*
+ * checkKnownViews() - cull a grid in the plane z = 0, from -1 to 1 and
+ * facing +z, and compare with the counts it must have. Returns the
+ * number of views that were wrong, or 1 if out of memory.
+ */
+static int checkKnownViews(void) {
+	// Eye, point looked at, and triangles culled by the frustum and by the cones
+	static const float known[3][8] = {
+		{0.0f, 0.0f, 3.0f, 0.0f, 0.0f, 0.0f, 0, 0},
+		{0.0f, 0.0f, -3.0f, 0.0f, 0.0f, 0.0f, 0, 2 * GRID_QUADS * GRID_QUADS},
+		{0.0f, 0.0f, 3.0f, 0.0f, 0.0f, 6.0f, 2 * GRID_QUADS * GRID_QUADS, 0},
+	};
+	static const char *knownNames[3] = {"in front", "behind", "looking away"};
+	float *vertices = (float*)calloc(8 * (GRID_QUADS + 1) * (GRID_QUADS + 1), sizeof(float)), mvp[16];
+	unsigned int *indices = (unsigned int*)malloc(6 * GRID_QUADS * GRID_QUADS * sizeof(unsigned int));
+	int *visible, i, j, v, failed = 0;
+	meshletSet set;
+	meshletView view;
+	meshletCullStats stats;
+
+	if(vertices == NULL || indices == NULL) {
+		free(vertices);
+		free(indices);
+		return 1;
+	}
+	for(j = 0; j <= GRID_QUADS; j++) {
+		for(i = 0; i <= GRID_QUADS; i++) {
+			v = j * (GRID_QUADS + 1) + i;
+			vertices[8 * v] = 2.0f * i / GRID_QUADS - 1.0f;
+			vertices[8 * v + 1] = 2.0f * j / GRID_QUADS - 1.0f;
+			vertices[8 * v + 5] = 1.0f;
+		}
+	}
+	for(j = 0; j < GRID_QUADS; j++) {
+		for(i = 0; i < GRID_QUADS; i++) {
+			v = j * (GRID_QUADS + 1) + i;
+			indices[6 * (j * GRID_QUADS + i)] = v;
+			indices[6 * (j * GRID_QUADS + i) + 1] = v + 1;
+			indices[6 * (j * GRID_QUADS + i) + 2] = v + GRID_QUADS + 2;
+			indices[6 * (j * GRID_QUADS + i) + 3] = v;
+			indices[6 * (j * GRID_QUADS + i) + 4] = v + GRID_QUADS + 2;
+			indices[6 * (j * GRID_QUADS + i) + 5] = v + GRID_QUADS + 1;
+		}
+	}
+	if(meshletBuild(&set, vertices, 8, indices, 2 * GRID_QUADS * GRID_QUADS,
+		(GRID_QUADS + 1) * (GRID_QUADS + 1)) != 0
+		|| (visible = (int*)malloc((set.nmeshlets + 1) * sizeof(int))) == NULL) {
+		free(vertices);
+		free(indices);
+		meshletFree(&set);
+		return 1;
+	}
+	printf("Grid of %d triangles in %d meshlets, culled from known views:\n",
+		2 * GRID_QUADS * GRID_QUADS, set.nmeshlets);
+	for(j = 0; j < 3; j++) {
+		viewMatrix(mvp, known[j], known[j] + 3, 0.05f, 10.0f);
+		meshletViewInit(&view, mvp, known[j]);
+		meshletCull(&set, &view, visible, &stats);
+		i = (stats.frustumtris != (int)known[j][6] || stats.backfacetris != (int)known[j][7]);
+		printf("  %-12s frustum %5d backface %5d, should be %5d and %5d%s\n", knownNames[j],
+			stats.frustumtris, stats.backfacetris, (int)known[j][6], (int)known[j][7], i ? "  FAILED" : "");
+		failed += i;
+	}
+	printf("\n");
+	free(visible);
+	free(vertices);
+	free(indices);
+	meshletFree(&set);
+	return failed;
+}
+
+int main(int argc, char *argv[]) {
+	const char *filename = (argc > 1) ? argv[1] : "meshes/teapot.obj";
+	objMesh mesh;
+	meshletSet set;
+	meshletView view;
+	meshletCullStats stats;
+	const meshlet *m;
+	const float *p[3];
+	float lo[3], hi[3], center[3], radius = 0.0f, eye[3], dir[3], len, mvp[16];
+	int *visible, *keep, i, j, k, t, v, nvisible, exact, wrong, failed = 0, cones = 0;
+	double time;
+
+	failed = (checkKnownViews() != 0);
+	if(objLoadThreaded(&mesh, filename, NULL, OBJ_WELD | OBJ_OPTIMIZE) != 0) {
+		printf("%s could not be read\n", filename);
+		return 1;
+	}
+	time = seconds();
+	if(meshletBuild(&set, mesh.vertexarray, 8, mesh.indexarray, mesh.ntris, mesh.nverts) != 0) {
+		printf("out of memory\n");
+		return 1;
+	}
+	time = seconds() - time;
+	for(i = 0; i < set.nmeshlets; i++) cones += set.meshlets[i].conecutoff < 1.0f;
+	printf("%s: %d triangles, %d vertices\n", filename, mesh.ntris, mesh.nverts);
+	printf("%d meshlets in %.2f ms, %.1f triangles and %.1f vertices each on average, %d with normal cones\n\n",
+		set.nmeshlets, 1000.0 * time, (double)set.ntriangles / set.nmeshlets,
+		(double)set.nvertices / set.nmeshlets, cones);
+
+	// The bounding sphere of the whole mesh, to place the eye
+	for(k = 0; k < 3; k++) lo[k] = hi[k] = mesh.vertexarray[k];
+	for(i = 1; i < mesh.nverts; i++) {
+		for(k = 0; k < 3; k++) {
+			if(mesh.vertexarray[8 * i + k] < lo[k]) lo[k] = mesh.vertexarray[8 * i + k];
+			if(mesh.vertexarray[8 * i + k] > hi[k]) hi[k] = mesh.vertexarray[8 * i + k];
+		}
+	}
+	for(k = 0; k < 3; k++) {
+		center[k] = 0.5f * (lo[k] + hi[k]);
+		radius += 0.25f * (hi[k] - lo[k]) * (hi[k] - lo[k]);
+	}
+	radius = sqrtf(radius);
+
+	visible = (int*)malloc(set.nmeshlets * sizeof(int));
+	keep = (int*)calloc(set.nmeshlets, sizeof(int));
+	printf("%-9s %9s %9s %9s %9s %9s %9s\n", "view", "meshlets", "frustum", "backface",
+		"culled", "exact", "us");
+	for(j = 0; j < (int)(sizeof(views) / sizeof(views[0])); j++) {
+		len = sqrtf(views[j][0] * views[j][0] + views[j][1] * views[j][1] + views[j][2] * views[j][2]);
+		for(k = 0; k < 3; k++) {
+			dir[k] = views[j][k] / len;
+			eye[k] = center[k] + dir[k] * views[j][3] * radius;
+		}
+		viewMatrix(mvp, eye, center, 0.05f * radius, 10.0f * radius);
+		meshletViewInit(&view, mvp, eye);
+
+		time = seconds();
+		nvisible = meshletCull(&set, &view, visible, &stats);
+		time = seconds() - time;
+
+		// Compare with culling each triangle
+		exact = wrong = 0;
+		for(i = 0; i < set.nmeshlets; i++) keep[i] = 0;
+		for(i = 0; i < nvisible; i++) keep[visible[i]] = 1;
+		for(i = 0; i < set.nmeshlets; i++) {
+			m = &set.meshlets[i];
+			for(t = 0; t < m->ntris; t++) {
+				for(v = 0; v < 3; v++) {
+					p[v] = mesh.vertexarray + 8 * set.vertices[m->vertexoffset
+						+ set.triangles[m->triangleoffset + 3 * t + v]];
+				}
+				if(triangleCulled(&view, p[0], p[1], p[2])) exact++;
+				else if(!keep[i]) wrong++;
+			}
+		}
+		printf("%-9s %9d %9d %9d %9d %9d %9.1f\n", viewNames[j], nvisible, stats.frustumtris,
+			stats.backfacetris, stats.frustumtris + stats.backfacetris, exact, 1e6 * time);
+		if(wrong) {
+			printf("  %d visible triangles were culled\n", wrong);
+			failed = 1;
+		}
+	}
+	printf("\n(meshlets: visible after culling; frustum, backface, culled: triangles culled\n"
+		"by meshlet; exact: triangles culled one by one)\n");
+
+	free(visible);
+	free(keep);
+	meshletFree(&set);
+	objFree(&mesh);
+	return failed;
+}
@@ -0,0 +1,87 @@
+/*
+ * meshoptbench.c - measure the mesh optimizations of meshOptimize.c with
+ * the vertex cache simulator, without a GPU.
+ *
+ * Each mesh is loaded welded, in file order, and then put through each
+ * step of meshOptimize(): Tipsify, the overdraw cluster sort and the
+ * vertex fetch reorder. After each step, the ACMR (cache misses per
+ * triangle) and ATVR (cache misses per vertex) of FIFO caches of 16 and
+ * 32 entries are printed, how much of the vertex array is read more than
+ * once (meshFetchSimulate()), and the overdraw in 256 x 256 views from
+ * 14 directions (meshOverdrawSimulate()).
+ *
+ * Usage: meshoptbench [file.obj ...]
+ * With no files, the meshes in meshes/ are used.
+ *
+ * This code is in the public domain.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "bench.h"
+#include "objLoader.h"
+#include "meshOptimize.h"
+
+static const char *defaultFiles[] = { BENCH_MESHES };
+
+static void printStep(const char *filename, const char *step, const objMesh *mesh, double ms) {
+	meshCacheStats s16, s32;
+
+	meshCacheSimulate(mesh->indexarray, mesh->ntris, mesh->nverts, 16, &s16);
+	meshCacheSimulate(mesh->indexarray, mesh->ntris, mesh->nverts, 32, &s32);
+	printf("%-26s %-10s %7.3f %7.3f %7.3f %7.3f %9.3f %8.3f %8.2f\n", filename, step,
+		s16.acmr, s16.atvr, s32.acmr, s32.atvr,
+		meshFetchSimulate(mesh->indexarray, mesh->ntris, mesh->nverts, 8 * sizeof(float)),
+		meshOverdrawSimulate(mesh->indexarray, mesh->ntris, mesh->vertexarray, 8, mesh->nverts, 256), ms);
+}
+
+int main(int argc, char *argv[]) {
+	const char **files = defaultFiles;
+	int nfiles = sizeof(defaultFiles) / sizeof(defaultFiles[0]);
+	int f, nclusters, nverts;
+	int *clusters;
+	objMesh mesh;
+	double t;
+
+	if(argc > 1) {
+		files = (const char**)&argv[1];
+		nfiles = argc - 1;
+	}
+	printf("%-26s %-10s %7s %7s %7s %7s %9s %8s %8s\n", "file", "step", "ACMR16", "ATVR16",
+		"ACMR32", "ATVR32", "overfetch", "overdraw", "ms");
+	for(f = 0; f < nfiles; f++) {
+		if(objLoadThreaded(&mesh, files[f], NULL, OBJ_WELD) != 0) {
+			printf("%-26s could not be read\n", files[f]);
+			continue;
+		}
+		clusters = (int*)malloc((mesh.ntris + 1) * sizeof(int));
+		if(clusters == NULL) {
+			objFree(&mesh);
+			continue;
+		}
+		printStep(files[f], "file", &mesh, 0.0);
+
+		t = seconds();
+		meshOptimizeVertexCache(mesh.indexarray, mesh.ntris, mesh.nverts, MESH_CACHE_SIZE,
+			clusters, &nclusters);
+		t = seconds() - t;
+		printStep(files[f], "tipsify", &mesh, 1000.0 * t);
+
+		t = seconds();
+		meshOptimizeOverdraw(mesh.indexarray, mesh.ntris, mesh.vertexarray, 8, mesh.nverts,
+			MESH_CACHE_SIZE, clusters, nclusters, MESH_OVERDRAW_THRESHOLD);
+		t = seconds() - t;
+		printStep(files[f], "overdraw", &mesh, 1000.0 * t);
+
+		t = seconds();
+		nverts = meshOptimizeVertexFetch(mesh.vertexarray, 8, mesh.indexarray, mesh.ntris, mesh.nverts);
+		t = seconds() - t;
+		if(nverts >= 0) mesh.nverts = nverts;
+		printStep(files[f], "fetch", &mesh, 1000.0 * t);
+
+		free(clusters);
+		objFree(&mesh);
+	}
+	return 0;
+}
@@ -0,0 +1,151 @@
+/*
+ * mipbench.c - time and check the mipmap chains of mipmap.c.
+ *
+ * First three small checks that print what they find:
+ * - A 1 pixel black and white checkerboard should give a level 1 of
+ *   sRGB 188, half the light, with MIP_SRGB, and 128 (which looks much
+ *   darker) without.
+ * - Opaque green pixels between transparent red ones should stay green
+ *   with MIP_ALPHA_WEIGHTED, and turn olive without.
+ * - A level should not be brighter or darker on the whole than the one
+ *   above it, whatever the kernel.
+ * Then full chains are made for RGBA test images of a few sizes with
+ * each kernel and with MIP_SRGB, and the times are shown, with the
+ * pixels of the source image per second.
+ *
+ * Usage: mipbench [threads [size ...]]
+ * The default is one thread per CPU, and sizes 1024, 4096 and 8192.
+ *
+ * This code is in the public domain.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "bench.h"
+#include "mipmap.h"
+#include "threadPool.h"
+
+static const int defaultSizes[] = { 1024, 4096, 8192 };
+
+/* The mean of channel c over a level */
+static double mean(const mipChain *chain, int level, int c) {
+	size_t i, n = (size_t)chain->width[level] * chain->height[level];
+	double sum = 0.0;
+
+	for(i = 0; i < n; i++) sum += chain->levels[level][i * chain->bpp + c];
+	return sum / n;
+}
+
+static void checkGamma(noisePool *pool) {
+	unsigned char *image = (unsigned char*)malloc(64 * 64 * 3);
+	mipChain chain;
+	int i, flags;
+
+	for(i = 0; i < 64 * 64; i++) memset(image + 3 * i, ((i ^ (i >> 6)) & 1) ? 255 : 0, 3);
+	printf("Checkerboard, level 1:");
+	for(flags = MIP_SRGB; flags >= 0; flags -= MIP_SRGB) {
+		if(mipBuild(&chain, image, 64, 64, 3, MIP_BOX, flags, pool) != 0) continue;
+		printf(" %.1f %s%s", mean(&chain, 1, 0), flags ? "with MIP_SRGB" : "without", flags ? "," : "\n");
+		mipFree(&chain);
+	}
+	free(image);
+}
+
+static void checkAlpha(noisePool *pool) {
+	unsigned char *image = (unsigned char*)malloc(64 * 64 * 4), *p;
+	mipChain chain;
+	int i, flags;
+
+	for(i = 0; i < 64 * 64; i++) {
+		p = image + 4 * i;
+		p[3] = ((i ^ (i >> 6)) & 1) ? 255 : 0;
+		p[0] = p[3] ? 0 : 255;
+		p[1] = p[3] ? 255 : 0;
+		p[2] = 0;
+	}
+	printf("Green in transparent red, level 1 RGBA:");
+	for(flags = MIP_ALPHA_WEIGHTED; flags >= 0; flags -= MIP_ALPHA_WEIGHTED) {
+		if(mipBuild(&chain, image, 64, 64, 4, MIP_KAISER, flags, pool) != 0) continue;
+		printf(" %.0f %.0f %.0f %.0f %s%s", mean(&chain, 1, 0), mean(&chain, 1, 1), mean(&chain, 1, 2),
+			mean(&chain, 1, 3), flags ? "with MIP_ALPHA_WEIGHTED" : "without", flags ? "," : "\n");
+		mipFree(&chain);
+	}
+	free(image);
+}
+
+/* Soft blobs and a ramp, with fine noise on top, and a height in alpha */
+static unsigned char *makeImage(int size) {
+	unsigned char *image = (unsigned char*)malloc((size_t)size * size * 4), *p;
+	unsigned int seed = 1;
+	int x, y, c;
+	float u, v;
+
+	if(image == NULL) return NULL;
+	for(y = 0; y < size; y++) {
+		for(x = 0; x < size; x++) {
+			p = image + 4 * ((size_t)y * size + x);
+			u = (float)x / size;
+			v = (float)y / size;
+			seed = seed * 1664525u + 1013904223u;
+			for(c = 0; c < 3; c++)
+				p[c] = (unsigned char)(127.5f + 100.0f * sinf(6.2832f * ((c + 1) * u + (3 - c) * v)) + (seed >> 28));
+			p[3] = (unsigned char)(255.0f * u * v);
+		}
+	}
+	return image;
+}
+
+int main(int argc, char *argv[]) {
+	noisePool *pool = noisePoolCreate((argc > 1) ? atoi(argv[1]) : 0);
+	const int *sizes = defaultSizes;
+	int nsizes = 3, *argsizes = NULL, i, filter, level, size;
+	unsigned char *image;
+	mipChain chain;
+	double t, worst;
+
+	if(pool == NULL) {
+		printf("Could not start the threads.\n");
+		return 1;
+	}
+	if(argc > 2) {
+		nsizes = argc - 2;
+		sizes = argsizes = (int*)malloc(nsizes * sizeof(int));
+		for(i = 0; i < nsizes; i++) argsizes[i] = atoi(argv[i + 2]);
+	}
+	printf("%d threads\n\n", noisePoolThreads(pool));
+	checkGamma(pool);
+	checkAlpha(pool);
+
+	for(i = 0; i < nsizes; i++) {
+		size = sizes[i];
+		if(size <= 0 || (image = makeImage(size)) == NULL) {
+			printf("\n%d x %d: no memory for it\n", size, size);
+			continue;
+		}
+		printf("\n%d x %d RGBA, sRGB:\n", size, size);
+		for(filter = MIP_BOX; filter <= MIP_LANCZOS; filter++) {
+			t = seconds();
+			if(mipBuild(&chain, image, size, size, 4, filter, MIP_SRGB | MIP_WRAP, pool) != 0) {
+				printf("  %-8s out of memory\n", mipFilterName(filter));
+				continue;
+			}
+			t = seconds() - t;
+			// The largest change in the mean alpha from one level to the next
+			worst = 0.0;
+			for(level = 1; level < chain.nlevels; level++) {
+				if(fabs(mean(&chain, level, 3) - mean(&chain, level - 1, 3)) > worst)
+					worst = fabs(mean(&chain, level, 3) - mean(&chain, level - 1, 3));
+			}
+			printf("  %-8s %2d levels in %8.1f ms, %7.1f Mpixels/s, mean alpha drift %.2f\n",
+				mipFilterName(filter), chain.nlevels, 1e3 * t, 1e-6 * size * size / t, worst);
+			mipFree(&chain);
+		}
+		free(image);
+	}
+	free(argsizes);
+	noisePoolDestroy(pool);
+	return 0;
+}
@@ -0,0 +1,352 @@
+/*
+ * mipmap.c - mipmap chains made on the CPU. See mipmap.h.
+ *
+ * Each task makes a band of rows of a new level. The rows of the level
+ * above that the band needs are converted to floats in linear light (or
+ * just to floats), weighted by alpha if asked to, and filtered along the
+ * row, one at a time as the columns call for them. A few such rows are
+ * kept, as many as the column filter reaches over, so that each is only
+ * filtered once per band. Each new row is then the weighted sum of those,
+ * converted back to bytes.
+ *
+ * Pixels are always 4 floats, also for RGB images, so that each is one
+ * SSE2 register in the row filter.
+ *
+ * This code is in the public domain.
+ */
+
+#include <stdlib.h> // For malloc() and free()
+#include <string.h> // For memset()
+#include <math.h>   // For sin(), pow() and floor()
+#include <pthread.h> // For pthread_once()
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define MIP_SIMD 1
+#endif
+
+#include "mipmap.h"
+
+// Rows of the new level in each task
+#define MIP_BAND_ROWS 16
+// Entries of the table from linear light to sRGB
+#define MIP_ENCODE_SIZE 16384
+// Radius of the kernels, in pixels of the new level, and the alpha of
+// the Kaiser window
+#define KAISER_RADIUS 2.0
+#define KAISER_ALPHA 4.0
+#define LANCZOS_RADIUS 3.0
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+static float decodeTable[256]; // sRGB to linear
+static unsigned char encodeTable[MIP_ENCODE_SIZE]; // Linear to sRGB
+static pthread_once_t tablesOnce = PTHREAD_ONCE_INIT; // mipBuild() may run on several threads
+
+/* Filter weights along one axis */
+typedef struct {
+	int ntaps;     // The same for each new pixel, padded with zero weights
+	int *index;    // ntaps old pixels for each new one,
+	float *weight; // and their weights, which add up to 1
+} filterTable;
+
+/* One level being made */
+typedef struct {
+	const unsigned char *src;
+	unsigned char *dst;
+	int sw, sh, dw, dh, bpp, flags;
+	filterTable rows, columns; // Along the rows (x) and the columns (y)
+	float *scratch;   // For each thread, see bandTask()
+	size_t perthread; // Floats of scratch for each thread
+	int slots;        // Rows filtered along x that are kept
+} levelJob;
+
+static void makeTables(void) {
+	double c, l;
+	int i;
+
+	for(i = 0; i < 256; i++) {
+		c = i / 255.0;
+		decodeTable[i] = (float)((c <= 0.04045) ? c / 12.92 : pow((c + 0.055) / 1.055, 2.4));
+	}
+	for(i = 0; i < MIP_ENCODE_SIZE; i++) {
+		l = i / (MIP_ENCODE_SIZE - 1.0);
+		c = (l <= 0.0031308) ? 12.92 * l : 1.055 * pow(l, 1.0 / 2.4) - 0.055;
+		encodeTable[i] = (unsigned char)(255.0 * c + 0.5);
+	}
+}
+
+static double sinc(double x) {
+	return (x == 0.0) ? 1.0 : sin(M_PI * x) / (M_PI * x);
+}
+
+/* The modified Bessel function of order 0, for the Kaiser window */
+static double besselI0(double x) {
+	double sum = 1.0, term = 1.0;
+	int k;
+
+	for(k = 1; k < 50 && term > 1e-12 * sum; k++) {
+		term *= (0.5 * x / k) * (0.5 * x / k);
+		sum += term;
+	}
+	return sum;
+}
+
+static double kernelRadius(int filter) {
+	if(filter == MIP_KAISER) return KAISER_RADIUS;
+	if(filter == MIP_LANCZOS) return LANCZOS_RADIUS;
+	return 0.5;
+}
+
+/* The kernel at t pixels of the new level from the center */
+static double kernel(int filter, double t) {
+	double r;
+
+	t = fabs(t);
+	if(filter == MIP_KAISER) {
+		if(t >= KAISER_RADIUS) return 0.0;
+		r = t / KAISER_RADIUS;
+		return sinc(t) * besselI0(KAISER_ALPHA * sqrt(1.0 - r * r)) / besselI0(KAISER_ALPHA);
+	}
+	if(filter == MIP_LANCZOS) return (t >= LANCZOS_RADIUS) ? 0.0 : sinc(t) * sinc(t / LANCZOS_RADIUS);
+	// A box, split evenly between two new pixels where it is on the edge
+	return (t < 0.5) ? 1.0 : (t == 0.5) ? 0.5 : 0.0;
+}
+
+static void freeTable(filterTable *table) {
+	free(table->index);
+	free(table->weight);
+	table->index = NULL;
+	table->weight = NULL;
+}
+
+/* The weights from src pixels to dst pixels along one axis */
+static int makeTable(filterTable *table, int filter, int src, int dst, int wrap) {
+	double scale = (double)src / dst, radius = kernelRadius(filter) * scale;
+	double center, sum, w[64];
+	int d, k, i, first, n;
+
+	n = (int)floor(2.0 * radius) + 1;
+	if(n > 63) n = 63; // See bandTask()
+	table->ntaps = n;
+	table->index = (int*)malloc((size_t)dst * n * sizeof(int));
+	table->weight = (float*)malloc((size_t)dst * n * sizeof(float));
+	if(table->index == NULL || table->weight == NULL) {
+		freeTable(table);
+		return -1;
+	}
+	for(d = 0; d < dst; d++) {
+		// Old pixel i has its center at i + 0.5
+		center = (d + 0.5) * scale;
+		first = (int)ceil(center - radius - 0.5);
+		sum = 0.0;
+		for(k = 0; k < n; k++) {
+			w[k] = kernel(filter, (first + k + 0.5 - center) / scale);
+			sum += w[k];
+		}
+		for(k = 0; k < n; k++) {
+			i = first + k;
+			if(wrap) i = ((i % src) + src) % src;
+			else i = (i < 0) ? 0 : (i >= src) ? src - 1 : i;
+			table->index[d * n + k] = i;
+			table->weight[d * n + k] = (float)(w[k] / sum);
+		}
+	}
+	return 0;
+}
+
+/* A row of the old level as 4 floats per pixel, in linear light if sRGB */
+static void decodeRow(const levelJob *job, const unsigned char *row, float *out) {
+	int x, c, bpp = job->bpp, srgb = job->flags & MIP_SRGB;
+	int weighted = (job->flags & MIP_ALPHA_WEIGHTED) && bpp == 4;
+	float a;
+
+	for(x = 0; x < job->sw; x++, row += bpp, out += 4) {
+		a = (bpp == 4) ? row[3] * (1.0f / 255.0f) : 1.0f;
+		for(c = 0; c < 3; c++) out[c] = srgb ? decodeTable[row[c]] : row[c] * (1.0f / 255.0f);
+		if(weighted) {
+			out[0] *= a;
+			out[1] *= a;
+			out[2] *= a;
+		}
+		out[3] = a;
+	}
+}
+
+/* A row of the new level from 4 floats per pixel */
+static void encodeRow(const levelJob *job, const float *in, unsigned char *row) {
+	int x, c, bpp = job->bpp, srgb = job->flags & MIP_SRGB;
+	int weighted = (job->flags & MIP_ALPHA_WEIGHTED) && bpp == 4;
+	float a, v, scale;
+
+	for(x = 0; x < job->dw; x++, row += bpp, in += 4) {
+		a = (in[3] < 0.0f) ? 0.0f : (in[3] > 1.0f) ? 1.0f : in[3];
+		scale = (weighted && a > 0.0f) ? 1.0f / a : 1.0f;
+		for(c = 0; c < 3; c++) {
+			v = in[c] * scale;
+			v = (v < 0.0f) ? 0.0f : (v > 1.0f) ? 1.0f : v;
+			row[c] = srgb ? encodeTable[(int)(v * (MIP_ENCODE_SIZE - 1) + 0.5f)]
+				: (unsigned char)(v * 255.0f + 0.5f);
+		}
+		if(bpp == 4) row[3] = (unsigned char)(a * 255.0f + 0.5f);
+	}
+}
+
+/* Filter a decoded row along x to the width of the new level */
+static void filterRow(const levelJob *job, const float *in, float *out) {
+	const int n = job->rows.ntaps;
+	const int *index = job->rows.index;
+	const float *weight = job->rows.weight;
+	int x, k;
+#ifdef MIP_SIMD
+	__m128 sum;
+
+	for(x = 0; x < job->dw; x++, index += n, weight += n) {
+		sum = _mm_setzero_ps();
+		for(k = 0; k < n; k++)
+			sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weight[k]), _mm_loadu_ps(in + 4 * index[k])));
+		_mm_storeu_ps(out + 4 * x, sum);
+	}
+#else
+	float s[4];
+	int c;
+
+	for(x = 0; x < job->dw; x++, index += n, weight += n) {
+		s[0] = s[1] = s[2] = s[3] = 0.0f;
+		for(k = 0; k < n; k++) {
+			for(c = 0; c < 4; c++) s[c] += weight[k] * in[4 * index[k] + c];
+		}
+		for(c = 0; c < 4; c++) out[4 * x + c] = s[c];
+	}
+#endif
+}
+
+/* sum += w * row, for n floats */
+static void addRow(float *sum, const float *row, float w, int n) {
+	int i = 0;
+#ifdef MIP_SIMD
+	const __m128 w4 = _mm_set1_ps(w);
+	for(; i + 4 <= n; i += 4)
+		_mm_storeu_ps(sum + i, _mm_add_ps(_mm_loadu_ps(sum + i), _mm_mul_ps(w4, _mm_loadu_ps(row + i))));
+#endif
+	for(; i < n; i++) sum[i] += w * row[i];
+}
+
+/*
+ * Make MIP_BAND_ROWS rows of the new level. The scratch of the thread is
+ * one decoded old row, the kept rows filtered along x (slots of them,
+ * tagged with the old row and when they were last used), and the sum.
+ */
+static void bandTask(void *arg, int index, int thread) {
+	levelJob *job = (levelJob*)arg;
+	float *scratch = job->scratch + job->perthread * thread;
+	float *decoded = scratch, *kept = decoded + 4 * (size_t)job->sw;
+	float *sum = kept + 4 * (size_t)job->dw * job->slots;
+	int tags[64], used[64], y, k, s, row, oldest, clock = 0;
+	int y1 = (index + 1) * MIP_BAND_ROWS, n = job->columns.ntaps;
+	const float *weight;
+	const int *rows;
+
+	for(s = 0; s < job->slots; s++) {
+		tags[s] = -1;
+		used[s] = 0;
+	}
+	if(y1 > job->dh) y1 = job->dh;
+	for(y = index * MIP_BAND_ROWS; y < y1; y++) {
+		memset(sum, 0, 4 * (size_t)job->dw * sizeof(float));
+		rows = job->columns.index + y * n;
+		weight = job->columns.weight + y * n;
+		for(k = 0; k < n; k++) {
+			if(weight[k] == 0.0f) continue;
+			row = rows[k];
+			for(s = 0; s < job->slots && tags[s] != row; s++);
+			if(s == job->slots) { // Not kept, so filter it in place of the oldest
+				for(s = oldest = 0; s < job->slots; s++) {
+					if(used[s] < used[oldest]) oldest = s;
+				}
+				s = oldest;
+				decodeRow(job, job->src + (size_t)row * job->sw * job->bpp, decoded);
+				filterRow(job, decoded, kept + 4 * (size_t)job->dw * s);
+				tags[s] = row;
+			}
+			used[s] = ++clock;
+			addRow(sum, kept + 4 * (size_t)job->dw * s, weight[k], 4 * job->dw);
+		}
+		encodeRow(job, sum, job->dst + (size_t)y * job->dw * job->bpp);
+	}
+}
+
+int mipBuild(mipChain *chain, const unsigned char *pixels, int width, int height, int bpp,
+	int filter, int flags, noisePool *pool) {
+	levelJob job;
+	size_t size = 0, offset;
+	int level, nthreads = pool ? noisePoolThreads(pool) : 1;
+
+	memset(chain, 0, sizeof(mipChain));
+	if(pixels == NULL || width <= 0 || height <= 0 || (bpp != 3 && bpp != 4)
+		|| filter < MIP_BOX || filter > MIP_LANCZOS) return -1;
+	pthread_once(&tablesOnce, makeTables);
+
+	// The sizes of the levels, down to 1 x 1
+	chain->bpp = bpp;
+	chain->levels[0] = pixels;
+	chain->width[0] = width;
+	chain->height[0] = height;
+	for(level = 1; level < MIP_MAX_LEVELS && (width > 1 || height > 1); level++) {
+		width = (width > 1) ? width / 2 : 1;
+		height = (height > 1) ? height / 2 : 1;
+		chain->width[level] = width;
+		chain->height[level] = height;
+		size += (size_t)width * height * bpp;
+	}
+	chain->nlevels = level;
+	if(level > 1 && (chain->data = (unsigned char*)malloc(size)) == NULL) return -1;
+
+	memset(&job, 0, sizeof(job));
+	job.bpp = bpp;
+	job.flags = flags;
+	for(level = 1, offset = 0; level < chain->nlevels; level++) {
+		job.src = chain->levels[level - 1];
+		job.dst = chain->data + offset;
+		job.sw = chain->width[level - 1];
+		job.sh = chain->height[level - 1];
+		job.dw = chain->width[level];
+		job.dh = chain->height[level];
+		if(makeTable(&job.rows, filter, job.sw, job.dw, flags & MIP_WRAP) != 0
+			|| makeTable(&job.columns, filter, job.sh, job.dh, flags & MIP_WRAP) != 0) {
+			freeTable(&job.rows);
+			mipFree(chain);
+			return -1;
+		}
+		job.slots = job.columns.ntaps + 1;
+		job.perthread = 4 * ((size_t)job.sw + (size_t)job.dw * (job.slots + 1));
+		job.scratch = (float*)malloc(job.perthread * nthreads * sizeof(float));
+		if(job.scratch == NULL) {
+			freeTable(&job.rows);
+			freeTable(&job.columns);
+			mipFree(chain);
+			return -1;
+		}
+		noisePoolFor(pool, (job.dh + MIP_BAND_ROWS - 1) / MIP_BAND_ROWS, bandTask, &job);
+		free(job.scratch);
+		freeTable(&job.rows);
+		freeTable(&job.columns);
+		chain->levels[level] = job.dst;
+		offset += (size_t)job.dw * job.dh * bpp;
+	}
+	return 0;
+}
+
+void mipFree(mipChain *chain) {
+	free(chain->data);
+	memset(chain, 0, sizeof(mipChain));
+}
+
+const char *mipFilterName(int filter) {
+	if(filter == MIP_BOX) return "box";
+	if(filter == MIP_KAISER) return "Kaiser";
+	if(filter == MIP_LANCZOS) return "Lanczos";
+	return "unknown";
+}
@@ -0,0 +1,81 @@
+/*
+ * mipmap.h - chains of mipmap levels for 8 bit RGB and RGBA images, made
+ * on the CPU, without OpenGL dependencies. Used by createTexture() in
+ * tgaloader.c in place of glGenerateMipmap().
+ *
+ * Each level is made from the one before it with a separable filter,
+ * first along the rows and then along the columns, in floating point
+ * with SSE2 where the compiler has it. The levels halve in size, rounded
+ * down, to 1 x 1 as in OpenGL, and sizes that are not powers of two are
+ * fine. The kernels are:
+ *
+ * MIP_BOX      the average of the 2 x 2 pixels under each new one. Fast
+ *              and soft, and it blurs more at each level.
+ * MIP_KAISER   a sinc with a Kaiser window, 2 pixels of the new level
+ *              out from the center, alpha 4. Sharp with little ringing,
+ *              the usual choice.
+ * MIP_LANCZOS  a Lanczos 3 windowed sinc. Sharpest, with some ringing
+ *              at hard edges.
+ *
+ * With MIP_SRGB, the color channels are taken to be sRGB encoded, as
+ * images from paint programs and cameras are, and are filtered in
+ * linear light: decoded and encoded again through lookup tables. That
+ * keeps fine detail from going darker at each level, which filtering
+ * the encoded values does. Alpha is always linear.
+ *
+ * With MIP_ALPHA_WEIGHTED, the color of each pixel counts as much as its
+ * alpha, so colors under alpha 0 do not bleed into the visible pixels.
+ * That is for alpha that is coverage or opacity. It is not for alpha
+ * that is data of its own, such as the height map in the alpha of the
+ * texture that vertexshader.glsl displaces the sphere by, which is left
+ * out of the color filtering either way and filtered as it is.
+ *
+ * The rows of each level are split into bands that run in parallel on
+ * a noisePool (cpuNoisePool.c).
+ *
+ * This code is in the public domain.
+ */
+
+#ifndef MIPMAP_H
+#define MIPMAP_H
+
+#include "threadPool.h" // For noisePool
+
+/* Filter kernels, see above */
+#define MIP_BOX 0
+#define MIP_KAISER 1
+#define MIP_LANCZOS 2
+
+/* Flags for mipBuild() */
+#define MIP_SRGB 1           // Filter the color in linear light, see above
+#define MIP_ALPHA_WEIGHTED 2 // Weight the color by alpha, see above
+#define MIP_WRAP 4           // The image repeats at the edges, as with GL_REPEAT
+
+// Most levels, enough for 32768 x 32768
+#define MIP_MAX_LEVELS 16
+
+typedef struct {
+	unsigned char *data;  // Levels 1 and up, one after the other
+	const unsigned char *levels[MIP_MAX_LEVELS]; // Level 0 is the source image
+	int width[MIP_MAX_LEVELS], height[MIP_MAX_LEVELS];
+	int nlevels;
+	int bpp;              // Bytes per pixel, 3 or 4
+} mipChain;
+
+/*
+ * mipBuild() - make all mipmap levels below the image of width x height
+ * pixels of bpp bytes (3 or 4) with the filter and the flags above,
+ * using the threads of pool, which may be NULL. The image is not copied:
+ * chain->levels[0] points to it, so it must stay until the chain is
+ * freed. Returns 0, or -1 if out of memory or for bad arguments.
+ */
+int mipBuild(mipChain *chain, const unsigned char *pixels, int width, int height, int bpp,
+	int filter, int flags, noisePool *pool);
+
+/* mipFree() - free the levels of chain and set it to all zeros */
+void mipFree(mipChain *chain);
+
+/* mipFilterName() - a printable name for a filter */
+const char *mipFilterName(int filter);
+
+#endif /* MIPMAP_H */
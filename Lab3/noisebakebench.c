@@ -0,0 +1,180 @@
+/*
+ * noisebakebench.c - time and check the tileable noise textures of
+ * cpuNoiseBake.c.
+ *
+ * Usage: noisebakebench [size]
+ *
+ * Bakes a size x size 2D tile (default 1024) and a size/8 cube, with one
+ * and with four octaves, in each output format, and shows the time and
+ * the rate in Mtexels/s. Each float tile is then checked at a few hundred
+ * texels against the sum of octaves of noisePeriodic2() and 3() that it
+ * stands for, and against the same sum one period further along each
+ * axis, which must be the same for the tile to wrap without a seam.
+ * The half and 8-bit tiles must hold exactly the float tile converted,
+ * a tile baked into one channel of an interleaved image must leave the
+ * other channels alone, and a tile of no size must be an error.
+ * The program exits with status 1 if any check fails.
+ *
+ * This code is in the public domain.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "bench.h"
+#include "cpuNoise.h"
+
+#define CHECK_POINTS 256
+// Largest difference from the reference sum, which uses the same kernels
+#define CHECK_EPSILON 1e-6f
+
+static const char *formatNames[3] = { "float32", "float16", "unorm8" };
+
+/*
+ * referenceTexel() - the value of texel (i, j, s) of a tile, from the
+ * definition in cpuNoise.h, with the tile moved one period along axis,
+ * or not at all if axis is -1
+ */
+static float referenceTexel(int i, int j, int s, int width, int height, int depth,
+	const noiseBakeParams *params, int axis) {
+	float x, y, z, rep[3], v, sum = 0.0f, freq = 1.0f, amp = 1.0f;
+	int k;
+
+	for(k = 0; k < params->octaves; k++, freq *= 2.0f, amp *= params->gain) {
+		rep[0] = params->period[0] * freq;
+		rep[1] = params->period[1] * freq;
+		rep[2] = params->period[2] * freq;
+		x = (i + 0.5f) / width * params->period[0] * freq;
+		y = (j + 0.5f) / height * rep[1];
+		z = (depth > 0) ? (s + 0.5f) / depth * rep[2] : 0.0f;
+		if(axis == 0) x += rep[0];
+		if(axis == 1) y += rep[1];
+		if(axis == 2) z += rep[2];
+		if(depth > 0) noisePeriodic3(&x, &y, &z, rep, &v, 1);
+		else noisePeriodic2(&x, &y, rep, &v, 1);
+		sum = (k == 0) ? v : sum + amp * v;
+	}
+	return sum;
+}
+
+/*
+ * checkTile() - the largest difference of a float tile from referenceTexel()
+ * at CHECK_POINTS texels, in place and moved one period along each axis
+ */
+static float checkTile(const float *tile, int width, int height, int depth,
+	const noiseBakeParams *params) {
+	unsigned int seed = 1;
+	float d, maxdiff = 0.0f;
+	int n, i, j, s, axis;
+
+	for(n = 0; n < CHECK_POINTS; n++) {
+		seed = seed * 1664525u + 1013904223u;
+		i = (seed >> 8) % width;
+		seed = seed * 1664525u + 1013904223u;
+		j = (seed >> 8) % height;
+		seed = seed * 1664525u + 1013904223u;
+		s = (depth > 0) ? (int)((seed >> 8) % depth) : 0;
+		for(axis = -1; axis < ((depth > 0) ? 3 : 2); axis++) {
+			d = fabsf(tile[((size_t)s * height + j) * width + i]
+				- referenceTexel(i, j, s, width, height, depth, params, axis));
+			if(d > maxdiff) maxdiff = d;
+		}
+	}
+	return maxdiff;
+}
+
+/* Bake a 2D tile (depth 0) or a volume */
+static int bake(void *dst, int width, int height, int depth, const noiseBakeParams *params) {
+	if(depth > 0) return noiseBakeTile3D(dst, width, height, depth, params);
+	return noiseBakeTile2D(dst, width, height, params);
+}
+
+/*
+ * benchTile() - bake one tile in every format, time it and check it.
+ * Returns the number of failed checks.
+ */
+static int benchTile(int width, int height, int depth, int octaves) {
+	noiseBakeParams params;
+	size_t texels = (size_t)width * height * (depth > 0 ? depth : 1), i;
+	float *tile = (float*)malloc(texels * 4 * sizeof(float)), maxdiff, v;
+	unsigned short *half = (unsigned short*)(tile + texels);
+	unsigned char *unorm = (unsigned char*)(tile + 2 * texels), *rgba = unorm + texels;
+	double t0, t, best;
+	int format, r, failed = 0, same;
+
+	if(tile == NULL) {
+		printf("  Out of memory\n");
+		return 1;
+	}
+	noiseBakeDefaults(&params);
+	params.octaves = octaves;
+	for(format = 0; format < 3; format++) {
+		params.format = (noiseFormat)format;
+		best = 1e30;
+		for(r = 0; r < 3; r++) {
+			t0 = seconds();
+			if(bake((format == 0) ? (void*)tile : (format == 1) ? (void*)half : (void*)unorm,
+				width, height, depth, &params) != 0) {
+				printf("  Out of memory\n");
+				free(tile);
+				return 1;
+			}
+			t = seconds() - t0;
+			if(t < best) best = t;
+		}
+		printf("  %4d x %4d x %3d, %d octave%s, %-7s %9.2f ms %8.1f Mtexels/s\n",
+			width, height, (depth > 0) ? depth : 1, octaves, (octaves > 1) ? "s" : " ",
+			formatNames[format], 1e3 * best, texels / best * 1e-6);
+	}
+
+	maxdiff = checkTile(tile, width, height, depth, &params);
+	printf("  largest difference from the octave sum and across the edges %.2e%s\n",
+		maxdiff, (maxdiff > CHECK_EPSILON) ? "  FAILED" : "");
+	failed += (maxdiff > CHECK_EPSILON);
+	for(i = 0, same = 1; i < texels; i++) {
+		v = 0.5f + 0.5f * tile[i];
+		v = (v < 0.0f) ? 0.0f : ((v > 1.0f) ? 1.0f : v);
+		same = same && half[i] == noiseFloatToHalf(tile[i])
+			&& unorm[i] == (unsigned char)(v * 255.0f + 0.5f);
+	}
+	if(!same) printf("  the float16 or unorm8 tile is not the float tile converted  FAILED\n");
+	failed += !same;
+
+	// Channel 2 of an RGBA image, the other channels must stay as they were
+	memset(rgba, 0x5a, texels * 4);
+	params.format = NOISE_FORMAT_UNORM8;
+	params.channels = 4;
+	same = (bake(rgba + 2, width, height, depth, &params) == 0);
+	for(i = 0; i < texels; i++) {
+		same = same && rgba[4 * i + 2] == unorm[i]
+			&& rgba[4 * i] == 0x5a && rgba[4 * i + 1] == 0x5a && rgba[4 * i + 3] == 0x5a;
+	}
+	if(!same) printf("  the tile baked into one channel of RGBA is wrong  FAILED\n");
+	failed += !same;
+	free(tile);
+	return failed;
+}
+
+int main(int argc, char *argv[]) {
+	noiseBakeParams params;
+	int size = (argc > 1) ? atoi(argv[1]) : 1024, octaves, failed = 0;
+	float dummy = 0.0f;
+
+	if(size < 8) size = 8;
+	printf("Tileable noise, %s kernels\n", noiseISAName(noiseGetISA()));
+	for(octaves = 1; octaves <= 4; octaves += 3) {
+		failed += benchTile(size, size, 0, octaves);
+		failed += benchTile(size / 8, size / 8, size / 8, octaves);
+	}
+
+	noiseBakeDefaults(&params);
+	if(noiseBakeTile2D(&dummy, 0, 1, &params) != -1
+		|| noiseBakeTile3D(&dummy, 1, 1, 0, &params) != -1) {
+		printf("A tile of no size was not an error  FAILED\n");
+		failed++;
+	}
+	if(failed > 0) printf("%d checks failed\n", failed);
+	return (failed > 0) ? 1 : 0;
+}
@@ -0,0 +1,92 @@
+/*
+ * noisefieldbench.c - throughput of the tiled noise field generator
+ * against the number of threads, in millions of samples per second.
+ *
+ * Usage: noisefieldbench [maxthreads [width height]]
+ *
+ * Generates a width x height field of 3D simplex noise and of 8 octave
+ * fBm with 1, 2, 4 ... maxthreads threads (default: all online CPUs),
+ * and checks that every thread count gives the same result as one thread.
+ *
+ * This code is in the public domain.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+#include "cpuNoise.h"
+
+/*
+ * bestTime() - the fastest of a few runs, after one warm-up run
+ */
+static double bestTime(noisePool *pool, float *dst, const noiseFieldParams *params,
+	noiseFieldKernel kernel, void *user) {
+	double t0, t, best = 1e30;
+	int r;
+
+	noiseFieldGenerate(pool, dst, params, kernel, user);
+	for(r = 0; r < 3; r++) {
+		t0 = seconds();
+		noiseFieldGenerate(pool, dst, params, kernel, user);
+		t = seconds() - t0;
+		if(t < best) best = t;
+	}
+	return best;
+}
+
+int main(int argc, char *argv[]) {
+	noiseFieldParams params;
+	noiseFbmParams fbm;
+	noisePool *pool;
+	float *field, *reference;
+	double samples, t, base[2];
+	int maxthreads, threads, width, height, k, same;
+	const char *names[2] = { "simplex3", "fbm3 x8" };
+	noiseFieldKernel kernels[2] = { noiseFieldSimplex3, noiseFieldFractal3 };
+
+	maxthreads = (argc > 1) ? atoi(argv[1]) : 0;
+	width = (argc > 3) ? atoi(argv[2]) : 4096;
+	height = (argc > 3) ? atoi(argv[3]) : 2048;
+	if(maxthreads <= 0) {
+		pool = noisePoolCreate(0);
+		maxthreads = pool ? noisePoolThreads(pool) : 1;
+		noisePoolDestroy(pool);
+	}
+
+	noiseFieldDefaults(&params, width, height, 1);
+	params.step[0] = params.step[1] = 1.0f / 256.0f;
+	noiseFbmDefaults(&fbm);
+	samples = (double)width * height;
+	field = (float*)malloc(samples * sizeof(float));
+	reference = (float*)malloc(samples * sizeof(float));
+	if(field == NULL || reference == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+
+	printf("%dx%d field, %dx%d tiles, %s kernels\n", width, height,
+		params.tilesize, params.tilesize, noiseISAName(noiseGetISA()));
+	printf("threads  kernel      Msamples/s  speedup  same\n");
+	for(threads = 1; threads <= maxthreads; threads = (threads * 2 > maxthreads
+		&& threads < maxthreads) ? maxthreads : threads * 2) {
+		pool = noisePoolCreate(threads);
+		if(pool == NULL) {
+			fprintf(stderr, "Could not start %d threads\n", threads);
+			return 1;
+		}
+		for(k = 0; k < 2; k++) {
+			noiseFieldGenerate(NULL, reference, &params, kernels[k], &fbm);
+			t = bestTime(pool, field, &params, kernels[k], &fbm);
+			if(threads == 1) base[k] = t;
+			same = (memcmp(field, reference, samples * sizeof(float)) == 0);
+			printf("%7d  %-10s  %10.1f  %7.2f  %s\n", threads, names[k],
+				samples / t * 1e-6, base[k] / t, same ? "yes" : "NO");
+		}
+		noisePoolDestroy(pool);
+	}
+	free(field);
+	free(reference);
+	return 0;
+}
@@ -0,0 +1,263 @@
+/*
+ * noisegraphbench.c - a compiled noise graph against the same graph
+ * evaluated one node at a time into full size buffers.
+ *
+ * Usage: noisegraphbench [threads [width height]]
+ *
+ * The graph follows the terrain chain of Lab4/mountains.tgd: a fractal
+ * warp of the position, a ridged power fractal on the warped position,
+ * the displacement amplitude, and the altitude limit and colour mix of
+ * a surface layer. The node by node version computes each node for the
+ * whole image with the batch functions of the library, one buffer per
+ * node, the way a straight port of the node network would. The compiled
+ * version runs the whole chain per SIMD step through noiseFieldGenerate(),
+ * and writes nothing but the output. Both run on one thread first, and
+ * the compiled graph then also on a pool of threads.
+ *
+ * This code is in the public domain.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "bench.h"
+#include "cpuNoise.h"
+
+#define MAXNODES 16
+
+/* A graph, with its nodes kept here as well for the node by node evaluation */
+typedef struct {
+	const char *name;
+	noiseNode nodes[MAXNODES];
+	int count, output;
+	noiseGraph *graph;
+} benchGraph;
+
+static int addNode(benchGraph *g, noiseNodeOp op, int a, int b, int c,
+	float v0, float v1, float v2) {
+	noiseNode *node = &g->nodes[g->count];
+
+	noiseNodeInit(node, op);
+	node->in[0] = a; node->in[1] = b; node->in[2] = c;
+	node->value[0] = v0; node->value[1] = v1; node->value[2] = v2;
+	if(op == NOISE_NODE_WARP) node->fbm.octaves = 4;
+	if(op == NOISE_NODE_FBM) node->fbm.type = NOISE_FRACTAL_RIDGED;
+	g->count++;
+	return noiseGraphAdd(g->graph, node);
+}
+
+/* The terrain of mountains.tgd, 20 octaves of noise per sample */
+static int buildTerrain(benchGraph *g) {
+	int x, y, z, wx, wy, wz, h, alt, cover, lo, hi;
+
+	x = addNode(g, NOISE_NODE_X, -1, -1, -1, 0.0f, 0.0f, 0.0f);
+	y = addNode(g, NOISE_NODE_Y, -1, -1, -1, 0.0f, 0.0f, 0.0f);
+	z = addNode(g, NOISE_NODE_Z, -1, -1, -1, 0.0f, 0.0f, 0.0f);
+	// Fractal warp shader: scale 1000 against a feature scale of 5000
+	wx = addNode(g, NOISE_NODE_WARP, x, y, z, 5.0f, 0.25f, 0.0f);
+	wy = addNode(g, NOISE_NODE_WARP, x, y, z, 5.0f, 0.25f, 1.0f);
+	wz = addNode(g, NOISE_NODE_WARP, x, y, z, 5.0f, 0.25f, 2.0f);
+	// Power fractal, ridged, displacement amplitude 2000
+	h = addNode(g, NOISE_NODE_FBM, wx, wy, wz, 1.0f, 0.0f, 0.0f);
+	alt = addNode(g, NOISE_NODE_MAD, h, -1, -1, 2000.0f, 0.0f, 0.0f);
+	// Surface layer: minimum altitude 300 with a fuzzy zone of 200
+	cover = addNode(g, NOISE_NODE_SMOOTHSTEP, alt, -1, -1, 200.0f, 400.0f, 0.0f);
+	lo = addNode(g, NOISE_NODE_CONST, -1, -1, -1, 0.3f, 0.0f, 0.0f);
+	hi = addNode(g, NOISE_NODE_CONST, -1, -1, -1, 0.8913f, 0.0f, 0.0f);
+	return addNode(g, NOISE_NODE_MIX, lo, hi, cover, 0.0f, 0.0f, 0.0f);
+}
+
+/* Six cheap nodes on one octave of noise, where memory traffic matters */
+static int buildLight(benchGraph *g) {
+	int x, y, z, n, m, s, a, c;
+
+	x = addNode(g, NOISE_NODE_X, -1, -1, -1, 0.0f, 0.0f, 0.0f);
+	y = addNode(g, NOISE_NODE_Y, -1, -1, -1, 0.0f, 0.0f, 0.0f);
+	z = addNode(g, NOISE_NODE_Z, -1, -1, -1, 0.0f, 0.0f, 0.0f);
+	n = addNode(g, NOISE_NODE_NOISE, x, y, z, 4.0f, 0.0f, 0.0f);
+	m = addNode(g, NOISE_NODE_MAD, n, -1, -1, 0.5f, 0.5f, 0.0f);
+	s = addNode(g, NOISE_NODE_SMOOTHSTEP, m, -1, -1, 0.3f, 0.7f, 0.0f);
+	a = addNode(g, NOISE_NODE_ABS, n, -1, -1, 0.0f, 0.0f, 0.0f);
+	c = addNode(g, NOISE_NODE_CLAMP, a, -1, -1, 0.0f, 0.6f, 0.0f);
+	return addNode(g, NOISE_NODE_MIX, s, c, m, 0.0f, 0.0f, 0.0f);
+}
+
+/*
+ * evaluateNodes() - every node for all n points, into buf[node]. x, y, z
+ * and fw are full size inputs too, and t[3] full size scratch buffers.
+ */
+static void evaluateNodes(const benchGraph *g, float **buf, float **t, const float *x,
+	const float *y, const float *z, const float *fw, int n) {
+	const noiseNode *node;
+	float *a, *b, *c, *o, f, v, off;
+	int i, k;
+
+	for(k = 0; k < g->count; k++) {
+		node = &g->nodes[k];
+		o = buf[k];
+		a = (node->in[0] >= 0) ? buf[node->in[0]] : NULL;
+		b = (node->in[1] >= 0) ? buf[node->in[1]] : NULL;
+		c = (node->in[2] >= 0) ? buf[node->in[2]] : NULL;
+		f = node->value[0];
+		switch(node->op) {
+			case NOISE_NODE_X: for(i = 0; i < n; i++) o[i] = x[i]; break;
+			case NOISE_NODE_Y: for(i = 0; i < n; i++) o[i] = y[i]; break;
+			case NOISE_NODE_Z: for(i = 0; i < n; i++) o[i] = z[i]; break;
+			case NOISE_NODE_CONST: for(i = 0; i < n; i++) o[i] = f; break;
+			case NOISE_NODE_ABS: for(i = 0; i < n; i++) o[i] = fabsf(a[i]); break;
+			case NOISE_NODE_MAD:
+				for(i = 0; i < n; i++) o[i] = a[i] * f + node->value[1];
+				break;
+			case NOISE_NODE_SMOOTHSTEP:
+				for(i = 0; i < n; i++) {
+					v = (a[i] - node->value[0]) / (node->value[1] - node->value[0]);
+					v = (v < 0.0f) ? 0.0f : (v > 1.0f) ? 1.0f : v;
+					o[i] = v * v * (3.0f - 2.0f * v);
+				}
+				break;
+			case NOISE_NODE_CLAMP:
+				for(i = 0; i < n; i++) {
+					v = (a[i] < node->value[0]) ? node->value[0] : a[i];
+					o[i] = (v > node->value[1]) ? node->value[1] : v;
+				}
+				break;
+			case NOISE_NODE_NOISE:
+				for(i = 0; i < n; i++) {
+					t[0][i] = a[i] * f;
+					t[1][i] = b[i] * f;
+					t[2][i] = c[i] * f;
+				}
+				noiseSimplex3(t[0], t[1], t[2], o, n);
+				break;
+			case NOISE_NODE_MIX:
+				for(i = 0; i < n; i++) o[i] = a[i] + (b[i] - a[i]) * c[i];
+				break;
+			case NOISE_NODE_FBM:
+			case NOISE_NODE_WARP:
+				off = (node->op == NOISE_NODE_WARP) ? 17.0f * (node->value[2] + 1.0f) : 0.0f;
+				for(i = 0; i < n; i++) {
+					t[0][i] = a[i] * f + off;
+					t[1][i] = b[i] * f + off;
+					t[2][i] = c[i] * f + off;
+					o[i] = fw[i] * f;
+				}
+				noiseFractal3(t[0], t[1], t[2], o, &node->fbm, o, n);
+				if(node->op == NOISE_NODE_WARP) {
+					v = node->value[1];
+					c = (node->value[2] == 0.0f) ? a : (node->value[2] == 1.0f) ? b : c;
+					for(i = 0; i < n; i++) o[i] = c[i] + v * o[i];
+				}
+				break;
+			default:
+				break;
+		}
+	}
+}
+
+/*
+ * runGraph() - time both versions of one graph and print a table row for
+ * each. The buffers hold everything the node by node version needs.
+ */
+static void runGraph(benchGraph *g, const noiseFieldParams *params, noisePool *pool,
+	float *fused, float **buf, float **t, float *x, float *y, float *z, float *fw) {
+	double t0, time, best[3], samples, diff, maxdiff, mb;
+	int i, j, r, width = params->width, height = params->height;
+
+	samples = (double)width * height;
+	best[0] = best[1] = best[2] = 1e30;
+	for(r = 0; r < 4; r++) {
+		// Node by node, starting from full size coordinate buffers
+		t0 = seconds();
+		for(j = 0; j < height; j++) {
+			for(i = 0; i < width; i++) {
+				x[(size_t)j * width + i] = params->origin[0] + i * params->step[0];
+				y[(size_t)j * width + i] = params->origin[1] + j * params->step[1];
+				z[(size_t)j * width + i] = params->origin[2];
+				fw[(size_t)j * width + i] = params->step[0];
+			}
+		}
+		evaluateNodes(g, buf, t, x, y, z, fw, (int)samples);
+		time = seconds() - t0;
+		if(r > 0 && time < best[0]) best[0] = time;
+
+		t0 = seconds();
+		noiseFieldGenerate(NULL, fused, params, noiseFieldGraph, g->graph);
+		time = seconds() - t0;
+		if(r > 0 && time < best[1]) best[1] = time;
+	}
+	maxdiff = 0.0;
+	for(i = 0; i < (int)samples; i++) {
+		diff = fabs(fused[i] - buf[g->output][i]);
+		if(diff > maxdiff) maxdiff = diff;
+	}
+	if(pool) {
+		for(r = 0; r < 4; r++) {
+			t0 = seconds();
+			noiseFieldGenerate(pool, fused, params, noiseFieldGraph, g->graph);
+			time = seconds() - t0;
+			if(r > 0 && time < best[2]) best[2] = time;
+		}
+	}
+
+	mb = samples * sizeof(float) / 1048576.0;
+	printf("%-8s %-19s %10.2f %8s %13.1f\n", g->name, "node by node",
+		samples / best[0] * 1e-6, "1.00", (4 + g->count + 3) * mb);
+	printf("%-8s %-19s %10.2f %8.2f %13.1f\n", g->name, "compiled, 1 thread",
+		samples / best[1] * 1e-6, best[0] / best[1], mb);
+	if(pool) {
+		printf("%-8s compiled, %2d threads %10.2f %8.2f %13.1f\n", g->name,
+			noisePoolThreads(pool), samples / best[2] * 1e-6, best[0] / best[2], mb);
+	}
+	printf("%-8s max difference %g\n", g->name, maxdiff);
+}
+
+int main(int argc, char *argv[]) {
+	static benchGraph graphs[2] = { { "terrain" }, { "light" } };
+	int (*builders[2])(benchGraph*) = { buildTerrain, buildLight };
+	noiseFieldParams params;
+	noisePool *pool;
+	float *x, *y, *z, *fw, *fused, *buf[MAXNODES], *t[3];
+	size_t samples;
+	int threads, width, height, i, k;
+
+	threads = (argc > 1) ? atoi(argv[1]) : 0;
+	width = (argc > 3) ? atoi(argv[2]) : 1024;
+	height = (argc > 3) ? atoi(argv[3]) : 1024;
+	samples = (size_t)width * height;
+	for(k = 0; k < 2; k++) {
+		graphs[k].graph = noiseGraphCreate();
+		graphs[k].output = graphs[k].graph ? builders[k](&graphs[k]) : -1;
+		if(graphs[k].output < 0 || noiseGraphCompile(graphs[k].graph, graphs[k].output) != 0) {
+			fprintf(stderr, "Could not build the %s graph\n", graphs[k].name);
+			return 1;
+		}
+	}
+	noiseFieldDefaults(&params, width, height, 1);
+	params.origin[2] = 0.5f;
+	params.step[0] = params.step[1] = 1.0f / 256.0f;
+
+	x = (float*)malloc((8 + MAXNODES) * samples * sizeof(float));
+	if(x == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+	y = x + samples;
+	z = y + samples;
+	fw = z + samples;
+	fused = fw + samples;
+	for(i = 0; i < 3; i++) t[i] = fused + samples * (i + 1);
+	for(i = 0; i < MAXNODES; i++) buf[i] = t[2] + samples * (i + 1);
+	pool = noisePoolCreate(threads);
+
+	printf("%dx%d, %s kernels\n", width, height, noiseISAName(noiseGetISA()));
+	printf("%-8s %-19s %10s %8s %13s\n", "graph", "", "Msamples/s", "speedup", "buffers (MB)");
+	for(k = 0; k < 2; k++) {
+		runGraph(&graphs[k], &params, pool, fused, buf, t, x, y, z, fw);
+		noiseGraphDestroy(graphs[k].graph);
+	}
+
+	noisePoolDestroy(pool);
+	free(x);
+	return 0;
+}
@@ -0,0 +1,373 @@
+/*
+ * noisehashbench.c - compare the lattice hash policies of cpuNoiseHash.h:
+ * the Ashima mod289() polynomial, a permutation table and an integer hash.
+ *
+ * Usage: noisehashbench [samples]
+ *
+ * For every instruction set the CPU supports, the throughput of 2D, 3D
+ * and 4D simplex noise and 3D classic noise is measured with each policy.
+ * Then the drift of 3D simplex noise far from the origin is measured: for
+ * points at increasing distances, the float kernels are compared with a
+ * double precision evaluation of the same noise with the same hash, from
+ * the same float input coordinates. The difference is therefore only the
+ * precision lost inside the noise function, not in the input. The large
+ * coordinate kernels (noiseSimplex3Large()) are compared the same way,
+ * with the offset as the cell and the exact points as the reference.
+ * Last, every instruction set path is checked against the scalar kernels
+ * with the same hash, which are the line-by-line port of the GLSL code:
+ * all kernels without octaves must agree to within NOISE_EPSILON for
+ * coordinates within +/-16, as cpuNoise.h promises. The program exits
+ * with status 1 if any of them does not.
+ *
+ * This program links all twelve kernel tables directly, see the
+ * noisehashbench target in the Makefile.
+ *
+ * This code is in the public domain.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "bench.h"
+#include "cpuNoise.h"
+#include "cpuNoiseKernels.h"
+// For noisePermTable, the table used by the kernels
+#define CPUNOISE_HASH_TABLE
+#include "cpuNoiseHash.h"
+
+extern const noiseKernelTable noiseKernelsScalar, noiseKernelsSSE41,
+	noiseKernelsAVX2, noiseKernelsAVX512;
+extern const noiseKernelTable noiseKernelsScalarTable, noiseKernelsSSE41Table,
+	noiseKernelsAVX2Table, noiseKernelsAVX512Table;
+extern const noiseKernelTable noiseKernelsScalarInt, noiseKernelsSSE41Int,
+	noiseKernelsAVX2Int, noiseKernelsAVX512Int;
+
+enum { HASH_ASHIMA, HASH_TABLE, HASH_INTEGER, HASH_COUNT };
+
+static const noiseKernelTable *tables[NOISE_ISA_COUNT][HASH_COUNT] = {
+	{ &noiseKernelsScalar, &noiseKernelsScalarTable, &noiseKernelsScalarInt },
+	{ &noiseKernelsSSE41, &noiseKernelsSSE41Table, &noiseKernelsSSE41Int },
+	{ &noiseKernelsAVX2, &noiseKernelsAVX2Table, &noiseKernelsAVX2Int },
+	{ &noiseKernelsAVX512, &noiseKernelsAVX512Table, &noiseKernelsAVX512Int }
+};
+
+/*
+ * The reference: snoise(vec3) from noise3D.glsl in double precision,
+ * with each of the three hashes computed exactly.
+ */
+/* x mod 289 for whole numbers x, exactly */
+static double dmod289(double x) {
+	return (double)(((long long)x % 289 + 289) % 289);
+}
+
+static double dlattice(int hash, double x) {
+	return (hash == HASH_INTEGER) ? x : dmod289(x);
+}
+
+static double dpermute(int hash, double x) {
+	unsigned int h;
+
+	switch(hash) {
+		case HASH_TABLE:
+			return noisePermTable[(int)dmod289(x)];
+		case HASH_INTEGER:
+			h = (unsigned int)(int)x ^ 0x9e3779b9U;
+			h ^= h >> 16;
+			h *= 0x7feb352dU;
+			h ^= h >> 15;
+			h *= 0x846ca68bU;
+			h ^= h >> 16;
+			return (double)(((h >> 16) * 289) >> 16);
+		default:
+			return dmod289((x * 34.0 + 1.0) * x);
+	}
+}
+
+/*
+ * gradient3() - the gradient for hash value p, computed in single
+ * precision exactly like the GLSL code and the kernels. The mapping has
+ * a few exact ties (h == 0) that single precision happens to resolve in
+ * its own way, and those choices are part of the gradient set.
+ */
+static void gradient3(double p, double *gx, double *gy, double *gz) {
+	const float ns = 0.142857142857f;
+	float j, x_, y_, x, y, h;
+
+	j = (float)p - 49.0f * floorf((float)p * ns * ns);
+	x_ = floorf(j * ns);
+	y_ = floorf(j - 7.0f * x_);
+	x = x_ * (2.0f * ns) + (0.5f * ns - 1.0f);
+	y = y_ * (2.0f * ns) + (0.5f * ns - 1.0f);
+	h = 1.0f - fabsf(x) - fabsf(y);
+	if(h <= 0.0f) {
+		x -= (x < 0.0f) ? -1.0f : 1.0f;
+		y -= (y < 0.0f) ? -1.0f : 1.0f;
+	}
+	*gx = x; *gy = y; *gz = h;
+}
+
+static double refSimplex3(int hash, double vx, double vy, double vz) {
+	const double Cx = 1.0 / 6.0, Cy = 1.0 / 3.0;
+	double s, ix, iy, iz, t, x0[3], g[3], l[3], i1[3], i2[3], X[4][3];
+	double o[4][3], p, gx, gy, h, m, n = 0.0;
+	int c, k;
+
+	s = (vx + vy + vz) * Cy;
+	ix = floor(vx + s); iy = floor(vy + s); iz = floor(vz + s);
+	t = (ix + iy + iz) * Cx;
+	x0[0] = vx - ix + t; x0[1] = vy - iy + t; x0[2] = vz - iz + t;
+	g[0] = (x0[0] >= x0[1]); g[1] = (x0[1] >= x0[2]); g[2] = (x0[2] >= x0[0]);
+	for(k = 0; k < 3; k++) l[k] = 1.0 - g[k];
+	i1[0] = fmin(g[0], l[2]); i1[1] = fmin(g[1], l[0]); i1[2] = fmin(g[2], l[1]);
+	i2[0] = fmax(g[0], l[2]); i2[1] = fmax(g[1], l[0]); i2[2] = fmax(g[2], l[1]);
+	for(k = 0; k < 3; k++) {
+		X[0][k] = x0[k];
+		X[1][k] = x0[k] - i1[k] + Cx;
+		X[2][k] = x0[k] - i2[k] + Cy;
+		X[3][k] = x0[k] - 0.5;
+		o[0][k] = 0.0; o[1][k] = i1[k]; o[2][k] = i2[k]; o[3][k] = 1.0;
+	}
+	ix = dlattice(hash, ix); iy = dlattice(hash, iy); iz = dlattice(hash, iz);
+	for(c = 0; c < 4; c++) {
+		p = dpermute(hash, dpermute(hash, dpermute(hash, iz + o[c][2]) + iy + o[c][1])
+			+ ix + o[c][0]);
+		gradient3(p, &gx, &gy, &h);
+		m = 0.6 - (X[c][0] * X[c][0] + X[c][1] * X[c][1] + X[c][2] * X[c][2]);
+		if(m > 0.0) {
+			m = m * m;
+			n += m * m * (1.79284291400159 - 0.85373472095314 * (gx * gx + gy * gy + h * h))
+				* (gx * X[c][0] + gy * X[c][1] + h * X[c][2]);
+		}
+	}
+	return 42.0 * n;
+}
+
+static double bestTime(void (*run)(const noiseKernelTable*, float**, int),
+	const noiseKernelTable *k, float **arrays, int n) {
+	double t0, t, best = 1e30;
+	int r;
+
+	run(k, arrays, n); // Warm up
+	for(r = 0; r < 5; r++) {
+		t0 = seconds();
+		run(k, arrays, n);
+		t = seconds() - t0;
+		if(t < best) best = t;
+	}
+	return best;
+}
+
+static void runSimplex2(const noiseKernelTable *k, float **a, int n) {
+	k->simplex2(a[0], a[1], a[4], n);
+}
+static void runSimplex3(const noiseKernelTable *k, float **a, int n) {
+	k->simplex3(a[0], a[1], a[2], a[4], n);
+}
+static void runSimplex4(const noiseKernelTable *k, float **a, int n) {
+	k->simplex4(a[0], a[1], a[2], a[3], a[4], n);
+}
+static void runClassic3(const noiseKernelTable *k, float **a, int n) {
+	k->classic3(a[0], a[1], a[2], a[4], n);
+}
+
+/* The other kernels that NOISE_EPSILON covers, for the check against scalar */
+static const float period[4] = { 5.0f, 7.0f, 16.0f, 3.0f };
+
+static void runSimplex4Frames(const noiseKernelTable *k, float **a, int n) {
+	k->simplex4frames(a[0], a[1], a[2], n / 4, a[3], 4, a[4]); // 4 frames, t from w
+}
+static void runSimplex2Deriv(const noiseKernelTable *k, float **a, int n) {
+	k->simplex2deriv(a[0], a[1], a[4], a[5], a[6], n);
+}
+static void runSimplex3Deriv(const noiseKernelTable *k, float **a, int n) {
+	k->simplex3deriv(a[0], a[1], a[2], a[4], a[5], a[6], a[7], n);
+}
+static void runSimplex4Deriv(const noiseKernelTable *k, float **a, int n) {
+	k->simplex4deriv(a[0], a[1], a[2], a[3], a[4], a[5], a[6], a[7], a[8], n);
+}
+static void runClassic2(const noiseKernelTable *k, float **a, int n) {
+	k->classic2(a[0], a[1], a[4], n);
+}
+static void runClassic4(const noiseKernelTable *k, float **a, int n) {
+	k->classic4(a[0], a[1], a[2], a[3], a[4], n);
+}
+static void runPeriodic2(const noiseKernelTable *k, float **a, int n) {
+	k->periodic2(a[0], a[1], period, a[4], n);
+}
+static void runPeriodic3(const noiseKernelTable *k, float **a, int n) {
+	k->periodic3(a[0], a[1], a[2], period, a[4], n);
+}
+static void runPeriodic4(const noiseKernelTable *k, float **a, int n) {
+	k->periodic4(a[0], a[1], a[2], a[3], period, a[4], n);
+}
+
+static const struct {
+	const char *name;
+	void (*run)(const noiseKernelTable*, float**, int);
+} checks[] = {
+	{ "simplex2", runSimplex2 }, { "simplex3", runSimplex3 }, { "simplex4", runSimplex4 },
+	{ "simplex4frames", runSimplex4Frames }, { "simplex2deriv", runSimplex2Deriv },
+	{ "simplex3deriv", runSimplex3Deriv }, { "simplex4deriv", runSimplex4Deriv },
+	{ "classic2", runClassic2 }, { "classic3", runClassic3 }, { "classic4", runClassic4 },
+	{ "periodic2", runPeriodic2 }, { "periodic3", runPeriodic3 }, { "periodic4", runPeriodic4 }
+};
+#define NCHECKS ((int)(sizeof(checks) / sizeof(checks[0])))
+
+/*
+ * checkScalar() - run every kernel in checks[] on n points within +/-16,
+ * half of them on a grid of 1/64 that hits the lattice and its edges
+ * exactly, with each path and hash, and compare the values with those
+ * of the scalar kernels. Returns the number of paths that differ by more
+ * than NOISE_EPSILON.
+ */
+static int checkScalar(int n, int best) {
+	float *a[9], *ref;
+	unsigned int seed = 12345;
+	double err, maxerr;
+	int i, k, c, isa, hash, worst, failed = 0;
+
+	n &= ~3; // Whole frames for simplex4frames
+	a[0] = (float*)malloc(10 * (size_t)n * sizeof(float));
+	if(n < 4 || a[0] == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		free(a[0]);
+		return 1;
+	}
+	for(k = 1; k < 9; k++) a[k] = a[k - 1] + n;
+	ref = a[8] + n;
+	for(i = 0; i < n; i++) {
+		for(k = 0; k < 4; k++) {
+			seed = seed * 1664525u + 1013904223u;
+			a[k][i] = (i & 1) ? (float)((int)(seed >> 20) - 2048) / 128.0f
+				: 32.0f * (float)(seed >> 8) / 16777216.0f - 16.0f;
+		}
+	}
+
+	printf("\nLargest difference from the scalar kernels with the same hash, for"
+		" coordinates\nwithin +/-16, over %d points (at most NOISE_EPSILON = %.0e)\n",
+		n, (double)NOISE_EPSILON);
+	printf("%-7s %-8s %10s  %-14s\n", "isa", "hash", "max diff", "worst kernel");
+	for(isa = 1; isa <= best; isa++) {
+		if(noiseSetISA((noiseISA)isa) != (noiseISA)isa) continue;
+		for(hash = 0; hash < HASH_COUNT; hash++) {
+			maxerr = 0.0;
+			worst = 0;
+			for(c = 0; c < NCHECKS; c++) {
+				checks[c].run(tables[NOISE_ISA_SCALAR][hash], a, n);
+				memcpy(ref, a[4], n * sizeof(float));
+				checks[c].run(tables[isa][hash], a, n);
+				for(i = 0; i < n; i++) {
+					err = fabs((double)a[4][i] - ref[i]);
+					if(err > maxerr || err != err) {
+						maxerr = (err != err) ? 1e30 : err;
+						worst = c;
+					}
+				}
+			}
+			printf("%-7s %-8s %10.2e  %-14s%s\n", tables[isa][hash]->name, tables[isa][hash]->hash,
+				maxerr, checks[worst].name, (maxerr > NOISE_EPSILON) ? "  FAILED" : "");
+			if(maxerr > NOISE_EPSILON) failed++;
+		}
+	}
+	free(a[0]);
+	return failed;
+}
+
+int main(int argc, char *argv[]) {
+	static const char *hashNames[HASH_COUNT] = { "ashima", "table", "integer" };
+	static const double offsets[] = { 0.0, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e9 };
+	void (*runs[4])(const noiseKernelTable*, float**, int) =
+		{ runSimplex2, runSimplex3, runSimplex4, runClassic3 };
+	float *arrays[5];
+	double *p[3], local[3], t, err, maxerr;
+	long long cell[3];
+	int n, i, k, isa, hash, f, o, best, large, failed;
+
+	n = (argc > 1) ? atoi(argv[1]) : (1 << 20);
+	if(n < 1) n = 1;
+	arrays[0] = (float*)malloc(5 * (size_t)n * sizeof(float));
+	if(arrays[0] == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+	for(i = 1; i < 5; i++) arrays[i] = arrays[i - 1] + n;
+	p[0] = (double*)malloc(3 * 4096 * sizeof(double));
+	if(p[0] == NULL) {
+		fprintf(stderr, "Out of memory\n");
+		return 1;
+	}
+	p[1] = p[0] + 4096;
+	p[2] = p[1] + 4096;
+	for(i = 0; i < n; i++) {
+		arrays[0][i] = (i % 1024) / 64.0f;
+		arrays[1][i] = (i / 1024) / 64.0f;
+		arrays[2][i] = 0.5f + 0.001f * (i / 1024);
+		arrays[3][i] = 0.25f + 0.002f * (i / 1024);
+	}
+
+	printf("Throughput, Msamples/s, %d samples, one thread\n", n);
+	printf("%-7s %-8s %9s %9s %9s %9s\n", "isa", "hash", "simplex2", "simplex3",
+		"simplex4", "classic3");
+	best = noiseDetectISA();
+	for(isa = 0; isa <= best; isa++) {
+		if(noiseSetISA((noiseISA)isa) != (noiseISA)isa) continue;
+		for(hash = 0; hash < HASH_COUNT; hash++) {
+			printf("%-7s %-8s", tables[isa][hash]->name, tables[isa][hash]->hash);
+			for(f = 0; f < 4; f++) {
+				t = bestTime(runs[f], tables[isa][hash], arrays, n);
+				printf(" %9.1f", n / t * 1e-6);
+			}
+			printf("\n");
+		}
+	}
+
+	// Drift: a 64x64 grid of points 1/64 apart, around each offset
+	n = (n < 4096) ? n : 4096;
+	printf("\nDrift of 3D simplex noise from a double precision reference"
+		" with the same hash,\n%s kernels, max absolute error, for float"
+		" coordinates and for\nthe large coordinate kernels\n", noiseISAName((noiseISA)best));
+	printf("%-9s", "offset");
+	for(hash = 0; hash < HASH_COUNT; hash++) printf(" %-19s", hashNames[hash]);
+	printf("\n%-9s", "");
+	for(hash = 0; hash < HASH_COUNT; hash++) printf(" %-9s %-9s", "float", "large");
+	printf("\n");
+	for(o = 0; o < (int)(sizeof(offsets) / sizeof(offsets[0])); o++) {
+		printf("%-9.0e", offsets[o]);
+		cell[0] = cell[1] = cell[2] = (long long)offsets[o];
+		for(hash = 0; hash < HASH_COUNT; hash++) {
+			for(large = 0; large < 2; large++) {
+				for(i = 0; i < n; i++) {
+					local[0] = (i % 64) / 64.0;
+					local[1] = (i / 64) / 64.0;
+					local[2] = 0.37;
+					for(k = 0; k < 3; k++) {
+						// The float kernels see the rounded point, the large ones the exact point
+						arrays[k][i] = large ? (float)local[k] : (float)(offsets[o] + local[k]);
+						p[k][i] = large ? offsets[o] + local[k] : arrays[k][i];
+					}
+				}
+				if(large) {
+					tables[best][hash]->simplex3large(cell, arrays[0], arrays[1], arrays[2],
+						arrays[4], n);
+				}
+				else {
+					tables[best][hash]->simplex3(arrays[0], arrays[1], arrays[2], arrays[4], n);
+				}
+				maxerr = 0.0;
+				for(i = 0; i < n; i++) {
+					err = fabs(arrays[4][i] - refSimplex3(hash, p[0][i], p[1][i], p[2][i]));
+					if(err > maxerr) maxerr = err;
+				}
+				printf(" %9.2e", maxerr);
+			}
+		}
+		printf("\n");
+	}
+	free(p[0]);
+	free(arrays[0]);
+
+	failed = checkScalar(1 << 16, best);
+	return (failed > 0) ? 1 : 0;
+}
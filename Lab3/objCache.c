@@ -0,0 +1,225 @@
+/*
+ * objCache.c - .soup cache files for OBJ meshes. See objCache.h.
+ *
+ * This code is in the public domain.
+ */
+
+#include <stdio.h>    // For fopen(), fwrite(), rename() and remove()
+#include <stdlib.h>   // For malloc() and free()
+#include <string.h>   // For memset(), memcmp() and strlen()
+
+#include "mappedFile.h"
+#include "objCache.h"
+
+// Alignment of the vertex and index blocks in the file
+#define OBJ_CACHE_ALIGN 64
+
+static unsigned long long alignUp(unsigned long long n) {
+	return (n + OBJ_CACHE_ALIGN - 1) & ~(unsigned long long)(OBJ_CACHE_ALIGN - 1);
+}
+
+int objCacheName(char *dst, size_t size, const char *objname) {
+	size_t n = strlen(objname), stem = n, i;
+
+	for(i = n; i > 0; i--) { // Find the extension, if there is one
+		if(objname[i - 1] == '.') {
+			stem = i - 1;
+			break;
+		}
+		if(objname[i - 1] == '/' || objname[i - 1] == '\\') break;
+	}
+	if(stem + 6 > size) return -1;
+	memcpy(dst, objname, stem);
+	memcpy(dst + stem, ".soup", 6);
+	return 0;
+}
+
+/* Whether the levels of detail in a cache file are sound, see objReadCache() */
+static int lodsFit(const objCacheHeader *header, const char *data, size_t size) {
+	const meshLod *lods = (const meshLod*)(data + header->lodoffset);
+	int i;
+
+	if(header->nlods < 1 || header->nlods > MESH_MAX_LODS || header->nlodindices < 0
+		|| header->lodoffset % OBJ_CACHE_ALIGN || header->lodindexoffset % OBJ_CACHE_ALIGN
+		|| header->lodoffset < header->indexoffset + 3ULL * sizeof(unsigned int) * header->ntris
+		|| header->lodoffset + header->nlods * sizeof(meshLod) > header->lodindexoffset
+		|| header->lodindexoffset + sizeof(unsigned int) * (unsigned long long)header->nlodindices > size) {
+		return 0;
+	}
+	for(i = 0; i < header->nlods; i++) {
+		if(lods[i].first > (unsigned int)header->nlodindices
+			|| lods[i].count > (unsigned int)header->nlodindices - lods[i].first) return 0;
+	}
+	return 1;
+}
+
+int objReadCache(objMesh *mesh, meshLodChain *lods, const char *cachename, const char *objname,
+	int flags) {
+	mappedFile *file;
+	const objCacheHeader *header;
+	unsigned long long size, hash, vertexbytes, indexbytes;
+	long long mtime;
+
+	memset(mesh, 0, sizeof(objMesh));
+	if(flags & OBJ_LODS) memset(lods, 0, sizeof(meshLodChain));
+	if(fileFingerprint(objname, &size, &mtime, &hash) != 0) return -1;
+	file = (mappedFile*)malloc(sizeof(mappedFile));
+	if(file == NULL) return -1;
+	if(mapFile(file, cachename) != 0) {
+		free(file);
+		return -1;
+	}
+	header = (const objCacheHeader*)file->data;
+	if(file->size < sizeof(objCacheHeader) || memcmp(header->magic, "SOUP", 4) != 0
+		|| header->version != OBJ_CACHE_VERSION || header->headersize != sizeof(objCacheHeader)
+		|| header->flags != (unsigned int)flags || header->sourcesize != size
+		|| header->sourcemtime != mtime || header->sourcehash != hash
+		|| header->nverts < 0 || header->ntris < 0) {
+		unmapFile(file);
+		free(file);
+		return -1;
+	}
+	// The blocks must be aligned and inside the file
+	vertexbytes = 8ULL * sizeof(float) * header->nverts;
+	indexbytes = 3ULL * sizeof(unsigned int) * header->ntris;
+	if(header->vertexoffset % OBJ_CACHE_ALIGN || header->indexoffset % OBJ_CACHE_ALIGN
+		|| header->vertexoffset < sizeof(objCacheHeader)
+		|| header->vertexoffset + vertexbytes > header->indexoffset
+		|| header->indexoffset + indexbytes > file->size
+		|| ((flags & OBJ_LODS) && !lodsFit(header, file->data, file->size))) {
+		unmapFile(file);
+		free(file);
+		return -1;
+	}
+	// The levels of detail are copied, so that they can be freed as usual
+	if(flags & OBJ_LODS) {
+		lods->indices = (unsigned int*)malloc(sizeof(unsigned int) * ((size_t)header->nlodindices + 1));
+		if(lods->indices == NULL) {
+			unmapFile(file);
+			free(file);
+			return -1;
+		}
+		memcpy(lods->indices, file->data + header->lodindexoffset, sizeof(unsigned int) * (size_t)header->nlodindices);
+		memcpy(lods->lods, file->data + header->lodoffset, header->nlods * sizeof(meshLod));
+		lods->nindices = header->nlodindices;
+		lods->nlods = header->nlods;
+		memcpy(lods->center, header->lodcenter, sizeof(lods->center));
+		lods->radius = header->lodradius;
+	}
+	mesh->vertexarray = (float*)(file->data + header->vertexoffset);
+	mesh->indexarray = (unsigned int*)(file->data + header->indexoffset);
+	mesh->nverts = header->nverts;
+	mesh->ntris = header->ntris;
+	mesh->numverts = header->numverts;
+	mesh->numnormals = header->numnormals;
+	mesh->numtexcoords = header->numtexcoords;
+	mesh->numfaces = header->numfaces;
+	mesh->mapping = file;
+	return 0;
+}
+
+int objWriteCache(const objMesh *mesh, const meshLodChain *lods, const char *cachename,
+	const char *objname, int flags) {
+	objCacheHeader header;
+	static const char zeros[OBJ_CACHE_ALIGN] = {0};
+	unsigned long long vertexbytes, indexbytes, lodbytes = 0, lodindexbytes = 0;
+	char *tempname;
+	FILE *file;
+	int i, k, ok;
+
+	memset(&header, 0, sizeof(header));
+	if(fileFingerprint(objname, &header.sourcesize, &header.sourcemtime, &header.sourcehash) != 0) {
+		return -1;
+	}
+	memcpy(header.magic, "SOUP", 4);
+	header.version = OBJ_CACHE_VERSION;
+	header.flags = (unsigned int)flags;
+	header.headersize = sizeof(objCacheHeader);
+	header.nverts = mesh->nverts;
+	header.ntris = mesh->ntris;
+	header.numverts = mesh->numverts;
+	header.numnormals = mesh->numnormals;
+	header.numtexcoords = mesh->numtexcoords;
+	header.numfaces = mesh->numfaces;
+	for(k = 0; k < 3; k++) {
+		header.bounds[k] = header.bounds[k + 3] = mesh->nverts ? mesh->vertexarray[k] : 0.0f;
+	}
+	for(i = 1; i < mesh->nverts; i++) {
+		for(k = 0; k < 3; k++) {
+			if(mesh->vertexarray[8 * i + k] < header.bounds[k]) header.bounds[k] = mesh->vertexarray[8 * i + k];
+			if(mesh->vertexarray[8 * i + k] > header.bounds[k + 3]) header.bounds[k + 3] = mesh->vertexarray[8 * i + k];
+		}
+	}
+	vertexbytes = 8ULL * sizeof(float) * mesh->nverts;
+	indexbytes = 3ULL * sizeof(unsigned int) * mesh->ntris;
+	header.vertexoffset = alignUp(sizeof(header));
+	header.indexoffset = alignUp(header.vertexoffset + vertexbytes);
+	header.lodoffset = header.lodindexoffset = alignUp(header.indexoffset + indexbytes);
+	if(flags & OBJ_LODS) {
+		header.nlods = lods->nlods;
+		header.nlodindices = lods->nindices;
+		memcpy(header.lodcenter, lods->center, sizeof(header.lodcenter));
+		header.lodradius = lods->radius;
+		lodbytes = lods->nlods * sizeof(meshLod);
+		lodindexbytes = sizeof(unsigned int) * (unsigned long long)lods->nindices;
+		header.lodindexoffset = alignUp(header.lodoffset + lodbytes);
+	}
+
+	tempname = (char*)malloc(strlen(cachename) + 5);
+	if(tempname == NULL) return -1;
+	strcpy(tempname, cachename);
+	strcat(tempname, ".tmp");
+	file = fopen(tempname, "wb");
+	if(file == NULL) {
+		free(tempname);
+		return -1;
+	}
+	ok = fwrite(&header, sizeof(header), 1, file) == 1
+		&& fwrite(zeros, 1, header.vertexoffset - sizeof(header), file) == header.vertexoffset - sizeof(header)
+		&& fwrite(mesh->vertexarray, 1, vertexbytes, file) == vertexbytes
+		&& fwrite(zeros, 1, header.indexoffset - header.vertexoffset - vertexbytes, file)
+			== header.indexoffset - header.vertexoffset - vertexbytes
+		&& fwrite(mesh->indexarray, 1, indexbytes, file) == indexbytes;
+	if(ok && (flags & OBJ_LODS)) {
+		ok = fwrite(zeros, 1, header.lodoffset - header.indexoffset - indexbytes, file)
+				== header.lodoffset - header.indexoffset - indexbytes
+			&& fwrite(lods->lods, 1, lodbytes, file) == lodbytes
+			&& fwrite(zeros, 1, header.lodindexoffset - header.lodoffset - lodbytes, file)
+				== header.lodindexoffset - header.lodoffset - lodbytes
+			&& fwrite(lods->indices, 1, lodindexbytes, file) == lodindexbytes;
+	}
+	ok = (fclose(file) == 0) && ok;
+	if(ok) {
+		remove(cachename); // rename() does not replace files on Windows
+		ok = (rename(tempname, cachename) == 0);
+	}
+	if(!ok) remove(tempname);
+	free(tempname);
+	return ok ? 0 : -1;
+}
+
+int objLoadCached(objMesh *mesh, meshLodChain *lods, const char *filename, noisePool *pool,
+	int flags, int *cached) {
+	char *cachename;
+	size_t size = strlen(filename) + 6;
+	int result;
+
+	if(cached) *cached = 0;
+	cachename = (char*)malloc(size);
+	if(cachename == NULL) return OBJ_ERROR_MEMORY;
+	objCacheName(cachename, size, filename);
+	if(objReadCache(mesh, lods, cachename, filename, flags) == 0) {
+		if(cached) *cached = 1;
+		free(cachename);
+		return 0;
+	}
+	result = objLoadThreaded(mesh, filename, pool, flags & ~OBJ_LODS);
+	if(result == 0 && (flags & OBJ_LODS) && meshLodBuild(lods, mesh->vertexarray, 8, mesh->indexarray,
+		mesh->ntris, mesh->nverts, NULL, 0) != 0) {
+		objFree(mesh);
+		result = OBJ_ERROR_MEMORY;
+	}
+	if(result == 0) objWriteCache(mesh, lods, cachename, filename, flags);
+	free(cachename);
+	return result;
+}
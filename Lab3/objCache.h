@@ -0,0 +1,99 @@
+/*
+ * objCache.h - a binary cache of loaded OBJ meshes, in .soup files next
+ * to the OBJ files, that loads by memory mapping without any parsing.
+ *
+ * A .soup file is a header followed by the vertex array and the index
+ * array of an objMesh, exactly as they are in memory, each starting at
+ * a multiple of 64 bytes. With OBJ_LODS, the levels of detail of the
+ * mesh follow, as the meshLod entries and then the indices of all levels
+ * of a meshLodChain (meshSimplify.h), so that they are only made once.
+ * The header has a magic number and a version, the flags the mesh was
+ * loaded with, the counts and the bounding box of the mesh, and the size,
+ * modification time and a hash of the OBJ file it was made from. A cache
+ * file is only used if all of those match and its blocks fit inside the
+ * file, otherwise the OBJ file is parsed and the cache written again.
+ *
+ * The hash is the one of fileFingerprint() (mappedFile.h), over 64
+ * evenly spaced 1 KB samples of the OBJ text, so that checking the cache
+ * does not cost a read of the whole OBJ file. Together with the size and
+ * the modification time, that catches any ordinary edit of the file.
+ *
+ * A mesh from a cache file has its arrays pointing straight into the
+ * read only mapping of the file, and mesh->mapping set. objFree()
+ * unmaps it. The arrays must not be written to.
+ *
+ * This code is in the public domain.
+ */
+
+#ifndef OBJCACHE_H
+#define OBJCACHE_H
+
+#include "objLoader.h"
+#include "meshSimplify.h" // For meshLodChain
+
+#define OBJ_CACHE_VERSION 4
+
+// Flag for objLoadCached(), besides those of objLoadThreaded(): make the
+// levels of detail of the mesh with meshLodBuild() and keep them as well
+#define OBJ_LODS 0x100
+
+/* The header at the start of a .soup file, 192 bytes */
+typedef struct {
+	char magic[4];               // "SOUP"
+	unsigned int version;        // OBJ_CACHE_VERSION
+	unsigned int flags;          // The objLoadThreaded() flags of the mesh
+	unsigned int headersize;     // sizeof(objCacheHeader), as a sanity check
+	unsigned long long sourcesize;  // Size of the OBJ file in bytes
+	long long sourcemtime;          // Modification time of the OBJ file
+	unsigned long long sourcehash;  // Sampled hash of the OBJ file, see above
+	int nverts, ntris;           // As in objMesh
+	int numverts, numnormals, numtexcoords, numfaces;
+	float bounds[6];             // xmin, ymin, zmin, xmax, ymax, zmax
+	unsigned long long vertexoffset; // Where the vertex array starts
+	unsigned long long indexoffset;  // Where the index array starts
+	int nlods, nlodindices;          // As in meshLodChain, 0 without OBJ_LODS
+	float lodcenter[3], lodradius;   // The bounding sphere of meshLodChain
+	unsigned long long lodoffset;    // Where the nlods meshLod entries start
+	unsigned long long lodindexoffset; // Where the indices of the levels start
+	char pad[48];
+} objCacheHeader;
+
+/*
+ * objLoadCached() - load an OBJ file through its .soup cache file (the
+ * same name, with the extension replaced). If the cache is valid for the
+ * file and flags, the mesh is mapped from it. Otherwise the OBJ file is
+ * loaded by objLoadThreaded(), and the cache file is written for next
+ * time, if possible. With OBJ_LODS in flags, lods gets the levels of
+ * detail of the mesh too, from the cache or made by meshLodBuild(), in
+ * memory of their own to be freed with meshLodFree(). Returns as
+ * objLoad(). If cached is not NULL, it is set to 1 if the mesh came from
+ * the cache and 0 if not.
+ */
+int objLoadCached(objMesh *mesh, meshLodChain *lods, const char *filename, noisePool *pool,
+	int flags, int *cached);
+
+/*
+ * objReadCache() - map a mesh from the cache file cachename, if it is
+ * valid for the OBJ file objname and flags, and with OBJ_LODS, copy its
+ * levels of detail to lods. Returns 0 on success, or -1 if the cache is
+ * missing, out of date or damaged, or if out of memory.
+ */
+int objReadCache(objMesh *mesh, meshLodChain *lods, const char *cachename, const char *objname,
+	int flags);
+
+/*
+ * objWriteCache() - write a mesh that was loaded from objname with flags
+ * to the cache file cachename, and with OBJ_LODS, its levels of detail
+ * lods. The file is written under a temporary name and then renamed, so
+ * a reader never sees half a file. Returns 0 on success or -1 on errors.
+ */
+int objWriteCache(const objMesh *mesh, const meshLodChain *lods, const char *cachename,
+	const char *objname, int flags);
+
+/*
+ * objCacheName() - the name of the cache file for an OBJ file, in dst,
+ * which has room for size characters. Returns 0, or -1 if it won't fit.
+ */
+int objCacheName(char *dst, size_t size, const char *objname);
+
+#endif /* OBJCACHE_H */
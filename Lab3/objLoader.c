@@ -0,0 +1,790 @@
+/*
+ * objLoader.c - a fast, single pass Wavefront OBJ loader. See objLoader.h.
+ *
+ * The text can be split into chunks that are parsed on separate threads.
+ * Since faces refer to elements by their number in the whole file, the
+ * chunks keep their elements and face corners to themselves until all
+ * are done, and the corners are resolved in a second, parallel step.
+ *
+ * This code is in the public domain.
+ */
+
+#include <stdio.h>  // For fopen() and fread() in objStreamFile()
+#include <stdlib.h> // For malloc(), realloc() and free()
+#include <string.h> // For memset(), memcpy(), memmove() and memchr()
+#include <math.h>   // For pow()
+#include <limits.h> // For INT_MAX
+
+#include "mappedFile.h"
+#include "meshOptimize.h"
+#include "objLoader.h"
+
+/* A growable array of floats or ints */
+typedef struct {
+	void *data;
+	size_t count, capacity; // In elements
+} objArray;
+
+/*
+ * Everything that was read from the text: positions (3 floats each),
+ * normals (3), texture coordinates (2) and the corners of the
+ * triangulated faces (3 ints each: 1-based v, t and n indices, with 0
+ * for a missing t or n, or relative indices as described below).
+ */
+typedef struct {
+	objArray v, vn, vt, corners;
+	size_t faces;      // Number of faces before triangulation
+	const char *error; // Where the first malformed statement starts
+	int nomemory;      // Set if an array could not grow
+	size_t memory;     // Bytes allocated for the arrays
+	size_t limit;      // Most bytes the arrays may take, 0 for no limit
+} objData;
+
+/*
+ * reserve() - make room in a, one of the arrays of d, for n more
+ * elements of size bytes each. The capacity is at least doubled when
+ * the array has to grow, unless that would go over the memory limit.
+ * Returns 0, or -1 with d->nomemory set.
+ */
+static int reserve(objData *d, objArray *a, size_t n, size_t size) {
+	size_t capacity, available;
+	void *data;
+
+	if(a->count + n <= a->capacity) return 0;
+	capacity = a->capacity ? 2 * a->capacity : 1024;
+	while(capacity < a->count + n) capacity *= 2;
+	if(d->limit) { // Grow no further than the limit allows
+		available = (d->limit - d->memory) / size + a->capacity;
+		if(d->memory > d->limit || available < a->count + n) {
+			d->nomemory = 1;
+			return -1;
+		}
+		if(capacity > available) capacity = available;
+	}
+	data = realloc(a->data, capacity * size);
+	if(data == NULL) {
+		d->nomemory = 1;
+		return -1;
+	}
+	d->memory += (capacity - a->capacity) * size;
+	a->data = data;
+	a->capacity = capacity;
+	return 0;
+}
+
+static const double powersOf10[23] = {
+	1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+	1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/*
+ * parseFloat() - read a decimal number like strtod() would, after any
+ * spaces or tabs. Up to 19 significant digits are kept in an integer,
+ * which is then scaled by an exact power of ten in double precision,
+ * so the result is correctly rounded to double for all numbers an OBJ
+ * exporter writes, and rounded from there to float. Returns the first
+ * character after the number, or NULL if there was no number.
+ */
+static const char *parseFloat(const char *p, const char *end, float *out) {
+	unsigned long long mantissa = 0;
+	int digits = 0, exponent = 0, e = 0, negative = 0, enegative = 0;
+	double value;
+
+	while(p < end && (*p == ' ' || *p == '\t')) p++;
+	if(p < end && (*p == '-' || *p == '+')) negative = (*p++ == '-');
+	while(p < end && (unsigned)(*p - '0') < 10) {
+		if(digits < 19) mantissa = mantissa * 10 + (*p - '0');
+		else exponent++; // Too many digits, drop the rest
+		if(mantissa) digits++;
+		p++;
+		e = 1;
+	}
+	if(p < end && *p == '.') {
+		p++;
+		while(p < end && (unsigned)(*p - '0') < 10) {
+			if(digits < 19) {
+				mantissa = mantissa * 10 + (*p - '0');
+				exponent--;
+				if(mantissa) digits++;
+			}
+			p++;
+			e = 1;
+		}
+	}
+	if(!e) return NULL; // No digits at all
+	if(p < end && (*p == 'e' || *p == 'E')) {
+		p++;
+		e = 0;
+		if(p < end && (*p == '-' || *p == '+')) enegative = (*p++ == '-');
+		while(p < end && (unsigned)(*p - '0') < 10) {
+			if(e < 10000) e = e * 10 + (*p - '0');
+			p++;
+		}
+		exponent += enegative ? -e : e;
+	}
+	value = (double)mantissa;
+	if(exponent < 0) {
+		value = (exponent >= -22) ? value / powersOf10[-exponent] : value * pow(10.0, exponent);
+	}
+	else if(exponent > 0) {
+		value = (exponent <= 22) ? value * powersOf10[exponent] : value * pow(10.0, exponent);
+	}
+	*out = (float)(negative ? -value : value);
+	return p;
+}
+
+/*
+ * Relative indices are stored as the 1-based index within the chunk
+ * minus OBJ_RELATIVE, which makes them negative and keeps them apart
+ * from absolute indices until the chunk offsets are known. An index
+ * within the chunk is 0 or less when it points into an earlier chunk.
+ */
+#define OBJ_RELATIVE (1 << 30)
+
+/*
+ * parseIndex() - read an optionally negative integer, or return NULL.
+ * Indices of OBJ_RELATIVE or more either way are too large for a mesh
+ * anyway, and would be mistaken for relative ones, so they are errors.
+ */
+static const char *parseIndex(const char *p, const char *end, int *out) {
+	int negative = 0, value = 0;
+	const char *start;
+
+	if(p < end && *p == '-') {
+		negative = 1;
+		p++;
+	}
+	start = p;
+	while(p < end && (unsigned)(*p - '0') < 10) {
+		if(value >= OBJ_RELATIVE / 10) return NULL; // The next digit would be too many
+		value = value * 10 + (*p - '0');
+		p++;
+	}
+	if(p == start) return NULL;
+	*out = negative ? -value : value;
+	return p;
+}
+
+/* Read n floats into a new element of a */
+static const char *parseFloats(const char *p, const char *end, objData *d, objArray *a, int n) {
+	float *f;
+	int k;
+
+	if(reserve(d, a, 1, (size_t)n * sizeof(float))) return NULL;
+	f = (float*)a->data + a->count * n;
+	for(k = 0; k < n; k++) {
+		p = parseFloat(p, end, &f[k]);
+		if(p == NULL) return NULL;
+	}
+	a->count++;
+	return p;
+}
+
+static int relative(int index, size_t count) {
+	return (index < 0) ? (int)count + index + 1 - OBJ_RELATIVE : index;
+}
+
+/*
+ * resolve() - turn a stored index into an absolute one, given the number
+ * of elements in the chunks before this one, and check it against the
+ * total number of elements. Returns 0 for a bad index.
+ */
+static int resolve(int index, size_t base, size_t count) {
+	long long i = (index < 0) ? (long long)base + index + OBJ_RELATIVE : index;
+	return (i > 0 && i <= (long long)count) ? (int)i : 0;
+}
+
+/*
+ * parseFace() - read the corners of a face, and add one triangle for
+ * each corner after the second, as a fan around the first corner
+ */
+static const char *parseFace(const char *p, const char *end, objData *d) {
+	int corner[3], first[3] = {0, 0, 0}, prev[3] = {0, 0, 0}, t = 0, vn = 0, n = 0, *c;
+
+	for(;;) {
+		while(p < end && (*p == ' ' || *p == '\t')) p++;
+		if(p == end || *p == '\n' || *p == '\r' || *p == '#') break;
+		p = parseIndex(p, end, &corner[0]);
+		if(p == NULL || corner[0] == 0) return NULL;
+		corner[0] = relative(corner[0], d->v.count);
+		corner[1] = corner[2] = 0;
+		if(p < end && *p == '/') {
+			p++;
+			if(p < end && *p != '/') {
+				p = parseIndex(p, end, &corner[1]);
+				if(p == NULL || corner[1] == 0) return NULL;
+				corner[1] = relative(corner[1], d->vt.count);
+			}
+			if(p < end && *p == '/') {
+				p = parseIndex(p + 1, end, &corner[2]);
+				if(p == NULL || corner[2] == 0) return NULL;
+				corner[2] = relative(corner[2], d->vn.count);
+			}
+		}
+		// All corners must have the same layout
+		if(n == 0) {
+			t = (corner[1] != 0);
+			vn = (corner[2] != 0);
+		}
+		else if(t != (corner[1] != 0) || vn != (corner[2] != 0)) return NULL;
+		if(n == 0) {
+			first[0] = corner[0]; first[1] = corner[1]; first[2] = corner[2];
+		}
+		else if(n >= 2) {
+			if(reserve(d, &d->corners, 3, 3 * sizeof(int))) return NULL;
+			c = (int*)d->corners.data + 3 * d->corners.count;
+			c[0] = first[0]; c[1] = first[1]; c[2] = first[2];
+			c[3] = prev[0]; c[4] = prev[1]; c[5] = prev[2];
+			c[6] = corner[0]; c[7] = corner[1]; c[8] = corner[2];
+			d->corners.count += 3;
+		}
+		prev[0] = corner[0]; prev[1] = corner[1]; prev[2] = corner[2];
+		n++;
+	}
+	if(n < 3) return NULL;
+	d->faces++;
+	return p;
+}
+
+/* The start of the next line after p, or end */
+static const char *nextLine(const char *p, const char *end) {
+	const char *newline = (const char*)memchr(p, '\n', end - p);
+	return newline ? newline + 1 : end;
+}
+
+/*
+ * parseText() - the single pass over the text, one statement per line.
+ * Returns 0, or -1 with d->error set to the start of the bad line.
+ */
+static int parseText(objData *d, const char *p, const char *end) {
+	const char *line, *next;
+
+	while(p < end) {
+		line = p;
+		while(p < end && (*p == ' ' || *p == '\t')) p++;
+		next = NULL;
+		if(p + 1 < end && (p[1] == ' ' || p[1] == '\t')) {
+			switch(*p) {
+				case 'v': next = parseFloats(p + 2, end, d, &d->v, 3); break;
+				case 'f': next = parseFace(p + 2, end, d); break;
+				default: next = p; break; // Some other statement
+			}
+		}
+		else if(p + 2 < end && p[0] == 'v' && (p[2] == ' ' || p[2] == '\t')) {
+			switch(p[1]) {
+				case 'n': next = parseFloats(p + 3, end, d, &d->vn, 3); break;
+				case 't': next = parseFloats(p + 3, end, d, &d->vt, 2); break;
+				default: next = p; break;
+			}
+		}
+		else {
+			next = p;
+		}
+		if(next == NULL) {
+			d->error = line;
+			return -1;
+		}
+		// Skip the rest of the line, like extra vertex components or comments
+		p = nextLine(next, end);
+	}
+	return 0;
+}
+
+/*
+ * The text is split into chunks at line boundaries, which are parsed
+ * independently, each into its own objData. The chunk offsets are then
+ * found by prefix sums over the counts, and each chunk writes its part
+ * of the output arrays directly.
+ */
+typedef struct {
+	const char *begin, *end;
+	objData d;
+	size_t v, vn, vt, corners; // Elements in all earlier chunks
+	size_t badcorner; // First corner with a bad index, or (size_t)-1
+} objChunk;
+
+typedef struct {
+	objChunk *chunks;
+	int nchunks;
+	float *v, *vn, *vt; // All elements of the file, in order
+	size_t nv, nvn, nvt;
+	objMesh *mesh;
+	int weld; // Set for OBJ_WELD
+} objJob;
+
+/* The state of objStreamFile() */
+typedef struct {
+	objStreamParams params;
+	objBatchFunc func;
+	void *user;
+	objStreamStats *stats;
+	objData d;        // All elements so far, and the corners of one buffer
+	float *batch;     // The batch being filled
+	int batchverts;   // Vertices in batch
+	int errorline;    // Line number at the start of the buffer
+} objStream;
+
+// Smallest chunk worth a task of its own, in bytes
+#define OBJ_MIN_CHUNK (256 * 1024)
+// Chunks per thread, to let the pool even out the work
+#define OBJ_CHUNKS_PER_THREAD 4
+
+static void parseTask(void *arg, int index, int thread) {
+	objChunk *chunk = &((objJob*)arg)->chunks[index];
+	parseText(&chunk->d, chunk->begin, chunk->end);
+}
+
+/* Copy the elements of a chunk to their place in the whole file */
+static void gatherTask(void *arg, int index, int thread) {
+	objJob *job = (objJob*)arg;
+	objChunk *chunk = &job->chunks[index];
+
+	memcpy(job->v + 3 * chunk->v, chunk->d.v.data, 3 * chunk->d.v.count * sizeof(float));
+	memcpy(job->vn + 3 * chunk->vn, chunk->d.vn.data, 3 * chunk->d.vn.count * sizeof(float));
+	memcpy(job->vt + 2 * chunk->vt, chunk->d.vt.data, 2 * chunk->d.vt.count * sizeof(float));
+}
+
+/* Write the vertex with position iv, texcoord it and normal in (0 if none) */
+static void emitVertex(const objJob *job, float *out, int iv, int it, int in) {
+	out[0] = job->v[3 * iv - 3];
+	out[1] = job->v[3 * iv - 2];
+	out[2] = job->v[3 * iv - 1];
+	if(in > 0) {
+		out[3] = job->vn[3 * in - 3];
+		out[4] = job->vn[3 * in - 2];
+		out[5] = job->vn[3 * in - 1];
+	}
+	else {
+		out[3] = out[4] = out[5] = 0.0f;
+	}
+	if(it > 0) {
+		out[6] = job->vt[2 * it - 2];
+		out[7] = job->vt[2 * it - 1];
+	}
+	else {
+		out[6] = out[7] = 0.0f;
+	}
+}
+
+/*
+ * stitchTask() - fill in the part of the output arrays of mesh that
+ * comes from one chunk, resolving and checking its indices. For welding,
+ * the resolved indices are only written back to the corners.
+ */
+static void stitchTask(void *arg, int index, int thread) {
+	objJob *job = (objJob*)arg;
+	objChunk *chunk = &job->chunks[index];
+	int *c = (int*)chunk->d.corners.data;
+	float *out = job->mesh->vertexarray + 8 * chunk->corners;
+	unsigned int *indices = job->mesh->indexarray + chunk->corners;
+	size_t i, n = chunk->d.corners.count;
+	int iv, it, in;
+
+	for(i = 0; i < n; i++, c += 3, out += 8) {
+		iv = resolve(c[0], chunk->v, job->nv);
+		it = c[1] ? resolve(c[1], chunk->vt, job->nvt) : -1;
+		in = c[2] ? resolve(c[2], chunk->vn, job->nvn) : -1;
+		if(iv == 0 || it == 0 || in == 0) {
+			chunk->badcorner = i;
+			return;
+		}
+		if(job->weld) {
+			c[0] = iv;
+			c[1] = (it > 0) ? it : 0;
+			c[2] = (in > 0) ? in : 0;
+		}
+		else {
+			emitVertex(job, out, iv, it, in);
+			indices[i] = (unsigned int)(chunk->corners + i);
+		}
+	}
+}
+
+/* Hash of a v/t/n index triple, for the welding table */
+static unsigned int hashCorner(const int *c) {
+	unsigned int h = (unsigned int)c[0] * 0x9E3779B1u;
+	h = (h ^ (unsigned int)c[1]) * 0x85EBCA77u;
+	h = (h ^ (unsigned int)c[2]) * 0xC2B2AE3Du;
+	return h ^ (h >> 16);
+}
+
+/*
+ * weldCorners() - give each distinct v/t/n index triple one vertex, in
+ * the order the triples are first used, and index the triangles by them.
+ * The triples are looked up in an open addressing hash table with linear
+ * probing, which holds vertex numbers plus one (0 for empty slots) and
+ * is kept at most half full. The triple of each vertex is kept in keys.
+ */
+static int weldCorners(objMesh *mesh, const objJob *job) {
+	unsigned int *table, *newtable, mask, h, slot, k;
+	int *keys, *c, *key;
+	size_t capacity, count = 0, corner = 0, i;
+	int j;
+	float *vertices;
+
+	capacity = 1024;
+	while(capacity < 2 * (job->nv + job->nv / 2)) capacity *= 2; // Most meshes have < 1.5 nv
+	table = (unsigned int*)calloc(capacity, sizeof(unsigned int));
+	keys = (int*)malloc((3 * (size_t)mesh->nverts + 1) * sizeof(int));
+	if(table == NULL || keys == NULL) {
+		free(table);
+		free(keys);
+		return OBJ_ERROR_MEMORY;
+	}
+	mask = (unsigned int)capacity - 1;
+
+	for(j = 0; j < job->nchunks; j++) {
+		c = (int*)job->chunks[j].d.corners.data;
+		for(i = 0; i < job->chunks[j].d.corners.count; i++, c += 3, corner++) {
+			for(slot = hashCorner(c) & mask; table[slot]; slot = (slot + 1) & mask) {
+				key = keys + 3 * (table[slot] - 1);
+				if(key[0] == c[0] && key[1] == c[1] && key[2] == c[2]) break;
+			}
+			if(table[slot] == 0) { // A new vertex
+				key = keys + 3 * count;
+				key[0] = c[0]; key[1] = c[1]; key[2] = c[2];
+				emitVertex(job, mesh->vertexarray + 8 * count, c[0], c[1], c[2]);
+				table[slot] = (unsigned int)++count;
+				if(2 * count > capacity) { // Grow the table and rehash
+					newtable = (unsigned int*)calloc(2 * capacity, sizeof(unsigned int));
+					if(newtable == NULL) {
+						free(table);
+						free(keys);
+						return OBJ_ERROR_MEMORY;
+					}
+					capacity *= 2;
+					mask = (unsigned int)capacity - 1;
+					for(k = 1; k <= count; k++) {
+						for(h = hashCorner(keys + 3 * (k - 1)) & mask; newtable[h]; h = (h + 1) & mask);
+						newtable[h] = k;
+					}
+					free(table);
+					table = newtable;
+				}
+				mesh->indexarray[corner] = (unsigned int)(count - 1);
+			}
+			else {
+				mesh->indexarray[corner] = table[slot] - 1;
+			}
+		}
+	}
+	free(table);
+	free(keys);
+
+	// Give back the unused part of the vertex array
+	vertices = (float*)realloc(mesh->vertexarray, (count + 1) * 8 * sizeof(float));
+	if(vertices != NULL) mesh->vertexarray = vertices;
+	mesh->nverts = (int)count;
+	return 0;
+}
+
+/* The line number of position p in the text */
+static int lineOf(const char *text, const char *p) {
+	int line = 1;
+	for(; text < p; text++) line += (*text == '\n');
+	return line;
+}
+
+/*
+ * faceAt() - the start of the line with the face that made corner
+ * number corner of a chunk, found by parsing its faces again
+ */
+static const char *faceAt(const objChunk *chunk, size_t corner) {
+	objData d;
+	const char *p = chunk->begin, *line = p;
+	size_t seen = 0;
+
+	memset(&d, 0, sizeof(d));
+	while(p < chunk->end) {
+		line = p;
+		while(p < chunk->end && (*p == ' ' || *p == '\t')) p++;
+		if(p + 1 < chunk->end && *p == 'f' && (p[1] == ' ' || p[1] == '\t')) {
+			d.corners.count = 0;
+			parseFace(p + 2, chunk->end, &d);
+			seen += d.corners.count;
+			if(seen > corner) break;
+		}
+		p = nextLine(p, chunk->end);
+	}
+	free(d.corners.data);
+	return line;
+}
+
+int objParseThreaded(objMesh *mesh, const char *text, size_t length, noisePool *pool, int flags) {
+	objJob job;
+	objChunk *chunk;
+	size_t size;
+	const char *split, *end = text + length;
+	int i, nchunks, result = 0;
+
+	memset(mesh, 0, sizeof(objMesh));
+	memset(&job, 0, sizeof(job));
+
+	// Split the text into chunks that end at a newline
+	nchunks = pool ? OBJ_CHUNKS_PER_THREAD * noisePoolThreads(pool) : 1;
+	if(length / OBJ_MIN_CHUNK < (size_t)nchunks) nchunks = (int)(length / OBJ_MIN_CHUNK);
+	if(nchunks < 1) nchunks = 1;
+	size = length / nchunks;
+	job.chunks = (objChunk*)calloc(nchunks, sizeof(objChunk));
+	if(job.chunks == NULL) return OBJ_ERROR_MEMORY;
+	split = text;
+	for(i = 0; i < nchunks; i++) {
+		chunk = &job.chunks[i];
+		chunk->begin = split;
+		split = (i == nchunks - 1) ? end : nextLine(text + (i + 1) * size - 1, end);
+		if(split < chunk->begin) split = chunk->begin;
+		chunk->end = split;
+		chunk->badcorner = (size_t)-1;
+	}
+	job.nchunks = nchunks;
+	job.mesh = mesh;
+	job.weld = (flags & OBJ_WELD) != 0;
+
+	noisePoolFor(pool, nchunks, parseTask, &job);
+
+	// Report the first error in the file, and add up the counts
+	for(i = 0; i < nchunks; i++) {
+		chunk = &job.chunks[i];
+		if(chunk->d.nomemory) {
+			result = OBJ_ERROR_MEMORY;
+			break;
+		}
+		if(chunk->d.error) {
+			mesh->errorline = lineOf(text, chunk->d.error);
+			result = OBJ_ERROR_SYNTAX;
+			break;
+		}
+		chunk->v = job.nv;
+		chunk->vn = job.nvn;
+		chunk->vt = job.nvt;
+		chunk->corners = (size_t)mesh->nverts;
+		if(chunk->d.corners.count > (size_t)(INT_MAX / 8 - 1 - mesh->nverts)) {
+			result = OBJ_ERROR_MEMORY; // Too many for the int offsets of an objMesh
+			break;
+		}
+		job.nv += chunk->d.v.count;
+		job.nvn += chunk->d.vn.count;
+		job.nvt += chunk->d.vt.count;
+		mesh->nverts += (int)chunk->d.corners.count;
+		mesh->numfaces += (int)chunk->d.faces;
+	}
+
+	if(result == 0) {
+		mesh->numverts = (int)job.nv;
+		mesh->numnormals = (int)job.nvn;
+		mesh->numtexcoords = (int)job.nvt;
+		mesh->ntris = mesh->nverts / 3;
+		mesh->vertexarray = (float*)malloc(((size_t)mesh->nverts + 1) * 8 * sizeof(float));
+		mesh->indexarray = (unsigned int*)malloc(((size_t)mesh->nverts + 1) * sizeof(unsigned int));
+		if(nchunks == 1) { // Nothing to gather
+			job.v = (float*)job.chunks[0].d.v.data;
+			job.vn = (float*)job.chunks[0].d.vn.data;
+			job.vt = (float*)job.chunks[0].d.vt.data;
+		}
+		else {
+			job.v = (float*)malloc((3 * job.nv + 1) * sizeof(float));
+			job.vn = (float*)malloc((3 * job.nvn + 1) * sizeof(float));
+			job.vt = (float*)malloc((2 * job.nvt + 1) * sizeof(float));
+		}
+		if(mesh->vertexarray == NULL || mesh->indexarray == NULL
+			|| (nchunks > 1 && (job.v == NULL || job.vn == NULL || job.vt == NULL))) {
+			result = OBJ_ERROR_MEMORY;
+		}
+	}
+
+	if(result == 0) {
+		if(nchunks > 1) noisePoolFor(pool, nchunks, gatherTask, &job);
+		noisePoolFor(pool, nchunks, stitchTask, &job);
+		for(i = 0; i < nchunks; i++) {
+			chunk = &job.chunks[i];
+			if(chunk->badcorner != (size_t)-1) {
+				mesh->errorline = lineOf(text, faceAt(chunk, chunk->badcorner));
+				result = OBJ_ERROR_SYNTAX;
+				break;
+			}
+		}
+		if(result == 0 && job.weld) result = weldCorners(mesh, &job);
+		if(result == 0 && (flags & OBJ_OPTIMIZE)) {
+			i = meshOptimize(mesh->vertexarray, 8, mesh->indexarray, mesh->ntris, mesh->nverts);
+			if(i < 0) result = OBJ_ERROR_MEMORY;
+			else mesh->nverts = i;
+		}
+	}
+
+	if(nchunks > 1) {
+		free(job.v);
+		free(job.vn);
+		free(job.vt);
+	}
+	for(i = 0; i < nchunks; i++) {
+		free(job.chunks[i].d.v.data);
+		free(job.chunks[i].d.vn.data);
+		free(job.chunks[i].d.vt.data);
+		free(job.chunks[i].d.corners.data);
+	}
+	free(job.chunks);
+	if(result != 0) objFree(mesh);
+	return result;
+}
+
+int objParse(objMesh *mesh, const char *text, size_t length) {
+	return objParseThreaded(mesh, text, length, NULL, 0);
+}
+
+int objLoadThreaded(objMesh *mesh, const char *filename, noisePool *pool, int flags) {
+	mappedFile file;
+	int result;
+
+	memset(mesh, 0, sizeof(objMesh));
+	if(mapFile(&file, filename) != 0) return OBJ_ERROR_OPEN;
+	result = objParseThreaded(mesh, file.data, file.size, pool, flags);
+	unmapFile(&file);
+	return result;
+}
+
+int objLoad(objMesh *mesh, const char *filename) {
+	return objLoadThreaded(mesh, filename, NULL, 0);
+}
+
+void objStreamDefaults(objStreamParams *params) {
+	params->batchtris = 65536;
+	params->buffersize = 1 << 20;
+	params->memorylimit = 0;
+}
+
+/*
+ * flushCorners() - resolve the corners that were parsed from one buffer
+ * full of text, and pass them on in batches. Returns 0, or an error.
+ */
+static int flushCorners(objStream *stream, const objChunk *chunk) {
+	objData *d = &stream->d;
+	objJob job;
+	const int *c = (const int*)d->corners.data;
+	size_t i;
+	int iv, it, in;
+
+	memset(&job, 0, sizeof(job));
+	job.v = (float*)d->v.data;
+	job.vn = (float*)d->vn.data;
+	job.vt = (float*)d->vt.data;
+	for(i = 0; i < d->corners.count; i++, c += 3) {
+		iv = resolve(c[0], 0, d->v.count);
+		it = c[1] ? resolve(c[1], 0, d->vt.count) : -1;
+		in = c[2] ? resolve(c[2], 0, d->vn.count) : -1;
+		if(iv == 0 || it == 0 || in == 0) {
+			stream->errorline += lineOf(chunk->begin, faceAt(chunk, i)) - 1;
+			return OBJ_ERROR_SYNTAX;
+		}
+		emitVertex(&job, stream->batch + 8 * stream->batchverts, iv, it, in);
+		if(++stream->batchverts == 3 * stream->params.batchtris) {
+			stream->stats->ntris += stream->params.batchtris;
+			stream->batchverts = 0;
+			if(stream->func(stream->batch, stream->params.batchtris, stream->user)) {
+				return OBJ_ERROR_STOPPED;
+			}
+		}
+	}
+	d->corners.count = 0;
+	return 0;
+}
+
+int objStreamFile(const char *filename, const objStreamParams *params,
+	objBatchFunc func, void *user, objStreamStats *stats) {
+	objStream stream;
+	objStreamStats dummy;
+	objChunk chunk;
+	FILE *file;
+	char *buffer = NULL;
+	const char *end, *p;
+	size_t have = 0, n, used;
+	int eof = 0, result = 0;
+
+	memset(&stream, 0, sizeof(stream));
+	stream.params = *params;
+	stream.func = func;
+	stream.user = user;
+	stream.stats = stats ? stats : &dummy;
+	memset(stream.stats, 0, sizeof(objStreamStats));
+	if(stream.params.batchtris < 1 || stream.params.buffersize < 2) return OBJ_ERROR_MEMORY;
+
+	// The buffers count towards the limit, and the arrays get the rest
+	used = stream.params.buffersize + 24 * sizeof(float) * (size_t)stream.params.batchtris;
+	if(stream.params.memorylimit) {
+		if(used >= stream.params.memorylimit) return OBJ_ERROR_MEMORY;
+		stream.d.limit = stream.params.memorylimit - used;
+	}
+	file = fopen(filename, "rb");
+	if(file == NULL) return OBJ_ERROR_OPEN;
+	setvbuf(file, NULL, _IONBF, 0); // We have our own buffer
+	buffer = (char*)malloc(stream.params.buffersize);
+	stream.batch = (float*)malloc(24 * sizeof(float) * (size_t)stream.params.batchtris);
+	if(buffer == NULL || stream.batch == NULL) result = OBJ_ERROR_MEMORY;
+	stream.errorline = 1;
+
+	while(result == 0 && !(eof && have == 0)) {
+		// Fill the buffer, and parse all complete lines in it
+		if(!eof) {
+			n = fread(buffer + have, 1, stream.params.buffersize - have, file);
+			have += n;
+			eof = (have < stream.params.buffersize);
+		}
+		end = buffer + have;
+		if(!eof) {
+			while(end > buffer && end[-1] != '\n') end--;
+			if(end == buffer) { // A line longer than the buffer
+				result = OBJ_ERROR_SYNTAX;
+				break;
+			}
+		}
+		if(parseText(&stream.d, buffer, end) != 0) {
+			if(stream.d.nomemory) result = OBJ_ERROR_MEMORY;
+			else {
+				stream.errorline += lineOf(buffer, stream.d.error) - 1;
+				result = OBJ_ERROR_SYNTAX;
+			}
+			break;
+		}
+		chunk.begin = buffer;
+		chunk.end = end;
+		result = flushCorners(&stream, &chunk);
+		if(result != 0) break;
+		for(p = buffer; p < end; p++) stream.errorline += (*p == '\n');
+
+		// Keep the start of the next line
+		have -= end - buffer;
+		memmove(buffer, end, have);
+	}
+	if(result == 0 && stream.batchverts > 0) { // The last batch
+		stream.stats->ntris += stream.batchverts / 3;
+		if(func(stream.batch, stream.batchverts / 3, user)) result = OBJ_ERROR_STOPPED;
+	}
+
+	stream.stats->numverts = (int)stream.d.v.count;
+	stream.stats->numnormals = (int)stream.d.vn.count;
+	stream.stats->numtexcoords = (int)stream.d.vt.count;
+	stream.stats->numfaces = (int)stream.d.faces;
+	stream.stats->peakmemory = used + stream.d.memory;
+	if(result == OBJ_ERROR_SYNTAX) stream.stats->errorline = stream.errorline;
+	fclose(file);
+	free(buffer);
+	free(stream.batch);
+	free(stream.d.v.data);
+	free(stream.d.vn.data);
+	free(stream.d.vt.data);
+	free(stream.d.corners.data);
+	return result;
+}
+
+void objFree(objMesh *mesh) {
+	int errorline = mesh->errorline;
+	if(mesh->mapping) {
+		unmapFile((mappedFile*)mesh->mapping);
+		free(mesh->mapping);
+	}
+	else {
+		free(mesh->vertexarray);
+		free(mesh->indexarray);
+	}
+	memset(mesh, 0, sizeof(objMesh));
+	mesh->errorline = errorline;
+}
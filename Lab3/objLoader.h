@@ -0,0 +1,131 @@
+/*
+ * objLoader.h - a fast loader for Wavefront OBJ meshes, without any
+ * OpenGL dependencies, used by soupReadOBJ() in triangleSoup.c.
+ *
+ * The file is memory mapped and read once, front to back, by a hand
+ * written tokenizer with its own float and integer parsing. Positions,
+ * normals, texture coordinates and face corners go into arrays that
+ * grow geometrically, and the output arrays are filled in from those.
+ *
+ * By default, the output is the same as the old soupReadOBJ() gave: three
+ * vertices of 8 floats (x y z nx ny nz s t) per triangle, and an index
+ * array that simply counts 0, 1, 2 ... (but see OBJ_WELD below). Faces
+ * may also be written as v, v/t or v//n, with negative (relative)
+ * indices, and polygons with more than three corners are split into
+ * triangle fans. Missing normals and texture coordinates are set to
+ * zero. Other statements are ignored.
+ *
+ * objLoadThreaded() splits the file at line boundaries into chunks that
+ * are parsed in parallel on a noisePool (cpuNoisePool.c), and then fills
+ * in the output arrays, also in parallel, once the position of each chunk
+ * in the file is known. The result is the same as from objLoad().
+ *
+ * This code is in the public domain.
+ */
+
+#ifndef OBJLOADER_H
+#define OBJLOADER_H
+
+#include <stddef.h> // For size_t
+
+#include "threadPool.h" // For noisePool
+
+typedef struct {
+	float *vertexarray;        // 8 floats per vertex: x y z nx ny nz s t
+	unsigned int *indexarray;  // 3 indices per triangle
+	int nverts;                // Number of vertices in vertexarray
+	int ntris;                 // Number of triangles in indexarray
+	int numverts, numnormals, numtexcoords, numfaces; // Counts from the file
+	int errorline;             // First malformed line, if objLoad() failed on one
+	void *mapping;             // The mappedFile the arrays are in, see objCache.h
+} objMesh;
+
+/* Results of objLoad() and objParse() other than success (0) */
+#define OBJ_ERROR_OPEN -1   // The file could not be opened or mapped
+#define OBJ_ERROR_MEMORY -2 // Out of memory
+#define OBJ_ERROR_SYNTAX -3 // Malformed data or a bad index at line errorline
+#define OBJ_ERROR_STOPPED -4 // The batch function of objStreamFile() said stop
+
+/*
+ * objLoad() - load an OBJ file into mesh. Returns 0 on success, or one
+ * of the errors above, in which case mesh is left empty. The arrays are
+ * allocated with malloc() and belong to the caller, see objFree().
+ */
+int objLoad(objMesh *mesh, const char *filename);
+
+/*
+ * objParse() - as objLoad(), for OBJ text that is already in memory.
+ * The text does not have to be 0 terminated.
+ */
+int objParse(objMesh *mesh, const char *text, size_t length);
+
+/* Flags for objLoadThreaded() and objParseThreaded() */
+#define OBJ_WELD 1     // One vertex for each distinct v/t/n triple, see below
+#define OBJ_OPTIMIZE 2 // Reorder triangles and vertices with meshOptimize()
+
+/*
+ * objLoadThreaded(), objParseThreaded() - as above, with the work spread
+ * over the threads of pool, and flags. With a NULL pool and no flags,
+ * these are the same as objLoad() and objParse().
+ *
+ * With OBJ_WELD, corners that use the same position, texture coordinate
+ * and normal share one vertex, and the index array refers to those, so
+ * nverts is the number of distinct triples instead of 3 * ntris. The
+ * vertices come in the order they are first used by the faces. Welding
+ * is one serial pass after the parallel ones, into a vertex array with
+ * room for every corner that is then shrunk, so it makes the result
+ * smaller but not the most memory the load takes on the way.
+ *
+ * With OBJ_OPTIMIZE, the triangles are reordered for the vertex cache and
+ * less overdraw, and the vertices for fetch locality, by meshOptimize()
+ * in meshOptimize.c. That is best combined with OBJ_WELD.
+ */
+int objLoadThreaded(objMesh *mesh, const char *filename, noisePool *pool, int flags);
+int objParseThreaded(objMesh *mesh, const char *text, size_t length, noisePool *pool, int flags);
+
+/*
+ * Streaming: objStreamFile() reads an OBJ file through a buffer of fixed
+ * size, and passes the triangles on to func in batches as soon as they
+ * are read, instead of collecting them. Each batch is ntris triangles of
+ * three vertices of 8 floats, like vertexarray without welding, and is
+ * only valid during the call. Returning nonzero from func stops the
+ * load. All batches except the last have params->batchtris triangles.
+ *
+ * Since faces may refer to any earlier position, normal or texcoord,
+ * those are kept, but nothing else grows with the file: the memory used
+ * is the buffer, one batch, the elements, and the face corners of one
+ * buffer full of text. With a memorylimit, all of that is kept within
+ * the limit, and the load fails with OBJ_ERROR_MEMORY if it can't be.
+ */
+typedef int (*objBatchFunc)(const float *vertices, int ntris, void *user);
+
+typedef struct {
+	int batchtris;      // Triangles per batch (default 65536)
+	size_t buffersize;  // Bytes of text read at a time (default 1 MB), longer lines fail
+	size_t memorylimit; // Most bytes to allocate in all, 0 for no limit (default)
+} objStreamParams;
+
+typedef struct {
+	int numverts, numnormals, numtexcoords, numfaces; // Counts from the file
+	int ntris;          // Triangles passed on to func
+	int errorline;      // First malformed line, for OBJ_ERROR_SYNTAX
+	size_t peakmemory;  // Most bytes allocated at any one time
+} objStreamStats;
+
+/* Set the defaults listed above */
+void objStreamDefaults(objStreamParams *params);
+
+/*
+ * objStreamFile() - stream an OBJ file to func, see above. Returns 0 or
+ * one of the OBJ_ERROR codes. If stats is not NULL, it is filled in.
+ */
+int objStreamFile(const char *filename, const objStreamParams *params,
+	objBatchFunc func, void *user, objStreamStats *stats);
+
+/*
+ * objFree() - free the arrays of a mesh, or unmap them if they are in
+ * a mapped file, and set it to all zeros
+ */
+void objFree(objMesh *mesh);
+
+#endif /* OBJLOADER_H */
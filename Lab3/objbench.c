@@ -0,0 +1,569 @@
+/*
+ * objbench.c - compare the OBJ loader in objLoader.c with the fgets() and
+ * sscanf() parser that soupReadOBJ() used before, without OpenGL.
+ *
+ * Each file is loaded a number of times by both parsers, and the best
+ * time of each is reported as MB/s of OBJ text. The two results are also
+ * compared vertex by vertex, so any difference in parsing shows up.
+ *
+ * Next, each file is loaded with OBJ_WELD, and the memory for the
+ * vertex and index arrays is reported before and after welding. The
+ * welded vertices, looked up through the index array, are checked
+ * against the unwelded ones.
+ *
+ * After that, each file is loaded through its .soup cache file, which is
+ * written by the first load, and the parse and cache load times are
+ * compared. Both include one read of all vertices and indices, like an
+ * upload to OpenGL would do, since mapping alone does not touch the data.
+ * The same is done once with OBJ_LODS, where the first load also builds
+ * the levels of detail and the second reads them back from the cache.
+ * Note that this leaves .soup files next to the OBJ files.
+ *
+ * Then the text of each file, repeated a number of times in memory, is
+ * parsed by objParseThreaded() with 1, 2, 4 ... threads, and checked
+ * against the single threaded result. The copies all refer to the
+ * vertices of the first one, which is still a valid OBJ file.
+ *
+ * With -s, only the streaming loader objStreamFile() is run, on each
+ * file once, with the given batch size and memory limit. The peak memory
+ * it allocated and the peak resident size of the whole process are
+ * reported, and the triangles it passed on are checked against objLoad().
+ * Run it on one large file at a time to see the resident size it needs.
+ *
+ * Usage: objbench [options] [file.obj ...]
+ *   -r reps      timed loads per file and parser (default 10)
+ *   -t threads   largest thread count (default: all online CPUs)
+ *   -x copies    copies of each file for the thread test (default 16)
+ *   -s           streaming test only
+ *   -b tris      triangles per batch for -s (default 65536)
+ *   -m MB        memory limit for -s (default none)
+ * With no files, the meshes in meshes/ are used.
+ *
+ * This code is in the public domain.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#ifndef _WIN32
+#include <sys/resource.h> // For getrusage()
+#endif
+
+#include "bench.h"
+#include "objLoader.h"
+#include "objCache.h"
+#include "mappedFile.h"
+
+static const char *defaultFiles[] = { BENCH_MESHES };
+
+/*
+ * oldReadOBJ() - the parser of the old soupReadOBJ(), with the OpenGL
+ * parts taken out. Two passes over the file with fgets(), the first to
+ * count elements and the second to read them with sscanf().
+ * Returns 0 on success, -1 on errors.
+ */
+static int oldReadOBJ(objMesh *mesh, const char *filename) {
+
+	FILE *objfile;
+
+	int numverts = 0;
+	int numnormals = 0;
+	int numtexcoords = 0;
+	int numfaces = 0;
+	int i_v = 0;
+	int i_n = 0;
+	int i_t = 0;
+	int i_f = 0;
+	float *verts, *normals, *texcoords;
+
+	char line[256];
+	char tag[3];
+	int v1,v2,v3,n1,n2,n3,t1,t2,t3;
+	int numargs, readerror, currentv;
+
+	memset(mesh, 0, sizeof(objMesh));
+	objfile = fopen(filename, "r");
+	if(objfile == NULL) return -1;
+
+	while(fgets(line, 256, objfile)) {
+		sscanf(line, "%2s ", tag);
+		if(!strcmp(tag, "v")) numverts++;
+		else if(!strcmp(tag, "vn")) numnormals++;
+		else if(!strcmp(tag, "vt")) numtexcoords++;
+		else if(!strcmp(tag, "f")) numfaces++;
+	}
+
+	verts = (float*)malloc(3*numverts*sizeof(float));
+	normals = (float*)malloc(3*numnormals*sizeof(float));
+	texcoords = (float*)malloc(2*numtexcoords*sizeof(float));
+
+	mesh->vertexarray = (float*)malloc(8*3*numfaces*sizeof(float));
+	mesh->indexarray = (unsigned int*)malloc(3*numfaces*sizeof(unsigned int));
+	mesh->nverts = 3*numfaces;
+	mesh->ntris = numfaces;
+	mesh->numverts = numverts;
+	mesh->numnormals = numnormals;
+	mesh->numtexcoords = numtexcoords;
+	mesh->numfaces = numfaces;
+
+	rewind(objfile);
+
+	readerror = 0;
+	while(fgets(line, 256, objfile)) {
+		tag[0] = '\0';
+		sscanf(line, "%2s ", tag);
+		if(!strcmp(tag, "v")) {
+			numargs = sscanf(line, "v %f %f %f",
+				&verts[3*i_v], &verts[3*i_v+1], &verts[3*i_v+2]);
+			if(numargs != 3) {
+				readerror = 1;
+				break;
+			}
+			i_v++;
+		}
+		else if(!strcmp(tag, "vn")) {
+			numargs = sscanf(line, "vn %f %f %f",
+				&normals[3*i_n], &normals[3*i_n+1], &normals[3*i_n+2]);
+			if(numargs != 3) {
+				readerror = 1;
+				break;
+			}
+			i_n++;
+		}
+		else if(!strcmp(tag, "vt"))  {
+			numargs = sscanf(line, "vt %f %f",
+				&texcoords[2*i_t], &texcoords[2*i_t+1]);
+			if(numargs != 2) {
+				readerror = 1;
+				break;
+			}
+			i_t++;
+		}
+		else if(!strcmp(tag, "f")) {
+			numargs = sscanf(line, "f %d/%d/%d %d/%d/%d %d/%d/%d",
+				&v1, &t1, &n1, &v2, &t2, &n2, &v3, &t3, &n3);
+			if(numargs != 9) {
+				readerror = 1;
+				break;
+			}
+			v1--; v2--; v3--; n1--; n2--; n3--; t1--; t2--; t3--;
+			currentv = 8*3*i_f;
+			memcpy(&mesh->vertexarray[currentv], &verts[3*v1], 3*sizeof(float));
+			memcpy(&mesh->vertexarray[currentv+3], &normals[3*n1], 3*sizeof(float));
+			memcpy(&mesh->vertexarray[currentv+6], &texcoords[2*t1], 2*sizeof(float));
+			memcpy(&mesh->vertexarray[currentv+8], &verts[3*v2], 3*sizeof(float));
+			memcpy(&mesh->vertexarray[currentv+11], &normals[3*n2], 3*sizeof(float));
+			memcpy(&mesh->vertexarray[currentv+14], &texcoords[2*t2], 2*sizeof(float));
+			memcpy(&mesh->vertexarray[currentv+16], &verts[3*v3], 3*sizeof(float));
+			memcpy(&mesh->vertexarray[currentv+19], &normals[3*n3], 3*sizeof(float));
+			memcpy(&mesh->vertexarray[currentv+22], &texcoords[2*t3], 2*sizeof(float));
+			mesh->indexarray[3*i_f] = 3*i_f;
+			mesh->indexarray[3*i_f+1] = 3*i_f+1;
+			mesh->indexarray[3*i_f+2] = 3*i_f+2;
+			i_f++;
+		};
+	}
+
+	free(verts);
+	free(normals);
+	free(texcoords);
+	fclose(objfile);
+
+	if(readerror) {
+		objFree(mesh);
+		return -1;
+	}
+	return 0;
+}
+
+/* The size of a file in bytes, or -1 */
+static long fileSize(const char *filename) {
+	FILE *f = fopen(filename, "rb");
+	long size;
+
+	if(f == NULL) return -1;
+	fseek(f, 0, SEEK_END);
+	size = ftell(f);
+	fclose(f);
+	return size;
+}
+
+/*
+ * compareMeshes() - the number of floats that differ between two
+ * meshes, or -1 if they differ in size, and the largest difference
+ */
+static int compareMeshes(const objMesh *a, const objMesh *b, double *maxdiff) {
+	int i, mismatches = 0;
+	double d;
+
+	*maxdiff = 0.0;
+	if(a->nverts != b->nverts) return -1;
+	for(i = 0; i < 8 * a->nverts; i++) {
+		d = fabs(a->vertexarray[i] - b->vertexarray[i]);
+		if(d > 0.0) mismatches++;
+		if(d > *maxdiff) *maxdiff = d;
+	}
+	return mismatches;
+}
+
+/*
+ * weldTest() - load a file with and without OBJ_WELD, and print the
+ * load times, the memory used by each and whether they agree
+ */
+static void weldTest(const char *filename, int reps) {
+	objMesh plain, welded;
+	double t, tplain = 1e30, tweld = 1e30, before, after;
+	int r, i, k, mismatches = 0;
+
+	if(objLoad(&plain, filename) != 0) return;
+	objFree(&plain);
+	for(r = 0; r < reps; r++) {
+		t = seconds();
+		objLoad(&plain, filename);
+		t = seconds() - t;
+		if(t < tplain) tplain = t;
+		if(r < reps - 1) objFree(&plain);
+
+		t = seconds();
+		objLoadThreaded(&welded, filename, NULL, OBJ_WELD);
+		t = seconds() - t;
+		if(t < tweld) tweld = t;
+		if(r < reps - 1) objFree(&welded);
+	}
+	for(i = 0; i < 3 * plain.ntris; i++) {
+		for(k = 0; k < 8; k++) {
+			if(welded.vertexarray[8 * welded.indexarray[i] + k] != plain.vertexarray[8 * i + k]) {
+				mismatches++;
+			}
+		}
+	}
+	before = (8.0 * sizeof(float) * plain.nverts + 3.0 * sizeof(unsigned int) * plain.ntris) / 1024.0;
+	after = (8.0 * sizeof(float) * welded.nverts + 3.0 * sizeof(unsigned int) * welded.ntris) / 1024.0;
+	printf("%-26s %9d %9d %9.0f %9.0f %8.2fx %8.2f %8.2f %11d\n", filename,
+		plain.nverts, welded.nverts, before, after, before / after,
+		1000.0 * tplain, 1000.0 * tweld, mismatches);
+	objFree(&plain);
+	objFree(&welded);
+}
+
+// Where touchMesh() results go, so the reads are not optimized away
+static volatile float touchSink;
+
+/* Read all of the vertex and index arrays of a mesh */
+static float touchMesh(const objMesh *mesh) {
+	float sum = 0.0f;
+	int i;
+
+	for(i = 0; i < 8 * mesh->nverts; i++) sum += mesh->vertexarray[i];
+	for(i = 0; i < 3 * mesh->ntris; i++) sum += (float)mesh->indexarray[i];
+	return sum;
+}
+
+/*
+ * cacheTest() - load a file through a fresh cache file, and then from
+ * the cache, and print the times and whether the meshes agree
+ */
+static void cacheTest(const char *filename, int reps) {
+	char cachename[1024];
+	objMesh parsed, mesh;
+	double t, tparse = 1e30, tcache = 1e30;
+	float sum = 0.0f;
+	int r, cached = 0, same;
+
+	if(objCacheName(cachename, sizeof(cachename), filename) != 0) return;
+	for(r = 0; r < reps; r++) {
+		remove(cachename);
+		t = seconds();
+		if(objLoadCached(&parsed, NULL, filename, NULL, OBJ_WELD, &cached) != 0) return;
+		sum += touchMesh(&parsed);
+		t = seconds() - t;
+		if(t < tparse) tparse = t;
+		if(r < reps - 1) objFree(&parsed);
+	}
+	for(r = 0; r < reps; r++) {
+		t = seconds();
+		if(objLoadCached(&mesh, NULL, filename, NULL, OBJ_WELD, &cached) != 0) break;
+		sum += touchMesh(&mesh);
+		t = seconds() - t;
+		if(t < tcache) tcache = t;
+		if(r < reps - 1) objFree(&mesh);
+	}
+	if(r < reps) {
+		objFree(&parsed);
+		return;
+	}
+	same = parsed.nverts == mesh.nverts && parsed.ntris == mesh.ntris
+		&& !memcmp(parsed.vertexarray, mesh.vertexarray, 8 * sizeof(float) * mesh.nverts)
+		&& !memcmp(parsed.indexarray, mesh.indexarray, 3 * sizeof(unsigned int) * mesh.ntris);
+	touchSink = sum;
+	printf("%-26s %10.2f %10.3f %8.0fx %7s %7s\n", filename, 1000.0 * tparse,
+		1000.0 * tcache, tparse / tcache, cached ? "yes" : "no", same ? "yes" : "no");
+	objFree(&parsed);
+	objFree(&mesh);
+}
+
+/*
+ * lodCacheTest() - load a file with OBJ_LODS through a fresh cache file,
+ * which builds the levels of detail, and then from the cache, and print
+ * the times and whether the levels agree
+ */
+static void lodCacheTest(const char *filename) {
+	char cachename[1024];
+	objMesh built, mesh;
+	meshLodChain builtlods, lods;
+	double t, tbuild, tcache;
+	int cached = 0, same;
+
+	if(objCacheName(cachename, sizeof(cachename), filename) != 0) return;
+	remove(cachename);
+	t = seconds();
+	if(objLoadCached(&built, &builtlods, filename, NULL, OBJ_WELD | OBJ_LODS, NULL) != 0) return;
+	tbuild = seconds() - t;
+	t = seconds();
+	if(objLoadCached(&mesh, &lods, filename, NULL, OBJ_WELD | OBJ_LODS, &cached) != 0) {
+		objFree(&built);
+		meshLodFree(&builtlods);
+		return;
+	}
+	tcache = seconds() - t;
+	same = lods.nlods == builtlods.nlods && lods.nindices == builtlods.nindices
+		&& lods.radius == builtlods.radius
+		&& !memcmp(lods.center, builtlods.center, sizeof(lods.center))
+		&& !memcmp(lods.lods, builtlods.lods, lods.nlods * sizeof(meshLod))
+		&& !memcmp(lods.indices, builtlods.indices, sizeof(unsigned int) * lods.nindices);
+	printf("%-26s %10.1f %10.3f %7d %7s %7s\n", filename, 1000.0 * tbuild, 1000.0 * tcache,
+		lods.nlods, cached ? "yes" : "no", same ? "yes" : "no");
+	objFree(&built);
+	objFree(&mesh);
+	meshLodFree(&builtlods);
+	meshLodFree(&lods);
+}
+
+/* Peak resident size of the process in MB, or 0 if unknown */
+static double peakRSS(void) {
+#ifdef _WIN32
+	return 0.0;
+#else
+	struct rusage usage;
+	if(getrusage(RUSAGE_SELF, &usage) != 0) return 0.0;
+#ifdef __APPLE__
+	return usage.ru_maxrss / 1048576.0; // In bytes on MacOSX
+#else
+	return usage.ru_maxrss / 1024.0;    // In KB on Linux
+#endif
+#endif
+}
+
+/* What streamBatch() has seen so far */
+typedef struct {
+	unsigned long long hash;
+	int batches;
+} streamCheck;
+
+/* An FNV-1a style hash of the bits of n floats, one float at a time */
+static unsigned long long hashFloats(unsigned long long h, const float *f, size_t n) {
+	unsigned int bits;
+	size_t i;
+
+	for(i = 0; i < n; i++) {
+		memcpy(&bits, &f[i], sizeof(bits));
+		h = (h ^ bits) * 0x100000001B3ULL;
+	}
+	return h;
+}
+
+static int streamBatch(const float *vertices, int ntris, void *user) {
+	streamCheck *check = (streamCheck*)user;
+	check->hash = hashFloats(check->hash, vertices, 24 * (size_t)ntris);
+	check->batches++;
+	return 0;
+}
+
+/*
+ * streamTest() - stream a file, and print the time, memory and whether
+ * the triangles were the same as from objLoad()
+ */
+static void streamTest(const char *filename, int batchtris, double limit) {
+	objStreamParams params;
+	objStreamStats stats;
+	streamCheck check;
+	objMesh mesh;
+	double t, rss;
+	int result;
+	const char *same;
+
+	objStreamDefaults(&params);
+	params.batchtris = batchtris;
+	params.memorylimit = (size_t)(limit * 1048576.0);
+	check.hash = 0xCBF29CE484222325ULL;
+	check.batches = 0;
+	t = seconds();
+	result = objStreamFile(filename, &params, streamBatch, &check, &stats);
+	t = seconds() - t;
+	rss = peakRSS(); // Before objLoad() below adds to it
+	if(result != 0) {
+		printf("%-26s failed with %d (line %d), %.1f MB allocated\n", filename, result,
+			stats.errorline, stats.peakmemory / 1048576.0);
+		return;
+	}
+	same = "-";
+	if(objLoad(&mesh, filename) == 0) {
+		same = (mesh.ntris == stats.ntris && check.hash
+			== hashFloats(0xCBF29CE484222325ULL, mesh.vertexarray, 8 * (size_t)mesh.nverts)) ? "yes" : "no";
+		objFree(&mesh);
+	}
+	printf("%-26s %9.1f %9d %8d %8.1f %9.1f %9.1f %5s\n", filename, fileSize(filename) / 1048576.0,
+		stats.ntris, check.batches, 1000.0 * t, stats.peakmemory / 1048576.0, rss, same);
+}
+
+/*
+ * threadTest() - parse copies of the text in a file with 1, 2, 4 ...
+ * threads, and print the speed of each and whether the results agree
+ */
+static void threadTest(const char *filename, int copies, int maxthreads, int reps) {
+	mappedFile file;
+	objMesh reference, mesh;
+	noisePool *pool;
+	char *text;
+	size_t size;
+	double t, best, mb, maxdiff;
+	int c, threads, r, mismatches;
+
+	if(mapFile(&file, filename) != 0) return;
+	size = file.size * copies;
+	text = (char*)malloc(size + 1);
+	if(text == NULL) {
+		unmapFile(&file);
+		return;
+	}
+	for(c = 0; c < copies; c++) memcpy(text + c * file.size, file.data, file.size);
+	unmapFile(&file);
+	mb = size / 1048576.0;
+
+	if(objParse(&reference, text, size) != 0) {
+		free(text);
+		return;
+	}
+	for(threads = 1; threads <= maxthreads; threads *= 2) {
+		pool = noisePoolCreate(threads);
+		if(pool == NULL) break;
+		best = 1e30;
+		mismatches = 0;
+		maxdiff = 0.0;
+		for(r = 0; r < reps; r++) {
+			t = seconds();
+			objParseThreaded(&mesh, text, size, pool, 0);
+			t = seconds() - t;
+			if(t < best) best = t;
+			if(r == 0) mismatches = compareMeshes(&reference, &mesh, &maxdiff);
+			objFree(&mesh);
+		}
+		noisePoolDestroy(pool);
+		printf("%-26s %9.1f %7d %10.1f %11d %9.2g\n", filename, mb, threads,
+			mb / best, mismatches, maxdiff);
+		if(threads < maxthreads && 2 * threads > maxthreads) threads = maxthreads / 2;
+	}
+	objFree(&reference);
+	free(text);
+}
+
+int main(int argc, char *argv[]) {
+	const char **files = defaultFiles;
+	int nfiles = sizeof(defaultFiles) / sizeof(defaultFiles[0]);
+	int reps = 10, maxthreads = 0, copies = 16, stream = 0, batchtris = 65536;
+	int a, f, r, mismatches;
+	double limit = 0.0;
+	double t, told, tnew, maxdiff;
+	noisePool *pool;
+	long size;
+	objMesh oldmesh, newmesh;
+
+	for(a = 1; a < argc && argv[a][0] == '-'; a++) {
+		if(!strcmp(argv[a], "-r") && a + 1 < argc) reps = atoi(argv[++a]);
+		else if(!strcmp(argv[a], "-t") && a + 1 < argc) maxthreads = atoi(argv[++a]);
+		else if(!strcmp(argv[a], "-x") && a + 1 < argc) copies = atoi(argv[++a]);
+		else if(!strcmp(argv[a], "-s")) stream = 1;
+		else if(!strcmp(argv[a], "-b") && a + 1 < argc) batchtris = atoi(argv[++a]);
+		else if(!strcmp(argv[a], "-m") && a + 1 < argc) limit = atof(argv[++a]);
+		else {
+			fprintf(stderr, "Usage: objbench [-r reps] [-t threads] [-x copies] "
+				"[-s [-b tris] [-m MB]] [file.obj ...]\n");
+			return 1;
+		}
+	}
+	if(a < argc) {
+		files = (const char**)&argv[a];
+		nfiles = argc - a;
+	}
+	if(reps < 1) reps = 1;
+	if(copies < 1) copies = 1;
+	if(stream) {
+		printf("%-26s %9s %9s %8s %8s %9s %9s %5s\n", "file", "MB", "tris", "batches",
+			"ms", "MB alloc", "MB RSS", "same");
+		for(f = 0; f < nfiles; f++) streamTest(files[f], batchtris, limit);
+		return 0;
+	}
+	if(maxthreads < 1) { // One per online CPU, as the pool counts them
+		pool = noisePoolCreate(0);
+		maxthreads = pool ? noisePoolThreads(pool) : 1;
+		noisePoolDestroy(pool);
+	}
+
+	printf("%-26s %9s %9s %9s %10s %10s %8s %11s %9s\n", "file", "MB", "tris",
+		"verts", "old MB/s", "new MB/s", "speedup", "mismatches", "max diff");
+	for(f = 0; f < nfiles; f++) {
+		size = fileSize(files[f]);
+		if(size < 0 || oldReadOBJ(&oldmesh, files[f]) != 0) {
+			printf("%-26s could not be read\n", files[f]);
+			continue;
+		}
+		objFree(&oldmesh);
+		told = tnew = 1e30;
+		for(r = 0; r < reps; r++) {
+			t = seconds();
+			oldReadOBJ(&oldmesh, files[f]);
+			t = seconds() - t;
+			if(t < told) told = t;
+			if(r < reps - 1) objFree(&oldmesh);
+
+			t = seconds();
+			if(objLoad(&newmesh, files[f]) != 0) {
+				printf("%-26s objLoad() failed at line %d\n", files[f], newmesh.errorline);
+				break;
+			}
+			t = seconds() - t;
+			if(t < tnew) tnew = t;
+			if(r < reps - 1) objFree(&newmesh);
+		}
+		if(r < reps) {
+			objFree(&oldmesh);
+			continue;
+		}
+
+		// Both parsers should give the same vertices
+		mismatches = compareMeshes(&oldmesh, &newmesh, &maxdiff);
+		printf("%-26s %9.2f %9d %9d %10.1f %10.1f %7.1fx %11d %9.2g\n", files[f],
+			size / 1048576.0, newmesh.ntris, newmesh.numverts, size / 1048576.0 / told,
+			size / 1048576.0 / tnew, told / tnew, mismatches, maxdiff);
+		objFree(&oldmesh);
+		objFree(&newmesh);
+	}
+
+	printf("\n%-26s %9s %9s %9s %9s %9s %8s %8s %11s\n", "file", "corners", "vertices",
+		"KB before", "KB after", "saving", "ms plain", "ms weld", "mismatches");
+	for(f = 0; f < nfiles; f++) weldTest(files[f], reps);
+
+	printf("\n%-26s %10s %10s %9s %7s %7s\n", "file", "ms parse", "ms cache", "speedup",
+		"cached", "same");
+	for(f = 0; f < nfiles; f++) cacheTest(files[f], reps);
+
+	printf("\n%-26s %10s %10s %7s %7s %7s\n", "file", "ms build", "ms cache", "levels",
+		"cached", "same");
+	for(f = 0; f < nfiles; f++) lodCacheTest(files[f]);
+
+	printf("\n%-26s %9s %7s %10s %11s %9s\n", "file", "MB", "threads", "MB/s",
+		"mismatches", "max diff");
+	for(f = 0; f < nfiles; f++) threadTest(files[f], copies, maxthreads, reps);
+	return 0;
+}
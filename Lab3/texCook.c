@@ -0,0 +1,58 @@
+/*
+ * texCook.c - mipmaps and block compression for textures. See texCook.h.
+ *
+ * This code is in the public domain.
+ */
+
+#include <stdlib.h> // For malloc() and free()
+#include <string.h> // For memset()
+
+#include "texCook.h"
+
+int texCook(cookedTexture *tex, const unsigned char *pixels, int width, int height, int bpp,
+	int filter, int flags, int format, int quality, noisePool *pool) {
+	size_t total = 0;
+	int level, channel = (format == BC4) ? bpp - 1 : 0;
+
+	memset(tex, 0, sizeof(cookedTexture));
+	if(format != TEX_RAW && format != BC1 && format != BC3 && format != BC4 && format != BC5) return -1;
+	if(mipBuild(&tex->chain, pixels, width, height, bpp, filter, flags, pool) != 0) return -1;
+	tex->format = format;
+	tex->bpp = bpp;
+	tex->filter = filter;
+	tex->flags = flags;
+	tex->quality = quality;
+	tex->nlevels = tex->chain.nlevels;
+	for(level = 0; level < tex->nlevels; level++) {
+		tex->width[level] = tex->chain.width[level];
+		tex->height[level] = tex->chain.height[level];
+		tex->levels[level] = tex->chain.levels[level];
+		tex->size[level] = (format == TEX_RAW) ? (size_t)tex->width[level] * tex->height[level] * bpp
+			: bcSize(format, tex->width[level], tex->height[level]);
+		total += tex->size[level];
+	}
+	if(format == TEX_RAW) return 0;
+
+	// Compress each level, and let go of the levels as they were
+	if((tex->blocks = (unsigned char*)malloc(total)) == NULL) {
+		texCookFree(tex);
+		return -1;
+	}
+	for(level = 0, total = 0; level < tex->nlevels; level++) {
+		if(bcEncode(tex->blocks + total, tex->chain.levels[level], tex->width[level], tex->height[level],
+			bpp, channel, format, quality, pool) != 0) {
+			texCookFree(tex);
+			return -1;
+		}
+		tex->levels[level] = tex->blocks + total;
+		total += tex->size[level];
+	}
+	mipFree(&tex->chain);
+	return 0;
+}
+
+void texCookFree(cookedTexture *tex) {
+	mipFree(&tex->chain);
+	free(tex->blocks);
+	memset(tex, 0, sizeof(cookedTexture));
+}
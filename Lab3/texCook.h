@@ -0,0 +1,52 @@
+/*
+ * texCook.h - the steps that make the pixels of an image ready to be a
+ * texture, without OpenGL dependencies: all its mipmap levels, made with
+ * mipBuild() (mipmap.h), and, if asked for, all of them block compressed
+ * with bcEncode() (bcEncode.h). Used by createTexture() in tgaloader.c.
+ *
+ * BC1 and BC3 take the RGB or RGBA of the image. BC4 takes its last
+ * channel, which is the height in the alpha of the texture for
+ * vertexshader.glsl, and BC5 its first two, as for a normal map.
+ *
+ * This code is in the public domain.
+ */
+
+#ifndef TEXCOOK_H
+#define TEXCOOK_H
+
+#include <stddef.h> // For size_t
+
+#include "mipmap.h"
+#include "bcEncode.h"
+#include "threadPool.h" // For noisePool
+
+// The format of levels that are not compressed: bpp bytes per pixel
+#define TEX_RAW 0
+
+typedef struct {
+	int format;     // TEX_RAW, BC1, BC3, BC4 or BC5
+	int bpp;        // Bytes per pixel of the image, 3 or 4
+	int filter, flags, quality; // What it was cooked with
+	int nlevels;
+	int width[MIP_MAX_LEVELS], height[MIP_MAX_LEVELS];
+	const unsigned char *levels[MIP_MAX_LEVELS];
+	size_t size[MIP_MAX_LEVELS]; // Bytes of each level
+	unsigned char *blocks; // The compressed levels, one after the other
+	mipChain chain;        // The levels before compression, kept for TEX_RAW
+} cookedTexture;
+
+/*
+ * texCook() - the mipmaps of the image of width x height pixels of bpp
+ * bytes (3 or 4), made with filter and flags as for mipBuild(), in
+ * format, compressed with quality, using the threads of pool, which may
+ * be NULL. For TEX_RAW, level 0 is the image itself, which must stay
+ * until tex is freed. Returns 0, or -1 if out of memory or for bad
+ * arguments.
+ */
+int texCook(cookedTexture *tex, const unsigned char *pixels, int width, int height, int bpp,
+	int filter, int flags, int format, int quality, noisePool *pool);
+
+/* texCookFree() - free the levels of tex and set it to all zeros */
+void texCookFree(cookedTexture *tex);
+
+#endif /* TEXCOOK_H */
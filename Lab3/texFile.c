@@ -0,0 +1,151 @@
+/*
+ * texFile.c - .tex files of cooked textures. See texFile.h.
+ *
+ * This code is in the public domain.
+ */
+
+#include <stdio.h>  // For fopen(), fwrite(), rename() and remove()
+#include <stdlib.h> // For malloc() and free()
+#include <string.h> // For memset(), memcmp() and strlen()
+
+#include "texFile.h"
+
+// Alignment of the levels in the file
+#define TEX_FILE_ALIGN 64
+
+static const char magic[4] = { 'T', 'E', 'X', 0x1a };
+
+static unsigned long long alignUp(unsigned long long n) {
+	return (n + TEX_FILE_ALIGN - 1) & ~(unsigned long long)(TEX_FILE_ALIGN - 1);
+}
+
+/* The bytes of a level of width x height in format */
+static unsigned long long levelSize(unsigned int format, unsigned int bpp,
+	unsigned int width, unsigned int height) {
+	if(format == TEX_RAW) return (unsigned long long)width * height * bpp;
+	return bcSize(format, width, height);
+}
+
+int texFileName(char *dst, size_t size, const char *sourcename) {
+	size_t n = strlen(sourcename), stem = n, i;
+
+	for(i = n; i > 0; i--) { // Find the extension, if there is one
+		if(sourcename[i - 1] == '.') {
+			stem = i - 1;
+			break;
+		}
+		if(sourcename[i - 1] == '/' || sourcename[i - 1] == '\\') break;
+	}
+	if(stem + 5 > size) return -1;
+	memcpy(dst, sourcename, stem);
+	memcpy(dst + stem, ".tex", 5);
+	return 0;
+}
+
+/* Nonzero if the header and the levels it points to make sense for a file of size bytes */
+static int validHeader(const texFileHeader *header, size_t size) {
+	const texFileLevel *level;
+	unsigned int i, width, height;
+
+	if(size < sizeof(texFileHeader) || memcmp(header->magic, magic, 4) != 0
+		|| header->version != TEX_FILE_VERSION || header->headersize != sizeof(texFileHeader)
+		|| (header->format != TEX_RAW && header->format != BC1 && header->format != BC3
+		&& header->format != BC4 && header->format != BC5) || (header->bpp != 3 && header->bpp != 4)
+		|| header->nlevels < 1 || header->nlevels > MIP_MAX_LEVELS) return 0;
+	// Each level half the size of the one before, aligned and inside the file
+	for(i = 0; i < header->nlevels; i++) {
+		level = &header->levels[i];
+		width = (i == 0) ? level->width : (header->levels[i - 1].width > 1) ? header->levels[i - 1].width / 2 : 1;
+		height = (i == 0) ? level->height : (header->levels[i - 1].height > 1) ? header->levels[i - 1].height / 2 : 1;
+		if(level->width == 0 || level->height == 0 || level->width != width || level->height != height
+			|| level->size != levelSize(header->format, header->bpp, width, height)
+			|| level->offset % TEX_FILE_ALIGN || level->offset < sizeof(texFileHeader)
+			|| level->offset > size || level->size > size - level->offset) return 0;
+	}
+	return 1;
+}
+
+int texReadFile(texFile *tex, const char *filename, const char *sourcename) {
+	unsigned long long size = 0, hash = 0;
+	long long mtime = 0;
+
+	memset(tex, 0, sizeof(texFile));
+	if(sourcename != NULL && fileFingerprint(sourcename, &size, &mtime, &hash) != 0) return -1;
+	if(mapFileStream(&tex->file, filename) != 0) return -1;
+	tex->header = (const texFileHeader*)tex->file.data;
+	if(tex->header == NULL || !validHeader(tex->header, tex->file.size) || (sourcename != NULL
+		&& (tex->header->sourcesize != size || tex->header->sourcemtime != mtime
+		|| tex->header->sourcehash != hash))) {
+		texCloseFile(tex);
+		return -1;
+	}
+	return 0;
+}
+
+const unsigned char *texFileLevelData(const texFile *tex, int level) {
+	return (const unsigned char*)tex->file.data + tex->header->levels[level].offset;
+}
+
+void texReleaseLevel(texFile *tex, int level) {
+	releaseFileRange(&tex->file, (size_t)tex->header->levels[level].offset, (size_t)tex->header->levels[level].size);
+}
+
+void texCloseFile(texFile *tex) {
+	unmapFile(&tex->file);
+	tex->header = NULL;
+}
+
+int texWriteFile(const cookedTexture *tex, const char *filename, const char *sourcename, int semantics) {
+	texFileHeader header;
+	static const char zeros[TEX_FILE_ALIGN] = {0};
+	unsigned long long offset;
+	char *tempname;
+	FILE *file;
+	int i, ok;
+
+	memset(&header, 0, sizeof(header));
+	if(sourcename != NULL && fileFingerprint(sourcename, &header.sourcesize, &header.sourcemtime,
+		&header.sourcehash) != 0) return -1;
+	memcpy(header.magic, magic, 4);
+	header.version = TEX_FILE_VERSION;
+	header.headersize = sizeof(texFileHeader);
+	header.format = tex->format;
+	header.bpp = tex->bpp;
+	header.semantics = semantics;
+	header.filter = tex->filter;
+	header.flags = tex->flags;
+	header.quality = tex->quality;
+	header.nlevels = tex->nlevels;
+	// The smallest level first
+	for(i = tex->nlevels - 1, offset = sizeof(header); i >= 0; i--) {
+		header.levels[i].offset = offset;
+		header.levels[i].size = tex->size[i];
+		header.levels[i].width = tex->width[i];
+		header.levels[i].height = tex->height[i];
+		offset = alignUp(offset + tex->size[i]);
+	}
+
+	tempname = (char*)malloc(strlen(filename) + 5);
+	if(tempname == NULL) return -1;
+	strcpy(tempname, filename);
+	strcat(tempname, ".tmp");
+	file = fopen(tempname, "wb");
+	if(file == NULL) {
+		free(tempname);
+		return -1;
+	}
+	ok = fwrite(&header, sizeof(header), 1, file) == 1;
+	for(i = tex->nlevels - 1, offset = sizeof(header); ok && i >= 0; i--) {
+		ok = fwrite(zeros, 1, header.levels[i].offset - offset, file) == header.levels[i].offset - offset
+			&& fwrite(tex->levels[i], 1, tex->size[i], file) == tex->size[i];
+		offset = header.levels[i].offset + tex->size[i];
+	}
+	ok = (fclose(file) == 0) && ok;
+	if(ok) {
+		remove(filename); // rename() does not replace files on Windows
+		ok = (rename(tempname, filename) == 0);
+	}
+	if(!ok) remove(tempname);
+	free(tempname);
+	return ok ? 0 : -1;
+}
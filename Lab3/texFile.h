@@ -0,0 +1,107 @@
+/*
+ * texFile.h - .tex files: textures cooked by texCook() (texCook.h), with
+ * all their mipmap levels, to be mapped and handed to OpenGL as they
+ * are. createTexture() in tgaloader.c keeps one next to each TGA file and
+ * uses it instead of the TGA file while it is up to date, in the same way
+ * as the .soup files of objCache.h for OBJ files.
+ *
+ * A .tex file is a header of 512 bytes followed by the levels, smallest
+ * first, as in KTX2 files, so that a reader that wants a small version
+ * of the texture first reads the file from the start. Each level starts
+ * at a multiple of 64 bytes. The header has
+ * - a magic number, a version and its own size, which must all match;
+ * - the pixel format, TEX_RAW or a BC format, the bytes per pixel of
+ *   the image, and what its channels hold (TEX_SRGB and so on below);
+ * - what it was cooked with: the mipmap filter and flags, and the
+ *   quality of the compression;
+ * - the size, modification time and sampled hash of the file that it
+ *   was cooked from (see fileFingerprint() in mappedFile.h), or zeros;
+ * - the size and place of each level.
+ * The numbers are little endian, as on all the machines this runs on.
+ *
+ * This code is in the public domain.
+ */
+
+#ifndef TEXFILE_H
+#define TEXFILE_H
+
+#include "mappedFile.h"
+#include "texCook.h"
+
+#define TEX_FILE_VERSION 2
+
+/* What the channels hold, for texFileHeader.semantics */
+#define TEX_SRGB 1         // The color channels are sRGB encoded
+#define TEX_ALPHA_HEIGHT 2 // Alpha, or the one channel of BC4, is a height map
+#define TEX_NORMAL_XY 4    // The first two channels are X and Y of unit normals
+
+typedef struct {
+	unsigned long long offset; // From the start of the file
+	unsigned long long size;   // In bytes
+	unsigned int width, height;
+} texFileLevel;
+
+/* The header at the start of a .tex file, 512 bytes */
+typedef struct {
+	char magic[4];               // "TEX\x1a"
+	unsigned int version;        // TEX_FILE_VERSION
+	unsigned int headersize;     // sizeof(texFileHeader), as a sanity check
+	unsigned int format;         // TEX_RAW, BC1, BC3, BC4 or BC5
+	unsigned int bpp;            // Bytes per pixel of the image, 3 or 4
+	unsigned int semantics;      // TEX_SRGB and so on
+	unsigned int filter, flags;  // What mipBuild() was called with
+	unsigned int quality;        // What bcEncode() was called with
+	unsigned int nlevels;
+	unsigned long long sourcesize;  // Size of the source file in bytes
+	long long sourcemtime;          // Modification time of the source file
+	unsigned long long sourcehash;  // Sampled hash of the source file
+	texFileLevel levels[MIP_MAX_LEVELS]; // Level 0 is the whole image
+	char pad[64];
+} texFileHeader;
+
+/* A .tex file, mapped */
+typedef struct {
+	const texFileHeader *header;
+	mappedFile file;
+} texFile;
+
+/*
+ * texReadFile() - map the .tex file filename and check that it is whole
+ * and sound. If sourcename is not NULL, it must also have been cooked
+ * from that file as it is now. The levels are not read in up front, see
+ * texFileLevelData(). Returns 0, or -1 if the file is missing, damaged
+ * or out of date.
+ */
+int texReadFile(texFile *tex, const char *filename, const char *sourcename);
+
+/*
+ * texFileLevelData() - the pixels or blocks of a level, in the mapping,
+ * which are read in from the file as they are used
+ */
+const unsigned char *texFileLevelData(const texFile *tex, int level);
+
+/*
+ * texReleaseLevel() - give back the memory of a level that is done with,
+ * as with releaseFileRange()
+ */
+void texReleaseLevel(texFile *tex, int level);
+
+/* texCloseFile() - unmap a file from texReadFile() */
+void texCloseFile(texFile *tex);
+
+/*
+ * texWriteFile() - write a cooked texture to the .tex file filename,
+ * with what its channels hold in semantics. If sourcename is not NULL,
+ * it is the file that the texture was cooked from. The file is written
+ * under a temporary name and then renamed, so a reader never sees half
+ * a file. Returns 0 on success or -1 on errors.
+ */
+int texWriteFile(const cookedTexture *tex, const char *filename, const char *sourcename, int semantics);
+
+/*
+ * texFileName() - the name of the .tex file for an image file, in dst,
+ * which has room for size characters. Returns 0, or -1 if it won't fit.
+ */
+int texFileName(char *dst, size_t size, const char *sourcename);
+
+#endif /* TEXFILE_H */
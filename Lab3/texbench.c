@@ -0,0 +1,182 @@
+/*
+ * texbench.c - time the .tex files of texFile.c against cooking the
+ * texture again from its TGA file, as createTexture() in tgaloader.c
+ * would otherwise do each time.
+ *
+ * Each image is cooked with all its mipmaps, uncompressed and as BC1 or
+ * BC3, and written to a .tex file, which is then mapped with texReadFile().
+ * The times shown are for reading the TGA file, cooking, writing, mapping
+ * and checking the header, reading the small levels that createTexture()
+ * uploads first, and reading all levels. The levels read back are
+ * compared with the ones that were written.
+ *
+ * Usage: texbench [threads [size [file.tga ...]]]
+ * The default is one thread per CPU, a size of 4096 for the painted test
+ * image, and textures/pyramid.tga. A size of 0 leaves the test image out.
+ *
+ * This code is in the public domain.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "bench.h"
+#include "texFile.h"
+#include "tgaDecode.h"
+#include "threadPool.h"
+
+#define TEST_SIZE 4096
+#define TEST_FILE "textures/pyramid.tga"
+#define TEMP_FILE "texbench.tex"
+#define STREAM_BYTES (64 * 1024) // As TGA_STREAM_BYTES in tgaloader.h
+
+/* A TGA file as RGB(A), or NULL */
+static unsigned char *loadImage(const char *filename, int *width, int *height, int *bpp) {
+	unsigned char *pixels;
+	tgaImage image;
+
+	if(tgaOpen(&image, filename) != 0) return NULL;
+	pixels = (unsigned char*)malloc((size_t)image.width * image.height * image.bpp);
+	if(pixels != NULL && tgaReadRows(&image, pixels, image.height) != image.height) {
+		free(pixels);
+		pixels = NULL;
+	}
+	*width = image.width;
+	*height = image.height;
+	*bpp = image.bpp;
+	tgaClose(&image);
+	return pixels;
+}
+
+/* Smooth color gradients, hard edged tiles and noise, with a height in alpha */
+static unsigned char *makeImage(int size) {
+	unsigned char *image = (unsigned char*)malloc((size_t)size * size * 4), *p;
+	unsigned int seed = 1;
+	int x, y, c, tile;
+	float u, v, h;
+
+	if(image == NULL) return NULL;
+	for(y = 0; y < size; y++) {
+		for(x = 0; x < size; x++) {
+			p = image + 4 * ((size_t)y * size + x);
+			u = (float)x / size;
+			v = (float)y / size;
+			seed = seed * 1664525u + 1013904223u;
+			tile = ((x >> 7) ^ (y >> 7)) & 1;
+			for(c = 0; c < 3; c++) {
+				h = 127.5f + 90.0f * sinf(6.2832f * ((c + 1) * u + (3 - c) * v)) + (float)(seed >> 29);
+				p[c] = (unsigned char)(tile ? h : 255.0f - h);
+			}
+			h = 0.5f + 0.25f * sinf(25.0f * u) * sinf(19.0f * v) + 0.2f * u;
+			p[3] = (unsigned char)(235.0f * h + (float)(seed >> 28));
+		}
+	}
+	return image;
+}
+
+/* Add up the bytes of levels last down to first, so that they are all read */
+static unsigned int touchLevels(const texFile *tex, int last, int first) {
+	const unsigned char *data;
+	unsigned int sum = 0;
+	size_t i;
+	int level;
+
+	for(level = last; level >= first; level--) {
+		data = texFileLevelData(tex, level);
+		for(i = 0; i < tex->header->levels[level].size; i++) sum += data[i];
+	}
+	return sum;
+}
+
+static void bench(const char *name, const char *filename, const unsigned char *pixels,
+	int width, int height, int bpp, double tload, noisePool *pool) {
+	cookedTexture cooked;
+	texFile tex;
+	unsigned int sum;
+	size_t total;
+	int i, level, first, format, same;
+	double t, tcook, twrite;
+
+	printf("\n%s, %d x %d, %d bytes per pixel", name, width, height, bpp);
+	if(filename != NULL) printf(", read in %.1f ms", 1e3 * tload);
+	printf(":\n");
+	for(i = 0; i < 2; i++) {
+		format = (i == 0) ? TEX_RAW : (bpp == 4) ? BC3 : BC1;
+		t = seconds();
+		if(texCook(&cooked, pixels, width, height, bpp, MIP_KAISER, MIP_SRGB | MIP_WRAP,
+			format, BC_NORMAL, pool) != 0) {
+			printf("  Out of memory\n");
+			return;
+		}
+		tcook = seconds() - t;
+		t = seconds();
+		if(texWriteFile(&cooked, TEMP_FILE, filename, TEX_SRGB | ((bpp == 4) ? TEX_ALPHA_HEIGHT : 0)) != 0) {
+			printf("  Could not write %s\n", TEMP_FILE);
+			texCookFree(&cooked);
+			return;
+		}
+		twrite = seconds() - t;
+		printf("  %-4s %2d levels, cooked in %8.1f ms, written in %6.1f ms\n",
+			(format == TEX_RAW) ? "Raw" : bcFormatName(format), cooked.nlevels, 1e3 * tcook, 1e3 * twrite);
+
+		t = seconds();
+		if(texReadFile(&tex, TEMP_FILE, filename) != 0) {
+			printf("  Could not read %s back\n", TEMP_FILE);
+			texCookFree(&cooked);
+			continue;
+		}
+		printf("       mapped and checked in %6.3f ms\n", 1e3 * (seconds() - t));
+		// The levels that createTexture() uploads right away
+		for(first = cooked.nlevels - 1; first > 0 && cooked.size[first - 1] <= STREAM_BYTES; first--);
+		t = seconds();
+		sum = touchLevels(&tex, cooked.nlevels - 1, first);
+		for(level = first, total = 0; level < cooked.nlevels; level++) total += cooked.size[level];
+		printf("       levels %d and smaller (%lu bytes) read in %6.3f ms\n", first,
+			(unsigned long)total, 1e3 * (seconds() - t));
+		t = seconds();
+		sum += touchLevels(&tex, first - 1, 0);
+		printf("       all levels (%lu bytes) read in %6.1f ms, sum %08x\n",
+			(unsigned long)tex.file.size, 1e3 * (seconds() - t), sum);
+		for(level = 0, same = 1; level < cooked.nlevels; level++)
+			same = same && memcmp(texFileLevelData(&tex, level), cooked.levels[level], cooked.size[level]) == 0;
+		if(!same) printf("       The levels read back are not the ones written!\n");
+		texCloseFile(&tex);
+		texCookFree(&cooked);
+	}
+	remove(TEMP_FILE);
+}
+
+int main(int argc, char *argv[]) {
+	noisePool *pool = noisePoolCreate((argc > 1) ? atoi(argv[1]) : 0);
+	int size = (argc > 2) ? atoi(argv[2]) : TEST_SIZE, width, height, bpp, i;
+	const char *filename;
+	unsigned char *pixels;
+	double t;
+
+	if(pool == NULL) {
+		printf("Could not start the threads.\n");
+		return 1;
+	}
+	printf("%d threads\n", noisePoolThreads(pool));
+	for(i = (argc > 3) ? 3 : 0; i < ((argc > 3) ? argc : 1); i++) {
+		filename = (argc > 3) ? argv[i] : TEST_FILE;
+		t = seconds();
+		if((pixels = loadImage(filename, &width, &height, &bpp)) == NULL) {
+			printf("\nCould not load %s\n", filename);
+			continue;
+		}
+		bench(filename, filename, pixels, width, height, bpp, seconds() - t, pool);
+		free(pixels);
+	}
+	if(size > 0) {
+		if((pixels = makeImage(size)) == NULL) printf("\nNo memory for the test image\n");
+		else {
+			bench("Test image", NULL, pixels, size, size, 4, 0.0, pool);
+			free(pixels);
+		}
+	}
+	noisePoolDestroy(pool);
+	return 0;
+}
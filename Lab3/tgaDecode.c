@@ -0,0 +1,213 @@
+/*
+ * tgaDecode.c - decoding of TGA pixel data, see tgaDecode.h.
+ *
+ * This code is in the public domain.
+ */
+
+#include <string.h> // For memcpy()
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define TGA_SIMD 1
+#endif
+
+#include "tgaDecode.h"
+
+// Shortest run, in pixels, that is expanded with vector stores
+#define TGA_RUN_SIMD_MIN 8
+// Bytes of pixels that tgaReadRows() does between giving back the file
+#define TGA_CHUNK_BYTES (256 * 1024)
+
+typedef void (*swizzleFunction)(unsigned char *dst, const unsigned char *src, size_t npixels, int bpp);
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define TGA_SWIZZLE_DISPATCH 1
+// In tgaSwizzle.c
+void tgaSwizzleSSSE3(unsigned char *dst, const unsigned char *src, size_t npixels, int bpp);
+void tgaSwizzleAVX2(unsigned char *dst, const unsigned char *src, size_t npixels, int bpp);
+#endif
+
+static swizzleFunction swizzle = NULL;
+
+/* The swizzle for CPUs without SSSE3 */
+static void swizzlePlain(unsigned char *dst, const unsigned char *src, size_t npixels, int bpp) {
+	size_t i = 0;
+	unsigned char t;
+
+	if(bpp == 4) {
+#ifdef TGA_SIMD
+		// B and R are bytes 0 and 2 of each 32 bit lane, so they swap
+		// places with a shift by 16 each way, and G and A stay
+		const __m128i rb = _mm_set1_epi32(0x00ff00ff);
+		__m128i p, q;
+		for(; i + 4 <= npixels; i += 4) {
+			p = _mm_loadu_si128((const __m128i*)(src + 4 * i));
+			q = _mm_and_si128(p, rb);
+			q = _mm_or_si128(_mm_slli_epi32(q, 16), _mm_srli_epi32(q, 16));
+			p = _mm_or_si128(_mm_andnot_si128(rb, p), q);
+			_mm_storeu_si128((__m128i*)(dst + 4 * i), p);
+		}
+#endif
+		for(; i < npixels; i++) {
+			t = src[4 * i];
+			dst[4 * i] = src[4 * i + 2];
+			dst[4 * i + 1] = src[4 * i + 1];
+			dst[4 * i + 2] = t;
+			dst[4 * i + 3] = src[4 * i + 3];
+		}
+	}
+	else {
+		for(; i < npixels; i++) {
+			t = src[3 * i];
+			dst[3 * i] = src[3 * i + 2];
+			dst[3 * i + 1] = src[3 * i + 1];
+			dst[3 * i + 2] = t;
+		}
+	}
+}
+
+/* The best swizzle for this CPU, as for noiseDetectISA() in cpuNoise.c */
+static swizzleFunction chooseSwizzle(void) {
+#ifdef TGA_SWIZZLE_DISPATCH
+	__builtin_cpu_init();
+	if(__builtin_cpu_supports("avx2")) return tgaSwizzleAVX2;
+	if(__builtin_cpu_supports("ssse3")) return tgaSwizzleSSSE3;
+#endif
+	return swizzlePlain;
+}
+
+void tgaSwizzle(unsigned char *dst, const unsigned char *src, size_t npixels, int bpp) {
+	if(swizzle == NULL) swizzle = chooseSwizzle();
+	swizzle(dst, src, npixels, bpp);
+}
+
+/* Write count copies of the pixel of bpp bytes (already swizzled) */
+static void fillRun(unsigned char *dst, const unsigned char *pixel, int count, int bpp) {
+	int i, n = count * bpp;
+#ifdef TGA_SIMD
+	unsigned char pattern[48]; // A whole number of pixels of 3 or 4 bytes
+	__m128i a, b, c;
+
+	if(count >= TGA_RUN_SIMD_MIN) {
+		for(i = 0; i < 48; i += bpp) memcpy(pattern + i, pixel, bpp);
+		a = _mm_loadu_si128((const __m128i*)pattern);
+		b = _mm_loadu_si128((const __m128i*)(pattern + 16));
+		c = _mm_loadu_si128((const __m128i*)(pattern + 32));
+		for(i = 0; i + 48 <= n; i += 48) {
+			_mm_storeu_si128((__m128i*)(dst + i), a);
+			_mm_storeu_si128((__m128i*)(dst + i + 16), b);
+			_mm_storeu_si128((__m128i*)(dst + i + 32), c);
+		}
+		memcpy(dst + i, pattern, n - i);
+		return;
+	}
+#endif
+	for(i = 0; i < n; i += bpp) memcpy(dst + i, pixel, bpp);
+}
+
+/*
+ * Expand npixels pixels from the packets at src, from where state is.
+ * A packet may be left part done, to go on with in the next call.
+ */
+static int decodePackets(tgaRleState *state, unsigned char *dst, const unsigned char *src,
+	size_t srcsize, size_t npixels, int bpp) {
+	const unsigned char *p = src + state->offset, *end = src + srcsize;
+	int count;
+
+	if(swizzle == NULL) swizzle = chooseSwizzle();
+	while(npixels > 0) {
+		if(state->left == 0) { // The next packet
+			if(p >= end) return -1;
+			state->left = (*p & 127) + 1;
+			state->run = *p++ & 128;
+			if(state->run) { // A run of one pixel
+				if(end - p < bpp) return -1;
+				state->pixel[0] = p[2];
+				state->pixel[1] = p[1];
+				state->pixel[2] = p[0];
+				state->pixel[3] = (bpp == 4) ? p[3] : 0;
+				p += bpp;
+			}
+			else if(end - p < state->left * bpp) return -1; // Raw pixels
+		}
+		count = ((size_t)state->left < npixels) ? state->left : (int)npixels;
+		if(state->run) fillRun(dst, state->pixel, count, bpp);
+		else {
+			swizzle(dst, p, count, bpp);
+			p += count * bpp;
+		}
+		dst += (size_t)count * bpp;
+		npixels -= count;
+		state->left -= count;
+	}
+	state->offset = p - src;
+	return 0;
+}
+
+int tgaDecodeRLE(unsigned char *dst, const unsigned char *src, size_t srcsize,
+	size_t npixels, int bpp) {
+	tgaRleState state;
+
+	memset(&state, 0, sizeof(state));
+	if(decodePackets(&state, dst, src, srcsize, npixels, bpp) != 0 || state.left != 0) return -1;
+	return 0;
+}
+
+int tgaOpen(tgaImage *image, const char *filename) {
+	const unsigned char *h;
+	size_t start;
+
+	memset(image, 0, sizeof(tgaImage));
+	if(mapFileStream(&image->file, filename) != 0) return -1;
+	h = (const unsigned char*)image->file.data;
+	start = 18 + (h ? h[0] : 0); // After the header and the image ID
+	if(image->file.size < 18 || h[1] != 0 || (h[2] != 2 && h[2] != 10)
+		|| (h[16] != 24 && h[16] != 32) || image->file.size < start) {
+		tgaClose(image);
+		return -1;
+	}
+	image->width = h[12] + 256 * h[13];
+	image->height = h[14] + 256 * h[15];
+	image->bpp = h[16] / 8;
+	image->rle = (h[2] == 10);
+	image->topdown = (h[17] & 32) != 0;
+	image->data = h + start;
+	image->datasize = image->file.size - start;
+	if(image->width == 0 || image->height == 0 || (!image->rle
+		&& image->datasize < (size_t)image->width * image->height * image->bpp)) {
+		tgaClose(image);
+		return -1;
+	}
+	if(!image->rle) image->pixels = image->data;
+	return 0;
+}
+
+int tgaReadRows(tgaImage *image, unsigned char *dst, int nrows) {
+	size_t rowsize = (size_t)image->width * image->bpp, done;
+	int rows, chunk = TGA_CHUNK_BYTES / rowsize, left;
+
+	if(nrows > image->height - image->row) nrows = image->height - image->row;
+	if(chunk < 1) chunk = 1;
+	// A chunk at a time, giving back the part of the file that is done
+	// with after each, so that not all of it is in memory at once
+	for(left = nrows; left > 0; left -= rows, dst += rows * rowsize) {
+		rows = (left < chunk) ? left : chunk;
+		if(image->rle) {
+			if(decodePackets(&image->state, dst, image->data, image->datasize,
+				(size_t)rows * image->width, image->bpp) != 0) return -1;
+			done = image->state.offset;
+		}
+		else {
+			tgaSwizzle(dst, image->pixels + image->row * rowsize, (size_t)rows * image->width, image->bpp);
+			done = (image->row + rows) * rowsize;
+		}
+		image->row += rows;
+		releaseFileRange(&image->file, 0, (image->data - (const unsigned char*)image->file.data) + done);
+	}
+	return (nrows > 0) ? nrows : 0;
+}
+
+void tgaClose(tgaImage *image) {
+	unmapFile(&image->file);
+	image->pixels = image->data = NULL;
+}
@@ -0,0 +1,90 @@
+/*
+ * tgaDecode.h - decoding of the pixel data of TGA files, without OpenGL
+ * dependencies, used by loadTGA() and createTexture() in tgaloader.c.
+ *
+ * TGA files store the pixels as BGR or BGRA, 3 or 4 bytes per pixel,
+ * either as they are (image type 2) or run length encoded (image type
+ * 10). The RLE data is a sequence of packets, each starting with a byte
+ * whose low 7 bits are one less than the number of pixels in it. If the
+ * top bit is set, the packet is a run: one pixel that is repeated. If
+ * not, it is raw: that many pixels follow as they are. Packets may span
+ * scanlines.
+ *
+ * The functions below swap the B and R channels to RGB or RGBA for
+ * OpenGL while they copy, so the pixels are only touched once. The swap
+ * uses the byte shuffle of SSSE3 or AVX2 where the CPU has it (see
+ * tgaSwizzle.c), and SSE2 shifts for 4 byte pixels otherwise. Runs are
+ * expanded with 16 byte SSE2 stores of the repeated pixel.
+ *
+ * tgaOpen() maps a file instead of reading it. Uncompressed pixels can
+ * then be used right where they are in the file, as BGR(A), or be read
+ * a few rows at a time with tgaReadRows() into a buffer of the caller,
+ * which gives back the part of the file it is done with. Either way,
+ * there is never more than one copy of the image in memory.
+ *
+ * This code is in the public domain.
+ */
+
+#ifndef TGADECODE_H
+#define TGADECODE_H
+
+#include <stddef.h> // For size_t
+
+#include "mappedFile.h"
+
+/* Where tgaReadRows() is in the RLE packets */
+typedef struct {
+	size_t offset;          // Of the next packet
+	int left;               // Pixels left of the packet before it
+	int run;                // Nonzero if that packet is a run
+	unsigned char pixel[4]; // The pixel of the run, swapped
+} tgaRleState;
+
+/* A TGA file opened with tgaOpen() */
+typedef struct {
+	int width, height;
+	int bpp;       // Bytes per pixel, 3 or 4
+	int rle;       // Nonzero for RLE compressed pixels
+	int topdown;   // Nonzero if the first row is the top of the image
+	const unsigned char *pixels; // The BGR(A) pixels in the mapped file, or NULL if RLE
+	const unsigned char *data;   // The pixels or the RLE packets
+	size_t datasize;
+	int row;       // The next row for tgaReadRows()
+	tgaRleState state;
+	mappedFile file;
+} tgaImage;
+
+/*
+ * tgaSwizzle() - copy npixels pixels of bpp bytes each (3 or 4) from
+ * src to dst, swapping the first and third byte of each pixel. dst may
+ * be the same as src, to swap in place.
+ */
+void tgaSwizzle(unsigned char *dst, const unsigned char *src, size_t npixels, int bpp);
+
+/*
+ * tgaDecodeRLE() - expand the RLE packets in the srcsize bytes at src to
+ * npixels pixels of bpp bytes each (3 or 4) at dst, swapped as above.
+ * Returns 0, or -1 if the data ends before npixels pixels are done or a
+ * packet goes past them.
+ */
+int tgaDecodeRLE(unsigned char *dst, const unsigned char *src, size_t srcsize,
+	size_t npixels, int bpp);
+
+/*
+ * tgaOpen() - map a TGA file of type 2 or 10, with 24 or 32 bits per
+ * pixel, and fill in image from its header. Returns 0, or -1 if the file
+ * could not be mapped or is not such a file.
+ */
+int tgaOpen(tgaImage *image, const char *filename);
+
+/*
+ * tgaReadRows() - the next nrows rows of the image (in file order, see
+ * topdown) as RGB(A) to dst, which has room for them. Returns the number
+ * of rows, fewer at the end of the image, or -1 if the RLE data is bad.
+ */
+int tgaReadRows(tgaImage *image, unsigned char *dst, int nrows);
+
+/* tgaClose() - unmap the file of image */
+void tgaClose(tgaImage *image);
+
+#endif /* TGADECODE_H */
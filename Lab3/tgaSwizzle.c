@@ -0,0 +1,86 @@
+/*
+ * tgaSwizzle.c - the BGR(A) to RGB(A) swizzle of tgaDecode.c with the
+ * byte shuffle (pshufb) of SSSE3 or AVX2. Compiled twice, with the -m
+ * flags and -DTGA_SWIZZLE_SSSE3 or -DTGA_SWIZZLE_AVX2, see the Makefile,
+ * and chosen at runtime by tgaSwizzle().
+ *
+ * Pixels of 4 bytes are swapped 4 or 8 at a time. Pixels of 3 bytes are
+ * done 4 (or 2 x 4) at a time from a 16 byte load that also holds 4
+ * bytes of the next pixels. Those 4 bytes are stored back as they were,
+ * so dst may be the same as src, and the next step writes them over.
+ *
+ * This code is in the public domain.
+ */
+
+#include <stddef.h> // For size_t
+
+#if defined(__SSSE3__)
+#include <immintrin.h>
+
+#include "tgaDecode.h"
+
+#if defined(TGA_SWIZZLE_AVX2) && defined(__AVX2__)
+#define TGA_SWIZZLE tgaSwizzleAVX2
+#else
+#define TGA_SWIZZLE tgaSwizzleSSSE3
+#endif
+
+void TGA_SWIZZLE(unsigned char *dst, const unsigned char *src, size_t npixels, int bpp) {
+	size_t i = 0;
+	unsigned char t;
+
+	if(bpp == 4) {
+		const __m128i swap4 = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+		__m128i p;
+#if defined(__AVX2__)
+		const __m256i swap8 = _mm256_broadcastsi128_si256(swap4);
+		__m256i q;
+		for(; i + 8 <= npixels; i += 8) {
+			q = _mm256_loadu_si256((const __m256i*)(src + 4 * i));
+			_mm256_storeu_si256((__m256i*)(dst + 4 * i), _mm256_shuffle_epi8(q, swap8));
+		}
+#endif
+		for(; i + 4 <= npixels; i += 4) {
+			p = _mm_loadu_si128((const __m128i*)(src + 4 * i));
+			_mm_storeu_si128((__m128i*)(dst + 4 * i), _mm_shuffle_epi8(p, swap4));
+		}
+		for(; i < npixels; i++) {
+			t = src[4 * i];
+			dst[4 * i] = src[4 * i + 2];
+			dst[4 * i + 1] = src[4 * i + 1];
+			dst[4 * i + 2] = t;
+			dst[4 * i + 3] = src[4 * i + 3];
+		}
+	}
+	else {
+		const __m128i swap3 = _mm_setr_epi8(2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 12, 13, 14, 15);
+		__m128i p;
+#if defined(__AVX2__)
+		// Bytes 0-15 to the low lane and 12-27 to the high lane, and
+		// the 12 swapped bytes of each lane together again after the
+		// shuffle, with bytes 24-31 as they were
+		const __m256i spread = _mm256_setr_epi32(0, 1, 2, 3, 3, 4, 5, 6);
+		const __m256i gather = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 6, 7);
+		const __m256i swap6 = _mm256_broadcastsi128_si256(swap3);
+		__m256i q, r;
+		for(; 3 * i + 32 <= 3 * npixels; i += 8) {
+			q = _mm256_loadu_si256((const __m256i*)(src + 3 * i));
+			r = _mm256_shuffle_epi8(_mm256_permutevar8x32_epi32(q, spread), swap6);
+			r = _mm256_blend_epi32(_mm256_permutevar8x32_epi32(r, gather), q, 0xc0);
+			_mm256_storeu_si256((__m256i*)(dst + 3 * i), r);
+		}
+#endif
+		for(; 3 * i + 16 <= 3 * npixels; i += 4) {
+			p = _mm_loadu_si128((const __m128i*)(src + 3 * i));
+			_mm_storeu_si128((__m128i*)(dst + 3 * i), _mm_shuffle_epi8(p, swap3));
+		}
+		for(; i < npixels; i++) {
+			t = src[3 * i];
+			dst[3 * i] = src[3 * i + 2];
+			dst[3 * i + 1] = src[3 * i + 1];
+			dst[3 * i + 2] = t;
+		}
+	}
+}
+
+#endif /* __SSSE3__ */
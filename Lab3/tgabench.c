@@ -0,0 +1,492 @@
+/*
+ * tgabench.c - time the loading of TGA images (tgaDecode.c), RLE
+ * compressed against uncompressed, and see how much memory it takes.
+ *
+ * Each image is written to two temporary files, uncompressed and RLE
+ * compressed. First the RLE decoding and the swizzles from BGR(A) to
+ * RGB(A) are timed in memory: tgaDecodeRLE() against a plain byte by
+ * byte decoder, and the byte by byte swizzle that loadTGA() used to have
+ * against tgaSwizzle() and its SSSE3 and AVX2 versions. Then the files
+ * are loaded in the ways of loadFile() below, with the page cache warm
+ * and with the file dropped from the page cache first (cold), and the
+ * most memory each load adds to the process (VmHWM on Linux) is shown.
+ * Speeds are in MB of decoded image per second.
+ *
+ * Dropping a file from the page cache uses posix_fadvise(), which is
+ * only a hint, and does nothing on some file systems (tmpfs for one).
+ * On Windows the cold numbers are left out, and the memory on all but
+ * Linux.
+ *
+ * Usage: tgabench [file.tga ...]
+ * With no files, a 2048 x 2048 painted test image, with flat areas,
+ * soft edges and some noise, is used in 24 and 32 bits, and
+ * textures/pyramid.tga. Files may be uncompressed or RLE compressed.
+ *
+ * This code is in the public domain.
+ */
+
+#ifndef _WIN32
+#define _XOPEN_SOURCE 600 // For posix_fadvise()
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#ifdef __GLIBC__
+#include <malloc.h> // For mallopt()
+#endif
+
+#include "bench.h"
+#include "tgaDecode.h"
+
+#define TEST_SIZE 2048
+#define RAW_FILE "tgabench-raw.tga"
+#define RLE_FILE "tgabench-rle.tga"
+// Times each thing is done, the best time is shown
+#define REPEATS 5
+
+typedef struct {
+	unsigned char *pixels; // BGR(A), as in the file
+	int width, height, bpp; // bpp in bytes
+} image;
+
+/* A plain decoder, without swizzling if swap is 0, for comparison */
+static int referenceDecode(unsigned char *dst, const unsigned char *src, size_t srcsize,
+	size_t npixels, int bpp, int swap) {
+	const unsigned char *end = src + srcsize;
+	size_t done = 0;
+	int i, k, count, run;
+
+	while(done < npixels) {
+		if(src >= end) return -1;
+		count = (*src & 127) + 1;
+		run = *src++ & 128;
+		if((size_t)count > npixels - done || end - src < (run ? 1 : count) * bpp) return -1;
+		for(i = 0; i < count; i++) {
+			for(k = 0; k < bpp; k++) dst[k] = src[(swap && k != 1 && k != 3) ? 2 - k : k];
+			dst += bpp;
+			if(!run) src += bpp;
+		}
+		if(run) src += bpp;
+		done += count;
+	}
+	return 0;
+}
+
+// In tgaSwizzle.c, chosen by tgaSwizzle() in tgaDecode.c
+void tgaSwizzleSSSE3(unsigned char *dst, const unsigned char *src, size_t npixels, int bpp);
+void tgaSwizzleAVX2(unsigned char *dst, const unsigned char *src, size_t npixels, int bpp);
+
+/* The swizzle as it was in loadUncompressedTGA(), for comparison */
+static void swizzleBytes(unsigned char *dst, const unsigned char *src, size_t npixels, int bpp) {
+	size_t i;
+	unsigned char t;
+
+	for(i = 0; i < npixels * bpp; i += bpp) {
+		t = src[i];
+		dst[i] = src[i + 2];
+		dst[i + 1] = src[i + 1];
+		dst[i + 2] = t;
+		if(bpp == 4) dst[i + 3] = src[i + 3];
+	}
+}
+
+typedef void (*swizzleFunction)(unsigned char *dst, const unsigned char *src, size_t npixels, int bpp);
+static const swizzleFunction swizzles[] = { swizzleBytes, tgaSwizzle, tgaSwizzleSSSE3, tgaSwizzleAVX2 };
+static const char *swizzleNames[] = { "byte by byte", "tgaSwizzle", "SSSE3", "AVX2" };
+static const int nswizzles = 4;
+
+static int swizzleSupported(int k) {
+	__builtin_cpu_init();
+	return k < 2 || (k == 2 && __builtin_cpu_supports("ssse3")) || (k == 3 && __builtin_cpu_supports("avx2"));
+}
+
+/* RLE encode the pixels of img into a buffer that is returned, size in *size */
+static unsigned char *encode(const image *img, size_t *size) {
+	size_t n = (size_t)img->width * img->height, i, j, k;
+	int bpp = img->bpp;
+	const unsigned char *p = img->pixels;
+	unsigned char *out = (unsigned char*)malloc(n * bpp + (n + 127) / 128), *o = out;
+
+	if(out == NULL) return NULL;
+	for(i = 0; i < n; i = j) {
+		// A run of two or more of the same pixel
+		for(j = i + 1; j < n && j - i < 128 && memcmp(p + j * bpp, p + i * bpp, bpp) == 0; j++);
+		if(j - i >= 2) {
+			*o++ = (unsigned char)(128 | (j - i - 1));
+			memcpy(o, p + i * bpp, bpp);
+			o += bpp;
+			continue;
+		}
+		// Raw pixels, up to where the next run starts
+		for(j = i + 1; j < n && j - i < 128; j++) {
+			if(j + 1 < n && memcmp(p + j * bpp, p + (j + 1) * bpp, bpp) == 0) break;
+		}
+		*o++ = (unsigned char)(j - i - 1);
+		for(k = i; k < j; k++, o += bpp) memcpy(o, p + k * bpp, bpp);
+	}
+	*size = o - out;
+	return out;
+}
+
+static int writeTGA(const char *filename, const image *img, const unsigned char *data,
+	size_t size, int rle) {
+	unsigned char header[18] = {0};
+	FILE *f = fopen(filename, "wb");
+	int ok;
+
+	if(f == NULL) return -1;
+	header[2] = rle ? 10 : 2;
+	header[12] = img->width & 255;
+	header[13] = img->width >> 8;
+	header[14] = img->height & 255;
+	header[15] = img->height >> 8;
+	header[16] = 8 * img->bpp;
+	ok = fwrite(header, 18, 1, f) == 1 && fwrite(data, 1, size, f) == size;
+	return (fclose(f) == 0 && ok) ? 0 : -1;
+}
+
+static int readTGA(const char *filename, image *img) {
+	unsigned char header[18], *data;
+	size_t n, size;
+	long end;
+	FILE *f = fopen(filename, "rb");
+
+	if(f == NULL) return -1;
+	if(fread(header, 18, 1, f) != 1 || (header[2] != 2 && header[2] != 10) || header[1] != 0
+		|| (header[16] != 24 && header[16] != 32) || fseek(f, 0, SEEK_END) != 0 || (end = ftell(f)) < 18
+		|| fseek(f, 18 + header[0], SEEK_SET) != 0) {
+		fclose(f);
+		return -1;
+	}
+	img->width = header[12] + 256 * header[13];
+	img->height = header[14] + 256 * header[15];
+	img->bpp = header[16] / 8;
+	n = (size_t)img->width * img->height;
+	size = end - 18 - header[0];
+	img->pixels = (unsigned char*)malloc(n * img->bpp);
+	data = (unsigned char*)malloc(size + 1);
+	if(img->pixels == NULL || data == NULL || fread(data, 1, size, f) != size
+		|| (header[2] == 2 && size < n * img->bpp)
+		|| (header[2] == 10 && referenceDecode(img->pixels, data, size, n, img->bpp, 0) != 0)) {
+		free(img->pixels);
+		free(data);
+		fclose(f);
+		return -1;
+	}
+	if(header[2] == 2) memcpy(img->pixels, data, n * img->bpp);
+	free(data);
+	fclose(f);
+	return 0;
+}
+
+/* Flat colored tiles with soft edged discs, and a strip of noise, in BGR(A) */
+static int makeImage(image *img, int size, int bpp) {
+	int x, y, k, tile = size / 8;
+	unsigned int seed = 1;
+	unsigned char *p, c[4], d[4];
+	float dx, dy, r, w;
+
+	img->width = img->height = size;
+	img->bpp = bpp;
+	img->pixels = (unsigned char*)malloc((size_t)size * size * bpp);
+	if(img->pixels == NULL) return -1;
+	for(y = 0; y < size; y++) {
+		for(x = 0; x < size; x++) {
+			p = img->pixels + ((size_t)y * size + x) * bpp;
+			k = (x / tile) * 8 + y / tile;
+			c[0] = (unsigned char)(37 * k);
+			c[1] = (unsigned char)(91 * k + 40);
+			c[2] = (unsigned char)(53 * k + 100);
+			c[3] = 255;
+			d[0] = 255 - c[0]; d[1] = c[2]; d[2] = c[1]; d[3] = 128;
+			// A disc in each tile, with an edge two pixels wide
+			dx = (float)(x % tile) - 0.5f * tile;
+			dy = (float)(y % tile) - 0.5f * tile;
+			r = sqrtf(dx * dx + dy * dy) - 0.3f * tile;
+			w = (r <= -1.0f) ? 1.0f : (r >= 1.0f) ? 0.0f : 0.5f - 0.5f * r;
+			for(k = 0; k < bpp; k++) p[k] = (unsigned char)(c[k] + w * (d[k] - c[k]) + 0.5f);
+			if(y >= size - size / 16) { // Noise, as in a photograph
+				for(k = 0; k < 3; k++) {
+					seed = seed * 1664525u + 1013904223u;
+					p[k] = (unsigned char)(p[k] / 2 + (seed >> 25));
+				}
+			}
+		}
+	}
+	return 0;
+}
+
+/* Drop a file from the page cache, if that can be done. Returns 0 if so. */
+static int dropCache(const char *filename) {
+#ifdef _WIN32
+	return -1;
+#else
+	int fd = open(filename, O_RDONLY), result;
+
+	if(fd < 0) return -1;
+	fdatasync(fd);
+	result = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+	close(fd);
+	return result ? -1 : 0;
+#endif
+}
+
+/* Reset the peak memory use of the process. Returns 0 if that can be done. */
+static int resetPeak(void) {
+#ifdef __linux__
+	FILE *f = fopen("/proc/self/clear_refs", "w");
+
+	if(f == NULL) return -1;
+	fputs("5", f); // Sets VmHWM to VmRSS
+	return fclose(f) ? -1 : 0;
+#else
+	return -1;
+#endif
+}
+
+/* A number of KB from /proc/self/status, or -1 */
+static long statusKB(const char *key) {
+	char line[256];
+	long kb = -1;
+	FILE *f = fopen("/proc/self/status", "r");
+
+	if(f == NULL) return -1;
+	while(fgets(line, sizeof(line), f)) {
+		if(strncmp(line, key, strlen(key)) == 0) kb = atol(line + strlen(key) + 1);
+	}
+	fclose(f);
+	return kb;
+}
+
+// The ways to load a file, see loadFile()
+#define LOAD_STDIO 0
+#define LOAD_MAPPED 1
+#define LOAD_STRIPS 2
+#define LOAD_BGR 3
+#define LOAD_WAYS 4
+static const char *loadNames[LOAD_WAYS] = {
+	"fread + swizzle", "map, whole image", "map, 256 KB strips", "map, BGR in place"
+};
+
+/*
+ * Load a file written above, in one of the ways:
+ * LOAD_STDIO reads the file into a buffer of the image, as loadTGA() did
+ * before, and swizzles or decodes it. LOAD_MAPPED reads it from the
+ * mapped file into a buffer of the image, as loadTGA() does. LOAD_STRIPS
+ * reads it a strip of rows at a time into a small buffer, as
+ * createTexture() does for RLE files, and LOAD_BGR only reads the mapped
+ * pixels once, as OpenGL does when createTexture() gives them to it as
+ * BGR. The pixels are checked against expected, as RGB(A), or as they
+ * are in the file for LOAD_BGR. Returns 0 if all is well.
+ */
+static int loadFile(const char *filename, int way, const image *img,
+	const unsigned char *expected) {
+	size_t n = (size_t)img->width * img->height, rowsize = (size_t)img->width * img->bpp, size;
+	unsigned char header[18], *pixels = NULL, *packets;
+	unsigned int sum = 0, check = 0;
+	int result = -1, rows, y;
+	tgaImage tga;
+	FILE *f;
+
+	if(way == LOAD_STDIO) {
+		if((f = fopen(filename, "rb")) == NULL) return -1;
+		fseek(f, 0, SEEK_END);
+		size = ftell(f) - 18;
+		fseek(f, 0, SEEK_SET);
+		pixels = (unsigned char*)malloc(n * img->bpp);
+		if(pixels != NULL && fread(header, 18, 1, f) == 1) {
+			if(header[2] == 2) { // Uncompressed
+				if(fread(pixels, 1, size, f) == size) {
+					tgaSwizzle(pixels, pixels, n, img->bpp);
+					result = 0;
+				}
+			}
+			else {
+				packets = (unsigned char*)malloc(size);
+				if(packets && fread(packets, 1, size, f) == size)
+					result = tgaDecodeRLE(pixels, packets, size, n, img->bpp);
+				free(packets);
+			}
+		}
+		fclose(f);
+		if(result == 0 && memcmp(pixels, expected, n * img->bpp) != 0) result = -1;
+		free(pixels);
+		return result;
+	}
+
+	if(tgaOpen(&tga, filename) != 0) return -1;
+	if(way == LOAD_MAPPED) {
+		pixels = (unsigned char*)malloc(n * img->bpp);
+		if(pixels != NULL && tgaReadRows(&tga, pixels, img->height) == img->height
+			&& memcmp(pixels, expected, n * img->bpp) == 0) result = 0;
+	}
+	else if(way == LOAD_STRIPS) {
+		rows = (256 * 1024) / rowsize;
+		if(rows < 1) rows = 1;
+		pixels = (unsigned char*)malloc(rows * rowsize);
+		for(y = 0; pixels != NULL && y < img->height; y += rows) {
+			if((rows = tgaReadRows(&tga, pixels, rows)) <= 0
+				|| memcmp(pixels, expected + y * rowsize, rows * rowsize) != 0) break;
+		}
+		if(pixels != NULL && y >= img->height) result = 0;
+	}
+	else if(tga.pixels != NULL) { // LOAD_BGR, only for uncompressed files
+		for(y = 0; y < n * img->bpp; y += 4) {
+			sum += tga.pixels[y];
+			check += expected[y];
+		}
+		if(sum == check) result = 0;
+	}
+	free(pixels);
+	tgaClose(&tga);
+	return result;
+}
+
+/* Best time of loading the file, cold or warm, or -1 if it failed */
+static double timeLoad(const char *filename, int way, const image *img,
+	const unsigned char *expected, int cold) {
+	double t, best = -1.0;
+	int i;
+
+	if(loadFile(filename, way, img, expected) != 0) return -1.0; // Warm it up
+	for(i = 0; i < REPEATS; i++) {
+		if(cold && dropCache(filename) != 0) return -1.0;
+		t = seconds();
+		if(loadFile(filename, way, img, expected) != 0) return -1.0;
+		t = seconds() - t;
+		if(best < 0.0 || t < best) best = t;
+	}
+	return best;
+}
+
+/* Most memory in MB that loading the file takes, cold, or -1 if not known */
+static double peakLoad(const char *filename, int way, const image *img, const unsigned char *expected) {
+	long before;
+
+	dropCache(filename);
+	if(resetPeak() != 0 || (before = statusKB("VmRSS")) < 0) return -1.0;
+	if(loadFile(filename, way, img, expected) != 0) return -1.0;
+	return (statusKB("VmHWM") - before) / 1024.0;
+}
+
+static void benchImage(const char *name, const image *img) {
+	size_t n = (size_t)img->width * img->height, bytes = n * img->bpp, size = 0;
+	unsigned char *packets = encode(img, &size);
+	unsigned char *expected = (unsigned char*)malloc(bytes), *pixels = (unsigned char*)malloc(bytes);
+	const char *file;
+	double mb = bytes / 1048576.0, t, best[6];
+	int i, k, way, nways;
+
+	if(packets == NULL || expected == NULL || pixels == NULL
+		|| writeTGA(RAW_FILE, img, img->pixels, bytes, 0) || writeTGA(RLE_FILE, img, packets, size, 1)) {
+		printf("%s: out of memory, or could not write the files\n", name);
+		goto done;
+	}
+	printf("\n%s: %d x %d, %d bits, %.1f MB uncompressed, %.1f MB RLE (%.2fx smaller)\n",
+		name, img->width, img->height, 8 * img->bpp, mb, size / 1048576.0, (double)bytes / size);
+
+	// The swizzles must all agree with the plain byte by byte one
+	for(i = 0; i < (int)bytes; i += img->bpp) {
+		for(k = 0; k < img->bpp; k++) expected[i + k] = img->pixels[i + ((k == 1 || k == 3) ? k : 2 - k)];
+	}
+	for(k = 0; k < nswizzles; k++) {
+		if(!swizzleSupported(k)) continue;
+		for(i = 0; i < 31 && i < (int)n; i++) { // All lengths of tails, and in place
+			memcpy(pixels, img->pixels, bytes);
+			swizzles[k](pixels + i * img->bpp, pixels + i * img->bpp, n - i, img->bpp);
+			if(memcmp(pixels + i * img->bpp, expected + i * img->bpp, bytes - i * img->bpp) != 0) break;
+		}
+		if(i < 31 && i < (int)n) printf("  %s gives the wrong pixels!\n", swizzleNames[k]);
+	}
+	memset(pixels, 0, bytes);
+	if(tgaDecodeRLE(pixels, packets, size, n, img->bpp) != 0 || memcmp(pixels, expected, bytes) != 0) {
+		printf("  tgaDecodeRLE() gives the wrong pixels!\n");
+		goto done;
+	}
+
+	// In memory: the decoders, and the swizzles of an uncompressed image
+	for(k = 0; k < 2 + nswizzles; k++) {
+		best[k] = -1.0;
+		if(k >= 2 && !swizzleSupported(k - 2)) continue;
+		for(i = 0; i < REPEATS; i++) {
+			t = seconds();
+			if(k == 0) tgaDecodeRLE(pixels, packets, size, n, img->bpp);
+			else if(k == 1) referenceDecode(pixels, packets, size, n, img->bpp, 1);
+			else swizzles[k - 2](pixels, img->pixels, n, img->bpp);
+			t = seconds() - t;
+			if(best[k] < 0.0 || t < best[k]) best[k] = t;
+		}
+	}
+	printf("  RLE in memory:  tgaDecodeRLE %6.0f MB/s, byte by byte %6.0f MB/s\n", mb / best[0], mb / best[1]);
+	printf("  swizzle:       ");
+	for(k = 0; k < nswizzles; k++) {
+		if(best[k + 2] > 0.0) printf(" %s %6.0f MB/s%s", swizzleNames[k], mb / best[k + 2], k + 1 < nswizzles ? "," : "");
+	}
+	printf("\n");
+
+	// From the files, in each way
+	printf("  %-20s %12s %10s %10s %12s %10s %10s\n", "", "uncompressed", "cold", "peak", "RLE", "cold", "peak");
+	for(way = 0; way < LOAD_WAYS; way++) {
+		printf("  %-20s", loadNames[way]);
+		nways = (way == LOAD_BGR) ? 1 : 2;
+		for(k = 0; k < nways; k++) {
+			file = k ? RLE_FILE : RAW_FILE;
+			best[0] = timeLoad(file, way, img, (way == LOAD_BGR) ? img->pixels : expected, 0);
+			best[1] = timeLoad(file, way, img, (way == LOAD_BGR) ? img->pixels : expected, 1);
+			best[2] = peakLoad(file, way, img, (way == LOAD_BGR) ? img->pixels : expected);
+			if(best[0] < 0.0) printf(" %12s", "failed");
+			else printf(" %9.1f ms", 1e3 * best[0]);
+			if(best[1] < 0.0) printf(" %10s", "n/a");
+			else printf(" %7.1f ms", 1e3 * best[1]);
+			if(best[2] < 0.0) printf(" %10s", "n/a");
+			else printf(" %7.1f MB", best[2]);
+		}
+		printf("\n");
+	}
+
+done:
+	remove(RAW_FILE);
+	remove(RLE_FILE);
+	free(packets);
+	free(expected);
+	free(pixels);
+}
+
+int main(int argc, char *argv[]) {
+	image img;
+	int i;
+
+#ifdef __GLIBC__
+	// Give large blocks back to the OS when they are freed, as at first,
+	// or the peak memory use of the loaders does not show
+	mallopt(M_MMAP_THRESHOLD, 1024 * 1024);
+#endif
+
+	if(argc > 1) {
+		for(i = 1; i < argc; i++) {
+			if(readTGA(argv[i], &img) != 0) {
+				printf("%s: could not read it as a 24 or 32 bit TGA file\n", argv[i]);
+				continue;
+			}
+			benchImage(argv[i], &img);
+			free(img.pixels);
+		}
+		return 0;
+	}
+	for(i = 3; i <= 4; i++) {
+		if(makeImage(&img, TEST_SIZE, i) != 0) return 1;
+		benchImage("painted test image", &img);
+		free(img.pixels);
+	}
+	if(readTGA("textures/pyramid.tga", &img) == 0) {
+		benchImage("textures/pyramid.tga", &img);
+		free(img.pixels);
+	}
+	return 0;
+}
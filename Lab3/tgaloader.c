@@ -2,140 +2,256 @@
 /* Modified, stripped-down and cleaned-up version of TGA loader from NeHe tutorial 33 */
 /* Stefan Gustavson (stefan.gustavson@liu.se 2013-11-20 */
 
+#include <string.h> // For strlen()
+
 #include "tgaloader.h"
+#include "tgaDecode.h" // For tgaSwizzle() and tgaDecodeRLE()
+#include "texCook.h" // For texCook()
+#include "texFile.h" // For texReadFile() and texWriteFile()
+
+// How createTexture() makes mipmaps: sRGB colors, and wrapping as with GL_REPEAT
+#define TGA_MIPMAP_FLAGS (MIP_SRGB | MIP_WRAP)
 
 /*
  * loadTGA(Texture * texture, char * filename)
- * Open and test the file to make sure it is a valid TGA file	
+ * Map the file, make sure it is a valid TGA file, and read the image
+ * into texture->imageData as RGB or RGBA. Free that with freeTGA().
+ * The file is mapped instead of read, so the image is in memory only
+ * once, and the part of the file that is done with is given back
+ * while the rest is read (see tgaDecode.h).
  */
 
 int loadTGA(Texture *texture, char *filename)
 {
-	FILE * fTGA;
-	TGAHeader tgaheader;
-
-	GLubyte uTGAcompare[12] = {0,0,2, 0,0,0,0,0,0,0,0,0}; // Uncompressed TGA Header
-	GLubyte cTGAcompare[12] = {0,0,10,0,0,0,0,0,0,0,0,0}; // RLE Compressed TGA Header
+	tgaImage image;
 
-	fTGA = fopen(filename, "rb");
-
-	if(fTGA == NULL) // If the file didn't open...
+	texture->imageData = NULL;
+	if(tgaOpen(&image, filename) != 0)							// Map the file and read the header
 	{
-		fprintf(stderr, "Could not open texture file.\n");	// Display an error message
-		return GL_FALSE;									// Exit function with "failure"
+		fprintf(stderr, "Could not open texture file, or unsupported image file format.\n");
+		return GL_FALSE;										// Exit with failure
 	}
 
-	if(fread(&tgaheader, sizeof(TGAHeader), 1, fTGA) == 0)	// Attempt to read 12 byte header from file
-	{
-		fprintf(stderr, "Could not read file header.\n");	// If it fails, display an error message 
-		if(fTGA != NULL)									// Check to see if file is still open
-		{
-			fclose(fTGA);									// If it is, close it
-		}
-		return GL_FALSE;									// Exit with failure
-	}
+	texture->width	= image.width;
+	texture->height	= image.height;
+	texture->bpp	= 8 * image.bpp;
+	texture->type	= (image.bpp == 3) ? GL_RGB : GL_RGBA;
+	printf("Texture type is %s%s\n", (image.bpp == 3) ? "GL_RGB" : "GL_RGBA", image.rle ? ", RLE compressed" : "");
 
-	if(memcmp(uTGAcompare, &tgaheader, sizeof(tgaheader)) == 0)	// See if header matches the predefined header of 
-	{															// an Uncompressed TGA image
-		loadUncompressedTGA(texture, fTGA);			// If so, jump to Uncompressed TGA loading code
-	}
-	else if(memcmp(cTGAcompare, &tgaheader, sizeof(tgaheader)) == 0) // See if header matches the predefined header of
-	{																 // an RLE compressed TGA image
-		fprintf(stderr, "RLE compressed TGA files are not supported.\n");
+	texture->imageData = (GLubyte *)malloc((size_t)image.bpp * image.width * image.height);
+	if(texture->imageData == NULL)
+	{
+		fprintf(stderr, "Could not allocate memory for image.\n");
+		tgaClose(&image);
+		return GL_FALSE;
 	}
-	else															// If header matches neither type
+	if(tgaReadRows(&image, texture->imageData, image.height) != image.height) // Swap to RGB(A) while copying
 	{
-		fprintf(stderr, "Unsupported image file format.\n");		// Unknown file type, or unknown TGA version
-		fclose(fTGA);
-		return GL_FALSE;											// Exit with failure
+		fprintf(stderr, "Could not read image data.\n");
+		freeTGA(texture);
+		tgaClose(&image);
+		return GL_FALSE;
 	}
-	return GL_TRUE;													// All is well, return "success"
+	tgaClose(&image);
+	return GL_TRUE;												// All is well, return "success"
 }
 
-int loadUncompressedTGA(Texture *texture, FILE *fTGA) // Load an uncompressed TGA 
-{													 	// (based on NeHe's TGA loading code)
-	GLubyte temp;
-	GLuint cswap;
-	TGA tga;												// TGA image data
+/*
+ * Free the image data from loadTGA(), once it is no longer needed
+ */
+void freeTGA(Texture *texture)
+{
+	free(texture->imageData);
+	texture->imageData = NULL;
+}
 
-	if(fread(tga.header, sizeof(tga.header), 1, fTGA) == 0)		// Read TGA header
-	{										
-		fprintf(stderr, "Could not read info header.\n");		// Display error
-		if(fTGA != NULL)										// if file is still open
-		{
-			fclose(fTGA);										// Close it
-		}
-		return GL_FALSE;										// Exit with failure
-	}
+/*
+ * The OpenGL internal format for a block format of bcEncode.h
+ */
+static GLenum compressedFormat(int format)
+{
+	if(format == BC1) return GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+	if(format == BC3) return GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+	if(format == BC4) return GL_COMPRESSED_RED_RGTC1;
+	return GL_COMPRESSED_RG_RGTC2;
+}
+
+/*
+ * Whether OpenGL takes a block format of bcEncode.h. S3TC (BC1 to BC3)
+ * is an extension that not all drivers have, RGTC (BC4 and BC5) is core
+ * from OpenGL 3.0. Needs a current context.
+ */
+static int compressionSupported(int format)
+{
+	if(format == BC1 || format == BC3)
+		return glfwExtensionSupported("GL_EXT_texture_compression_s3tc");
+	return glfwGetWindowAttrib(glfwGetCurrentContext(), GLFW_CONTEXT_VERSION_MAJOR) >= 3
+		|| glfwExtensionSupported("GL_ARB_texture_compression_rgtc");
+}
+
+/*
+ * The format that createTexture() cooks an image of bpp bytes per pixel
+ * to, uncompressed if OpenGL can't take the block format
+ */
+static int cookedFormat(int bpp)
+{
+	int format = (bpp == 4) ? BC3 : BC1;
+
+	return (TGA_COMPRESS && compressionSupported(format)) ? format : TEX_RAW;
+}
+
+/*
+ * Upload one mipmap level, pixels or blocks as given by format
+ */
+static void uploadLevel(Texture *texture, int level, int format, int width, int height,
+	size_t size, const void *data)
+{
+	if(format == TEX_RAW)
+		glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA, width, height, 0,
+			texture->type, GL_UNSIGNED_BYTE, data);
+	else
+		glCompressedTexImage2D(GL_TEXTURE_2D, level, compressedFormat(format),
+			width, height, 0, size, data);
+}
 
-	texture->width  = tga.header[1] * 256 + tga.header[0];		// Determine The TGA Width	(highbyte*256+lowbyte)
-	texture->height = tga.header[3] * 256 + tga.header[2];		// Determine The TGA Height	(highbyte*256+lowbyte)
-	texture->bpp	= tga.header[4];							// Determine the bits per pixel
-	tga.width		= texture->width;							// Copy width into local structure						
-	tga.height		= texture->height;							// Copy height into local structure
-	tga.bpp			= texture->bpp;								// Copy BPP into local structure
+/*
+ * Upload the image from loadTGA() and all mipmap levels below it, made
+ * on the CPU with the threads of a noisePool, and block compressed if
+ * TGA_COMPRESS is set (see texCook.h), and write them to the .tex file
+ * of the TGA file for next time. Alpha is not used to weight the colors,
+ * since it is a height map for vertexshader.glsl, not coverage.
+ * Returns GL_FALSE if there was no memory for the levels.
+ */
+static int uploadMipmaps(Texture *texture, char *filename)
+{
+	noisePool *pool = noisePoolCreate(0);
+	cookedTexture tex;
+	size_t namesize = strlen(filename) + 5; // For ".tex" in place of ".tga"
+	char *texname;
+	int level, bytes = texture->bpp / 8;
 
-	if((texture->width <= 0) || (texture->height <= 0)
-		|| ((texture->bpp != 24) && (texture->bpp !=32)))		// Make sure all information is valid
+	if(texCook(&tex, texture->imageData, texture->width, texture->height, bytes,
+		TGA_MIPMAP_FILTER, TGA_MIPMAP_FLAGS, cookedFormat(bytes), TGA_COMPRESS_QUALITY, pool) != 0)
 	{
-		fprintf(stderr, "Invalid texture information.\n");		// Display Error
-		if(fTGA != NULL)										// Check if file is still open
-		{
-			fclose(fTGA);										// If so, close it
-		}
-		return GL_FALSE;										// Return "failure"
+		noisePoolDestroy(pool);
+		return GL_FALSE;
 	}
+	noisePoolDestroy(pool);
+	for(level = 0; level < tex.nlevels; level++)
+		uploadLevel(texture, level, tex.format, tex.width[level], tex.height[level], tex.size[level], tex.levels[level]);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, tex.nlevels - 1);
+	texname = (char *)malloc(namesize);
+	if(texname != NULL && texFileName(texname, namesize, filename) == 0)
+		texWriteFile(&tex, texname, filename, TEX_SRGB | ((bytes == 4) ? TEX_ALPHA_HEIGHT : 0));
+	free(texname);
+	texCookFree(&tex);
+	return GL_TRUE;
+}
 
-	if(texture->bpp == 24)										// If the the image is 24 BPP
+/*
+ * Start uploading the texture from the .tex file of the TGA file, if it
+ * is up to date and cooked as createTexture() would. The smallest levels
+ * are uploaded now, so that there is a texture to draw with right away,
+ * and the rest later by streamTexture(). Returns GL_FALSE if the .tex
+ * file could not be used.
+ */
+static int openCooked(Texture *texture, char *filename)
+{
+	const texFileHeader *header;
+	size_t namesize = strlen(filename) + 5; // For ".tex" in place of ".tga"
+	texFile *file = (texFile *)malloc(sizeof(texFile));
+	char *texname = (char *)malloc(namesize);
+	int level;
+
+	if(file == NULL || texname == NULL || texFileName(texname, namesize, filename) != 0
+		|| texReadFile(file, texname, filename) != 0)
 	{
-		texture->type	= GL_RGB;								// Set Image type to GL_RGB
-		printf("Texture type is GL_RGB\n");
+		free(file);
+		free(texname);
+		return GL_FALSE;
 	}
-	else														// Else it's 32 BPP
+	free(texname);
+	header = file->header;
+	if(header->format != (unsigned int)cookedFormat(header->bpp) || header->filter != TGA_MIPMAP_FILTER
+		|| header->flags != TGA_MIPMAP_FLAGS || (header->format != TEX_RAW && header->quality != TGA_COMPRESS_QUALITY))
 	{
-		texture->type	= GL_RGBA;								// Set image type to GL_RGBA
-		printf("Texture type is GL_RGBA\n");
+		texCloseFile(file);
+		free(file);
+		return GL_FALSE;
 	}
-
-	tga.bytesPerPixel	= (tga.bpp / 8);						// Compute the number of BYTES per pixel
-	tga.imageSize		= (tga.bytesPerPixel * tga.width * tga.height);	// Compute the total amount of memory needed
-	texture->imageData	= (GLubyte *)malloc(tga.imageSize);				// Allocate that much memory
-
-	if(texture->imageData == NULL)										// If no space was allocated
+	texture->width	= header->levels[0].width;
+	texture->height	= header->levels[0].height;
+	texture->bpp	= 8 * header->bpp;
+	texture->type	= (header->bpp == 3) ? GL_RGB : GL_RGBA;
+	for(level = header->nlevels - 1; level >= 0; level--)
 	{
-		fprintf(stderr, "Could not allocate memory for image.\n");		// Display Error
-		fclose(fTGA);													// Close the file
-		return GL_FALSE;												// Return "failure"
+		if(level < (int)header->nlevels - 1 && header->levels[level].size > TGA_STREAM_BYTES) break;
+		uploadLevel(texture, level, header->format, header->levels[level].width, header->levels[level].height,
+			header->levels[level].size, texFileLevelData(file, level));
+		texReleaseLevel(file, level);
 	}
-
-	if(fread(texture->imageData, 1, tga.imageSize, fTGA) != tga.imageSize)	// Attempt to read image data
+	texture->baselevel = level + 1;
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, texture->baselevel);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, header->nlevels - 1);
+	if(texture->baselevel > 0) texture->stream = file;
+	else
 	{
-		fprintf(stderr, "Could not read image data.\n");					// Display error
-		if(texture->imageData != NULL)										// If image data was allocated
-		{
-			free(texture->imageData);										// Deallocate that data
-		}
-		fclose(fTGA);														// Close file
-		return GL_FALSE;													// Return "failure"
+		texCloseFile(file);
+		free(file);
 	}
+	return GL_TRUE;
+}
 
-	// stegu 2013-11-19: Stupid, slow and outdated in-place XOR byte swapping code removed. Ugh.
-	for(cswap = 0; cswap < (int)tga.imageSize; cswap += tga.bytesPerPixel)
-	{
-		temp = texture->imageData[cswap];
-		texture->imageData[cswap] = texture->imageData[cswap+2];
-		texture->imageData[cswap+2] = temp;
-	}
+/*
+ * Upload the next larger mipmap level of a texture that createTexture()
+ * is streaming in from its .tex file, and draw with it from now on.
+ * Call once per frame. Returns GL_TRUE while there are levels left.
+ */
+int streamTexture(Texture *texture)
+{
+	const texFileHeader *header;
+	int level;
 
-	fclose(fTGA);			// Close file
-	return GL_TRUE;			// Return success
+	if(texture->stream == NULL) return GL_FALSE;
+	header = texture->stream->header;
+	level = texture->baselevel - 1;
+	glBindTexture(GL_TEXTURE_2D, texture->texID);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	uploadLevel(texture, level, header->format, header->levels[level].width, header->levels[level].height,
+		header->levels[level].size, texFileLevelData(texture->stream, level));
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	texReleaseLevel(texture->stream, level); // OpenGL has its own copy
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+	texture->baselevel = level;
+	if(level > 0) return GL_TRUE;
+	texCloseFile(texture->stream);
+	free(texture->stream);
+	texture->stream = NULL;
+	return GL_FALSE;
 }
 
 /*
- * Load and activate a 2D texture from a TGA file
+ * Load and activate a 2D texture from a TGA file.
+ * With TGA_CPU_MIPMAPS, the mipmaps are made on the CPU, with a better
+ * filter than most drivers use for glGenerateMipmap(), and compressed
+ * with TGA_COMPRESS. That is done once: the result is kept in a .tex
+ * file next to the TGA file (see texFile.h), which is mapped the next
+ * time and streamed in, smallest level first (see streamTexture()).
+ * Without a .tex file, the image is read whole with loadTGA() and
+ * cooked, before all of it is freed. If the driver has no S3TC, the
+ * mipmaps are cooked and kept uncompressed.
+ * Otherwise, or if there is no memory for the mipmaps, uncompressed
+ * pixels go to OpenGL straight from the mapped file, as BGR(A), and RLE
+ * compressed ones are decoded a strip of rows at a time, so no copy of
+ * the whole image is made, and none is kept. glGenerateMipmap() makes
+ * the mipmaps then.
  */
 void createTexture(Texture *texture, char *filename) {
-    loadTGA(texture, filename);
+	tgaImage image;
+	GLubyte *strip;
+	GLenum format;
+	int rows, y;
+
 	glEnable(GL_TEXTURE_2D); // Required for glBuildMipmap() to work (!)
 	glGenTextures(1, &(texture->texID));     // Create The texture ID
     glBindTexture ( GL_TEXTURE_2D , texture->texID );
@@ -145,9 +261,63 @@ void createTexture(Texture *texture, char *filename) {
     // Set parameters to determine how the texture wraps at edges
     glTexParameteri ( GL_TEXTURE_2D , GL_TEXTURE_WRAP_S , GL_REPEAT );
     glTexParameteri ( GL_TEXTURE_2D , GL_TEXTURE_WRAP_T , GL_REPEAT );
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // Rows of 3 byte pixels are not padded
+	texture->stream = NULL;
+	texture->baselevel = 0;
+	if(TGA_CPU_MIPMAPS)
+	{
+		texture->imageData = NULL;
+		if(openCooked(texture, filename) || !loadTGA(texture, filename) || uploadMipmaps(texture, filename))
+		{
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+			freeTGA(texture);
+			return;
+		}
+		// Give the copy back, and upload from the mapped file below
+		freeTGA(texture);
+		fprintf(stderr, "Could not allocate memory for mipmaps, leaving them to OpenGL.\n");
+	}
+
+	texture->imageData = NULL;
+	if(tgaOpen(&image, filename) != 0)
+	{
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		fprintf(stderr, "Could not open texture file, or unsupported image file format.\n");
+		return;
+	}
+	texture->width	= image.width;
+	texture->height	= image.height;
+	texture->bpp	= 8 * image.bpp;
+	texture->type	= (image.bpp == 3) ? GL_RGB : GL_RGBA;
     // Read the texture data from file and upload it to the GPU
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, texture->width, texture->height, 0,
-		texture->type, GL_UNSIGNED_BYTE, texture->imageData);
+	if(image.pixels) // Uncompressed: OpenGL swaps B and R itself
+	{
+		format = (image.bpp == 3) ? GL_BGR : GL_BGRA;
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, texture->width, texture->height, 0,
+			format, GL_UNSIGNED_BYTE, image.pixels);
+	}
+	else // RLE compressed: a strip of rows at a time
+	{
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, texture->width, texture->height, 0,
+			texture->type, GL_UNSIGNED_BYTE, NULL);
+		rows = TGA_STRIP_BYTES / (image.bpp * image.width);
+		if(rows < 1) rows = 1;
+		strip = (GLubyte *)malloc((size_t)rows * image.bpp * image.width);
+		for(y = 0; strip != NULL && y < image.height; y += rows)
+		{
+			if((rows = tgaReadRows(&image, strip, rows)) <= 0)
+			{
+				fprintf(stderr, "Could not read image data.\n");
+				break;
+			}
+			glTexSubImage2D(GL_TEXTURE_2D, 0, 0, y, texture->width, rows,
+				texture->type, GL_UNSIGNED_BYTE, strip);
+		}
+		if(strip == NULL) fprintf(stderr, "Could not allocate memory for image.\n");
+		free(strip);
+	}
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	tgaClose(&image); // The pixels are all with OpenGL now
 	glGenerateMipmap(GL_TEXTURE_2D);
 }
-
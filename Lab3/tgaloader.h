@@ -11,34 +11,41 @@
 #endif
 
 #include "tnm084.h" // To have access to glGenerateMipmap() extension in createTexture()
+#include "texFile.h" // For the .tex files of cooked textures
 
 typedef	struct									
 {
-	GLubyte	*imageData;	// Image data (3 or 4 bytes per pixel)
+	GLubyte	*imageData;	// Image data (3 or 4 bytes per pixel) from loadTGA(), NULL after createTexture()
 	GLuint	bpp;		// Image color depth in bits per pixel
 	GLuint	width;		// Image width
 	GLuint	height;		// Image height
 	GLuint	texID;		// Texture ID for OpenGL
 	GLuint	type;		// Image type (3 bytes per pixel: GL_RGB, 4 bytes: GL_RGBA)
+	texFile	*stream;	// The .tex file while levels are left to upload, see streamTexture()
+	GLint	baselevel;	// The largest mipmap level that is uploaded
 } Texture;	
 
-typedef struct
-{
-	GLubyte Header[12];	// TGA File Header
-} TGAHeader;
-
-typedef struct
-{
-	GLubyte		header[6];								// First 6 useful bytes from the header
-	GLuint		bytesPerPixel;							// Holds number of bytes per pixel used in the TGA file
-	GLuint		imageSize;								// Data size in bytes
-	GLuint		type;
-	GLuint		height;									//Height of Image
-	GLuint		width;									//Width ofImage
-	GLuint		bpp;									// Bits Per Pixel
-} TGA;
+// Most bytes of pixels that createTexture() decodes at a time
+#define TGA_STRIP_BYTES (256 * 1024)
+
+// Nonzero to have createTexture() make the mipmaps on the CPU with
+// mipBuild() (see mipmap.h), 0 to leave them to glGenerateMipmap()
+#define TGA_CPU_MIPMAPS 1
+// The kernel for them, MIP_BOX, MIP_KAISER or MIP_LANCZOS
+#define TGA_MIPMAP_FILTER MIP_KAISER
+// Nonzero to have those mipmaps block compressed (see bcEncode.h), to
+// BC1 for RGB images and BC3 for RGBA, which is an eighth and a quarter
+// of the memory and upload bandwidth of RGBA. Needs TGA_CPU_MIPMAPS.
+// Drivers without GL_EXT_texture_compression_s3tc get them uncompressed.
+#define TGA_COMPRESS 1
+// BC_FAST, BC_NORMAL or BC_SLOW
+#define TGA_COMPRESS_QUALITY BC_NORMAL
+// Levels of a .tex file up to this many bytes are uploaded right away by
+// createTexture(), and larger ones one at a time by streamTexture()
+#define TGA_STREAM_BYTES (64 * 1024)
 
 int loadTGA(Texture *texture, char *filename);		// Load a TGA file
-int loadUncompressedTGA(Texture *texture, FILE *tgafile);	// Load an uncompressed file
+void freeTGA(Texture *texture); // Free the image data from loadTGA()
 void createTexture(Texture *texture, char *filename); // Load GL texture from file
+int streamTexture(Texture *texture); // Upload the next mipmap level, once per frame
 
@@ -0,0 +1,41 @@
+/*
+ * threadPool.h - a small thread pool with work stealing, for running many
+ * small independent tasks such as the tiles of a noise field, the chunks
+ * of an OBJ file or the blocks of a texture (cpuNoisePool.c).
+ *
+ * noisePoolRun() calls task(arg, index, thread) once for every index in
+ * [0, ntasks) and returns when all calls have returned. The calling thread
+ * takes part as thread 0, so thread is always in [0, noisePoolThreads()).
+ * Each thread starts with a contiguous range of indices and takes them
+ * one at a time from the front. A thread that runs out steals the back
+ * half of the range of another thread, so uneven tasks still balance out
+ * while neighbouring indices mostly stay on the same thread.
+ *
+ * This code is in the public domain.
+ */
+
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+typedef struct noisePool noisePool;
+
+typedef void (*noiseTaskFunc)(void *arg, int index, int thread);
+
+/*
+ * noisePoolCreate() - start a pool of threads, counting the calling
+ * thread. If threads is 0 or less, one thread per online CPU is used.
+ * Returns NULL if the threads could not be created.
+ */
+noisePool *noisePoolCreate(int threads);
+void noisePoolDestroy(noisePool *pool);
+int noisePoolThreads(const noisePool *pool);
+void noisePoolRun(noisePool *pool, int ntasks, noiseTaskFunc task, void *arg);
+
+/*
+ * noisePoolFor() - like noisePoolRun(), but pool may be NULL, and the
+ * tasks then run in order on the calling thread as thread 0. A single
+ * task is also run directly, without waking the pool.
+ */
+void noisePoolFor(noisePool *pool, int ntasks, noiseTaskFunc task, void *arg);
+
+#endif /* THREADPOOL_H */
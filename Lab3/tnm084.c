@@ -45,6 +45,7 @@ PFNGLGETUNIFORMLOCATIONPROC      glGetUniformLocation = NULL;
 PFNGLUNIFORM1FPROC               glUniform1f          = NULL;
 PFNGLUNIFORM1FVPROC              glUniform1fv         = NULL;
 PFNGLUNIFORM1IPROC               glUniform1i          = NULL;
+PFNGLUNIFORM3FVPROC              glUniform3fv         = NULL;
 PFNGLUNIFORMMATRIX4FVPROC        glUniformMatrix4fv   = NULL;
 PFNGLGENBUFFERSPROC              glGenBuffers         = NULL;
 PFNGLISBUFFERPROC                glIsBuffer           = NULL;
@@ -60,6 +61,7 @@ PFNGLVERTEXATTRIBPOINTERPROC     glVertexAttribPointer = NULL;
 PFNGLDISABLEVERTEXATTRIBARRAYPROC glDisableVertexAttribArray = NULL;
 PFNGLACTIVETEXTUREPROC           glActiveTexture      = NULL;
 PFNGLGENERATEMIPMAPPROC          glGenerateMipmap     = NULL;
+PFNGLCOMPRESSEDTEXIMAGE2DPROC    glCompressedTexImage2D = NULL;
 #endif
 
 
@@ -113,13 +115,14 @@ void loadExtensions() {
         glUniform1f          = (PFNGLUNIFORM1FPROC)glfwGetProcAddress("glUniform1f");
         glUniform1fv         = (PFNGLUNIFORM1FVPROC)glfwGetProcAddress("glUniform1fv");
         glUniform1i          = (PFNGLUNIFORM1IPROC)glfwGetProcAddress("glUniform1i");
+        glUniform3fv         = (PFNGLUNIFORM3FVPROC)glfwGetProcAddress("glUniform3fv");
   		glUniformMatrix4fv   = (PFNGLUNIFORMMATRIX4FVPROC)glfwGetProcAddress("glUniformMatrix4fv");
 
         if( !glCreateProgram || !glDeleteProgram || !glUseProgram ||
             !glCreateShader || !glDeleteShader || !glShaderSource || !glCompileShader || 
             !glGetShaderiv || !glGetShaderInfoLog || !glAttachShader || !glDetachShader || !glLinkProgram ||
             !glGetProgramiv || !glGetProgramInfoLog || !glGetUniformLocation ||
-            !glUniform1fv || !glUniform1f || !glUniform1i || !glUniformMatrix4fv )
+            !glUniform1fv || !glUniform1f || !glUniform1i || !glUniform3fv || !glUniformMatrix4fv )
         {
             printError("GL init error", "One or more required OpenGL shader-related functions were not found");
             return;
@@ -139,11 +142,13 @@ void loadExtensions() {
 		glDisableVertexAttribArray = (PFNGLDISABLEVERTEXATTRIBARRAYPROC)glfwGetProcAddress("glDisableVertexAttribArray");
 		glActiveTexture            = (PFNGLACTIVETEXTUREPROC)glfwGetProcAddress("glActiveTexture");
 		glGenerateMipmap           = (PFNGLGENERATEMIPMAPPROC)glfwGetProcAddress("glGenerateMipmap");
+		glCompressedTexImage2D     = (PFNGLCOMPRESSEDTEXIMAGE2DPROC)glfwGetProcAddress("glCompressedTexImage2D");
 		
 		if( !glGenBuffers || !glIsBuffer || !glBindBuffer || !glBufferData || !glDeleteBuffers ||
 		    !glGenVertexArrays || !glIsVertexArray || !glBindVertexArray || !glDeleteVertexArrays ||
 			!glEnableVertexAttribArray || !glVertexAttribPointer ||
-			!glDisableVertexAttribArray || !glActiveTexture || !glGenerateMipmap )
+			!glDisableVertexAttribArray || !glActiveTexture || !glGenerateMipmap ||
+			!glCompressedTexImage2D )
         {
             printError("GL init error", "One or more required OpenGL functions were not found");
             return;
@@ -23,6 +23,7 @@ extern PFNGLGETUNIFORMLOCATIONPROC      glGetUniformLocation;
 extern PFNGLUNIFORM1FPROC               glUniform1f;
 extern PFNGLUNIFORM1FVPROC              glUniform1fv;
 extern PFNGLUNIFORM1IPROC               glUniform1i;
+extern PFNGLUNIFORM3FVPROC              glUniform3fv;
 extern PFNGLUNIFORMMATRIX4FVPROC        glUniformMatrix4fv;
 extern PFNGLGENBUFFERSPROC              glGenBuffers;
 extern PFNGLISBUFFERPROC                glIsBuffer;
@@ -38,6 +39,7 @@ extern PFNGLVERTEXATTRIBPOINTERPROC     glVertexAttribPointer;
 extern PFNGLDISABLEVERTEXATTRIBARRAYPROC glDisableVertexAttribArray;
 extern PFNGLACTIVETEXTUREPROC           glActiveTexture;
 extern PFNGLGENERATEMIPMAPPROC          glGenerateMipmap;
+extern PFNGLCOMPRESSEDTEXIMAGE2DPROC    glCompressedTexImage2D;
 #endif
 
 
@@ -1,6 +1,6 @@
-#include <stdio.h>  // For file input in soupReadOBJ()
+#include <stdio.h>  // For printf()
 #include <stdlib.h> // For malloc() and free()
-#include <string.h> // For strcmp()
+#include <string.h> // For memset()
 #include <math.h>   // For sin() and cos() in soupCreateSphere()
 #include <GLFW/glfw3.h>
 
@@ -11,6 +11,10 @@
 #include "tnm084.h"  // To be able to use OpenGL extensions below
 
 #include "triangleSoup.h"
+#include "objLoader.h"
+#include "objCache.h"
+#include "meshOptimize.h"
+#include "mappedFile.h"
 
 
 /* Initialize a triangleSoup object to all zeros */
@@ -22,6 +26,12 @@ void soupInit(triangleSoup *soup) {
 	soup->indexarray = NULL;
 	soup->nverts = 0;
 	soup->ntris = 0;
+	soup->mapping = NULL;
+	vertexFormatInit(&soup->format, VERTEX_FLOAT32, NULL, 0);
+	memset(&soup->lods, 0, sizeof(meshLodChain));
+	soup->lod = 0;
+	soup->wantlods = 0;
+	soup->locations[0] = soup->locations[1] = soup->locations[2] = -1;
 }
 
 
@@ -43,6 +53,13 @@ void soupDelete(triangleSoup *soup) {
 	}
 	soup->indexbuffer = 0;
 
+	if(soup->mapping) { // The arrays are in a mapped .soup file
+		unmapFile((mappedFile*)soup->mapping);
+		free(soup->mapping);
+		soup->mapping = NULL;
+		soup->vertexarray = NULL;
+		soup->indexarray = NULL;
+	}
 	if(soup->vertexarray) {
 		free((void*)soup->vertexarray);
 	}
@@ -51,6 +68,8 @@ void soupDelete(triangleSoup *soup) {
 	}
 	soup->nverts = 0;
 	soup->ntris = 0;
+	meshLodFree(&soup->lods);
+	soup->lod = 0;
 
 };
 
@@ -60,6 +79,106 @@ void soupCreateBox(triangleSoup *soup, float xsize, float ysize, float zsize) {
 	/* Not yet implemented */
 };
 
+/*
+ * soupUpload(triangleSoup *soup)
+ *
+ * Send the vertex and index arrays of a triangleSoup object to OpenGL,
+ * and set up its vertex array object. Used by soupCreateSphere() and
+ * soupReadOBJ() once the arrays are filled in, and by soupSetFormat().
+ * With a packed format, the vertices are packed into a temporary array
+ * first. vertexbench shows the error of the packing.
+ */
+static void soupUpload(triangleSoup *soup) {
+
+	void *packed = soup->vertexarray;
+	int stride, packed16;
+
+	vertexFormatInit(&soup->format, soup->format.type, soup->vertexarray, soup->nverts);
+	stride = soup->format.stride;
+	if(soup->format.type != VERTEX_FLOAT32) {
+		packed = malloc((size_t)soup->nverts * stride);
+		if(packed == NULL) { // Keep the floats then
+			vertexFormatInit(&soup->format, VERTEX_FLOAT32, NULL, 0);
+			packed = soup->vertexarray;
+			stride = soup->format.stride;
+		}
+		else vertexEncode(packed, soup->vertexarray, soup->nverts, &soup->format);
+	}
+	packed16 = (soup->format.type == VERTEX_PACKED16);
+
+	// Generate one vertex array object (VAO) and bind it
+	glGenVertexArrays(1, &(soup->vao));
+	glBindVertexArray(soup->vao);
+
+	// Generate two buffer IDs
+	glGenBuffers(1, &(soup->vertexbuffer));
+	glGenBuffers(1, &(soup->indexbuffer));
+
+ 	// Activate the vertex buffer
+	glBindBuffer(GL_ARRAY_BUFFER, soup->vertexbuffer);
+ 	// Present our vertex coordinates to OpenGL
+	glBufferData(GL_ARRAY_BUFFER,
+		(size_t)soup->nverts * stride, packed, GL_STATIC_DRAW);
+	// Specify how many attribute arrays we have in our VAO
+	glEnableVertexAttribArray(0); // Vertex coordinates
+	glEnableVertexAttribArray(1); // Normals
+	glEnableVertexAttribArray(2); // Texture coordinates
+	// Specify how OpenGL should interpret the vertex buffer data:
+	// Attributes 0, 1, 2 (must match the lines above and the layout in the shader)
+	// Number of dimensions (3 means vec3 in the shader, 2 means vec2)
+	// Type, and whether integers are normalized to [-1,1]
+	// Stride (bytes per vertex in the interleaved array)
+	// Array buffer offset (offset into first vertex)
+	if(soup->format.type == VERTEX_FLOAT32) {
+		// 8 floats per vertex, at offsets 0, 3, 6
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE,
+			stride, (void*)0); // xyz coordinates
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE,
+			stride, (void*)(3*sizeof(GLfloat))); // normals
+		glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE,
+			stride, (void*)(6*sizeof(GLfloat))); // texcoords
+	}
+	else if(packed16) {
+		// Packed, see vertexFormat.h. The shader scales the positions
+		// and decodes the normals, see soupRender().
+		glVertexAttribPointer(0, 3, GL_SHORT, GL_FALSE,
+			stride, (void*)0); // xyz coordinates
+		glVertexAttribPointer(1, 2, GL_SHORT, GL_TRUE,
+			stride, (void*)8); // octahedron normals
+		glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE,
+			stride, (void*)12); // texcoords
+	}
+	else {
+		// The normal bytes at offset 6 come in as the fourth short of the
+		// position, so that no attribute starts off a 4 byte boundary,
+		// which some GPUs fetch slower. The shader takes them apart.
+		glVertexAttribPointer(0, 4, GL_SHORT, GL_FALSE,
+			stride, (void*)0); // xyz coordinates and normal
+		glDisableVertexAttribArray(1);
+		glVertexAttribPointer(2, 2, GL_HALF_FLOAT, GL_FALSE,
+			stride, (void*)8); // texcoords
+	}
+
+ 	// Activate the index buffer
+ 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, soup->indexbuffer);
+ 	// Present our vertex indices to OpenGL, all levels of detail if any
+	if(soup->lods.nlods > 0)
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+			soup->lods.nindices*sizeof(GLuint), soup->lods.indices, GL_STATIC_DRAW);
+	else
+	 	glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+		 	3*soup->ntris*sizeof(GLuint), soup->indexarray, GL_STATIC_DRAW);
+
+	// Deactivate (unbind) the VAO and the buffers again.
+	// Do NOT unbind the buffers while the VAO is still bound.
+	// The index buffer is an essential part of the VAO state.
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+ 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	if(packed != soup->vertexarray) free(packed);
+};
+
 /*
  * soupCreateSphere(triangleSoup soup, float radius, int segments)
  *
@@ -166,50 +285,12 @@ void soupCreateSphere(triangleSoup *soup, float radius, int segments) {
 		soup->indexarray[base+3*i+2] = soup->nverts-3-i;
 	}
 
-	// Generate one vertex array object (VAO) and bind it
-	glGenVertexArrays(1, &(soup->vao));
-	glBindVertexArray(soup->vao);
-
-	// Generate two buffer IDs
-	glGenBuffers(1, &(soup->vertexbuffer));
-	glGenBuffers(1, &(soup->indexbuffer));
-
- 	// Activate the vertex buffer
-	glBindBuffer(GL_ARRAY_BUFFER, soup->vertexbuffer);
- 	// Present our vertex coordinates to OpenGL
-	glBufferData(GL_ARRAY_BUFFER,
-		8*soup->nverts * sizeof(GLfloat), soup->vertexarray, GL_STATIC_DRAW);
-	// Specify how many attribute arrays we have in our VAO
-	glEnableVertexAttribArray(0); // Vertex coordinates
-	glEnableVertexAttribArray(1); // Normals
-	glEnableVertexAttribArray(2); // Texture coordinates
-	// Specify how OpenGL should interpret the vertex buffer data:
-	// Attributes 0, 1, 2 (must match the lines above and the layout in the shader)
-	// Number of dimensions (3 means vec3 in the shader, 2 means vec2)
-	// Type GL_FLOAT
-	// Not normalized (GL_FALSE)
-	// Stride 8 (interleaved array with 8 floats per vertex)
-	// Array buffer offset 0, 3, 6 (offset into first vertex)
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE,
-		8*sizeof(GLfloat), (void*)0); // xyz coordinates
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE,
-		8*sizeof(GLfloat), (void*)(3*sizeof(GLfloat))); // normals
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE,
-		8*sizeof(GLfloat), (void*)(6*sizeof(GLfloat))); // texcoords
-
- 	// Activate the index buffer
- 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, soup->indexbuffer);
- 	// Present our vertex indices to OpenGL
- 	glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-	 	3*soup->ntris*sizeof(GLuint), soup->indexarray, GL_STATIC_DRAW);
-
-	// Deactivate (unbind) the VAO and the buffers again.
-	// Do NOT unbind the buffers while the VAO is still bound.
-	// The index buffer is an essential part of the VAO state.
-	glBindVertexArray(0);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
- 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+#if SOUP_OPTIMIZE
+	// Reorder the triangles and vertices for the GPU vertex cache
+	meshOptimize(soup->vertexarray, stride, soup->indexarray, soup->ntris, soup->nverts);
+#endif
 
+	soupUpload(soup);
 };
 
 
@@ -229,193 +310,133 @@ void soupCreateSphere(triangleSoup *soup, float radius, int segments) {
  */
 void soupReadOBJ(triangleSoup* soup, char* filename) {
 
-	FILE *objfile;
-
-	int numverts = 0;
-	int numnormals = 0;
-	int numtexcoords = 0;
-	int numfaces = 0;
-	int i_v = 0;
-	int i_n = 0;
-	int i_t = 0;
-	int i_f = 0;
-	float *verts, *normals, *texcoords;
-
-	char line[256];
-	char tag[3];
-	int v1,v2,v3,n1,n2,n3,t1,t2,t3;
-	int numargs, readerror, currentv;
-
-	objfile = fopen(filename, "r");
-	
-	// Scan through the file to count the number of data elements
-	while(fgets(line, 256, objfile)) {
-		sscanf(line, "%2s ", tag);
-		if(!strcmp(tag, "v")) numverts++;
-		else if(!strcmp(tag, "vn")) numnormals++;
-		else if(!strcmp(tag, "vt")) numtexcoords++;
-		else if(!strcmp(tag, "f")) numfaces++;
-		//else printf("Ignoring line starting with \"%s\"\n", tag);
+	objMesh mesh;
+	noisePool *pool;
+	int result;
+
+	// The parsing is done by objLoadThreaded() in objLoader.c, which maps
+	// the file into memory and reads it in chunks on all CPUs. If the
+	// threads can't be started, pool is NULL and one thread does it all.
+	// Corners with the same v/t/n indices are welded into one vertex, and
+	// with SOUP_OPTIMIZE, triangles and vertices are reordered for the GPU
+	// (meshOptimize.c).
+	// The result is kept in a .soup file next to the OBJ file, which is
+	// mapped instead of parsing the OBJ file again next time (objCache.c).
+	// After soupBuildLods(), the levels of detail are kept there as well.
+	meshLodFree(&soup->lods);
+	soup->lod = 0;
+	pool = noisePoolCreate(0);
+	result = objLoadCached(&mesh, soup->wantlods ? &soup->lods : NULL, filename, pool,
+		OBJ_WELD | (SOUP_OPTIMIZE ? OBJ_OPTIMIZE : 0) | (soup->wantlods ? OBJ_LODS : 0), NULL);
+	noisePoolDestroy(pool);
+	if(result == OBJ_ERROR_OPEN) {
+		printf("loadObj(\"%s\"): could not open file.\n", filename);
+		return;
 	}
-	
-	printf("loadObj(\"%s\"): found %d vertices, %d normals, %d texcoords, %d faces.\n",
-		filename, numverts, numnormals, numtexcoords, numfaces);
-
-	verts = (float*)malloc(3*numverts*sizeof(float));
-	normals = (float*)malloc(3*numnormals*sizeof(float));
-	texcoords = (float*)malloc(2*numtexcoords*sizeof(float));
-
-	soup->vertexarray = (float*)malloc(8*3*numfaces*sizeof(float));
-	soup->indexarray = (unsigned int*)malloc(3*numfaces*sizeof(unsigned int));
-	soup->nverts = 3*numfaces;
-	soup->ntris = numfaces;
-
-	rewind(objfile); // Start from the top again to read data
-
-	readerror = 0;
-	while(fgets(line, 256, objfile)) {
-		tag[0] = '\0';
-		sscanf(line, "%2s ", tag);
-		if(!strcmp(tag, "v")) {
-//			printf("Reading vertex %d\n", i_v+1);
-			numargs = sscanf(line, "v %f %f %f",
-				&verts[3*i_v], &verts[3*i_v+1], &verts[3*i_v+2]);
-			if(numargs != 3) {
-				printf("Malformed vertex data found at vertex %d.\n", i_v+1);
-				printf("Aborting.\n");
-				readerror = 1;
-				break;
-			}
-//			printf("Read vertex coord %d: %8.2f %8.2f %8.2f\n",
-//			i_v, verts[3*i_v], verts[3*i_v+1], verts[3*i_v+2]);
-			i_v++;
-		}
-		else if(!strcmp(tag, "vn")) {
-//			printf("Reading normal %d\n", i_n+1);
-			numargs = sscanf(line, "vn %f %f %f",
-				&normals[3*i_n], &normals[3*i_n+1], &normals[3*i_n+2]);
-			if(numargs != 3) {
-				printf("Malformed normal data found at normal %d.\n", i_n+1);
-				printf("Aborting.\n");
-				readerror = 1;
-				break;
-			}
-			i_n++;
-		}
-		else if(!strcmp(tag, "vt"))  {
-//          printf("Reading texcoord %d\n", i_t+1);
-			numargs = sscanf(line, "vt %f %f",
-				&texcoords[2*i_t], &texcoords[2*i_t+1]);
-			if(numargs != 2) {
-				printf("Malformed texcoord data found at texcoord %d.\n", i_t+1);
-				printf("Aborting.\n");
-				readerror = 1;
-				break;
-			}
-			i_t++;
-		}
-		else if(!strcmp(tag, "f")) {
-//			printf("Reading face %d\n", i_f+1);
-			numargs = sscanf(line, "f %d/%d/%d %d/%d/%d %d/%d/%d",
-				&v1, &t1, &n1, &v2, &t2, &n2, &v3, &t3, &n3);
-			if(numargs != 9) {
-				printf("Malformed face data found at face %d.\n", i_f+1);
-				printf("Aborting.\n");
-				readerror = 1;
-				break;
-			}
-//			printf("Read vertex data %d/%d/%d %d/%d/%d %d/%d/%d\n",
-//			v1, t1, n1, v2, t2, n2, v3, t3, n3);
-			v1--; v2--; v3--; n1--; n2--; n3--; t1--; t2--; t3--;
-			currentv = 8*3*i_f;
-			soup->vertexarray[currentv] = verts[3*v1];
-			soup->vertexarray[currentv+1] = verts[3*v1+1];
-			soup->vertexarray[currentv+2] = verts[3*v1+2];
-			soup->vertexarray[currentv+3] = normals[3*n1];
-			soup->vertexarray[currentv+4] = normals[3*n1+1];
-			soup->vertexarray[currentv+5] = normals[3*n1+2];
-			soup->vertexarray[currentv+6] = texcoords[2*t1];
-			soup->vertexarray[currentv+7] = texcoords[2*t1+1];
-			soup->vertexarray[currentv+8] = verts[3*v2];
-			soup->vertexarray[currentv+9] = verts[3*v2+1];
-			soup->vertexarray[currentv+10] = verts[3*v2+2];
-			soup->vertexarray[currentv+11] = normals[3*n2];
-			soup->vertexarray[currentv+12] = normals[3*n2+1];
-			soup->vertexarray[currentv+13] = normals[3*n2+2];
-			soup->vertexarray[currentv+14] = texcoords[2*t2];
-			soup->vertexarray[currentv+15] = texcoords[2*t2+1];
-			soup->vertexarray[currentv+16] = verts[3*v3];
-			soup->vertexarray[currentv+17] = verts[3*v3+1];
-			soup->vertexarray[currentv+18] = verts[3*v3+2];
-			soup->vertexarray[currentv+19] = normals[3*n3];
-			soup->vertexarray[currentv+20] = normals[3*n3+1];
-			soup->vertexarray[currentv+21] = normals[3*n3+2];
-			soup->vertexarray[currentv+22] = texcoords[2*t3];
-			soup->vertexarray[currentv+23] = texcoords[2*t3+1];
-			soup->indexarray[3*i_f] = 3*i_f;
-			soup->indexarray[3*i_f+1] = 3*i_f+1;
-			soup->indexarray[3*i_f+2] = 3*i_f+2;
-			i_f++;
-		};
+	if(result == OBJ_ERROR_SYNTAX) {
+		printf("Malformed data found at line %d.\n", mesh.errorline);
+		printf("Aborting.\n");
+		soupDelete(soup);
+		return;
+	}
+	if(result != 0) {
+		printf("loadObj(\"%s\"): out of memory.\n", filename);
+		printf("Aborting.\n");
+		soupDelete(soup);
+		return;
 	}
 
-	// Free the temporary arrays we created
-	free(verts);
-	free(normals);
-	free(texcoords);
-	fclose(objfile);
+	printf("loadObj(\"%s\"): found %d vertices, %d normals, %d texcoords, %d faces.\n",
+		filename, mesh.numverts, mesh.numnormals, mesh.numtexcoords, mesh.numfaces);
 
-	if(readerror) { // Delete corrupt data and bail out if a read error occured
-		soupDelete(soup);
+	// The arrays are handed over to the triangleSoup object
+	soup->vertexarray = mesh.vertexarray;
+	soup->indexarray = mesh.indexarray;
+	soup->nverts = mesh.nverts;
+	soup->ntris = mesh.ntris;
+	soup->mapping = mesh.mapping;
+
+	soupUpload(soup);
+};
+
+/* Choose the vertex buffer layout, and upload again in that layout */
+void soupSetFormat(triangleSoup *soup, int format) {
+
+	vertexFormat check;
+
+	if(vertexFormatInit(&check, format, NULL, 0) != 0) {
+		printf("soupSetFormat(): unknown vertex format %d.\n", format);
 		return;
 	}
-		
-	// Generate one vertex array object (VAO) and bind it
-	glGenVertexArrays(1, &(soup->vao));
-	glBindVertexArray(soup->vao);
+	soup->format.type = format;
+	if(soup->vertexarray == NULL) return; // Used when geometry is created
 
-	// Generate two buffer IDs
-	glGenBuffers(1, &(soup->vertexbuffer));
-	glGenBuffers(1, &(soup->indexbuffer));
+	if(glIsVertexArray(soup->vao)) glDeleteVertexArrays(1, &(soup->vao));
+	if(glIsBuffer(soup->vertexbuffer)) glDeleteBuffers(1, &(soup->vertexbuffer));
+	if(glIsBuffer(soup->indexbuffer)) glDeleteBuffers(1, &(soup->indexbuffer));
+	soupUpload(soup);
+};
 
- 	// Activate the vertex buffer
-	glBindBuffer(GL_ARRAY_BUFFER, soup->vertexbuffer);
- 	// Present our vertex coordinates to OpenGL
-	glBufferData(GL_ARRAY_BUFFER,
-		8*soup->nverts * sizeof(GLfloat), soup->vertexarray, GL_STATIC_DRAW);
+/* Look up the uniforms for the vertex format once, for soupRender() */
+void soupSetProgram(triangleSoup *soup, GLuint program) {
+	soup->locations[0] = glGetUniformLocation(program, "PositionScale");
+	soup->locations[1] = glGetUniformLocation(program, "PositionOffset");
+	soup->locations[2] = glGetUniformLocation(program, "OctNormals");
+};
 
-	// Specify how many attribute arrays we have in our VAO
-	glEnableVertexAttribArray(0); // Vertex coordinates
-	glEnableVertexAttribArray(1); // Normals
-	glEnableVertexAttribArray(2); // Texture coordinates
-	// Specify how OpenGL should interpret the vertex buffer data:
-	// Attributes 0, 1, 2 (must match the lines above and the layout in the shader)
-	// Number of dimensions (3 means vec3 in the shader, 2 means vec2)
-	// Type GL_FLOAT
-	// Not normalized (GL_FALSE)
-	// Stride 8 (interleaved array with 8 floats per vertex)
-	// Array buffer offset 0, 3, 6 (offset into first vertex)
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE,
-		8*sizeof(GLfloat), (void*)0); // xyz coordinates
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE,
-		8*sizeof(GLfloat), (void*)(3*sizeof(GLfloat))); // normals
-	glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE,
-		8*sizeof(GLfloat), (void*)(6*sizeof(GLfloat))); // texcoords
+/* Ask for levels of detail, made by soupMakeLods() or read by soupReadOBJ() */
+void soupBuildLods(triangleSoup *soup) {
+	soup->wantlods = 1;
+};
 
- 	// Activate the index buffer
- 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, soup->indexbuffer);
- 	// Present our vertex indices to OpenGL
- 	glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-	 	3*soup->ntris*sizeof(GLuint), soup->indexarray, GL_STATIC_DRAW);
+/* Make the levels of detail, and send them to OpenGL in place of the triangles */
+static void soupMakeLods(triangleSoup *soup) {
 
-	// Deactivate (unbind) the VAO and the buffers again.
-	// Do NOT unbind the buffers while the VAO is still bound.
-	// The index buffer is an essential part of the VAO state.
+	int i;
+
+	if(soup->indexarray == NULL || soup->ntris == 0) return;
+	meshLodFree(&soup->lods);
+	soup->lod = 0;
+	if(meshLodBuild(&soup->lods, soup->vertexarray, 8, soup->indexarray,
+		soup->ntris, soup->nverts, NULL, 0) != 0) {
+		printf("soupBuildLods(): out of memory.\n");
+		soup->wantlods = 0; // Don't try again every frame
+		return;
+	}
+	printf("triangleSoup: %d levels of detail,", soup->lods.nlods);
+	for(i = 0; i < soup->lods.nlods; i++) printf(" %d", soup->lods.lods[i].count / 3);
+	printf(" triangles.\n");
+
+	// The index buffer is part of the VAO state, so bind that first
+	glBindVertexArray(soup->vao);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, soup->indexbuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+		soup->lods.nindices*sizeof(GLuint), soup->lods.indices, GL_STATIC_DRAW);
 	glBindVertexArray(0);
-	glBindBuffer(GL_ARRAY_BUFFER, 0);
- 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+};
 
-	return;
+/* Choose the level of detail from the distance and the projection */
+void soupSelectLod(triangleSoup *soup, const float *MV, const float *P) {
+
+	GLint viewport[4];
+	float c[3], scale, distance;
+	int i;
+
+	if(soup->wantlods && soup->lods.nlods == 0) soupMakeLods(soup);
+	if(soup->lods.nlods == 0) return;
+	glGetIntegerv(GL_VIEWPORT, viewport);
+	// The center of the bounding sphere in view coordinates, and its
+	// radius, scaled as much as the modelview matrix scales the x axis
+	for(i = 0; i < 3; i++) {
+		c[i] = MV[i] * soup->lods.center[0] + MV[4 + i] * soup->lods.center[1]
+			+ MV[8 + i] * soup->lods.center[2] + MV[12 + i];
+	}
+	scale = sqrtf(MV[0] * MV[0] + MV[1] * MV[1] + MV[2] * MV[2]);
+	distance = sqrtf(c[0] * c[0] + c[1] * c[1] + c[2] * c[2]) - scale * soup->lods.radius;
+	// The error in pixels grows with the scale, so the distance shrinks
+	soup->lod = meshLodSelect(&soup->lods, distance / scale,
+		P[5] * viewport[3] / 2.0f, SOUP_LOD_PIXELS);
 };
 
 /* Print data from a triangleSoup object, for debugging purposes */
@@ -442,6 +463,12 @@ void soupPrintInfo(triangleSoup soup) {
      printf("triangleSoup information:\n");
      printf("vertices : %d\n", soup.nverts);
      printf("triangles: %d\n", soup.ntris);
+     printf("format   : %s, %d bytes per vertex\n",
+         vertexFormatName(soup.format.type), soup.format.stride);
+     for(i=0; i<soup.lods.nlods; i++) {
+         printf("lod %d    : %d triangles, error %g\n",
+             i, soup.lods.lods[i].count / 3, soup.lods.lods[i].error);
+     }
      xmin = xmax = soup.vertexarray[0];
      ymin = ymax = soup.vertexarray[1];
      zmin = zmax = soup.vertexarray[2];
@@ -465,11 +492,27 @@ void soupPrintInfo(triangleSoup soup) {
      printf("zmax: %8.2f\n", zmax);
 };
 
-/* Render the geometry in a triangleSoup object */
+/*
+ * Render the geometry in a triangleSoup object.
+ * The vertex shader gets the position scale and offset of the packed
+ * formats as the uniforms PositionScale and PositionOffset, and in
+ * OctNormals 1 if the normals are octahedron encoded, or 2 if they are
+ * also in the fourth component of the position (VERTEX_PACKED12), in
+ * the program given to soupSetProgram(). Shaders that leave those out
+ * can only render VERTEX_FLOAT32.
+ */
 void soupRender(triangleSoup soup) {
-	
+
+	if(soup.locations[0] != -1) glUniform3fv(soup.locations[0], 1, soup.format.scale);
+	if(soup.locations[1] != -1) glUniform3fv(soup.locations[1], 1, soup.format.offset);
+	if(soup.locations[2] != -1) glUniform1i(soup.locations[2],
+		(soup.format.type == VERTEX_PACKED12) ? 2 : (soup.format.type == VERTEX_PACKED16));
 	glBindVertexArray(soup.vao);	
-	glDrawElements(GL_TRIANGLES, 3 * soup.ntris, GL_UNSIGNED_INT, (void*)0);
+	if(soup.lods.nlods > 0)
+		glDrawElements(GL_TRIANGLES, soup.lods.lods[soup.lod].count, GL_UNSIGNED_INT,
+			(void*)(soup.lods.lods[soup.lod].first*sizeof(GLuint)));
+	else
+		glDrawElements(GL_TRIANGLES, 3 * soup.ntris, GL_UNSIGNED_INT, (void*)0);
 	// (mode, vertex count, type, element array buffer offset)
 	glBindVertexArray(0);	
 
@@ -1,3 +1,13 @@
+#include "vertexFormat.h" // For the packed vertex buffer formats
+#include "meshSimplify.h" // For the levels of detail
+
+// Most pixels on the screen a level of detail may be off by, see soupSelectLod()
+#define SOUP_LOD_PIXELS 1.0f
+// Nonzero to have soupCreateSphere() and soupReadOBJ() reorder the triangles
+// and vertices for the GPU with meshOptimize() (meshOptimize.h), 0 to keep
+// them in the order they are made or read in
+#define SOUP_OPTIMIZE 1
+
 /* A struct to hold geometry data and send it off for rendering */
 typedef struct {
        GLuint vao;          // Vertex array object, the main handle for geometry
@@ -7,6 +17,12 @@ typedef struct {
        GLuint *indexarray;   // Element index array
        int nverts; // Number of vertices in the vertex array
        int ntris;  // Number of triangles in the index array (may be zero)
+       void *mapping; // Mapped cache file the arrays point into, or NULL
+       vertexFormat format; // Layout of the vertex buffer, see soupSetFormat()
+       meshLodChain lods; // Levels of detail, see soupBuildLods() (may be empty)
+       int lod;           // Level to render
+       int wantlods;      // Nonzero once soupBuildLods() is called
+       GLint locations[3]; // Of the uniforms for the vertex format, see soupSetProgram()
 } triangleSoup;
 
 /* Initialize a triangleSoup object to all zeros */
@@ -24,6 +40,42 @@ void soupCreateSphere(triangleSoup *soup, float radius, int segments);
 /* Load geometry from an OBJ file */
 void soupReadOBJ(triangleSoup* soup, char* filename);
 
+/*
+ * Look up the uniforms that soupRender() sets for the vertex format in
+ * the shader program that will render the geometry. Call it once after
+ * the program is linked, and again if another program is used.
+ */
+void soupSetProgram(triangleSoup *soup, GLuint program);
+
+/*
+ * Choose the layout of the vertex buffer: VERTEX_FLOAT32 (the default),
+ * VERTEX_PACKED16 or VERTEX_PACKED12 from vertexFormat.h. The vertex
+ * array stays as 8 floats per vertex. Geometry that is already there is
+ * sent to OpenGL again in the new format.
+ */
+void soupSetFormat(triangleSoup *soup, int format);
+
+/*
+ * Ask for levels of detail of the triangles, each with about half the
+ * triangles of the one before it (meshSimplify.h), sent to OpenGL all
+ * together in the index buffer. The vertices are shared by all levels.
+ * Making them takes a while, so it is put off: soupReadOBJ() keeps them
+ * in the .soup cache file (objCache.h) and reads them back next time,
+ * and other geometry gets them on the first call to soupSelectLod().
+ * Call it before soupReadOBJ() to have them cached. The choice is kept
+ * by soupDelete(), like the vertex format. soupRender() draws the full
+ * mesh until soupSelectLod() picks a level.
+ */
+void soupBuildLods(triangleSoup *soup);
+
+/*
+ * Choose the level of detail to render, from the modelview matrix MV
+ * and the perspective projection matrix P (both column major) and the
+ * current viewport: the coarsest level that is off from the full mesh
+ * by at most SOUP_LOD_PIXELS pixels on the screen.
+ */
+void soupSelectLod(triangleSoup *soup, const float *MV, const float *P);
+
 /* Print data from a triangleSoup object, for debugging purposes */
 void soupPrint(triangleSoup soup);
 
@@ -0,0 +1,539 @@
+/*
+ * vertexFormat.c - packed vertex formats. See vertexFormat.h.
+ *
+ * The SSE2 code works on four vertices at a time: their 8 floats are
+ * transposed into one vector per component, encoded side by side, and
+ * the 16-bit results are interleaved again with unpack instructions.
+ * The last nverts % 4 vertices go through a padded copy, so that the
+ * results never depend on where a vertex is in the array. The scalar
+ * code, for compilers without SSE2, does the same arithmetic one vertex
+ * at a time, but -ffast-math lets the compiler reorder it, so a stored
+ * normal may come out one step different.
+ *
+ * This code is in the public domain.
+ */
+
+#include <stdlib.h> // For malloc() and free()
+#include <string.h> // For memcpy()
+#include <math.h>   // For fabsf(), lrintf() and sqrt()
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define VERTEX_SIMD 1
+#endif
+
+#include "vertexFormat.h"
+
+static int useSimd = 1;
+
+// Largest stored values of positions and normals
+#define POSITION_MAX 32767.0f
+#define NORMAL16_MAX 32767.0f
+#define NORMAL8_MAX 127.0f
+// Constants for the half float conversions, see halfFromFloat()
+#define F32_INFINITY (255u << 23)
+#define F16_MAX ((127u + 16u) << 23)
+#define F16_DENORM_MAGIC (((127u - 15u) + (23u - 10u) + 1u) << 23)
+#define F16_NORMAL_MIN (113u << 23)
+
+int vertexSetSimd(int enable) {
+#ifdef VERTEX_SIMD
+	useSimd = enable;
+#else
+	useSimd = 0;
+#endif
+	return useSimd;
+}
+
+const char *vertexFormatName(int type) {
+	switch(type) {
+		case VERTEX_FLOAT32: return "float32";
+		case VERTEX_PACKED16: return "packed16";
+		case VERTEX_PACKED12: return "packed12";
+		default: return "unknown";
+	}
+}
+
+int vertexFormatInit(vertexFormat *format, int type, const float *vertices, int nverts) {
+	float lo[4], hi[4];
+	int i, k;
+
+	if(type == VERTEX_FLOAT32) format->stride = 8 * sizeof(float);
+	else if(type == VERTEX_PACKED16) format->stride = 16;
+	else if(type == VERTEX_PACKED12) format->stride = 12;
+	else return -1;
+	format->type = type;
+	for(k = 0; k < 3; k++) {
+		format->offset[k] = 0.0f;
+		format->scale[k] = 1.0f;
+	}
+	if(type == VERTEX_FLOAT32 || nverts <= 0) return 0;
+
+	// The bounding box, in the first three lanes
+#ifdef VERTEX_SIMD
+	{
+		__m128 vlo = _mm_loadu_ps(vertices), vhi = vlo, v;
+		for(i = 1; i < nverts; i++) {
+			v = _mm_loadu_ps(vertices + 8 * i);
+			vlo = _mm_min_ps(vlo, v);
+			vhi = _mm_max_ps(vhi, v);
+		}
+		_mm_storeu_ps(lo, vlo);
+		_mm_storeu_ps(hi, vhi);
+	}
+#else
+	for(k = 0; k < 3; k++) lo[k] = hi[k] = vertices[k];
+	for(i = 1; i < nverts; i++) {
+		for(k = 0; k < 3; k++) {
+			if(vertices[8 * i + k] < lo[k]) lo[k] = vertices[8 * i + k];
+			if(vertices[8 * i + k] > hi[k]) hi[k] = vertices[8 * i + k];
+		}
+	}
+#endif
+	for(k = 0; k < 3; k++) {
+		format->offset[k] = 0.5f * (lo[k] + hi[k]);
+		format->scale[k] = 0.5f * (hi[k] - lo[k]) / POSITION_MAX;
+		if(!(format->scale[k] > 0.0f)) format->scale[k] = 1.0f; // Flat along this axis
+	}
+	return 0;
+}
+
+/*
+ * halfFromFloat() - convert a float to a half float, rounding to nearest
+ * even, with overflow to infinity and denormals. By Fabian Giesen, from
+ * "float_to_half_fast3_rtne" (public domain).
+ */
+static unsigned int halfFromFloat(float value) {
+	unsigned int f, sign, o, odd;
+	float d;
+
+	memcpy(&f, &value, 4);
+	sign = f & 0x80000000u;
+	f ^= sign;
+	if(f >= F16_MAX) { // Too large: infinity, or NaN for NaN
+		o = (f > F32_INFINITY) ? 0x7e00 : 0x7c00;
+	}
+	else if(f < F16_NORMAL_MIN) { // Denormal or zero: let the FPU round it
+		o = F16_DENORM_MAGIC;
+		memcpy(&d, &f, 4);
+		memcpy(&value, &o, 4);
+		d += value;
+		memcpy(&o, &d, 4);
+		o -= F16_DENORM_MAGIC;
+	}
+	else {
+		odd = (f >> 13) & 1;
+		f += ((15u - 127u) << 23) + 0xfff + odd;
+		o = f >> 13;
+	}
+	return o | (sign >> 16);
+}
+
+/* floatFromHalf() - convert the low 16 bits of h from a half float */
+static float floatFromHalf(unsigned int h) {
+	unsigned int o = (h & 0x7fff) << 13, exponent = o & (0x7c00 << 13), magic = F16_NORMAL_MIN;
+	float value, m;
+
+	o += (127u - 15u) << 23;
+	if(exponent == (0x7c00 << 13)) { // Infinity or NaN
+		o += (128u - 16u) << 23;
+	}
+	else if(exponent == 0) { // Denormal or zero
+		o += 1u << 23;
+		memcpy(&value, &o, 4);
+		memcpy(&m, &magic, 4);
+		value -= m;
+		memcpy(&o, &value, 4);
+	}
+	o |= (h & 0x8000) << 16;
+	memcpy(&value, &o, 4);
+	return value;
+}
+
+/* +1.0 or -1.0, by the sign bit of a */
+static float signOne(float a) {
+	unsigned int u;
+	memcpy(&u, &a, 4);
+	u = (u & 0x80000000u) | 0x3f800000u;
+	memcpy(&a, &u, 4);
+	return a;
+}
+
+/* The octahedron encoding of a normal, in [-1,1] squared */
+static void octEncode(const float *n, float *x, float *y) {
+	float s = (fabsf(n[0]) + fabsf(n[1])) + fabsf(n[2]), fx, fy;
+
+	s = (s > 1e-30f) ? s : 1e-30f;
+	*x = n[0] / s;
+	*y = n[1] / s;
+	if(n[2] < 0.0f) { // Fold the lower half out over the corners
+		fx = (1.0f - fabsf(*y)) * signOne(*x);
+		fy = (1.0f - fabsf(*x)) * signOne(*y);
+		*x = fx;
+		*y = fy;
+	}
+}
+
+/* The unit normal for an octahedron encoding */
+static void octDecode(float x, float y, float *n) {
+	float z = (1.0f - fabsf(x)) - fabsf(y), fx, fy, inv;
+
+	if(z < 0.0f) {
+		fx = (1.0f - fabsf(y)) * signOne(x);
+		fy = (1.0f - fabsf(x)) * signOne(y);
+		x = fx;
+		y = fy;
+	}
+	inv = 1.0f / sqrtf(x * x + y * y + z * z);
+	n[0] = x * inv;
+	n[1] = y * inv;
+	n[2] = z * inv;
+}
+
+static void encodeScalar(unsigned char *dst, const float *v, const vertexFormat *format,
+	const float *inv) {
+	short p[6];
+	float x, y;
+	int k;
+
+	for(k = 0; k < 3; k++) p[k] = (short)lrintf((v[k] - format->offset[k]) * inv[k]);
+	octEncode(v + 3, &x, &y);
+	if(format->type == VERTEX_PACKED16) {
+		p[3] = 0;
+		memcpy(dst, p, 8);
+		p[4] = (short)lrintf(x * NORMAL16_MAX);
+		p[5] = (short)lrintf(y * NORMAL16_MAX);
+		memcpy(dst + 8, p + 4, 4);
+	}
+	else {
+		memcpy(dst, p, 6);
+		dst[6] = (unsigned char)(signed char)lrintf(x * NORMAL8_MAX);
+		dst[7] = (unsigned char)(signed char)lrintf(y * NORMAL8_MAX);
+	}
+	p[0] = (short)halfFromFloat(v[6]);
+	p[1] = (short)halfFromFloat(v[7]);
+	memcpy(dst + format->stride - 4, p, 4);
+}
+
+static void decodeScalar(float *v, const unsigned char *src, const vertexFormat *format) {
+	short p[4];
+	unsigned short h[2];
+	float x, y;
+	int k;
+
+	memcpy(p, src, 6);
+	for(k = 0; k < 3; k++) v[k] = format->offset[k] + format->scale[k] * (float)p[k];
+	if(format->type == VERTEX_PACKED16) {
+		memcpy(p, src + 8, 4);
+		x = (float)p[0] * (1.0f / NORMAL16_MAX);
+		y = (float)p[1] * (1.0f / NORMAL16_MAX);
+	}
+	else {
+		x = (float)(signed char)src[6] * (1.0f / NORMAL8_MAX);
+		y = (float)(signed char)src[7] * (1.0f / NORMAL8_MAX);
+	}
+	x = (x > -1.0f) ? x : -1.0f; // -32768 and -128 are -1 too
+	y = (y > -1.0f) ? y : -1.0f;
+	octDecode(x, y, v + 3);
+	memcpy(h, src + format->stride - 4, 4);
+	v[6] = floatFromHalf(h[0]);
+	v[7] = floatFromHalf(h[1]);
+}
+
+#ifdef VERTEX_SIMD
+
+static __m128 absPs(__m128 a) {
+	return _mm_and_ps(a, _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff)));
+}
+
+static __m128 signOnePs(__m128 a) {
+	return _mm_or_ps(_mm_and_ps(a, _mm_castsi128_ps(_mm_set1_epi32(0x80000000))),
+		_mm_set1_ps(1.0f));
+}
+
+/* select(mask, a, b): a where mask is set, else b */
+static __m128 selectPs(__m128 mask, __m128 a, __m128 b) {
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+static __m128i selectEpi32(__m128i mask, __m128i a, __m128i b) {
+	return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+/* halfFromFloat() for four floats, giving the halves in 32-bit lanes */
+static __m128i halfFromFloat4(__m128 value) {
+	__m128i f = _mm_castps_si128(value), sign, big, denorm, normal, odd, o;
+
+	sign = _mm_and_si128(f, _mm_set1_epi32(0x80000000));
+	f = _mm_xor_si128(f, sign);
+	big = _mm_or_si128(_mm_set1_epi32(0x7c00),
+		_mm_and_si128(_mm_cmpgt_epi32(f, _mm_set1_epi32(F32_INFINITY)), _mm_set1_epi32(0x0200)));
+	denorm = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(_mm_castsi128_ps(f),
+		_mm_castsi128_ps(_mm_set1_epi32(F16_DENORM_MAGIC)))), _mm_set1_epi32(F16_DENORM_MAGIC));
+	odd = _mm_and_si128(_mm_srli_epi32(f, 13), _mm_set1_epi32(1));
+	normal = _mm_add_epi32(f, _mm_set1_epi32(((15u - 127u) << 23) + 0xfff));
+	normal = _mm_srli_epi32(_mm_add_epi32(normal, odd), 13);
+	o = selectEpi32(_mm_cmpgt_epi32(_mm_set1_epi32(F16_NORMAL_MIN), f), denorm, normal);
+	o = selectEpi32(_mm_cmpgt_epi32(_mm_set1_epi32(F16_MAX), f), o, big);
+	return _mm_or_si128(o, _mm_srli_epi32(sign, 16));
+}
+
+/* floatFromHalf() for the low 16 bits of four 32-bit lanes */
+static __m128 floatFromHalf4(__m128i h) {
+	__m128i o, exponent, special, zero, denorm;
+
+	o = _mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(0x7fff)), 13);
+	exponent = _mm_and_si128(o, _mm_set1_epi32(0x7c00 << 13));
+	o = _mm_add_epi32(o, _mm_set1_epi32((127u - 15u) << 23));
+	special = _mm_cmpeq_epi32(exponent, _mm_set1_epi32(0x7c00 << 13));
+	zero = _mm_cmpeq_epi32(exponent, _mm_setzero_si128());
+	o = _mm_add_epi32(o, _mm_and_si128(special, _mm_set1_epi32((128u - 16u) << 23)));
+	denorm = _mm_castps_si128(_mm_sub_ps(
+		_mm_castsi128_ps(_mm_add_epi32(o, _mm_set1_epi32(1 << 23))),
+		_mm_castsi128_ps(_mm_set1_epi32(F16_NORMAL_MIN))));
+	o = selectEpi32(zero, denorm, o);
+	o = _mm_or_si128(o, _mm_slli_epi32(_mm_and_si128(h, _mm_set1_epi32(0x8000)), 16));
+	return _mm_castsi128_ps(o);
+}
+
+/* Sign extend the low 16 bits of each 32-bit lane */
+static __m128i extend16(__m128i a) {
+	return _mm_srai_epi32(_mm_slli_epi32(a, 16), 16);
+}
+
+static void encode4(unsigned char *dst, const float *src, const vertexFormat *format,
+	const float *inv) {
+	__m128 a0, a1, a2, a3, b0, b1, b2, b3, s, x, y, fx, fy, neg, q;
+	__m128i px, py, pz, ox, oy, hs, ht, w, A, B, C, D, lo, hi, p01, p23, n01, n23, v;
+	int i, k;
+
+	a0 = _mm_loadu_ps(src); b0 = _mm_loadu_ps(src + 4);
+	a1 = _mm_loadu_ps(src + 8); b1 = _mm_loadu_ps(src + 12);
+	a2 = _mm_loadu_ps(src + 16); b2 = _mm_loadu_ps(src + 20);
+	a3 = _mm_loadu_ps(src + 24); b3 = _mm_loadu_ps(src + 28);
+	_MM_TRANSPOSE4_PS(a0, a1, a2, a3); // x y z nx
+	_MM_TRANSPOSE4_PS(b0, b1, b2, b3); // ny nz s t
+
+	px = _mm_cvtps_epi32(_mm_mul_ps(_mm_sub_ps(a0, _mm_set1_ps(format->offset[0])), _mm_set1_ps(inv[0])));
+	py = _mm_cvtps_epi32(_mm_mul_ps(_mm_sub_ps(a1, _mm_set1_ps(format->offset[1])), _mm_set1_ps(inv[1])));
+	pz = _mm_cvtps_epi32(_mm_mul_ps(_mm_sub_ps(a2, _mm_set1_ps(format->offset[2])), _mm_set1_ps(inv[2])));
+
+	s = _mm_add_ps(_mm_add_ps(absPs(a3), absPs(b0)), absPs(b1));
+	s = _mm_max_ps(s, _mm_set1_ps(1e-30f));
+	x = _mm_div_ps(a3, s);
+	y = _mm_div_ps(b0, s);
+	fx = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(1.0f), absPs(y)), signOnePs(x));
+	fy = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(1.0f), absPs(x)), signOnePs(y));
+	neg = _mm_cmplt_ps(b1, _mm_setzero_ps());
+	x = selectPs(neg, fx, x);
+	y = selectPs(neg, fy, y);
+	q = _mm_set1_ps(format->type == VERTEX_PACKED16 ? NORMAL16_MAX : NORMAL8_MAX);
+	ox = _mm_cvtps_epi32(_mm_mul_ps(x, q));
+	oy = _mm_cvtps_epi32(_mm_mul_ps(y, q));
+
+	// Sign extended, so that the saturating packs below keep all bits
+	hs = extend16(halfFromFloat4(b2));
+	ht = extend16(halfFromFloat4(b3));
+
+	// Four vectors of 8 x 16 bits, of which each vertex gets one lane
+	A = _mm_packs_epi32(px, py);
+	if(format->type == VERTEX_PACKED16) { // x y z 0 ox oy s t
+		B = _mm_packs_epi32(pz, _mm_setzero_si128());
+		C = _mm_packs_epi32(ox, oy);
+		D = _mm_packs_epi32(hs, ht);
+	}
+	else { // x y z (ox oy) s t
+		w = _mm_or_si128(_mm_and_si128(ox, _mm_set1_epi32(0xff)), _mm_slli_epi32(oy, 8));
+		B = _mm_packs_epi32(pz, w);
+		C = _mm_packs_epi32(hs, ht);
+		D = _mm_setzero_si128();
+	}
+	lo = _mm_unpacklo_epi16(A, B);
+	hi = _mm_unpackhi_epi16(A, B);
+	p01 = _mm_unpacklo_epi16(lo, hi);
+	p23 = _mm_unpackhi_epi16(lo, hi);
+	lo = _mm_unpacklo_epi16(C, D);
+	hi = _mm_unpackhi_epi16(C, D);
+	n01 = _mm_unpacklo_epi16(lo, hi);
+	n23 = _mm_unpackhi_epi16(lo, hi);
+
+	for(i = 0; i < 4; i++) {
+		v = (i & 1) ? _mm_unpackhi_epi64(i < 2 ? p01 : p23, i < 2 ? n01 : n23)
+			: _mm_unpacklo_epi64(i < 2 ? p01 : p23, i < 2 ? n01 : n23);
+		if(format->type == VERTEX_PACKED16) {
+			_mm_storeu_si128((__m128i*)(dst + 16 * i), v);
+		}
+		else {
+			_mm_storel_epi64((__m128i*)(dst + 12 * i), v);
+			k = _mm_cvtsi128_si32(_mm_srli_si128(v, 8));
+			memcpy(dst + 12 * i + 8, &k, 4);
+		}
+	}
+}
+
+static void decode4(float *dst, const unsigned char *src, const vertexFormat *format) {
+	__m128i v[4], t0, t1, t2, t3, u0, u1, u2, u3, w;
+	__m128 x, y, z, fx, fy, nx, ny, nz, s, t, px, py, pz, len, q, neg;
+	int i, k;
+
+	for(i = 0; i < 4; i++) {
+		if(format->type == VERTEX_PACKED16) {
+			v[i] = _mm_loadu_si128((const __m128i*)(src + 16 * i));
+		}
+		else {
+			memcpy(&k, src + 12 * i + 8, 4);
+			v[i] = _mm_unpacklo_epi64(_mm_loadl_epi64((const __m128i*)(src + 12 * i)),
+				_mm_cvtsi32_si128(k));
+		}
+	}
+	// Transpose to one vector of four 32-bit lanes per 16-bit field
+	t0 = _mm_unpacklo_epi16(v[0], v[1]);
+	t1 = _mm_unpackhi_epi16(v[0], v[1]);
+	t2 = _mm_unpacklo_epi16(v[2], v[3]);
+	t3 = _mm_unpackhi_epi16(v[2], v[3]);
+	u0 = _mm_unpacklo_epi32(t0, t2); // x, y
+	u1 = _mm_unpackhi_epi32(t0, t2); // z, w
+	u2 = _mm_unpacklo_epi32(t1, t3); // ox, oy or s, t
+	u3 = _mm_unpackhi_epi32(t1, t3); // s, t or nothing
+
+	px = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(u0, u0), 16));
+	py = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(u0, u0), 16));
+	pz = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(u1, u1), 16));
+	px = _mm_add_ps(_mm_set1_ps(format->offset[0]), _mm_mul_ps(_mm_set1_ps(format->scale[0]), px));
+	py = _mm_add_ps(_mm_set1_ps(format->offset[1]), _mm_mul_ps(_mm_set1_ps(format->scale[1]), py));
+	pz = _mm_add_ps(_mm_set1_ps(format->offset[2]), _mm_mul_ps(_mm_set1_ps(format->scale[2]), pz));
+
+	if(format->type == VERTEX_PACKED16) {
+		x = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(u2, u2), 16));
+		y = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(u2, u2), 16));
+		q = _mm_set1_ps(1.0f / NORMAL16_MAX);
+		s = floatFromHalf4(_mm_unpacklo_epi16(u3, u3));
+		t = floatFromHalf4(_mm_unpackhi_epi16(u3, u3));
+	}
+	else {
+		w = _mm_unpackhi_epi16(u1, u1); // The two bytes in the high 16 bits
+		x = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(w, 8), 24));
+		y = _mm_cvtepi32_ps(_mm_srai_epi32(w, 24));
+		q = _mm_set1_ps(1.0f / NORMAL8_MAX);
+		s = floatFromHalf4(_mm_unpacklo_epi16(u2, u2));
+		t = floatFromHalf4(_mm_unpackhi_epi16(u2, u2));
+	}
+	x = _mm_max_ps(_mm_mul_ps(x, q), _mm_set1_ps(-1.0f));
+	y = _mm_max_ps(_mm_mul_ps(y, q), _mm_set1_ps(-1.0f));
+	z = _mm_sub_ps(_mm_sub_ps(_mm_set1_ps(1.0f), absPs(x)), absPs(y));
+	fx = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(1.0f), absPs(y)), signOnePs(x));
+	fy = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(1.0f), absPs(x)), signOnePs(y));
+	neg = _mm_cmplt_ps(z, _mm_setzero_ps());
+	x = selectPs(neg, fx, x);
+	y = selectPs(neg, fy, y);
+	len = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+	len = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(len));
+	nx = _mm_mul_ps(x, len);
+	ny = _mm_mul_ps(y, len);
+	nz = _mm_mul_ps(z, len);
+
+	_MM_TRANSPOSE4_PS(px, py, pz, nx);
+	_MM_TRANSPOSE4_PS(ny, nz, s, t);
+	_mm_storeu_ps(dst, px); _mm_storeu_ps(dst + 4, ny);
+	_mm_storeu_ps(dst + 8, py); _mm_storeu_ps(dst + 12, nz);
+	_mm_storeu_ps(dst + 16, pz); _mm_storeu_ps(dst + 20, s);
+	_mm_storeu_ps(dst + 24, nx); _mm_storeu_ps(dst + 28, t);
+}
+
+#endif /* VERTEX_SIMD */
+
+void vertexEncode(void *dst, const float *src, int nverts, const vertexFormat *format) {
+	unsigned char *out = (unsigned char*)dst;
+	float inv[3];
+	int i = 0, k;
+
+	if(format->type == VERTEX_FLOAT32) {
+		memcpy(dst, src, (size_t)nverts * 8 * sizeof(float));
+		return;
+	}
+	for(k = 0; k < 3; k++) inv[k] = 1.0f / format->scale[k];
+#ifdef VERTEX_SIMD
+	if(useSimd) {
+		for(; i + 4 <= nverts; i += 4) {
+			encode4(out + (size_t)i * format->stride, src + 8 * (size_t)i, format, inv);
+		}
+		if(i < nverts) { // The last few, through a padded copy
+			float last[32] = {0};
+			unsigned char packed[64];
+			memcpy(last, src + 8 * (size_t)i, (nverts - i) * 8 * sizeof(float));
+			encode4(packed, last, format, inv);
+			memcpy(out + (size_t)i * format->stride, packed, (nverts - i) * format->stride);
+			return;
+		}
+	}
+#endif
+	for(; i < nverts; i++) {
+		encodeScalar(out + (size_t)i * format->stride, src + 8 * (size_t)i, format, inv);
+	}
+}
+
+void vertexDecode(float *dst, const void *src, int nverts, const vertexFormat *format) {
+	const unsigned char *in = (const unsigned char*)src;
+	int i = 0;
+
+	if(format->type == VERTEX_FLOAT32) {
+		memcpy(dst, src, (size_t)nverts * 8 * sizeof(float));
+		return;
+	}
+#ifdef VERTEX_SIMD
+	if(useSimd) {
+		for(; i + 4 <= nverts; i += 4) {
+			decode4(dst + 8 * (size_t)i, in + (size_t)i * format->stride, format);
+		}
+		if(i < nverts) {
+			unsigned char packed[64] = {0};
+			float last[32];
+			memcpy(packed, in + (size_t)i * format->stride, (nverts - i) * format->stride);
+			decode4(last, packed, format);
+			memcpy(dst + 8 * (size_t)i, last, (nverts - i) * 8 * sizeof(float));
+			return;
+		}
+	}
+#endif
+	for(; i < nverts; i++) {
+		decodeScalar(dst + 8 * (size_t)i, in + (size_t)i * format->stride, format);
+	}
+}
+
+int vertexFormatError(const float *vertices, const void *packed, int nverts,
+	const vertexFormat *format, vertexError *error) {
+	float *decoded;
+	const float *a, *b;
+	double d, sum = 0.0, angle, anglesum = 0.0, len, dot;
+	int i, k, nnormals = 0;
+
+	error->positionmax = error->positionrms = 0.0f;
+	error->normalmax = error->normalmean = 0.0f;
+	error->texcoordmax = 0.0f;
+	if(nverts <= 0) return 0;
+	decoded = (float*)malloc((size_t)nverts * 8 * sizeof(float));
+	if(decoded == NULL) return -1;
+	vertexDecode(decoded, packed, nverts, format);
+	for(i = 0; i < nverts; i++) {
+		a = vertices + 8 * (size_t)i;
+		b = decoded + 8 * (size_t)i;
+		d = (b[0] - a[0]) * (b[0] - a[0]) + (b[1] - a[1]) * (b[1] - a[1]) + (b[2] - a[2]) * (b[2] - a[2]);
+		sum += d;
+		if(sqrt(d) > error->positionmax) error->positionmax = (float)sqrt(d);
+		len = sqrt(a[3] * a[3] + a[4] * a[4] + a[5] * a[5]);
+		if(len > 0.0) {
+			dot = (a[3] * b[3] + a[4] * b[4] + a[5] * b[5]) / len;
+			angle = acos(dot > 1.0 ? 1.0 : (dot < -1.0 ? -1.0 : dot)) * (180.0 / M_PI);
+			anglesum += angle;
+			nnormals++;
+			if(angle > error->normalmax) error->normalmax = (float)angle;
+		}
+		for(k = 6; k < 8; k++) {
+			if(fabsf(b[k] - a[k]) > error->texcoordmax) error->texcoordmax = fabsf(b[k] - a[k]);
+		}
+	}
+	error->positionrms = (float)sqrt(sum / nverts);
+	if(nnormals > 0) error->normalmean = (float)(anglesum / nnormals);
+	free(decoded);
+	return 0;
+}
@@ -0,0 +1,88 @@
+/*
+ * vertexFormat.h - packed vertex formats for triangleSoup, to save memory
+ * and bandwidth over the 8 floats (32 bytes) per vertex of vertexarray.
+ * Without OpenGL dependencies: the GL attribute setup for each format is
+ * done by soupSetFormat() in triangleSoup.c.
+ *
+ * The positions are stored as 16-bit integers relative to the bounding
+ * box of the mesh, with offset and scale per axis to be applied in the
+ * vertex shader. The normals are octahedron encoded (Meyer et al., "On
+ * Floating-Point Normal Vectors", EGSR 2010): the unit sphere is mapped
+ * onto the octahedron |x|+|y|+|z| = 1, and the lower half is folded out
+ * over the corners of the upper half to make a square, so two signed
+ * normalized integers are enough. The texture coordinates are stored as
+ * half floats, which keeps them exact for small images and still allows
+ * values outside [0,1] for repeating textures.
+ *
+ * VERTEX_PACKED16, 16 bytes per vertex:
+ *   0: x y z (GL_SHORT, not normalized), 6: unused
+ *   8: normal (2 x GL_SHORT, normalized, octahedron)
+ *  12: s t (2 x GL_HALF_FLOAT)
+ * VERTEX_PACKED12, 12 bytes per vertex:
+ *   0: x y z (GL_SHORT, not normalized)
+ *   6: normal (2 signed bytes, octahedron, 127 for 1)
+ *   8: s t (2 x GL_HALF_FLOAT)
+ * OpenGL reads the first 8 bytes of VERTEX_PACKED12 as 4 x GL_SHORT, so
+ * that every attribute is 4 byte aligned, and the vertex shader splits
+ * the fourth into the two bytes of the normal.
+ *
+ * The encoding and decoding run four vertices at a time with SSE2 where
+ * the compiler has it (always on x86-64), and in scalar code otherwise.
+ *
+ * This code is in the public domain.
+ */
+
+#ifndef VERTEXFORMAT_H
+#define VERTEXFORMAT_H
+
+/* Vertex formats */
+#define VERTEX_FLOAT32 0  // 8 floats, the layout of vertexarray (32 bytes)
+#define VERTEX_PACKED16 1 // See above (16 bytes)
+#define VERTEX_PACKED12 2 // See above (12 bytes)
+
+typedef struct {
+	int type;        // One of the formats above
+	int stride;      // Bytes per vertex
+	float offset[3]; // A stored position p means offset + scale * p
+	float scale[3];  // (0 and 1 for VERTEX_FLOAT32)
+} vertexFormat;
+
+/* Differences between decoded vertices and the float source */
+typedef struct {
+	float positionmax, positionrms; // In the units of the mesh
+	float normalmax, normalmean;    // Angles in degrees, for nonzero source normals
+	float texcoordmax;              // Largest error in s or t
+} vertexError;
+
+/*
+ * vertexFormatInit() - set up format for a type and for the bounds of
+ * nverts vertices of 8 floats. Returns 0, or -1 for an unknown type.
+ */
+int vertexFormatInit(vertexFormat *format, int type, const float *vertices, int nverts);
+
+/* vertexFormatName() - a printable name for a format type */
+const char *vertexFormatName(int type);
+
+/*
+ * vertexEncode() - pack nverts vertices of 8 floats into dst, which has
+ * room for nverts * format->stride bytes
+ */
+void vertexEncode(void *dst, const float *src, int nverts, const vertexFormat *format);
+
+/* vertexDecode() - unpack nverts vertices from src into 8 floats each */
+void vertexDecode(float *dst, const void *src, int nverts, const vertexFormat *format);
+
+/*
+ * vertexFormatError() - compare packed vertices with the vertices they
+ * were packed from. Returns 0, or -1 if out of memory.
+ */
+int vertexFormatError(const float *vertices, const void *packed, int nverts,
+	const vertexFormat *format, vertexError *error);
+
+/*
+ * vertexSetSimd() - use the SSE2 code (1, the default) or the scalar code
+ * (0), e.g. for benchmarks. Returns whether SSE2 is used from now on.
+ */
+int vertexSetSimd(int enable);
+
+#endif /* VERTEXFORMAT_H */
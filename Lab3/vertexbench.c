@@ -0,0 +1,116 @@
+/*
+ * vertexbench.c - test and time the packed vertex formats of
+ * vertexFormat.c on OBJ meshes, without OpenGL.
+ *
+ * For each mesh and packed format, this prints the size, the error
+ * against the float vertices, and the speed of encoding and decoding in
+ * millions of vertices per second with the scalar and the SSE2 code.
+ * It also counts the vertices that the two pack differently (they may
+ * differ by one step in a normal, see vertexFormat.c), and reports the
+ * largest difference between their decoded floats.
+ *
+ * Usage: vertexbench [file.obj ...]
+ * With no files, the meshes in meshes/ are used.
+ *
+ * This code is in the public domain.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "bench.h"
+#include "objLoader.h"
+#include "vertexFormat.h"
+
+static const char *defaultFiles[] = { BENCH_MESHES };
+
+// Least number of vertices to encode or decode for each timing
+#define BENCH_VERTICES 4000000
+
+/* Millions of vertices per second for encoding (0) or decoding (1) */
+static double speed(int decode, float *vertices, unsigned char *packed, int nverts,
+	const vertexFormat *format) {
+	int reps = BENCH_VERTICES / nverts + 1, r;
+	double t = seconds();
+
+	for(r = 0; r < reps; r++) {
+		if(decode) vertexDecode(vertices, packed, nverts, format);
+		else vertexEncode(packed, vertices, nverts, format);
+	}
+	t = seconds() - t;
+	return (double)reps * nverts / t * 1e-6;
+}
+
+int main(int argc, char *argv[]) {
+	static const int types[] = {VERTEX_PACKED16, VERTEX_PACKED12};
+	const char **files = defaultFiles;
+	int nfiles = sizeof(defaultFiles) / sizeof(defaultFiles[0]);
+	int f, j, i, differ, simd;
+	unsigned char *packed, *packedscalar;
+	float *decoded, *decodedscalar, diff;
+	double enc[2], dec[2];
+	vertexFormat format;
+	vertexError error;
+	objMesh mesh;
+
+	if(argc > 1) {
+		files = (const char**)&argv[1];
+		nfiles = argc - 1;
+	}
+	simd = vertexSetSimd(1);
+	printf("SSE2 code %s.\n", simd ? "available" : "not available, scalar only");
+	for(f = 0; f < nfiles; f++) {
+		if(objLoadThreaded(&mesh, files[f], NULL, OBJ_WELD) != 0 || mesh.nverts == 0) {
+			printf("%s could not be read\n", files[f]);
+			continue;
+		}
+		printf("\n%s: %d vertices, %d KB as floats\n", files[f], mesh.nverts,
+			(int)(mesh.nverts * 8 * sizeof(float) / 1024));
+		packed = (unsigned char*)malloc((size_t)mesh.nverts * 16);
+		packedscalar = (unsigned char*)malloc((size_t)mesh.nverts * 16);
+		decoded = (float*)malloc((size_t)mesh.nverts * 8 * sizeof(float));
+		decodedscalar = (float*)malloc((size_t)mesh.nverts * 8 * sizeof(float));
+		if(packed == NULL || packedscalar == NULL || decoded == NULL || decodedscalar == NULL) {
+			printf("out of memory\n");
+			free(packed); free(packedscalar); free(decoded); free(decodedscalar);
+			objFree(&mesh);
+			continue;
+		}
+		for(j = 0; j < 2; j++) {
+			vertexFormatInit(&format, types[j], mesh.vertexarray, mesh.nverts);
+
+			vertexSetSimd(0);
+			vertexEncode(packedscalar, mesh.vertexarray, mesh.nverts, &format);
+			vertexDecode(decodedscalar, packedscalar, mesh.nverts, &format);
+			enc[0] = speed(0, mesh.vertexarray, packedscalar, mesh.nverts, &format);
+			dec[0] = speed(1, decoded, packedscalar, mesh.nverts, &format);
+			vertexSetSimd(1);
+			vertexEncode(packed, mesh.vertexarray, mesh.nverts, &format);
+			vertexDecode(decoded, packed, mesh.nverts, &format);
+			enc[1] = speed(0, mesh.vertexarray, packed, mesh.nverts, &format);
+			dec[1] = speed(1, decoded, packed, mesh.nverts, &format);
+
+			differ = 0;
+			for(i = 0; i < mesh.nverts; i++) {
+				differ += memcmp(packed + i * format.stride, packedscalar + i * format.stride, format.stride) != 0;
+			}
+			vertexDecode(decoded, packed, mesh.nverts, &format);
+			diff = 0.0f;
+			for(i = 0; i < 8 * mesh.nverts; i++) {
+				if(fabsf(decoded[i] - decodedscalar[i]) > diff) diff = fabsf(decoded[i] - decodedscalar[i]);
+			}
+			vertexFormatError(mesh.vertexarray, packed, mesh.nverts, &format, &error);
+
+			printf("  %-8s %2d bytes, %6d KB: position %.2g max %.2g rms, normal %.3f max %.3f mean degrees, texcoord %.2g max\n",
+				vertexFormatName(types[j]), format.stride, (int)((size_t)mesh.nverts * format.stride / 1024),
+				error.positionmax, error.positionrms, error.normalmax, error.normalmean, error.texcoordmax);
+			printf("  %-8s encode %7.1f scalar %7.1f SSE2, decode %7.1f scalar %7.1f SSE2 Mverts/s, %d differ, decode diff %g\n",
+				"", enc[0], enc[1], dec[0], dec[1], differ, diff);
+		}
+		free(packed); free(packedscalar); free(decoded); free(decodedscalar);
+		objFree(&mesh);
+	}
+	return 0;
+}
@@ -71,10 +71,15 @@ float snoise(vec2 v)
   return 130.0 * dot(m, g);
 }
 
-layout(location = 0) in vec3 Position;
+layout(location = 0) in vec4 Position; // w is the normal for OctNormals 2
 layout(location = 1) in vec3 Normal;
 layout(location = 2) in vec2 TexCoord;
 
+// For the packed vertex formats of triangleSoup (vertexFormat.h)
+uniform vec3 PositionScale;
+uniform vec3 PositionOffset;
+uniform int OctNormals; // 0 for float normals, 1 octahedron, 2 octahedron in Position.w
+
 uniform mat4 MV;
 uniform mat4 P;
 uniform float time;
@@ -84,11 +89,29 @@ out vec3 interpolatedNormal;
 out vec2 st;
 out vec3 xyz;
 
+// The unit normal for an octahedron encoded one, as in vertexFormat.c
+vec3 octDecode(vec2 e) {
+  vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+  if(n.z < 0.0) n.xy = (1.0 - abs(n.yx)) * vec2(e.x >= 0.0 ? 1.0 : -1.0, e.y >= 0.0 ? 1.0 : -1.0);
+  return normalize(n);
+}
+
+// The two signed bytes of an octahedron normal, read as one short
+vec3 octDecodeBytes(float packed) {
+  int n = int(packed);
+  int x = n & 255;
+  vec2 e = vec2((x < 128) ? x : x - 256, n >> 8) / 127.0;
+  return octDecode(max(e, -1.0)); // -128 is -1 too
+}
+
 void main(){
+  vec3 position = PositionOffset + PositionScale * Position.xyz;
+  vec3 normal = (OctNormals == 2) ? octDecodeBytes(Position.w)
+    : (OctNormals == 1) ? octDecode(Normal.xy) : Normal;
 // get heightmap from the texture. make mountains
-  vec3 pos = Position + 7.0*0.01*Normal*texture(tex,TexCoord).a;//*snoise(1 .0*time*1.0*Position.xy);//*sin(10.0*time+10.0*Position.y);
+  vec3 pos = position + 7.0*0.01*normal*texture(tex,TexCoord).a;//*snoise(1 .0*time*1.0*Position.xy);//*sin(10.0*time+10.0*Position.y);
   gl_Position = (P * MV) * vec4(pos, 1.0);
-  interpolatedNormal = mat3(MV) * Normal;
+  interpolatedNormal = mat3(MV) * normal;
   st = TexCoord;
   xyz = pos;
 }